@@ -3,6 +3,7 @@ Batch Processing Router for AI Service
 Handles batch operations for improved performance
 """
 
+import asyncio
 from typing import List, Dict, Any, Optional
 from fastapi import APIRouter, HTTPException, status
 from pydantic import BaseModel, Field
@@ -14,6 +15,7 @@ sys.path.insert(0, str(Path(__file__).parent.parent.parent))
 
 from ai_service.utils.decorators import handle_errors, retry_on_error
 from ai_service.database import postgres_db
+from ai_service.routers.chat_command import ChatCommandRequest, handle_chat_command
 
 
 router = APIRouter(prefix="/api/batch", tags=["batch"])
@@ -138,9 +140,12 @@ async def batch_player_interactions(
 ) -> BatchPlayerInteractionResponse:
     """
     Process multiple player interactions in a single batch
-    
-    This endpoint handles multiple player-NPC interactions efficiently,
-    useful for processing queued interactions or bulk operations.
+
+    Every interaction is a /ai/chat/command request. The results are in the
+    same order and shaped like its responses (success, npc_response, emotion,
+    error), so callers can answer the successful entries and retry only the
+    failed ones. The interactions run concurrently, a batch takes about as long
+    as its slowest interaction.
     """
     logger.info(f"Processing batch of {len(request.interactions)} player interactions")
     
@@ -148,26 +153,32 @@ async def batch_player_interactions(
     failed = 0
     results = []
     
+    async def process_interaction(interaction: Dict[str, Any]):
+        return await handle_chat_command(ChatCommandRequest(**interaction))
+
     try:
-        for interaction in request.interactions:
-            try:
-                # Process interaction
-                # This is a placeholder - actual implementation would call the interaction handler
-                logger.debug(f"Processing interaction: {interaction}")
-                processed += 1
-                results.append({
-                    "success": True,
-                    "interaction": interaction
-                })
-                
-            except Exception as e:
-                logger.error(f"Failed to process interaction: {e}")
+        outcomes = await asyncio.gather(
+            *(process_interaction(interaction) for interaction in request.interactions),
+            return_exceptions=True
+        )
+
+        for outcome in outcomes:
+            if isinstance(outcome, BaseException):
+                detail = outcome.detail if isinstance(outcome, HTTPException) else str(outcome)
+                logger.error(f"Failed to process interaction: {detail}")
                 failed += 1
                 results.append({
                     "success": False,
-                    "interaction": interaction,
-                    "error": str(e)
+                    "error": detail
                 })
+                continue
+
+            results.append(outcome.dict())
+
+            if outcome.success:
+                processed += 1
+            else:
+                failed += 1
         
         logger.info(f"Batch interaction complete: {processed} processed, {failed} failed")
         
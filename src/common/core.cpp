@@ -14,6 +14,7 @@
 #include "socket.hpp"
 #include "timer.hpp"
 #include "sql.hpp"
+#include "watchdog.hpp"
 #endif
 
 #ifndef _WIN32
@@ -386,9 +387,13 @@ int32 Core::start( int32 argc, char **argv ){
 		if( !this->m_run_once ){
 			// Main runtime cycle
 			while( this->get_status() == e_core_status::RUNNING ){
+				watchdog_tick_begin();
+
 				t_tick next = do_timer( gettick_nocache() );
 
+				watchdog_timers_end();
 				this->handle_main( next );
+				watchdog_tick_end();
 			}
 		}
 #endif
@@ -401,6 +406,7 @@ int32 Core::start( int32 argc, char **argv ){
 
 	this->set_status( e_core_status::CORE_FINALIZING );
 #ifndef MINICORE
+	watchdog_final();
 	timer_final();
 	socket_final();
 	db_final();
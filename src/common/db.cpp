@@ -10,6 +10,8 @@
  *  (5) Public functions
  *
  *  The databases are structured as a hashtable of RED-BLACK trees.
+ *  Databases with integer keys use an open addressing hashtable instead,
+ *  see DB_ENABLE_OPEN_ADDRESSING.
  *
  *  <B>Properties of the RED-BLACK trees being used:</B>
  *  1. The value of any node is greater than the value of its left child and
@@ -47,6 +49,7 @@
  *  - create a db that organizes itself by splaying
  *
  *  HISTORY:
+ *    2026/10/16 - Added open addressing for integer keyed databases
  *    2013/08/25 - Added int64/uint64 support for keys [Ind/Hercules]
  *    2013/04/27 - Added ERS to speed up iterator memory allocation [Ind/Hercules]
  *    2012/03/09 - Added enum for data types (int32, uint32, void*)
@@ -70,12 +73,14 @@
 
 #include "db.hpp"
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 
 #include "cbasetypes.hpp"
 #include "ers.hpp"
 #include "malloc.hpp"
+#include "metrics.hpp"
 #include "mmo.hpp"
 #include "showmsg.hpp"
 #include "strlib.hpp"
@@ -88,6 +93,7 @@
  *  DBNColor        - Enumeration of colors of the nodes.                    *
  *  DBNode          - Structure of a node in RED-BLACK trees.                *
  *  struct db_free  - Structure that holds a deleted node to be freed.       *
+ *  DBEntry         - Structure of an entry in open addressing mode.         *
  *  DBMap_impl      - Structure of the database.                             *
  *  stats           - Statistics about the database system.                  *
 \*****************************************************************************/
@@ -104,6 +110,24 @@
  */
 //#define DB_ENABLE_STATS
 
+/**
+ * If defined databases with integer keys (DB_INT, DB_UINT, DB_INT64 and
+ * DB_UINT64) use an open addressing hashtable instead of the hashtable of
+ * RED-BLACK trees.
+ * The entries are kept in fixed blocks that are never moved, so the data of
+ * an entry stays at the same address until it is removed, just like a tree
+ * node. The hashtable itself only holds one control byte (7 bits of the hash)
+ * and the slot of the entry per bucket, most buckets that do not match are
+ * rejected without touching the entries.
+ * Define DB_DISABLE_OPEN_ADDRESSING to keep these databases on the trees.
+ * @private
+ * @see #DBEntry
+ * @see DBMap_impl#blocks
+ */
+#ifndef DB_DISABLE_OPEN_ADDRESSING
+	#define DB_ENABLE_OPEN_ADDRESSING
+#endif
+
 /**
  * Size of the hashtable in the database.
  * @private
@@ -158,6 +182,63 @@ struct db_free {
 	DBNode **root;
 };
 
+/**
+ * Number of entries per block of an open addressing database (as a power of 2).
+ * @private
+ * @see DBMap_impl#blocks
+ */
+#define DB_OA_BLOCK_BITS 6
+#define DB_OA_BLOCK_SIZE (1 << DB_OA_BLOCK_BITS)
+
+/**
+ * Initial number of buckets in the hashtable of an open addressing database.
+ * @private
+ * @see DBMap_impl#ctrl
+ */
+#define DB_OA_MIN_BUCKETS 16
+
+/**
+ * Marks the end of a list of slots or a key that was not found.
+ * @private
+ */
+#define DB_OA_NONE UINT32_MAX
+
+/**
+ * Control bytes of the buckets that hold no entry.
+ * Buckets with an entry hold 7 bits of the hash of its key.
+ * @private
+ * @see DBMap_impl#ctrl
+ */
+#define DB_OA_CTRL_EMPTY 0x80
+#define DB_OA_CTRL_DELETED 0xFE
+
+/**
+ * State of an entry in open addressing mode.
+ * @private
+ * @see struct dbe
+ */
+typedef enum entry_state : uint8 {
+	DB_OA_FREE,
+	DB_OA_USED,
+	DB_OA_DELETED
+} entry_state;
+
+/**
+ * An entry of a database in open addressing mode.
+ * @param key Key of this database entry
+ * @param data Data of this database entry
+ * @param next Next slot in the list of free or deleted entries
+ * @param state State of the entry
+ * @private
+ * @see DBMap_impl#blocks
+ */
+typedef struct dbe {
+	DBKey key;
+	DBData data;
+	uint32 next;
+	entry_state state;
+} DBEntry;
+
 /**
  * Complete database structure.
  * @param vtable Interface of the database
@@ -177,6 +258,17 @@ struct db_free {
  * @param item_count Number of items in the database
  * @param maxlen Maximum length of strings in DB_STRING and DB_ISTRING databases
  * @param global_lock Global lock of the database
+ * @param open_addressing If the database uses open addressing instead of ht
+ * @param blocks Blocks of entries in open addressing mode
+ * @param block_count Number of blocks
+ * @param slot_count Number of entry slots handed out so far
+ * @param free_slots List of entry slots that can be reused
+ * @param deleted_slots List of deleted entries waiting for the free_lock
+ * @param ctrl Control bytes of the open addressing hashtable
+ * @param buckets Entry slots of the open addressing hashtable
+ * @param bucket_count Size of the open addressing hashtable (power of 2)
+ * @param bucket_used Number of buckets holding an entry
+ * @param bucket_deleted Number of buckets that held a deleted entry
  * @private
  * @see #db_alloc(const char*,int32,DBType,DBOptions,uint16)
  */
@@ -203,6 +295,18 @@ typedef struct DBMap_impl {
 	uint32 item_count;
 	uint16 maxlen;
 	unsigned global_lock : 1;
+	unsigned open_addressing : 1;
+	// Open addressing
+	DBEntry **blocks;
+	uint32 block_count;
+	uint32 slot_count;
+	uint32 free_slots;
+	uint32 deleted_slots;
+	uint8 *ctrl;
+	uint32 *buckets;
+	uint32 bucket_count;
+	uint32 bucket_used;
+	uint32 bucket_deleted;
 } DBMap_impl;
 
 /**
@@ -211,6 +315,7 @@ typedef struct DBMap_impl {
  * @param db Parent database
  * @param ht_index Current index of the hashtable
  * @param node Current node
+ * @param slot Current slot in open addressing mode
  * @private
  * @see #DBIterator
  * @see #DBMap_impl
@@ -222,6 +327,7 @@ typedef struct DBIterator_impl {
 	DBMap_impl* db;
 	int32 ht_index;
 	DBNode *node;
+	int64 slot;
 } DBIterator_impl;
 
 #if defined(DB_ENABLE_STATS)
@@ -334,6 +440,14 @@ static struct db_stats {
 #define DB_COUNTSTAT(token)
 #endif /* !defined(DB_ENABLE_STATS) */
 
+/// Operations on all databases, always counted for the metrics
+/// Per thread, so worker threads may read databases; only the main thread is reported.
+static thread_local struct {
+	uint64 lookups; // get, exists and ensure
+	uint64 inserts;
+	uint64 removes;
+} db_ops;
+
 /* [Ind/Hercules] */
 struct eri *db_iterator_ers;
 struct eri *db_alloc_ers;
@@ -353,6 +467,17 @@ struct eri *db_alloc_ers;
  *  db_free_unlock     - Decrement the free_lock of a database.              *
  *         If it was the last lock, frees the nodes in free_list.            *
  *         NOTE: Keeps the database trees balanced.                          *
+ *  db_oa_entry        - Get an entry of an open addressing database.        *
+ *  db_oa_key          - Get the value of an integer key.                    *
+ *  db_oa_hash         - Hash the value of an integer key.                   *
+ *  db_oa_find         - Find the bucket of a key.                           *
+ *  db_oa_insert       - Put an entry slot in the hashtable.                 *
+ *  db_oa_rehash       - Resize the hashtable, dropping the deleted buckets. *
+ *  db_oa_reserve      - Make room in the hashtable for one more entry.      *
+ *  db_oa_alloc_entry  - Get an unused entry slot.                           *
+ *  db_oa_free_add     - Add an entry to the deleted entries.                *
+ *  db_oa_free_remove  - Remove an entry from the deleted entries.           *
+ *  db_oa_free_deleted - Free the deleted entries.                           *
 \*****************************************************************************/
 
 /**
@@ -696,6 +821,261 @@ static void db_dup_key_free(DBMap_impl* db, DBKey key)
 	}
 }
 
+/**
+ * Get the entry in a slot of an open addressing database.
+ * @param db Target database
+ * @param slot Slot of the entry
+ * @return Entry in the slot
+ * @private
+ * @see DBMap_impl#blocks
+ */
+static inline DBEntry* db_oa_entry(DBMap_impl* db, uint32 slot)
+{
+	return &db->blocks[slot >> DB_OA_BLOCK_BITS][slot & (DB_OA_BLOCK_SIZE - 1)];
+}
+
+/**
+ * Get the value of an integer key, regardless of the database type.
+ * @param db Database the key is being used in
+ * @param key Key of the database
+ * @return Value of the key
+ * @private
+ */
+static inline uint64 db_oa_key(DBMap_impl* db, DBKey key)
+{
+	switch (db->type) {
+		case DB_INT:  return (uint32)key.i;
+		case DB_UINT: return key.ui;
+		default:      return key.ui64;
+	}
+}
+
+/**
+ * Hash the value of an integer key.
+ * The ids used as keys are mostly sequential, so the bits are mixed
+ * (finalizer of MurmurHash3) to spread them over the whole hashtable.
+ * @param value Value of the key
+ * @return Hash of the key
+ * @private
+ */
+static inline uint64 db_oa_hash(uint64 value)
+{
+	value ^= value >> 33;
+	value *= 0xff51afd7ed558ccdULL;
+	value ^= value >> 33;
+	value *= 0xc4ceb9fe1a85ec53ULL;
+	value ^= value >> 33;
+	return value;
+}
+
+/**
+ * Find the bucket of a key in the hashtable of an open addressing database.
+ * Entries that are deleted but not freed yet are found as well.
+ * @param db Target database
+ * @param key Key being searched
+ * @return Bucket of the key or DB_OA_NONE if not found
+ * @private
+ */
+static uint32 db_oa_find(DBMap_impl* db, DBKey key)
+{
+	uint64 value, hash;
+	uint32 mask, i;
+	uint8 h2;
+
+	if (db->bucket_count == 0)
+		return DB_OA_NONE;
+
+	value = db_oa_key(db, key);
+	hash = db_oa_hash(value);
+	h2 = (uint8)(hash >> 57);
+	mask = db->bucket_count - 1;
+	// there is always an empty bucket, the hashtable is never full
+	for (i = (uint32)hash & mask; db->ctrl[i] != DB_OA_CTRL_EMPTY; i = (i + 1) & mask) {
+		if (db->ctrl[i] == h2 && db_oa_key(db, db_oa_entry(db, db->buckets[i])->key) == value)
+			return i;
+	}
+	return DB_OA_NONE;
+}
+
+/**
+ * Put an entry slot in the hashtable of an open addressing database.
+ * NOTE: The key of the entry must not be in the hashtable yet and there must
+ * be room for it, see db_oa_reserve.
+ * @param db Target database
+ * @param slot Slot of the entry
+ * @private
+ * @see #db_oa_reserve(DBMap_impl*)
+ */
+static void db_oa_insert(DBMap_impl* db, uint32 slot)
+{
+	uint64 hash = db_oa_hash(db_oa_key(db, db_oa_entry(db, slot)->key));
+	uint32 mask = db->bucket_count - 1;
+	uint32 i;
+
+	for (i = (uint32)hash & mask; !(db->ctrl[i]&0x80); i = (i + 1) & mask)
+		;// bucket in use
+	if (db->ctrl[i] == DB_OA_CTRL_DELETED)
+		db->bucket_deleted--;
+	db->ctrl[i] = (uint8)(hash >> 57);
+	db->buckets[i] = slot;
+	db->bucket_used++;
+}
+
+/**
+ * Resize the hashtable of an open addressing database.
+ * Only the hashtable is rebuilt, the entries stay where they are.
+ * @param db Target database
+ * @param size New number of buckets (power of 2)
+ * @private
+ */
+static void db_oa_rehash(DBMap_impl* db, uint32 size)
+{
+	uint8 *old_ctrl = db->ctrl;
+	uint32 *old_buckets = db->buckets;
+	uint32 old_count = db->bucket_count;
+	uint32 i;
+
+	CREATE(db->ctrl, uint8, size);
+	CREATE(db->buckets, uint32, size);
+	memset(db->ctrl, DB_OA_CTRL_EMPTY, size);
+	db->bucket_count = size;
+	db->bucket_used = 0;
+	db->bucket_deleted = 0;
+
+	for (i = 0; i < old_count; i++) {
+		if (!(old_ctrl[i]&0x80))
+			db_oa_insert(db, old_buckets[i]);
+	}
+	aFree(old_ctrl);
+	aFree(old_buckets);
+}
+
+/**
+ * Make room for one more entry in the hashtable of an open addressing
+ * database. Keeps at least 1/8 of the buckets empty.
+ * @param db Target database
+ * @private
+ */
+static void db_oa_reserve(DBMap_impl* db)
+{
+	uint64 used = (uint64)db->bucket_used + db->bucket_deleted + 1;
+
+	if (db->bucket_count == 0)
+		db_oa_rehash(db, DB_OA_MIN_BUCKETS);
+	else if (used * 8 > (uint64)db->bucket_count * 7) {
+		if ((uint64)(db->bucket_used + 1) * 8 > (uint64)db->bucket_count * 3)
+			db_oa_rehash(db, db->bucket_count * 2);
+		else // mostly deleted buckets, clean up
+			db_oa_rehash(db, db->bucket_count);
+	}
+}
+
+/**
+ * Get an unused entry slot of an open addressing database.
+ * Slots of freed entries are reused first, new blocks are allocated when all
+ * blocks are used.
+ * @param db Target database
+ * @return Slot of the entry
+ * @private
+ */
+static uint32 db_oa_alloc_entry(DBMap_impl* db)
+{
+	uint32 slot;
+
+	DB_COUNTSTAT(db_node_alloc);
+	if (db->free_slots != DB_OA_NONE) {
+		slot = db->free_slots;
+		db->free_slots = db_oa_entry(db, slot)->next;
+		return slot;
+	}
+
+	slot = db->slot_count;
+	if ((slot >> DB_OA_BLOCK_BITS) == db->block_count) {
+		RECREATE(db->blocks, DBEntry*, db->block_count + 1);
+		CREATE(db->blocks[db->block_count], DBEntry, DB_OA_BLOCK_SIZE);
+		db->block_count++;
+	}
+	db->slot_count++;
+	return slot;
+}
+
+/**
+ * Mark an entry of an open addressing database as deleted.
+ * The entry stays in the hashtable until the database is unlocked, just
+ * like the nodes in free_list.
+ * @param db Target database
+ * @param slot Slot of the entry
+ * @private
+ * @see #db_oa_free_deleted(DBMap_impl*)
+ */
+static void db_oa_free_add(DBMap_impl* db, uint32 slot)
+{
+	DBEntry *entry = db_oa_entry(db, slot);
+
+	DB_COUNTSTAT(db_free_add);
+	entry->state = DB_OA_DELETED;
+	entry->next = db->deleted_slots;
+	db->deleted_slots = slot;
+	db->item_count--;
+}
+
+/**
+ * Remove an entry from the deleted entries of an open addressing database.
+ * Marks the entry as used.
+ * @param db Target database
+ * @param slot Slot of the entry
+ * @private
+ */
+static void db_oa_free_remove(DBMap_impl* db, uint32 slot)
+{
+	uint32 *link = &db->deleted_slots;
+
+	DB_COUNTSTAT(db_free_remove);
+	while (*link != DB_OA_NONE && *link != slot)
+		link = &db_oa_entry(db, *link)->next;
+	if (*link == DB_OA_NONE) {
+		ShowWarning("db_oa_free_remove: entry was not found - database allocated at %s:%d\n", db->alloc_file, db->alloc_line);
+	} else {
+		*link = db_oa_entry(db, slot)->next;
+	}
+	db_oa_entry(db, slot)->state = DB_OA_USED;
+	db->item_count++;
+}
+
+/**
+ * Free the deleted entries of an open addressing database.
+ * Their buckets are released and the slots can be reused.
+ * @param db Target database
+ * @private
+ * @see #db_free_unlock(DBMap_impl*)
+ */
+static void db_oa_free_deleted(DBMap_impl* db)
+{
+	uint32 mask = db->bucket_count - 1;
+
+	while (db->deleted_slots != DB_OA_NONE) {
+		uint32 slot = db->deleted_slots;
+		DBEntry *entry = db_oa_entry(db, slot);
+		uint32 i = db_oa_find(db, entry->key);
+
+		db->deleted_slots = entry->next;
+		if (i != DB_OA_NONE) {
+			// no probe goes past an empty bucket, so the bucket can be emptied if the next one is empty
+			if (db->ctrl[(i + 1) & mask] == DB_OA_CTRL_EMPTY)
+				db->ctrl[i] = DB_OA_CTRL_EMPTY;
+			else {
+				db->ctrl[i] = DB_OA_CTRL_DELETED;
+				db->bucket_deleted++;
+			}
+			db->bucket_used--;
+		}
+		entry->state = DB_OA_FREE;
+		entry->next = db->free_slots;
+		db->free_slots = slot;
+		DB_COUNTSTAT(db_node_free);
+	}
+}
+
 /**
  * Add a node to the free_list of the database.
  * Marks the node as deleted.
@@ -827,6 +1207,11 @@ static void db_free_unlock(DBMap_impl* db)
 	if (db->free_lock)
 		return; // Not last lock
 
+	if (db->open_addressing) {
+		db_oa_free_deleted(db);
+		return;
+	}
+
 	for (i = 0; i < db->free_count ; i++) {
 		db_rebalance_erase(db->free_list[i].node, db->free_list[i].root);
 		db_dup_key_free(db, db->free_list[i].node->key);
@@ -1213,6 +1598,24 @@ static void db_release_both(DBKey key, DBData data, DBRelease which)
  *  db_obj_size     - Return the size of the database.                       *
  *  db_obj_type     - Return the type of the database.                       *
  *  db_obj_options  - Return the options of the database.                    *
+ *  dbit_oa_first   - Fetches the first entry from an open addressing db.    *
+ *  dbit_oa_last    - Fetches the last entry from an open addressing db.     *
+ *  dbit_oa_next    - Fetches the next entry from an open addressing db.     *
+ *  dbit_oa_prev    - Fetches the previous entry from an open addressing db. *
+ *  dbit_oa_exists  - Returns true if the current entry exists.              *
+ *  dbit_oa_remove  - Remove the current entry from the database.            *
+ *  db_oa_iterator  - Return a new iterator of an open addressing database.  *
+ *  db_oa_exists    - Checks if an entry exists (open addressing).           *
+ *  db_oa_get       - Get the data identified by the key (open addressing).  *
+ *  db_oa_vgetall   - Get the data of the matched entries (open addressing). *
+ *  db_oa_vensure   - Get the data identified by the key, creating if it     *
+ *           doesn't exist yet (open addressing).                            *
+ *  db_oa_put       - Put data identified by the key in the database         *
+ *           (open addressing).                                              *
+ *  db_oa_remove    - Remove an entry from the database (open addressing).   *
+ *  db_oa_vforeach  - Apply a function to every entry in the database        *
+ *           (open addressing).                                              *
+ *  db_oa_vclear    - Remove all entries from the database (open addressing).*
 \*****************************************************************************/
 
 /**
@@ -1526,6 +1929,7 @@ static bool db_obj_exists(DBMap* self, DBKey key)
 	bool found = false;
 
 	DB_COUNTSTAT(db_exists);
+	db_ops.lookups++;
 	if (db == nullptr) return false; // nullpo candidate
 	if (!(db->options&DB_OPT_ALLOW_NULL_KEY) && db_is_key_null(db->type, key)) {
 		return false; // nullpo candidate
@@ -1576,6 +1980,7 @@ static DBData* db_obj_get(DBMap* self, DBKey key)
 	DBData *data = nullptr;
 
 	DB_COUNTSTAT(db_get);
+	db_ops.lookups++;
 	if (db == nullptr) return nullptr; // nullpo candidate
 	if (!(db->options&DB_OPT_ALLOW_NULL_KEY) && db_is_key_null(db->type, key)) {
 		ShowError("db_get: Attempted to retrieve non-allowed nullptr key for db allocated at %s:%d\n",db->alloc_file, db->alloc_line);
@@ -1736,6 +2141,7 @@ static DBData* db_obj_vensure(DBMap* self, DBKey key, DBCreateData create, va_li
 	DBData *data = nullptr;
 
 	DB_COUNTSTAT(db_vensure);
+	db_ops.lookups++;
 	if (db == nullptr) return nullptr; // nullpo candidate
 	if (create == nullptr) {
 		ShowError("db_ensure: Create function is nullptr for db allocated at %s:%d\n",db->alloc_file, db->alloc_line);
@@ -1864,6 +2270,7 @@ static int32 db_obj_put(DBMap* self, DBKey key, DBData data, DBData *out_data)
 	uint32 hash;
 
 	DB_COUNTSTAT(db_put);
+	db_ops.inserts++;
 	if (db == nullptr) return 0; // nullpo candidate
 	if (db->global_lock) {
 		ShowError("db_put: Database is being destroyed, aborting entry insertion.\n"
@@ -1968,6 +2375,7 @@ static int32 db_obj_remove(DBMap* self, DBKey key, DBData *out_data)
 	int32 retval = 0;
 
 	DB_COUNTSTAT(db_remove);
+	db_ops.removes++;
 	if (db == nullptr) return 0; // nullpo candidate
 	if (db->global_lock) {
 		ShowError("db_remove: Database is being destroyed. Aborting entry deletion.\n"
@@ -2236,7 +2644,21 @@ static int32 db_obj_vdestroy(DBMap* self, DBApply func, va_list args)
 	aFree(db->free_list);
 	db->free_list = nullptr;
 	db->free_max = 0;
-	ers_destroy(db->nodes);
+	if (db->open_addressing) {
+		uint32 i;
+
+		for (i = 0; i < db->block_count; i++)
+			aFree(db->blocks[i]);
+		aFree(db->blocks);
+		aFree(db->ctrl);
+		aFree(db->buckets);
+		db->blocks = nullptr;
+		db->block_count = 0;
+		db->ctrl = nullptr;
+		db->buckets = nullptr;
+		db->bucket_count = 0;
+	} else
+		ers_destroy(db->nodes);
 	db_free_unlock(db);
 	ers_free(db_alloc_ers, db);
 	return sum;
@@ -2341,6 +2763,542 @@ static DBOptions db_obj_options(DBMap* self)
 	return options;
 }
 
+/**
+ * Fetches the first entry in an open addressing database.
+ * Returns the data of the entry.
+ * Puts the key in out_key, if out_key is not nullptr.
+ * @param self Iterator
+ * @param out_key Key of the entry
+ * @return Data of the entry
+ * @protected
+ * @see DBIterator#first
+ */
+static DBData* dbit_oa_first(DBIterator* self, DBKey* out_key)
+{
+	DBIterator_impl* it = (DBIterator_impl*)self;
+
+	DB_COUNTSTAT(dbit_first);
+	// position before the first entry
+	it->slot = -1;
+	// get next entry
+	return self->next(self, out_key);
+}
+
+/**
+ * Fetches the last entry in an open addressing database.
+ * Returns the data of the entry.
+ * Puts the key in out_key, if out_key is not nullptr.
+ * @param self Iterator
+ * @param out_key Key of the entry
+ * @return Data of the entry
+ * @protected
+ * @see DBIterator#last
+ */
+static DBData* dbit_oa_last(DBIterator* self, DBKey* out_key)
+{
+	DBIterator_impl* it = (DBIterator_impl*)self;
+
+	DB_COUNTSTAT(dbit_last);
+	// position after the last entry
+	it->slot = it->db->slot_count;
+	// get previous entry
+	return self->prev(self, out_key);
+}
+
+/**
+ * Fetches the next entry in an open addressing database.
+ * The entries are visited in the order of their slots.
+ * Returns the data of the entry.
+ * Puts the key in out_key, if out_key is not nullptr.
+ * @param self Iterator
+ * @param out_key Key of the entry
+ * @return Data of the entry
+ * @protected
+ * @see DBIterator#next
+ */
+static DBData* dbit_oa_next(DBIterator* self, DBKey* out_key)
+{
+	DBIterator_impl* it = (DBIterator_impl*)self;
+	DBMap_impl* db = it->db;
+	int64 slot = it->slot;
+
+	DB_COUNTSTAT(dbit_next);
+	// slot_count is read every time, entries can be added while iterating
+	while (++slot < (int64)db->slot_count) {
+		DBEntry *entry = db_oa_entry(db, (uint32)slot);
+
+		if (entry->state == DB_OA_USED) { // found next entry
+			it->slot = slot;
+			if (out_key)
+				memcpy(out_key, &entry->key, sizeof(DBKey));
+			return &entry->data;
+		}
+	}
+	it->slot = db->slot_count;
+	return nullptr;// not found
+}
+
+/**
+ * Fetches the previous entry in an open addressing database.
+ * Returns the data of the entry.
+ * Puts the key in out_key, if out_key is not nullptr.
+ * @param self Iterator
+ * @param out_key Key of the entry
+ * @return Data of the entry
+ * @protected
+ * @see DBIterator#prev
+ */
+static DBData* dbit_oa_prev(DBIterator* self, DBKey* out_key)
+{
+	DBIterator_impl* it = (DBIterator_impl*)self;
+	DBMap_impl* db = it->db;
+	int64 slot = std::min<int64>(it->slot, db->slot_count);
+
+	DB_COUNTSTAT(dbit_prev);
+	while (--slot >= 0) {
+		DBEntry *entry = db_oa_entry(db, (uint32)slot);
+
+		if (entry->state == DB_OA_USED) { // found previous entry
+			it->slot = slot;
+			if (out_key)
+				memcpy(out_key, &entry->key, sizeof(DBKey));
+			return &entry->data;
+		}
+	}
+	it->slot = -1;
+	return nullptr;// not found
+}
+
+/**
+ * Returns true if the fetched entry exists.
+ * @param self Iterator
+ * @return true if the entry exists
+ * @protected
+ * @see DBIterator#exists
+ */
+static bool dbit_oa_exists(DBIterator* self)
+{
+	DBIterator_impl* it = (DBIterator_impl*)self;
+	DBMap_impl* db = it->db;
+
+	DB_COUNTSTAT(dbit_exists);
+	return (it->slot >= 0 && it->slot < (int64)db->slot_count && db_oa_entry(db, (uint32)it->slot)->state == DB_OA_USED);
+}
+
+/**
+ * Removes the current entry from an open addressing database.
+ * NOTE: {@link DBIterator#exists} will return false until another entry
+ *       is fetched
+ * Puts data of the removed entry in out_data, if out_data is not nullptr (unless data has been released)
+ * @param self Iterator
+ * @param out_data Data of the removed entry.
+ * @return 1 if entry was removed, 0 otherwise
+ * @protected
+ * @see DBIterator#remove
+ */
+static int32 dbit_oa_remove(DBIterator* self, DBData *out_data)
+{
+	DBIterator_impl* it = (DBIterator_impl*)self;
+	DBMap_impl* db = it->db;
+	DBEntry *entry;
+
+	DB_COUNTSTAT(dbit_remove);
+	if (!dbit_oa_exists(self))
+		return 0;
+
+	entry = db_oa_entry(db, (uint32)it->slot);
+	db->release(entry->key, entry->data, DB_RELEASE_DATA);
+	if (out_data)
+		memcpy(out_data, &entry->data, sizeof(DBData));
+	db_oa_free_add(db, (uint32)it->slot);
+	return 1;
+}
+
+/**
+ * Returns a new iterator for an open addressing database.
+ * The iterator keeps the database locked until it is destroyed.
+ * @param self Database
+ * @return New iterator
+ * @protected
+ * @see DBMap#iterator
+ */
+static DBIterator* db_oa_iterator(DBMap* self)
+{
+	DBMap_impl* db = (DBMap_impl*)self;
+	DBIterator_impl* it;
+
+	DB_COUNTSTAT(db_iterator);
+	it = ers_alloc(db_iterator_ers, struct DBIterator_impl);
+	/* Interface of the iterator **/
+	it->vtable.first   = dbit_oa_first;
+	it->vtable.last    = dbit_oa_last;
+	it->vtable.next    = dbit_oa_next;
+	it->vtable.prev    = dbit_oa_prev;
+	it->vtable.exists  = dbit_oa_exists;
+	it->vtable.remove  = dbit_oa_remove;
+	it->vtable.destroy = dbit_obj_destroy;
+	/* Initial state (before the first entry) */
+	it->db = db;
+	it->ht_index = -1;
+	it->node = nullptr;
+	it->slot = -1;
+	/* Lock the database */
+	db_free_lock(db);
+	return &it->vtable;
+}
+
+/**
+ * Returns true if the entry exists in an open addressing database.
+ * @param self Interface of the database
+ * @param key Key that identifies the entry
+ * @return true is the entry exists
+ * @protected
+ * @see DBMap#exists
+ */
+static bool db_oa_exists(DBMap* self, DBKey key)
+{
+	DBMap_impl* db = (DBMap_impl*)self;
+	uint32 i;
+
+	DB_COUNTSTAT(db_exists);
+	db_ops.lookups++;
+	if (db == nullptr) return false; // nullpo candidate
+
+	i = db_oa_find(db, key);
+	return (i != DB_OA_NONE && db_oa_entry(db, db->buckets[i])->state == DB_OA_USED);
+}
+
+/**
+ * Get the data of the entry identified by the key in an open addressing
+ * database.
+ * @param self Interface of the database
+ * @param key Key that identifies the entry
+ * @return Data of the entry or nullptr if not found
+ * @protected
+ * @see DBMap#get
+ */
+static DBData* db_oa_get(DBMap* self, DBKey key)
+{
+	DBMap_impl* db = (DBMap_impl*)self;
+	DBEntry *entry;
+	uint32 i;
+
+	DB_COUNTSTAT(db_get);
+	db_ops.lookups++;
+	if (db == nullptr) return nullptr; // nullpo candidate
+
+	i = db_oa_find(db, key);
+	if (i == DB_OA_NONE)
+		return nullptr;
+	entry = db_oa_entry(db, db->buckets[i]);
+	if (entry->state != DB_OA_USED)
+		return nullptr;
+	return &entry->data;
+}
+
+/**
+ * Get the data of the entries matched by <code>match</code> in an open
+ * addressing database.
+ * It puts a maximum of <code>max</code> entries into <code>buf</code>.
+ * If <code>buf</code> is nullptr, it only counts the matches.
+ * Returns the number of entries that matched.
+ * @param self Interface of the database
+ * @param buf Buffer to put the data of the matched entries
+ * @param max Maximum number of data entries to be put into buf
+ * @param match Function that matches the database entries
+ * @param args Extra arguments for match
+ * @return The number of entries that matched
+ * @protected
+ * @see DBMap#vgetall
+ */
+static uint32 db_oa_vgetall(DBMap* self, DBData **buf, uint32 max, DBMatcher match, va_list args)
+{
+	DBMap_impl* db = (DBMap_impl*)self;
+	uint32 slot;
+	uint32 ret = 0;
+
+	DB_COUNTSTAT(db_vgetall);
+	if (db == nullptr) return 0; // nullpo candidate
+	if (match == nullptr) return 0; // nullpo candidate
+
+	db_free_lock(db);
+	for (slot = 0; slot < db->slot_count; slot++) {
+		DBEntry *entry = db_oa_entry(db, slot);
+
+		if (entry->state == DB_OA_USED) {
+			va_list argscopy;
+			va_copy(argscopy, args);
+			if (match(entry->key, entry->data, argscopy) == 0) {
+				if (buf && ret < max)
+					buf[ret] = &entry->data;
+				ret++;
+			}
+			va_end(argscopy);
+		}
+	}
+	db_free_unlock(db);
+	return ret;
+}
+
+/**
+ * Get the data of the entry identified by the key in an open addressing
+ * database.
+ * If the entry does not exist, an entry is added with the data returned by
+ * <code>create</code>.
+ * @param self Interface of the database
+ * @param key Key that identifies the entry
+ * @param create Function used to create the data if the entry doesn't exist
+ * @param args Extra arguments for create
+ * @return Data of the entry
+ * @protected
+ * @see DBMap#vensure
+ */
+static DBData* db_oa_vensure(DBMap* self, DBKey key, DBCreateData create, va_list args)
+{
+	DBMap_impl* db = (DBMap_impl*)self;
+	DBEntry *entry;
+	va_list argscopy;
+	uint32 i, slot;
+
+	DB_COUNTSTAT(db_vensure);
+	db_ops.lookups++;
+	if (db == nullptr) return nullptr; // nullpo candidate
+	if (create == nullptr) {
+		ShowError("db_ensure: Create function is nullptr for db allocated at %s:%d\n",db->alloc_file, db->alloc_line);
+		return nullptr; // nullpo candidate
+	}
+
+	db_free_lock(db);
+	i = db_oa_find(db, key);
+	if (i != DB_OA_NONE) {
+		slot = db->buckets[i];
+		entry = db_oa_entry(db, slot);
+		if (entry->state == DB_OA_USED) {
+			db_free_unlock(db);
+			return &entry->data;
+		}
+		db_oa_free_remove(db, slot); // deleted entry, use it again
+	} else {
+		if (db->item_count == UINT32_MAX) {
+			ShowError("db_vensure: item_count overflow, aborting item insertion.\n"
+					"Database allocated at %s:%d",
+					db->alloc_file, db->alloc_line);
+			db_free_unlock(db);
+			return nullptr;
+		}
+		db_oa_reserve(db);
+		slot = db_oa_alloc_entry(db);
+		entry = db_oa_entry(db, slot);
+		entry->key = key;
+		entry->state = DB_OA_USED;
+		db_oa_insert(db, slot);
+		db->item_count++;
+	}
+	va_copy(argscopy, args);
+	entry->data = create(key, argscopy);
+	va_end(argscopy);
+	db_free_unlock(db);
+	return &entry->data;
+}
+
+/**
+ * Put the data identified by the key in an open addressing database.
+ * Puts the previous data in out_data, if out_data is not nullptr. (unless data has been released)
+ * @param self Interface of the database
+ * @param key Key that identifies the data
+ * @param data Data to be put in the database
+ * @param out_data Previous data if the entry exists
+ * @return 1 if if the entry already exists, 0 otherwise
+ * @protected
+ * @see DBMap#put
+ */
+static int32 db_oa_put(DBMap* self, DBKey key, DBData data, DBData *out_data)
+{
+	DBMap_impl* db = (DBMap_impl*)self;
+	DBEntry *entry;
+	int32 retval = 0;
+	uint32 i, slot;
+
+	DB_COUNTSTAT(db_put);
+	db_ops.inserts++;
+	if (db == nullptr) return 0; // nullpo candidate
+	if (db->global_lock) {
+		ShowError("db_put: Database is being destroyed, aborting entry insertion.\n"
+				"Database allocated at %s:%d\n",
+				db->alloc_file, db->alloc_line);
+		return 0; // nullpo candidate
+	}
+	if (!(db->options&DB_OPT_ALLOW_NULL_DATA) && (data.type == DB_DATA_PTR && data.u.ptr == nullptr)) {
+		ShowError("db_put: Attempted to use non-allowed nullptr data for db allocated at %s:%d\n",db->alloc_file, db->alloc_line);
+		return 0; // nullpo candidate
+	}
+
+	if (db->item_count == UINT32_MAX) {
+		ShowError("db_put: item_count overflow, aborting item insertion.\n"
+				"Database allocated at %s:%d",
+				db->alloc_file, db->alloc_line);
+		return 0;
+	}
+	db_free_lock(db);
+	i = db_oa_find(db, key);
+	if (i != DB_OA_NONE) { // equal entry, replace
+		slot = db->buckets[i];
+		entry = db_oa_entry(db, slot);
+		if (entry->state == DB_OA_DELETED) {
+			db_oa_free_remove(db, slot);
+		} else {
+			db->release(entry->key, entry->data, DB_RELEASE_BOTH);
+			if (out_data)
+				memcpy(out_data, &entry->data, sizeof(*out_data));
+			retval = 1;
+		}
+	} else { // allocate a new entry
+		db_oa_reserve(db);
+		slot = db_oa_alloc_entry(db);
+		entry = db_oa_entry(db, slot);
+		entry->key = key;
+		entry->state = DB_OA_USED;
+		db_oa_insert(db, slot);
+		db->item_count++;
+	}
+	entry->data = data;
+	db_free_unlock(db);
+	return retval;
+}
+
+/**
+ * Remove an entry from an open addressing database.
+ * Puts the previous data in out_data, if out_data is not nullptr. (unless data has been released)
+ * @param self Interface of the database
+ * @param key Key that identifies the entry
+ * @param out_data Previous data if the entry exists
+ * @return 1 if if the entry already exists, 0 otherwise
+ * @protected
+ * @see DBMap#remove
+ */
+static int32 db_oa_remove(DBMap* self, DBKey key, DBData *out_data)
+{
+	DBMap_impl* db = (DBMap_impl*)self;
+	DBEntry *entry;
+	int32 retval = 0;
+	uint32 i;
+
+	DB_COUNTSTAT(db_remove);
+	db_ops.removes++;
+	if (db == nullptr) return 0; // nullpo candidate
+	if (db->global_lock) {
+		ShowError("db_remove: Database is being destroyed. Aborting entry deletion.\n"
+				"Database allocated at %s:%d\n",
+				db->alloc_file, db->alloc_line);
+		return 0; // nullpo candidate
+	}
+
+	db_free_lock(db);
+	i = db_oa_find(db, key);
+	if (i != DB_OA_NONE) {
+		entry = db_oa_entry(db, db->buckets[i]);
+		if (entry->state == DB_OA_USED) {
+			db->release(entry->key, entry->data, DB_RELEASE_DATA);
+			if (out_data)
+				memcpy(out_data, &entry->data, sizeof(*out_data));
+			retval = 1;
+			db_oa_free_add(db, db->buckets[i]);
+		}
+	}
+	db_free_unlock(db);
+	return retval;
+}
+
+/**
+ * Apply <code>func</code> to every entry in an open addressing database.
+ * Returns the sum of values returned by func.
+ * @param self Interface of the database
+ * @param func Function to be applied
+ * @param args Extra arguments for func
+ * @return Sum of the values returned by func
+ * @protected
+ * @see DBMap#vforeach
+ */
+static int32 db_oa_vforeach(DBMap* self, DBApply func, va_list args)
+{
+	DBMap_impl* db = (DBMap_impl*)self;
+	int32 sum = 0;
+	uint32 slot;
+
+	DB_COUNTSTAT(db_vforeach);
+	if (db == nullptr) return 0; // nullpo candidate
+	if (func == nullptr) {
+		ShowError("db_foreach: Passed function is nullptr for db allocated at %s:%d\n",db->alloc_file, db->alloc_line);
+		return 0; // nullpo candidate
+	}
+
+	db_free_lock(db);
+	for (slot = 0; slot < db->slot_count; slot++) {
+		DBEntry *entry = db_oa_entry(db, slot);
+
+		if (entry->state == DB_OA_USED) {
+			va_list argscopy;
+			va_copy(argscopy, args);
+			sum += func(entry->key, &entry->data, argscopy);
+			va_end(argscopy);
+		}
+	}
+	db_free_unlock(db);
+	return sum;
+}
+
+/**
+ * Removes all entries from an open addressing database.
+ * Before deleting an entry, func is applied to it.
+ * Releases the key and the data.
+ * The blocks and the hashtable are kept for the next entries.
+ * Returns the sum of values returned by func, if it exists.
+ * @param self Interface of the database
+ * @param func Function to be applied to every entry before deleting
+ * @param args Extra arguments for func
+ * @return Sum of values returned by func
+ * @protected
+ * @see DBMap#vclear
+ */
+static int32 db_oa_vclear(DBMap* self, DBApply func, va_list args)
+{
+	DBMap_impl* db = (DBMap_impl*)self;
+	int32 sum = 0;
+	uint32 slot;
+
+	DB_COUNTSTAT(db_vclear);
+	if (db == nullptr) return 0; // nullpo candidate
+
+	db_free_lock(db);
+	for (slot = 0; slot < db->slot_count; slot++) {
+		DBEntry *entry = db_oa_entry(db, slot);
+
+		if (entry->state == DB_OA_USED) {
+			if (func)
+			{
+				va_list argscopy;
+				va_copy(argscopy, args);
+				sum += func(entry->key, &entry->data, argscopy);
+				va_end(argscopy);
+			}
+			db->release(entry->key, entry->data, DB_RELEASE_BOTH);
+		}
+		if (entry->state != DB_OA_FREE)
+			DB_COUNTSTAT(db_node_free);
+		entry->state = DB_OA_FREE;
+	}
+	db->slot_count = 0;
+	db->free_slots = DB_OA_NONE;
+	db->deleted_slots = DB_OA_NONE;
+	if (db->bucket_count)
+		memset(db->ctrl, DB_OA_CTRL_EMPTY, db->bucket_count);
+	db->bucket_used = 0;
+	db->bucket_deleted = 0;
+	db->item_count = 0;
+	db_free_unlock(db);
+	return sum;
+}
+
 /*****************************************************************************\
  *  (5) Section with public functions.
  *  db_fix_options     - Apply database type restrictions to the options.
@@ -2557,6 +3515,22 @@ DBMap* db_alloc(const char *file, const char *func, int32 line, DBType type, DBO
 	db->vtable.size     = db_obj_size;
 	db->vtable.type     = db_obj_type;
 	db->vtable.options  = db_obj_options;
+#ifdef DB_ENABLE_OPEN_ADDRESSING
+	db->open_addressing = (type == DB_INT || type == DB_UINT || type == DB_INT64 || type == DB_UINT64);
+#else
+	db->open_addressing = 0;
+#endif
+	if (db->open_addressing) {
+		db->vtable.iterator = db_oa_iterator;
+		db->vtable.exists   = db_oa_exists;
+		db->vtable.get      = db_oa_get;
+		db->vtable.vgetall  = db_oa_vgetall;
+		db->vtable.vensure  = db_oa_vensure;
+		db->vtable.put      = db_oa_put;
+		db->vtable.remove   = db_oa_remove;
+		db->vtable.vforeach = db_oa_vforeach;
+		db->vtable.vclear   = db_oa_vclear;
+	}
 	/* File and line of allocation */
 	db->alloc_file = file;
 	db->alloc_line = line;
@@ -2566,8 +3540,12 @@ DBMap* db_alloc(const char *file, const char *func, int32 line, DBType type, DBO
 	db->free_max = 0;
 	db->free_lock = 0;
 	/* Other */
-	snprintf(ers_name, 50, "db_alloc:nodes:%s:%s:%d",func,file,line);
-	db->nodes = ers_new(sizeof(struct dbn),ers_name,ERS_DBN_OPTIONS);
+	if (db->open_addressing)
+		db->nodes = nullptr; // entries are kept in db->blocks
+	else {
+		snprintf(ers_name, 50, "db_alloc:nodes:%s:%s:%d",func,file,line);
+		db->nodes = ers_new(sizeof(struct dbn),ers_name,ERS_DBN_OPTIONS);
+	}
 	db->cmp = db_default_cmp(type);
 	db->hash = db_default_hash(type);
 	db->release = db_default_release(type, options);
@@ -2579,6 +3557,16 @@ DBMap* db_alloc(const char *file, const char *func, int32 line, DBType type, DBO
 	db->item_count = 0;
 	db->maxlen = maxlen;
 	db->global_lock = 0;
+	db->blocks = nullptr;
+	db->block_count = 0;
+	db->slot_count = 0;
+	db->free_slots = DB_OA_NONE;
+	db->deleted_slots = DB_OA_NONE;
+	db->ctrl = nullptr;
+	db->buckets = nullptr;
+	db->bucket_count = 0;
+	db->bucket_used = 0;
+	db->bucket_deleted = 0;
 
 	if( db->maxlen == 0 && (type == DB_STRING || type == DB_ISTRING) )
 		db->maxlen = UINT16_MAX;
@@ -2785,6 +3773,31 @@ int64 db_data2i64(DBData *data)
 	return 0;
 }
 
+/**
+ * Whether databases with integer keys use open addressing.
+ * @return true if DB_ENABLE_OPEN_ADDRESSING is defined
+ * @public
+ */
+bool db_open_addressing_enabled(void)
+{
+#ifdef DB_ENABLE_OPEN_ADDRESSING
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ * Writes the operation counters of all databases for the metrics endpoint.
+ * @private
+ * @see #db_init(void)
+ */
+static void db_metrics(MetricsWriter& writer) {
+	writer.counter("rathena_db_lookups_total", "Lookups in all databases.", db_ops.lookups);
+	writer.counter("rathena_db_inserts_total", "Inserts into all databases.", db_ops.inserts);
+	writer.counter("rathena_db_removes_total", "Removals from all databases.", db_ops.removes);
+}
+
 /**
  * Initializes the database system.
  * @public
@@ -2795,6 +3808,7 @@ void db_init(void) {
 	db_alloc_ers = ers_new(sizeof(struct DBMap_impl),"db.cpp::db_alloc_ers",ERS_CACHE_OPTIONS);
 	ers_chunk_size(db_alloc_ers, 50);
 	ers_chunk_size(db_iterator_ers, 10);
+	metrics_add_collector(db_metrics);
 	DB_COUNTSTAT(db_init);
 }
 
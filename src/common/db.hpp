@@ -936,6 +936,14 @@ void* db_data2ptr(DBData *data);
  */
 int64 db_data2i64(DBData *data);
 
+/**
+ * Whether databases with integer keys use open addressing instead of the
+ * hashtable of trees, see DB_DISABLE_OPEN_ADDRESSING in db.cpp.
+ * @return true if they use open addressing
+ * @public
+ */
+bool db_open_addressing_enabled(void);
+
 /**
  * Initialize the database system.
  * @public
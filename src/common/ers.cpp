@@ -351,6 +351,17 @@ void ers_report(void) {
 	ShowInfo("ers_report: '" CL_WHITE "%u" CL_NORMAL "' blocks total, consuming '" CL_WHITE "%.2f MB" CL_NORMAL "' \n",blocks_a,(double)((memory_t)/1024)/1024);
 }
 
+void ers_usage(size_t* used, size_t* allocated) {
+	ers_cache_t *cache;
+
+	*used = *allocated = 0;
+
+	for (cache = CacheList; cache; cache = cache->Next) {
+		*used += (size_t)cache->UsedObjs * cache->ObjectSize;
+		*allocated += (size_t)(cache->UsedObjs + cache->Free) * cache->ObjectSize;
+	}
+}
+
 /**
  * Call on shutdown to clear remaining entries
  **/
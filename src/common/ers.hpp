@@ -140,6 +140,7 @@ typedef struct eri {
 // Disable the public functions
 #	define ers_new(size,name,options) nullptr
 #	define ers_report()
+#	define ers_usage(used,allocated) (*(used) = *(allocated) = 0)
 #	define ers_final()
 #else /* not DISABLE_ERS */
 // These defines should be used to allow the code to keep working whenever
@@ -171,6 +172,13 @@ ERS *ers_new(uint32 size, const char *name, enum ERSOptions options);
  */
 void ers_report(void);
 
+/**
+ * Memory of all caches in bytes.
+ * @param used Receives the memory of the entries in use
+ * @param allocated Receives the memory of all entries, including the reusable ones
+ */
+void ers_usage(size_t* used, size_t* allocated);
+
 /**
  * Clears the remainder of the managers
  **/
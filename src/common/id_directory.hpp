@@ -0,0 +1,196 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef ID_DIRECTORY_HPP
+#define ID_DIRECTORY_HPP
+
+#include <vector>
+
+#include "cbasetypes.hpp"
+
+/**
+ * Dense directory of the ids handed out from a range [first_id, last_id).
+ * An id is made of a slot index (the low index_bits of the offset into the
+ * range) and the generation of the slot (the remaining bits). Looking up an
+ * id is a range check and one array access, and an id that was released
+ * does not match the slot anymore once it was handed out again, because the
+ * generation of a slot is increased every time it is released.
+ * Released slots are reused in FIFO order, but only once more than min_free
+ * of them are waiting, so the same id does not come back for at least
+ * min_free * generations allocations.
+ */
+template <typename T> class IdDirectory {
+private:
+	static const uint32 NONE = UINT32_MAX;
+
+	struct s_slot {
+		T* data;
+		uint32 generation;
+		uint32 next_free;
+		bool reserved;
+	};
+
+	std::vector<s_slot> slots;
+	uint32 first_id;
+	uint32 index_bits;
+	uint32 index_mask;
+	uint32 generations;
+	uint32 min_free;
+	uint32 free_head;
+	uint32 free_tail;
+	uint32 free_count;
+
+	int32 to_id( uint32 index, uint32 generation ) const {
+		return (int32)( this->first_id + ( generation << this->index_bits ) + index );
+	}
+
+	/// Slot of a reserved id, nullptr if the id is not reserved (anymore)
+	s_slot* get_slot( int32 id ){
+		uint32 offset = (uint32)id - this->first_id;
+		uint32 index = offset & this->index_mask;
+
+		if( ( offset >> this->index_bits ) >= this->generations || index >= this->slots.size() ){
+			return nullptr;
+		}
+
+		s_slot& slot = this->slots[index];
+
+		if( !slot.reserved || slot.generation != ( offset >> this->index_bits ) ){
+			return nullptr;
+		}
+
+		return &slot;
+	}
+
+public:
+	/**
+	 * @param first_id: First id of the range
+	 * @param last_id: End of the range (exclusive)
+	 * @param index_bits: Maximum number of ids in use at the same time (as a power of 2)
+	 * @param min_free: Number of released slots that are kept waiting before they are reused
+	 */
+	IdDirectory( int32 first_id, int64 last_id, uint32 index_bits, uint32 min_free ){
+		this->first_id = (uint32)first_id;
+		this->index_bits = index_bits;
+		this->index_mask = ( 1 << index_bits ) - 1;
+		this->generations = (uint32)( ( last_id - first_id ) >> index_bits );
+		this->min_free = min_free;
+		this->free_head = NONE;
+		this->free_tail = NONE;
+		this->free_count = 0;
+	}
+
+	/**
+	 * Maximum number of ids in use at the same time
+	 */
+	uint32 capacity() const {
+		return this->index_mask + 1;
+	}
+
+	/**
+	 * Number of ids in use
+	 */
+	size_t size() const {
+		return this->slots.size() - this->free_count;
+	}
+
+	/**
+	 * Reserve a new id
+	 * @return The id or 0 if all ids are in use
+	 */
+	int32 acquire(){
+		uint32 index;
+
+		if( this->free_count > this->min_free || ( this->free_count > 0 && this->slots.size() == this->capacity() ) ){
+			index = this->free_head;
+			this->free_head = this->slots[index].next_free;
+			this->free_count--;
+
+			if( this->free_head == NONE ){
+				this->free_tail = NONE;
+			}
+		}else if( this->slots.size() < this->capacity() ){
+			index = (uint32)this->slots.size();
+			this->slots.push_back( s_slot{ nullptr, 0, NONE, false } );
+		}else{
+			return 0;
+		}
+
+		this->slots[index].reserved = true;
+
+		return this->to_id( index, this->slots[index].generation );
+	}
+
+	/**
+	 * Release an id, it no longer finds anything
+	 * @return false if the id was not reserved
+	 */
+	bool release( int32 id ){
+		s_slot* slot = this->get_slot( id );
+
+		if( slot == nullptr ){
+			return false;
+		}
+
+		uint32 index = (uint32)( slot - this->slots.data() );
+
+		slot->data = nullptr;
+		slot->reserved = false;
+		slot->generation = ( slot->generation + 1 ) % this->generations;
+		slot->next_free = NONE;
+
+		if( this->free_tail != NONE ){
+			this->slots[this->free_tail].next_free = index;
+		}else{
+			this->free_head = index;
+		}
+
+		this->free_tail = index;
+		this->free_count++;
+
+		return true;
+	}
+
+	/**
+	 * Attach the data of a reserved id
+	 * @return false if the id was not reserved
+	 */
+	bool set( int32 id, T* data ){
+		s_slot* slot = this->get_slot( id );
+
+		if( slot == nullptr ){
+			return false;
+		}
+
+		slot->data = data;
+
+		return true;
+	}
+
+	/**
+	 * Look up the data of an id
+	 * @return The data or nullptr if the id is not in use
+	 */
+	T* find( int32 id ) const {
+		uint32 offset = (uint32)id - this->first_id;
+		uint32 index = offset & this->index_mask;
+
+		if( ( offset >> this->index_bits ) >= this->generations || index >= this->slots.size() ){
+			return nullptr;
+		}
+
+		const s_slot& slot = this->slots[index];
+
+		// Released slots have no data, so a stale generation is the only check left
+		return slot.generation == ( offset >> this->index_bits ) ? slot.data : nullptr;
+	}
+
+	/**
+	 * Whether an id is reserved
+	 */
+	bool exists( int32 id ){
+		return this->get_slot( id ) != nullptr;
+	}
+};
+
+#endif /* ID_DIRECTORY_HPP */
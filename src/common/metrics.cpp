@@ -0,0 +1,184 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "metrics.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+#include "ers.hpp"
+#include "malloc.hpp"
+#include "timer.hpp"
+
+// Upper bounds of the histogram buckets in seconds
+static const double metrics_histogram_bounds[MetricsHistogram::BUCKETS] = { 0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1 };
+
+static std::vector<MetricsCollector> metrics_collectors;
+static std::string metrics_current;
+static std::mutex metrics_mutex;
+
+void MetricsWriter::family( const char* name, const char* type, const char* help ){
+	this->out += "# HELP ";
+	this->out += name;
+	this->out += ' ';
+	this->out += help;
+	this->out += "\n# TYPE ";
+	this->out += name;
+	this->out += ' ';
+	this->out += type;
+	this->out += '\n';
+}
+
+/**
+ * Write a sample of the current family
+ * @param labels: Labels without the braces (e.g. "type=\"0x0360\""), nullptr if there are none
+ */
+void MetricsWriter::sample( const char* name, const char* labels, uint64 value ){
+	char buf[32];
+
+	snprintf( buf, sizeof( buf ), " %" PRIu64 "\n", value );
+	this->out += name;
+
+	if( labels != nullptr ){
+		this->out += '{';
+		this->out += labels;
+		this->out += '}';
+	}
+
+	this->out += buf;
+}
+
+void MetricsWriter::sample( const char* name, const char* labels, double value ){
+	char buf[32];
+
+	snprintf( buf, sizeof( buf ), " %.9g\n", value );
+	this->out += name;
+
+	if( labels != nullptr ){
+		this->out += '{';
+		this->out += labels;
+		this->out += '}';
+	}
+
+	this->out += buf;
+}
+
+void MetricsWriter::counter( const char* name, const char* help, uint64 value ){
+	this->family( name, "counter", help );
+	this->sample( name, nullptr, value );
+}
+
+void MetricsWriter::gauge( const char* name, const char* help, double value ){
+	this->family( name, "gauge", help );
+	this->sample( name, nullptr, value );
+}
+
+MetricsHistogram::MetricsHistogram(){
+	for( std::atomic<uint64>& count : this->counts ){
+		count = 0;
+	}
+
+	this->sum = 0;
+}
+
+void MetricsHistogram::observe( uint64 nanoseconds ){
+	size_t bucket = 0;
+
+	while( bucket < BUCKETS && nanoseconds > metrics_histogram_bounds[bucket] * 1e9 ){
+		bucket++;
+	}
+
+	this->counts[bucket].fetch_add( 1, std::memory_order_relaxed );
+	this->sum.fetch_add( nanoseconds, std::memory_order_relaxed );
+}
+
+void MetricsHistogram::write( MetricsWriter& writer, const char* name, const char* help ) const {
+	std::string bucket_name = std::string( name ) + "_bucket";
+	uint64 total = 0;
+	char labels[32];
+
+	writer.family( name, "histogram", help );
+
+	for( size_t i = 0; i < BUCKETS; i++ ){
+		total += this->counts[i].load( std::memory_order_relaxed );
+		snprintf( labels, sizeof( labels ), "le=\"%g\"", metrics_histogram_bounds[i] );
+		writer.sample( bucket_name.c_str(), labels, total );
+	}
+
+	total += this->counts[BUCKETS].load( std::memory_order_relaxed );
+	writer.sample( bucket_name.c_str(), "le=\"+Inf\"", total );
+	writer.sample( ( std::string( name ) + "_sum" ).c_str(), nullptr, this->sum.load( std::memory_order_relaxed ) / 1e9 );
+	writer.sample( ( std::string( name ) + "_count" ).c_str(), nullptr, total );
+}
+
+/**
+ * Register a function that writes the values of a module
+ * Collectors are only run on the main thread.
+ */
+void metrics_add_collector( MetricsCollector collector ){
+	metrics_collectors.push_back( collector );
+}
+
+static void metrics_process( MetricsWriter& writer ){
+	size_t ers_used, ers_allocated;
+
+	ers_usage( &ers_used, &ers_allocated );
+
+	writer.gauge( "rathena_uptime_seconds", "Time since the server was started.", (double)get_uptime() );
+	writer.gauge( "rathena_memory_bytes", "Memory allocated through the memory manager.", malloc_usage() * 1024. );
+	writer.gauge( "rathena_ers_used_bytes", "Memory of the entry reusage system that is in use.", (double)ers_used );
+	writer.gauge( "rathena_ers_allocated_bytes", "Memory allocated by the entry reusage system.", (double)ers_allocated );
+}
+
+/**
+ * Run all collectors and replace the snapshot
+ */
+void metrics_update( void ){
+	std::string text;
+	MetricsWriter writer( text );
+
+	for( MetricsCollector collector : metrics_collectors ){
+		collector( writer );
+	}
+
+	std::lock_guard<std::mutex> lock( metrics_mutex );
+
+	metrics_current.swap( text );
+}
+
+/**
+ * Latest snapshot, can be called from any thread
+ */
+std::string metrics_snapshot( void ){
+	std::lock_guard<std::mutex> lock( metrics_mutex );
+
+	return metrics_current;
+}
+
+static TIMER_FUNC( metrics_update_timer ){
+	metrics_update();
+
+	return 0;
+}
+
+/**
+ * Start taking a snapshot every second
+ */
+void metrics_init( void ){
+	metrics_add_collector( metrics_process );
+
+	add_timer_func_list( metrics_update_timer, "metrics_update_timer" );
+	add_timer_interval( gettick() + 1000, metrics_update_timer, 0, 0, 1000 );
+
+	metrics_update();
+}
+
+void metrics_final( void ){
+	metrics_collectors.clear();
+
+	std::lock_guard<std::mutex> lock( metrics_mutex );
+
+	metrics_current.clear();
+}
@@ -0,0 +1,62 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <atomic>
+#include <string>
+
+#include "cbasetypes.hpp"
+
+/**
+ * Live counters of a server in the Prometheus text exposition format
+ * Every module registers a collector that writes its current values. The
+ * main thread runs the collectors once per second and keeps the result, which
+ * the HTTP endpoints hand out from their own threads. Counters only ever
+ * grow, so rates per second are computed by whatever scrapes them.
+ */
+
+class MetricsWriter {
+private:
+	std::string& out;
+
+public:
+	MetricsWriter( std::string& out ) : out( out ){}
+
+	void family( const char* name, const char* type, const char* help );
+	void sample( const char* name, const char* labels, uint64 value );
+	void sample( const char* name, const char* labels, double value );
+
+	void counter( const char* name, const char* help, uint64 value );
+	void gauge( const char* name, const char* help, double value );
+};
+
+/**
+ * Latency histogram that can be updated from any thread
+ */
+class MetricsHistogram {
+public:
+	static const size_t BUCKETS = 9;
+
+private:
+	std::atomic<uint64> counts[BUCKETS + 1];
+	std::atomic<uint64> sum; // nanoseconds
+
+public:
+	MetricsHistogram();
+
+	void observe( uint64 nanoseconds );
+	void write( MetricsWriter& writer, const char* name, const char* help ) const;
+};
+
+typedef void (*MetricsCollector)( MetricsWriter& writer );
+
+void metrics_add_collector( MetricsCollector collector );
+void metrics_update( void );
+std::string metrics_snapshot( void );
+
+void metrics_init( void );
+void metrics_final( void );
+
+#endif /* METRICS_HPP */
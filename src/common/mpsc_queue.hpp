@@ -0,0 +1,146 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef MPSC_QUEUE_HPP
+#define MPSC_QUEUE_HPP
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "cbasetypes.hpp"
+
+/**
+ * Bounded lock-free multi-producer/single-consumer queue.
+ * Ring buffer with one sequence number per cell (Vyukov): producers claim a
+ * slot with a CAS on the enqueue position, the single consumer never takes a
+ * lock and never blocks a producer. Capacity is rounded up to a power of two.
+ * push() may be called from any thread, pop()/drain() only from the consumer.
+ */
+template <typename T> class MPSCQueue {
+private:
+	struct Cell {
+		std::atomic<size_t> sequence;
+		T data;
+	};
+
+	std::unique_ptr<Cell[]> buffer;
+	size_t mask;
+
+	// Producers and the consumer live on separate cache lines
+	alignas(64) std::atomic<size_t> enqueue_pos;
+	alignas(64) std::atomic<size_t> dequeue_pos;
+
+public:
+	MPSCQueue( size_t capacity ){
+		size_t size = 2;
+
+		while( size < capacity ){
+			size <<= 1;
+		}
+
+		this->buffer = std::make_unique<Cell[]>( size );
+		this->mask = size - 1;
+
+		for( size_t i = 0; i < size; i++ ){
+			this->buffer[i].sequence.store( i, std::memory_order_relaxed );
+		}
+
+		this->enqueue_pos.store( 0, std::memory_order_relaxed );
+		this->dequeue_pos.store( 0, std::memory_order_relaxed );
+	}
+
+	MPSCQueue( const MPSCQueue& ) = delete;
+	MPSCQueue& operator=( const MPSCQueue& ) = delete;
+
+	/**
+	 * Push an element (any thread)
+	 * @param value: Element to move into the queue
+	 * @return false if the queue is full
+	 */
+	bool push( T&& value ){
+		size_t pos = this->enqueue_pos.load( std::memory_order_relaxed );
+		Cell* cell;
+
+		for( ;; ){
+			cell = &this->buffer[pos & this->mask];
+			size_t seq = cell->sequence.load( std::memory_order_acquire );
+			intptr_t diff = static_cast<intptr_t>( seq ) - static_cast<intptr_t>( pos );
+
+			if( diff == 0 ){
+				if( this->enqueue_pos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) ){
+					break;
+				}
+			}else if( diff < 0 ){
+				return false; // Full
+			}else{
+				pos = this->enqueue_pos.load( std::memory_order_relaxed );
+			}
+		}
+
+		cell->data = std::move( value );
+		cell->sequence.store( pos + 1, std::memory_order_release );
+
+		return true;
+	}
+
+	bool push( const T& value ){
+		T copy = value;
+
+		return this->push( std::move( copy ) );
+	}
+
+	/**
+	 * Pop the oldest element (consumer thread only)
+	 * @param value: Output parameter for the popped element
+	 * @return false if the queue is empty
+	 */
+	bool pop( T& value ){
+		size_t pos = this->dequeue_pos.load( std::memory_order_relaxed );
+		Cell* cell = &this->buffer[pos & this->mask];
+		size_t seq = cell->sequence.load( std::memory_order_acquire );
+
+		if( seq != pos + 1 ){
+			return false; // Empty, or a producer has not finished writing yet
+		}
+
+		value = std::move( cell->data );
+		cell->sequence.store( pos + this->mask + 1, std::memory_order_release );
+		this->dequeue_pos.store( pos + 1, std::memory_order_relaxed );
+
+		return true;
+	}
+
+	/**
+	 * Move every available element into a local vector (consumer thread only)
+	 * @param out: Elements are appended in FIFO order
+	 * @return Number of elements drained
+	 */
+	size_t drain( std::vector<T>& out ){
+		size_t count = 0;
+		T value;
+
+		while( this->pop( value ) ){
+			out.push_back( std::move( value ) );
+			count++;
+		}
+
+		return count;
+	}
+
+	/**
+	 * Approximate number of queued elements (any thread)
+	 */
+	size_t size_approx() const {
+		size_t enqueued = this->enqueue_pos.load( std::memory_order_relaxed );
+		size_t dequeued = this->dequeue_pos.load( std::memory_order_relaxed );
+
+		return enqueued > dequeued ? enqueued - dequeued : 0;
+	}
+
+	size_t capacity() const {
+		return this->mask + 1;
+	}
+};
+
+#endif /* MPSC_QUEUE_HPP */
@@ -0,0 +1,196 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#include "showmsg.hpp"
+#include "timer.hpp"
+
+// Values below 16ns have a bucket each, above that every power of 2 is split into 4 buckets
+#define PROFILER_EXACT 16
+#define PROFILER_BUCKETS 256
+
+struct s_profiler_section {
+	std::string name;
+	uint64 calls;
+	uint64 total;
+	uint64 max;
+	uint32 histogram[PROFILER_BUCKETS];
+};
+
+bool profiler_enabled = false;
+static std::vector<s_profiler_section> profiler_sections;
+static uint64 profiler_since = 0; // start of the current sample window
+
+static uint32 profiler_bucket( uint64 value ){
+	if( value < PROFILER_EXACT ){
+		return (uint32)value;
+	}
+
+	// Index of the highest bit
+	uint32 bit = 0;
+
+	for( uint32 step = 32; step > 0; step >>= 1 ){
+		if( value >> ( bit + step ) ){
+			bit += step;
+		}
+	}
+
+	return PROFILER_EXACT + ( bit - 4 ) * 4 + (uint32)( ( value >> ( bit - 2 ) ) & 3 );
+}
+
+/// Largest value that falls into a bucket
+static uint64 profiler_bucket_limit( uint32 bucket ){
+	if( bucket < PROFILER_EXACT ){
+		return bucket;
+	}
+
+	uint32 bit = ( bucket - PROFILER_EXACT ) / 4 + 4;
+	uint64 sub = ( bucket - PROFILER_EXACT ) % 4;
+
+	return ( ( 5 + sub ) << ( bit - 2 ) ) - 1;
+}
+
+/// Estimate a percentile of a section, rounded up to the limit of its bucket
+static uint64 profiler_percentile( const s_profiler_section& section, uint32 percent ){
+	uint64 rank = ( section.calls * percent + 99 ) / 100;
+	uint64 seen = 0;
+
+	for( uint32 bucket = 0; bucket < PROFILER_BUCKETS; bucket++ ){
+		seen += section.histogram[bucket];
+
+		if( seen >= rank && seen > 0 ){
+			return std::min( profiler_bucket_limit( bucket ), section.max );
+		}
+	}
+
+	return section.max;
+}
+
+/**
+ * Register a section
+ * @param name: Name shown in the reports
+ * @return Id of the section for profiler_record
+ */
+int32 profiler_add_section( const char* name ){
+	s_profiler_section section = {};
+
+	section.name = name;
+	profiler_sections.push_back( section );
+
+	return (int32)( profiler_sections.size() - 1 );
+}
+
+/**
+ * Add a sample to a section
+ * @param section: Id returned by profiler_add_section
+ * @param nanoseconds: Wall time spent in the section
+ */
+void profiler_record( int32 section, uint64 nanoseconds ){
+	s_profiler_section& entry = profiler_sections[section];
+
+	entry.calls++;
+	entry.total += nanoseconds;
+	entry.max = std::max( entry.max, nanoseconds );
+	entry.histogram[profiler_bucket( nanoseconds )]++;
+}
+
+/**
+ * Turn sampling on or off, enabling it starts a new sample window
+ */
+void profiler_enable( bool enable ){
+	if( enable && !profiler_enabled ){
+		profiler_reset();
+	}
+
+	profiler_enabled = enable;
+}
+
+/**
+ * Drop all samples, the sections stay registered
+ */
+void profiler_reset(){
+	for( s_profiler_section& section : profiler_sections ){
+		section.calls = 0;
+		section.total = 0;
+		section.max = 0;
+		memset( section.histogram, 0, sizeof( section.histogram ) );
+	}
+
+	profiler_since = profiler_clock();
+}
+
+/**
+ * Describe the sections with the most total time, one line per section
+ * @param lines: Receives the header and the section lines
+ * @param limit: Maximum number of sections
+ */
+void profiler_report( std::vector<std::string>& lines, size_t limit ){
+	std::vector<const s_profiler_section*> used;
+	uint64 total = 0;
+	char line[256];
+
+	for( const s_profiler_section& section : profiler_sections ){
+		if( section.calls > 0 ){
+			used.push_back( &section );
+			total += section.total;
+		}
+	}
+
+	std::sort( used.begin(), used.end(), []( const s_profiler_section* a, const s_profiler_section* b ){
+		return a->total > b->total;
+	} );
+
+	snprintf( line, sizeof( line ), "%.1f seconds sampled, %.2f ms spent in %d sections%s", ( profiler_clock() - profiler_since ) / 1e9, total / 1e6, (int32)used.size(), profiler_enabled ? "" : " (disabled)" );
+	lines.push_back( line );
+
+	for( size_t i = 0; i < used.size() && i < limit; i++ ){
+		const s_profiler_section& section = *used[i];
+
+		snprintf( line, sizeof( line ), "%-32s %9" PRIu64 " calls %10.2f ms | avg %.1f p50 %.1f p99 %.1f max %.1f us",
+			section.name.c_str(), section.calls, section.total / 1e6, section.total / 1e3 / section.calls,
+			profiler_percentile( section, 50 ) / 1e3, profiler_percentile( section, 99 ) / 1e3, section.max / 1e3 );
+		lines.push_back( line );
+	}
+}
+
+/**
+ * Append a report of all sections to a file
+ * @param filename: File to append to
+ * @param reset: Start a new sample window afterwards
+ * @return false if the file could not be opened
+ */
+bool profiler_dump( const char* filename, bool reset ){
+	FILE* fp = fopen( filename, "a" );
+
+	if( fp == nullptr ){
+		ShowError( "profiler_dump: Could not open '%s' for writing.\n", filename );
+		return false;
+	}
+
+	std::vector<std::string> lines;
+	char timestring[255];
+
+	profiler_report( lines, profiler_sections.size() );
+	timestamp2string( timestring, sizeof( timestring ), time( nullptr ), "%Y-%m-%d %H:%M:%S" );
+
+	fprintf( fp, "[%s] %s\n", timestring, lines[0].c_str() );
+
+	for( size_t i = 1; i < lines.size(); i++ ){
+		fprintf( fp, "  %s\n", lines[i].c_str() );
+	}
+
+	fclose( fp );
+
+	if( reset ){
+		profiler_reset();
+	}
+
+	return true;
+}
@@ -0,0 +1,37 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "cbasetypes.hpp"
+
+/**
+ * Wall time profiler for named code sections (timer functions, packet handlers, ...)
+ * Every section counts its calls, the total and the maximum time and keeps a
+ * histogram with 4 buckets per power of 2, from which the percentiles are
+ * estimated with an error of at most 25%.
+ * While it is disabled the callers only test profiler_enabled, while it is
+ * enabled a sample costs two clock reads and a few additions.
+ */
+
+extern bool profiler_enabled;
+
+/// Monotonic clock in nanoseconds
+static inline uint64 profiler_clock(){
+	return (uint64)std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+int32 profiler_add_section( const char* name );
+void profiler_record( int32 section, uint64 nanoseconds );
+
+void profiler_enable( bool enable );
+void profiler_reset();
+void profiler_report( std::vector<std::string>& lines, size_t limit );
+bool profiler_dump( const char* filename, bool reset );
+
+#endif /* PROFILER_HPP */
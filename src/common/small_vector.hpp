@@ -0,0 +1,105 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef SMALL_VECTOR_HPP
+#define SMALL_VECTOR_HPP
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+/**
+ * Vector that keeps its first N elements inline
+ * Meant for short lived lists on the stack, which then only reach the heap
+ * when they outgrow N. Only holds trivially copyable types, so growing is a
+ * plain memcpy. The heap is reached through the C allocator, not through
+ * aMalloc, so worker threads may use it as well.
+ */
+template <typename T, size_t N> class SmallVector {
+	static_assert( std::is_trivially_copyable<T>::value, "SmallVector only holds trivially copyable types" );
+	static_assert( N > 0, "SmallVector needs an inline capacity" );
+
+private:
+	T inline_data[N];
+	T* elements;
+	size_t count;
+	size_t capacity;
+
+	void grow(){
+		size_t new_capacity = this->capacity * 2;
+		T* grown = static_cast<T*>( std::malloc( new_capacity * sizeof( T ) ) );
+
+		if( grown == nullptr ){
+			throw std::bad_alloc();
+		}
+
+		std::memcpy( grown, this->elements, this->count * sizeof( T ) );
+
+		if( this->elements != this->inline_data ){
+			std::free( this->elements );
+		}
+
+		this->elements = grown;
+		this->capacity = new_capacity;
+	}
+
+public:
+	SmallVector() : elements( inline_data ), count( 0 ), capacity( N ){}
+
+	~SmallVector(){
+		if( this->elements != this->inline_data ){
+			std::free( this->elements );
+		}
+	}
+
+	SmallVector( const SmallVector& ) = delete;
+	SmallVector& operator=( const SmallVector& ) = delete;
+
+	void push_back( const T& value ){
+		if( this->count == this->capacity ){
+			this->grow();
+		}
+
+		this->elements[this->count++] = value;
+	}
+
+	/// Removes all elements, but keeps the memory
+	void clear(){
+		this->count = 0;
+	}
+
+	size_t size() const {
+		return this->count;
+	}
+
+	bool empty() const {
+		return this->count == 0;
+	}
+
+	T& operator[]( size_t index ){
+		return this->elements[index];
+	}
+
+	const T& operator[]( size_t index ) const {
+		return this->elements[index];
+	}
+
+	T* begin(){
+		return this->elements;
+	}
+
+	T* end(){
+		return this->elements + this->count;
+	}
+
+	const T* begin() const {
+		return this->elements;
+	}
+
+	const T* end() const {
+		return this->elements + this->count;
+	}
+};
+
+#endif /* SMALL_VECTOR_HPP */
@@ -4,6 +4,7 @@
 #include "socket.hpp"
 
 #include <cstdlib>
+#include <deque>
 
 #ifdef WIN32
 	#include "winapi.hpp"
@@ -15,10 +16,12 @@
 	#include <sys/ioctl.h>
 	#include <sys/socket.h>
 	#include <sys/time.h>
+	#include <sys/uio.h>
 	#include <unistd.h>
 
 	#if defined(__linux__) || defined(__linux)
 		#include <linux/tcp.h>
+		#include <sys/eventfd.h>
 
 		#ifdef SOCKET_EPOLL
 			#include <sys/epoll.h>
@@ -44,8 +47,26 @@
 #include "malloc.hpp"
 #include "mmo.hpp"
 #include "showmsg.hpp"
+#include "socket_io.hpp"
+#include "socket_uring.hpp"
 #include "strlib.hpp"
 #include "timer.hpp"
+#include "utils.hpp"
+#include "watchdog.hpp"
+
+#if defined(SOCKET_EPOLL) && !defined(MINICORE)
+	// Client connections can be handled by network I/O threads
+	#define SOCKET_IO
+#endif
+
+#ifndef WIN32
+	// Shared packets are sent straight from their buffer with sendmsg()
+	#define SOCKET_SHARED_PACKETS
+#endif
+
+#if defined(SOCKET_IO_URING) && !defined(SOCKET_EPOLL)
+	#error SOCKET_IO_URING requires SOCKET_EPOLL
+#endif
 
 // Reuseable global packet buffer to prevent too many allocations
 // Take socket.cpp::socket_max_client_packet into consideration
@@ -230,6 +251,19 @@ char* sErr(int32 code)
 	static struct epoll_event *epevents = nullptr;
 #endif
 
+#ifdef SOCKET_IO
+	// Number of network I/O threads for client connections, 0 to handle them on the main thread
+	static int32 socket_io_thread_count = 0;
+	static int32 socket_io_wakeup = -1;
+#endif
+
+#ifdef SOCKET_IO_URING
+	// Batch the sends and receives of a cycle into io_uring submissions, falls back to plain epoll if unsupported
+	static bool socket_io_uring = true;
+	static int32 socket_io_uring_entries = 1024;
+	static SocketUring socket_uring;
+#endif
+
 int32 fd_max;
 time_t last_tick;
 time_t stall_time = 60;
@@ -270,6 +304,40 @@ size_t send_shortlist_count = 0;// how many fd's are in the shortlist
 uint32 send_shortlist_set[(MAXCONN+31)/32];// to know if specific fd's are already in the shortlist
 #endif
 
+#ifdef SOCKET_SHARED_PACKETS
+// Maximum number of buffers handed to a single sendmsg()
+#define SENDLIST_IOV_MAX 64
+
+struct s_socket_sendlist_entry {
+	size_t wpos;	// WFIFO data queued before this packet
+	size_t offset;	// Bytes of the packet that were already sent
+	SharedPacket packet;
+};
+
+/// Shared packets of a connection, in the order they were queued
+struct s_socket_sendlist {
+	std::deque<s_socket_sendlist_entry> entries;
+	size_t size = 0; // Unsent bytes of all entries
+};
+#endif
+
+// Maximum number of replaceable packets tracked per connection
+#define COALESCE_MAX_ENTRIES 64
+
+struct s_socket_coalesce_entry {
+	uint64 key;
+	size_t pos;	// Offset of the packet in the WFIFO
+	size_t len;
+};
+
+/// Unsent packets of a connection that a newer packet with the same key replaces
+struct s_socket_coalesce {
+	std::vector<s_socket_coalesce_entry> entries;
+};
+
+// Number of packets replaced by a newer one before they were sent, by packet type
+static std::unordered_map<uint16, uint64> coalesce_elided;
+
 static int32 create_session(int32 fd, RecvFunc func_recv, SendFunc func_send, ParseFunc func_parse);
 
 #ifndef MINICORE
@@ -368,6 +436,45 @@ void set_eof(int32 fd)
 	}
 }
 
+/// The first len bytes of the WFIFO were sent, packets in there can no longer be replaced
+static void wfifo_consumed(int32 fd, size_t len)
+{
+	struct s_socket_coalesce* coalesce = session[fd]->coalesce;
+
+	if( coalesce == nullptr || len == 0 )
+		return;
+
+	for( auto it = coalesce->entries.begin(); it != coalesce->entries.end(); ) {
+		if( it->pos < len ) {
+			it = coalesce->entries.erase(it);
+		} else {
+			it->pos -= len;
+			++it;
+		}
+	}
+}
+
+/// Accounts len bytes received into the RFIFO
+static void recv_to_fifo_done(int32 fd, int32 len)
+{
+	if( len == 0 )
+	{//Normal connection end.
+		set_eof(fd);
+		return;
+	}
+
+	session[fd]->rdata_size += len;
+	session[fd]->rdata_tick = last_tick;
+#ifdef SHOW_SERVER_STATS
+	socket_data_i += len;
+	socket_data_qi += len;
+	if (!session[fd]->flag.server)
+	{
+		socket_data_ci += len;
+	}
+#endif
+}
+
 int32 recv_to_fifo(int32 fd)
 {
 	int32 len;
@@ -386,24 +493,170 @@ int32 recv_to_fifo(int32 fd)
 		return 0;
 	}
 
+	recv_to_fifo_done(fd, len);
+	return 0;
+}
+
+/// Number of bytes waiting to be sent, WFIFO data and shared packets
+static size_t session_output_size(int32 fd)
+{
+	size_t size = session[fd]->wdata_size;
+
+#ifdef SOCKET_SHARED_PACKETS
+	if( session[fd]->sendlist != nullptr )
+		size += session[fd]->sendlist->size;
+#endif
+
+	return size;
+}
+
+/// The connection failed while sending
+static void send_from_fifo_failed(int32 fd)
+{
+#ifdef SHOW_SERVER_STATS
+	socket_data_qo -= session_output_size(fd);
+#endif
+	wfifo_consumed(fd, session[fd]->wdata_size);
+	session[fd]->wdata_size = 0; //Clear the send queue as we can't send anymore. [Skotlex]
+#ifdef SOCKET_SHARED_PACKETS
+	if( session[fd]->sendlist != nullptr ) {
+		session[fd]->sendlist->entries.clear();
+		session[fd]->sendlist->size = 0;
+	}
+#endif
+	set_eof(fd);
+}
+
+/// Removes len sent bytes from the WFIFO
+static void send_from_fifo_done(int32 fd, int32 len)
+{
+	if( len > 0 )
+	{
+		session[fd]->wdata_tick = last_tick;
+
+		// some data could not be transferred?
+		// shift unsent data to the beginning of the queue
+		if( (size_t)len < session[fd]->wdata_size )
+			memmove(session[fd]->wdata, session[fd]->wdata + len, session[fd]->wdata_size - len);
+
+		session[fd]->wdata_size -= len;
+		wfifo_consumed(fd, len);
+#ifdef SHOW_SERVER_STATS
+		socket_data_o += len;
+		socket_data_qo -= len;
+		if (!session[fd]->flag.server)
+		{
+			socket_data_co += len;
+		}
+#endif
+	}
+}
+
+#ifdef SOCKET_SHARED_PACKETS
+/// Sends the WFIFO together with the shared packets queued in between with a single sendmsg()
+static int32 send_from_sendlist(int32 fd)
+{
+	struct socket_data* s = session[fd];
+	struct s_socket_sendlist* list = s->sendlist;
+	struct iovec iov[SENDLIST_IOV_MAX];
+	struct msghdr msg = {};
+	size_t count = 0, packets = 0, cursor = 0;
+	ssize_t len;
+
+	for( const s_socket_sendlist_entry& entry : list->entries ) {
+		// keep room for this entry and the WFIFO data around it
+		if( count + 3 > SENDLIST_IOV_MAX )
+			break;
+
+		if( entry.wpos > cursor ) {
+			iov[count].iov_base = s->wdata + cursor;
+			iov[count].iov_len = entry.wpos - cursor;
+			count++;
+			cursor = entry.wpos;
+		}
+
+		iov[count].iov_base = (void*)( entry.packet->data() + entry.offset );
+		iov[count].iov_len = entry.packet->size() - entry.offset;
+		count++;
+		packets++;
+	}
+
+	if( packets == list->entries.size() && cursor < s->wdata_size ) {
+		iov[count].iov_base = s->wdata + cursor;
+		iov[count].iov_len = s->wdata_size - cursor;
+		count++;
+	}
+
+	msg.msg_iov = iov;
+	msg.msg_iovlen = count;
+
+	len = sendmsg(fd, &msg, MSG_NOSIGNAL);
+
+	if( len == SOCKET_ERROR )
+	{//An exception has occured
+		if( sErrno != S_EWOULDBLOCK )
+			send_from_fifo_failed(fd);
+		return 0;
+	}
+
 	if( len == 0 )
-	{//Normal connection end.
-		set_eof(fd);
 		return 0;
+
+	// walk the sent bytes through the WFIFO data and the packets in the order they were sent
+	size_t left = len;
+
+	cursor = 0;
+	while( left > 0 && !list->entries.empty() ) {
+		s_socket_sendlist_entry& entry = list->entries.front();
+
+		if( entry.wpos > cursor ) {
+			size_t chunk = std::min(left, entry.wpos - cursor);
+
+			cursor += chunk;
+			left -= chunk;
+
+			if( cursor < entry.wpos )
+				break;
+		}
+
+		size_t chunk = std::min(left, entry.packet->size() - entry.offset);
+
+		entry.offset += chunk;
+		left -= chunk;
+		list->size -= chunk;
+
+		if( entry.offset < entry.packet->size() )
+			break;
+
+		list->entries.pop_front();
 	}
+	cursor += left; // the rest came from the WFIFO data behind the last packet
 
-	session[fd]->rdata_size += len;
-	session[fd]->rdata_tick = last_tick;
+	// shift unsent data to the beginning of the queue
+	if( cursor > 0 ) {
+		if( cursor < s->wdata_size )
+			memmove(s->wdata, s->wdata + cursor, s->wdata_size - cursor);
+
+		s->wdata_size -= cursor;
+		wfifo_consumed(fd, cursor);
+
+		for( s_socket_sendlist_entry& entry : list->entries )
+			entry.wpos -= cursor;
+	}
+
+	s->wdata_tick = last_tick;
 #ifdef SHOW_SERVER_STATS
-	socket_data_i += len;
-	socket_data_qi += len;
-	if (!session[fd]->flag.server)
+	socket_data_o += len;
+	socket_data_qo -= len;
+	if (!s->flag.server)
 	{
-		socket_data_ci += len;
+		socket_data_co += len;
 	}
 #endif
+
 	return 0;
 }
+#endif
 
 int32 send_from_fifo(int32 fd)
 {
@@ -412,6 +665,11 @@ int32 send_from_fifo(int32 fd)
 	if( !session_isValid(fd) )
 		return -1;
 
+#ifdef SOCKET_SHARED_PACKETS
+	if( session[fd]->sendlist != nullptr && !session[fd]->sendlist->entries.empty() )
+		return send_from_sendlist(fd);
+#endif
+
 	if( session[fd]->wdata_size == 0 )
 		return 0; // nothing to send
 
@@ -421,38 +679,190 @@ int32 send_from_fifo(int32 fd)
 	{//An exception has occured
 		if( sErrno != S_EWOULDBLOCK ) {
 			//ShowDebug("send_from_fifo: %s, ending connection #%d\n", error_msg(), fd);
-#ifdef SHOW_SERVER_STATS
-			socket_data_qo -= session[fd]->wdata_size;
-#endif
-			session[fd]->wdata_size = 0; //Clear the send queue as we can't send anymore. [Skotlex]
+			send_from_fifo_failed(fd);
+		}
+		return 0;
+	}
+
+	send_from_fifo_done(fd, len);
+	return 0;
+}
+
+#ifdef SOCKET_IO_URING
+static void uring_recv_complete(uint64 user_data, int32 result)
+{
+	int32 fd = (int32)user_data;
+
+	if( result < 0 ) {
+		if( result != -EAGAIN && result != -EINTR )
 			set_eof(fd);
+		return;
+	}
+
+	recv_to_fifo_done(fd, result);
+}
+
+static void uring_send_complete(uint64 user_data, int32 result)
+{
+	int32 fd = (int32)user_data;
+
+	if( result < 0 ) {
+		if( result != -EAGAIN && result != -EINTR )
+			send_from_fifo_failed(fd);
+		return;
+	}
+
+	send_from_fifo_done(fd, result);
+}
+
+/// Hands the queued requests to the kernel, switches back to plain recv/send if the ring failed
+static void uring_submit(void (*on_complete)(uint64 user_data, int32 result))
+{
+	if( socket_uring.submit(on_complete) < 0 ) {
+		ShowWarning("Disabling io_uring, falling back to '" CL_WHITE "epoll" CL_RESET "'.\n");
+		socket_uring.final();
+	}
+}
+
+/// Whether the WFIFO of the connection is sent by the batch of uring_send_shortlist
+static bool uring_sends(int32 fd)
+{
+	return socket_uring.is_active() && session[fd]->func_send == send_from_fifo && session_output_size(fd) == session[fd]->wdata_size;
+}
+
+/// Queues a recv into the RFIFO of a ready connection, submits first if the batch is full
+static bool uring_queue_recv(int32 fd)
+{
+	if( !socket_uring.is_active() || session[fd]->func_recv != recv_to_fifo )
+		return false;
+
+	if( socket_uring.pending() == socket_uring.capacity() ) {
+		uring_submit(uring_recv_complete);
+
+		if( !socket_uring.is_active() )
+			return false;
+	}
+
+	return socket_uring.prep_recv(fd, session[fd]->rdata + session[fd]->rdata_size, RFIFOSPACE(fd), fd);
+}
+
+/// Sends the WFIFO of every shortlisted connection in as few submissions as possible
+static void uring_send_shortlist()
+{
+	if( !socket_uring.is_active() )
+		return;
+
+	for( size_t i = 0; i < send_shortlist_count; i++ ) {
+		int32 fd = send_shortlist_array[i];
+
+		if( !session_isValid(fd) || !uring_sends(fd) || session[fd]->wdata_size == 0 )
+			continue;
+
+		if( socket_uring.pending() == socket_uring.capacity() ) {
+			uring_submit(uring_send_complete);
+
+			if( !socket_uring.is_active() )
+				return;
 		}
+
+		socket_uring.prep_send(fd, session[fd]->wdata, session[fd]->wdata_size, fd);
+	}
+
+	uring_submit(uring_send_complete);
+}
+#endif
+
+#ifdef SOCKET_IO
+/// Copies what the I/O thread received into the RFIFO
+static int32 io_recv_from_ring(int32 fd)
+{
+	struct socket_data* s;
+	size_t len;
+
+	if( !session_isActive(fd) )
+		return -1;
+
+	s = session[fd];
+	len = s->io->in.read(s->rdata + s->rdata_size, RFIFOSPACE(fd));
+
+	if( len > 0 )
+	{
+		s->rdata_size += len;
+		s->rdata_tick = last_tick;
+#ifdef SHOW_SERVER_STATS
+		socket_data_i += len;
+		socket_data_qi += len;
+		socket_data_ci += len;
+#endif
+	}
+
+	// The I/O thread stopped reading because the ring was full
+	if( s->io->rx_paused.load(std::memory_order_relaxed) && s->io->rx_paused.exchange(false) )
+		socket_io_resume(s->io);
+
+	// Only close once everything received before the connection ended was parsed
+	if( s->io->eof && s->io->in.size_approx() == 0 && len == 0 )
+		set_eof(fd);
+
+	return 0;
+}
+
+/// Moves the WFIFO into the output ring of the I/O thread
+static int32 io_send_to_ring(int32 fd)
+{
+	struct socket_data* s;
+	size_t len;
+
+	if( !session_isValid(fd) )
+		return -1;
+
+	s = session[fd];
+
+	if( s->wdata_size == 0 )
+		return 0; // nothing to send
+
+	if( s->io->eof )
+	{
+#ifdef SHOW_SERVER_STATS
+		socket_data_qo -= s->wdata_size;
+#endif
+		wfifo_consumed(fd, s->wdata_size);
+		s->wdata_size = 0; // Clear the send queue as we can't send anymore.
+		set_eof(fd);
 		return 0;
 	}
 
+	len = s->io->out.write(s->wdata, s->wdata_size);
+
 	if( len > 0 )
 	{
-		session[fd]->wdata_tick = last_tick;
+		s->wdata_tick = last_tick;
 
-		// some data could not be transferred?
-		// shift unsent data to the beginning of the queue
-		if( (size_t)len < session[fd]->wdata_size )
-			memmove(session[fd]->wdata, session[fd]->wdata + len, session[fd]->wdata_size - len);
+		// what does not fit stays in the WFIFO until the I/O thread caught up
+		if( len < s->wdata_size )
+			memmove(s->wdata, s->wdata + len, s->wdata_size - len);
 
-		session[fd]->wdata_size -= len;
+		s->wdata_size -= len;
+		wfifo_consumed(fd, len);
 #ifdef SHOW_SERVER_STATS
 		socket_data_o += len;
 		socket_data_qo -= len;
-		if (!session[fd]->flag.server)
-		{
-			socket_data_co += len;
-		}
+		socket_data_co += len;
 #endif
+		socket_io_flush(s->io);
 	}
 
 	return 0;
 }
 
+/// I/O threads signal the main thread when a connection has new data
+static int32 io_wakeup_recv(int32 fd)
+{
+	wakeup_event_consume(fd);
+	return 0;
+}
+#endif
+
 /// Best effort - there's no warranty that the data will be sent.
 void flush_fifo(int32 fd)
 {
@@ -506,6 +916,19 @@ int32 connect_client(int32 listen_fd)
 	}
 #endif
 
+#ifdef SOCKET_IO
+	if( session[listen_fd]->flag.io && socket_io_enabled() ) {
+		// recv/send happen on an I/O thread, the main thread only parses
+		if( fd_max <= fd ) fd_max = fd + 1;
+
+		create_session(fd, io_recv_from_ring, io_send_to_ring, default_func_parse);
+		session[fd]->client_addr = ntohl(client_address.sin_addr.s_addr);
+		session[fd]->io = socket_io_attach(fd);
+
+		return fd;
+	}
+#endif
+
 #ifndef SOCKET_EPOLL
 	// Select Based Event Dispatcher
 	sFD_SET(fd,&readfds);
@@ -598,6 +1021,29 @@ int32 make_listen_bind(uint32 ip, uint16 port)
 	return fd;
 }
 
+/// Like make_listen_bind, but the accepted connections are handed to the network
+/// I/O threads if socket_io_threads is enabled. The threads are started with the
+/// first such listen socket.
+/// Only for game clients, server links of the same server stay on the main thread.
+int32 make_listen_bind_io(uint32 ip, uint16 port)
+{
+	int32 fd = make_listen_bind(ip, port);
+
+	if( fd == -1 )
+		return -1;
+
+	session[fd]->flag.io = 1;
+
+#ifdef SOCKET_IO
+	if( socket_io_thread_count > 0 && socket_io_wakeup == -1 ) {
+		socket_io_wakeup = make_wakeup_event(io_wakeup_recv);
+		socket_io_init(socket_io_thread_count, socket_io_wakeup);
+	}
+#endif
+
+	return fd;
+}
+
 int32 make_connection(uint32 ip, uint16 port, bool silent,int32 timeout) {
 	struct sockaddr_in remote_address;
 	int32 fd;
@@ -723,6 +1169,77 @@ int32 make_connection(uint32 ip, uint16 port, bool silent,int32 timeout) {
 	return fd;
 }
 
+/// Creates a wakeup event that other threads can signal to interrupt the
+/// select/epoll wait in do_sockets. func_recv is called on the main thread
+/// once the event was signaled and has to call wakeup_event_consume.
+/// Returns the event's fd, or -1 if the platform does not support it.
+int32 make_wakeup_event(RecvFunc func_recv)
+{
+#if defined(__linux__) || defined(__linux)
+	int32 fd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+
+	if( fd == -1 ){
+		ShowError( "make_wakeup_event: eventfd creation failed (%s)!\n", error_msg() );
+		return -1;
+	}
+	if( fd == 0 || fd >= MAXCONN ){
+		ShowError( "make_wakeup_event: New event #%d is out of range (MAXCONN=%d)!\n", fd, MAXCONN );
+		sClose( fd );
+		return -1;
+	}
+
+#ifndef SOCKET_EPOLL
+	// Select Based Event Dispatcher
+	sFD_SET(fd,&readfds);
+#else
+	// Epoll based Event Dispatcher
+	epevent.data.fd = fd;
+	epevent.events = EPOLLIN;
+
+	if( epoll_ctl( epfd, EPOLL_CTL_ADD, fd, &epevent ) == SOCKET_ERROR ){
+		ShowError( "make_wakeup_event: failed to add event #%d to epoll event dispatcher: %s\n", fd, error_msg() );
+		sClose( fd );
+		return -1;
+	}
+#endif
+
+	if( fd_max <= fd ) fd_max = fd + 1;
+
+	create_session(fd, func_recv, null_send, null_parse);
+	session[fd]->client_addr = 0; // not a connection
+	session[fd]->rdata_tick = 0; // disable timeouts on this event
+	session[fd]->wdata_tick = 0;
+
+	return fd;
+#else
+	return -1;
+#endif
+}
+
+/// Signals a wakeup event. Safe to call from any thread.
+void wakeup_event_signal(int32 fd)
+{
+#if defined(__linux__) || defined(__linux)
+	uint64 value = 1;
+
+	if( write( fd, &value, sizeof( value ) ) == -1 && errno != EAGAIN ){
+		ShowError( "wakeup_event_signal: failed to signal event #%d: %s\n", fd, error_msg() );
+	}
+#endif
+}
+
+/// Resets a signaled wakeup event, must be called from its func_recv.
+void wakeup_event_consume(int32 fd)
+{
+#if defined(__linux__) || defined(__linux)
+	uint64 value;
+
+	if( read( fd, &value, sizeof( value ) ) == -1 && errno != EAGAIN ){
+		ShowError( "wakeup_event_consume: failed to reset event #%d: %s\n", fd, error_msg() );
+	}
+#endif
+}
+
 static int32 create_session(int32 fd, RecvFunc func_recv, SendFunc func_send, ParseFunc func_parse)
 {
 	CREATE(session[fd], struct socket_data, 1);
@@ -744,8 +1261,12 @@ static void delete_session(int32 fd)
 	{
 #ifdef SHOW_SERVER_STATS
 		socket_data_qi -= session[fd]->rdata_size - session[fd]->rdata_pos;
-		socket_data_qo -= session[fd]->wdata_size;
+		socket_data_qo -= session_output_size(fd);
 #endif
+#ifdef SOCKET_SHARED_PACKETS
+		delete session[fd]->sendlist;
+#endif
+		delete session[fd]->coalesce;
 		aFree(session[fd]->rdata);
 		aFree(session[fd]->wdata);
 		aFree(session[fd]->session_data);
@@ -860,7 +1381,7 @@ int32 WFIFOSET(int32 fd, size_t len)
 			return 0;
 		}
 
-		if( s->wdata_size+len > WFIFO_MAX ) {// reached maximum write fifo size
+		if( session_output_size(fd)+len > WFIFO_MAX ) {// reached maximum write fifo size
 			ShowError("WFIFOSET: Maximum write buffer size for client connection %d exceeded, most likely caused by packet 0x%04x (len=%" PRIuPTR ", ip=%lu.%lu.%lu.%lu).\n", fd, WFIFOW(fd,0), len, CONVIP(s->client_addr));
 			set_eof(fd);
 			return 0;
@@ -889,6 +1410,113 @@ int32 WFIFOSET(int32 fd, size_t len)
 	return 0;
 }
 
+/// Builds a packet that can be queued for several connections with WFIFOSHARE
+SharedPacket socket_shared_packet(const void* buf, size_t len)
+{
+	return std::make_shared<const std::vector<uint8>>((const uint8*)buf, (const uint8*)buf + len);
+}
+
+/// Queues a shared packet for sending, like WFIFOHEAD/memcpy/WFIFOSET.
+/// Client connections reference the packet in their send list, so a broadcast
+/// is built once and sent from the same buffer to every recipient.
+/// Other connections get a copy in their WFIFO.
+int32 WFIFOSHARE(int32 fd, const SharedPacket& packet)
+{
+	size_t len = packet->size();
+
+	if( !session_isValid(fd) || session[fd]->wdata == nullptr || len == 0 )
+		return 0;
+
+#ifdef SOCKET_SHARED_PACKETS
+	struct socket_data* s = session[fd];
+
+	if( !s->flag.server && s->func_send == send_from_fifo ) {
+		if( len > socket_max_client_packet ) {// see declaration of socket_max_client_packet for details
+			ShowError("WFIFOSHARE: Dropped too large client packet 0x%04x (length=%" PRIuPTR ", max=%" PRIuPTR ").\n", *(uint16*)packet->data(), len, socket_max_client_packet);
+			return 0;
+		}
+
+		if( session_output_size(fd)+len > WFIFO_MAX ) {// reached maximum write fifo size
+			ShowError("WFIFOSHARE: Maximum write buffer size for client connection %d exceeded, most likely caused by packet 0x%04x (len=%" PRIuPTR ", ip=%lu.%lu.%lu.%lu).\n", fd, *(uint16*)packet->data(), len, CONVIP(s->client_addr));
+			set_eof(fd);
+			return 0;
+		}
+
+		if( s->sendlist == nullptr )
+			s->sendlist = new s_socket_sendlist();
+
+		s->sendlist->entries.push_back({ s->wdata_size, 0, packet });
+		s->sendlist->size += len;
+#ifdef SHOW_SERVER_STATS
+		socket_data_qo += len;
+#endif
+#ifdef SEND_SHORTLIST
+		send_shortlist_add_fd(fd);
+#endif
+		return 0;
+	}
+#endif
+
+	WFIFOHEAD(fd, len);
+	memcpy(WFIFOP(fd, 0), packet->data(), len);
+	return WFIFOSET(fd, len);
+}
+
+/// Like WFIFOSET, but for packets that only carry the latest state of something.
+/// If a packet with the same key and length is the last one waiting in the WFIFO,
+/// it is overwritten with the new one instead of sending both. A packet that was
+/// followed by others is not replaced, the newer state must not overtake them.
+/// @param key: Identifies what the packet describes, for example its packet type and object id
+int32 WFIFOSET_COALESCE(int32 fd, size_t len, uint64 key)
+{
+	struct socket_data* s = session[fd];
+
+	if( !session_isValid(fd) || s->wdata == nullptr )
+		return 0;
+
+	if( s->coalesce == nullptr )
+		s->coalesce = new s_socket_coalesce();
+
+	std::vector<s_socket_coalesce_entry>& entries = s->coalesce->entries;
+
+	for( auto it = entries.begin(); it != entries.end(); ++it ) {
+		if( it->key != key )
+			continue;
+
+		bool last = ( it->pos + it->len == s->wdata_size );
+#ifdef SOCKET_SHARED_PACKETS
+		// shared packets queued after it are not in the WFIFO
+		if( s->sendlist != nullptr && !s->sendlist->entries.empty() && s->sendlist->entries.back().wpos >= it->pos + it->len )
+			last = false;
+#endif
+
+		if( it->len == len && last ) {
+			// the older packet was not sent yet and nothing came after it, replace it
+			memcpy(s->wdata + it->pos, WFIFOP(fd, 0), len);
+			coalesce_elided[WFIFOW(fd, 0)]++;
+			return 0;
+		}
+
+		entries.erase(it);
+		break;
+	}
+
+	size_t pos = s->wdata_size;
+	int32 ret = WFIFOSET(fd, len);
+
+	// only track it if WFIFOSET neither dropped nor sent it
+	if( session[fd] == s && s->wdata_size == pos + len && entries.size() < COALESCE_MAX_ENTRIES )
+		entries.push_back({ key, pos, len });
+
+	return ret;
+}
+
+/// Number of packets WFIFOSET_COALESCE replaced before they were sent, by packet type
+const std::unordered_map<uint16, uint64>& socket_coalesce_stats()
+{
+	return coalesce_elided;
+}
+
 int32 do_sockets(t_tick next)
 {
 #ifndef SOCKET_EPOLL
@@ -907,7 +1535,7 @@ int32 do_sockets(t_tick next)
 		if(!session[i])
 			continue;
 
-		if(session[i]->wdata_size)
+		if(session_output_size(i))
 			session[i]->func_send(i);
 	}
 #endif
@@ -920,7 +1548,9 @@ int32 do_sockets(t_tick next)
 	timeout.tv_usec = (long)(next%1000*1000);
 
 	memcpy(&rfd, &readfds, sizeof(rfd));
+	watchdog_idle_begin();
 	ret = sSelect(fd_max, &rfd, nullptr, nullptr, &timeout);
+	watchdog_idle_end();
 
 	if( ret == SOCKET_ERROR )
 	{
@@ -934,7 +1564,9 @@ int32 do_sockets(t_tick next)
 #else
 	// Epoll based Event Dispatcher
 
+	watchdog_idle_begin();
 	ret = epoll_wait( epfd, epevents, epoll_maxevents, next );
+	watchdog_idle_end();
 
 	if( ret == SOCKET_ERROR ){
 		if( sErrno != S_EINTR ){
@@ -973,9 +1605,21 @@ int32 do_sockets(t_tick next)
 			set_eof( fd );
 		}else if( it->events & EPOLLIN ){
 			// data waiting
+#ifdef SOCKET_IO_URING
+			if( uring_queue_recv( fd ) ){
+				continue;
+			}
+#endif
 			sock->func_recv( fd );
 		}
 	}
+
+#ifdef SOCKET_IO_URING
+	// Receive everything that was queued in a single submission
+	if( socket_uring.pending() > 0 ){
+		uring_submit( uring_recv_complete );
+	}
+#endif
 #else
 	// otherwise assume that the fd_set is a bit-array and enumerate it in a standard way
 	for( i = 1; ret && i < fd_max; ++i )
@@ -997,7 +1641,7 @@ int32 do_sockets(t_tick next)
 		if(!session[i])
 			continue;
 
-		if(session[i]->wdata_size)
+		if(session_output_size(i))
 			session[i]->func_send(i);
 
 		if(session[i]->flag.eof) //func_send can't free a session, this is safe.
@@ -1013,6 +1657,12 @@ int32 do_sockets(t_tick next)
 		if(!session[i])
 			continue;
 
+#ifdef SOCKET_IO
+		// Connections of the I/O threads are not in the event dispatcher, pick up their data here
+		if (session[i]->io)
+			session[i]->func_recv(i);
+#endif
+
 		if (session[i]->rdata_tick && DIFF_TICK(last_tick, session[i]->rdata_tick) > stall_time) {
 			if( session[i]->flag.server ) {/* server is special */
 				if( session[i]->flag.ping != 2 )/* only update if necessary otherwise it'd resend the ping unnecessarily */
@@ -1357,6 +2007,17 @@ int32 socket_config_read(const char* cfgName)
 				epoll_maxevents = 16;
 			}
 		}
+		else if( !strcmpi( w1, "socket_io_threads" ) ){
+			socket_io_thread_count = cap_value( atoi( w2 ), 0, 64 );
+		}
+#endif
+#ifdef SOCKET_IO_URING
+		else if( !strcmpi( w1, "socket_io_uring" ) ){
+			socket_io_uring = config_switch( w2 ) != 0;
+		}
+		else if( !strcmpi( w1, "socket_io_uring_entries" ) ){
+			socket_io_uring_entries = cap_value( atoi( w2 ), 16, 4096 );
+		}
 #endif
 #endif
 		else if (!strcmpi(w1, "import"))
@@ -1373,6 +2034,9 @@ int32 socket_config_read(const char* cfgName)
 void socket_final(void)
 {
 	int32 i;
+
+	for( const auto& it : coalesce_elided )
+		ShowInfo("Coalesced %" PRIu64 " unsent update(s) of packet 0x%04x.\n", it.second, it.first);
 #ifndef MINICORE
 	ConnectHistory* hist;
 	ConnectHistory* next_hist;
@@ -1392,9 +2056,27 @@ void socket_final(void)
 #endif
 
 	for( i = 1; i < fd_max; i++ )
+#ifdef SOCKET_IO
+		if(session[i] && i != socket_io_wakeup)
+#else
 		if(session[i])
+#endif
 			do_close(i);
 
+#ifdef SOCKET_IO
+	// Closes the connections handed back by do_close
+	socket_io_final();
+
+	// The I/O threads signal it until they are stopped
+	if( socket_io_wakeup != -1 && session[socket_io_wakeup] )
+		do_close(socket_io_wakeup);
+	socket_io_wakeup = -1;
+#endif
+
+#ifdef SOCKET_IO_URING
+	socket_uring.final();
+#endif
+
 	// session[0]
 	aFree(session[0]->rdata);
 	aFree(session[0]->wdata);
@@ -1428,6 +2110,16 @@ void do_close(int32 fd)
 
 	flush_fifo(fd); // Try to send what's left (although it might not succeed since it's a nonblocking socket)
 
+#ifdef SOCKET_IO
+	if( session[fd] && session[fd]->io ) {
+		// The I/O thread sends what is left and closes the socket
+		socket_io_detach(session[fd]->io);
+		session[fd]->io = nullptr;
+		delete_session(fd);
+		return;
+	}
+#endif
+
 #ifndef SOCKET_EPOLL
 	// Select based Event Dispatcher
 	sFD_CLR(fd, &readfds);// this needs to be done before closing the socket
@@ -1607,6 +2299,15 @@ void socket_init(void)
 
 	socket_config_read(SOCKET_CONF_FILENAME);
 
+#ifdef SOCKET_IO_URING
+	if( socket_io_uring ) {
+		if( socket_uring.init(socket_io_uring_entries) )
+			ShowInfo("Server uses '" CL_WHITE "io_uring" CL_RESET "' with up to " CL_WHITE "%u" CL_RESET " sends/receives per submission\n", socket_uring.capacity());
+		else
+			ShowWarning("socket_init: io_uring is not supported by this kernel, falling back to '" CL_WHITE "epoll" CL_RESET "'.\n");
+	}
+#endif
+
 	// initialise last send-receive tick
 	last_tick = time(nullptr);
 
@@ -1718,6 +2419,10 @@ void send_shortlist_add_fd(int32 fd)
 // Do pending network sends and eof handling from the shortlist.
 void send_shortlist_do_sends()
 {
+#ifdef SOCKET_IO_URING
+	uring_send_shortlist();
+#endif
+
 	for( int32 i = static_cast<int32>( send_shortlist_count - 1 ); i >= 0; --i ){
 		int32 fd = send_shortlist_array[i];
 		int32 idx = fd/32;
@@ -1744,7 +2449,12 @@ void send_shortlist_do_sends()
 		if( session[fd] )
 		{
 			// Send data
-			if( session[fd]->wdata_size )
+#ifdef SOCKET_IO_URING
+			// Already sent by the batch, do not retry a full socket buffer
+			if( session_output_size(fd) && !uring_sends(fd) )
+#else
+			if( session_output_size(fd) )
+#endif
 				session[fd]->func_send(fd);
 
 			// If it's been marked as eof, call the parse func on it so that
@@ -1754,7 +2464,7 @@ void send_shortlist_do_sends()
 
 			// If the session still exists, is not eof and has things left to
 			// be sent from it we'll re-add it to the shortlist.
-			if( session_isActive(fd) && session[fd]->wdata_size )
+			if( session_isActive(fd) && session_output_size(fd) )
 				send_shortlist_add_fd(fd);
 		}
 	}
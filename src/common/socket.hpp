@@ -5,6 +5,9 @@
 #define SOCKET_HPP
 
 #include <ctime>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
 #include <config/core.hpp>
 
@@ -95,6 +98,7 @@ struct socket_data
 		unsigned char eof : 1;
 		unsigned char server : 1;
 		unsigned char ping : 2;
+		unsigned char io : 1; // listen socket whose connections go to the network I/O threads, see make_listen_bind_io
 	} flag;
 
 	uint32 client_addr; // remote client address
@@ -111,8 +115,17 @@ struct socket_data
 	ParseFunc func_parse;
 
 	void* session_data; // stores application-specific data related to the session
+	struct s_socket_io* io; // recv/send state if the connection is handled by a network I/O thread
+	struct s_socket_sendlist* sendlist; // shared packets queued between the WFIFO data, see WFIFOSHARE
+	struct s_socket_coalesce* coalesce; // unsent packets that can be replaced by a newer one, see WFIFOSET_COALESCE
 };
 
+/// Packet built once and queued for several connections, see WFIFOSHARE
+typedef std::shared_ptr<const std::vector<uint8>> SharedPacket;
+
+/// Packets smaller than this are cheaper to copy into every WFIFO than to reference
+#define SHARED_PACKET_MIN_SIZE 128
+
 
 // Data prototype declaration
 
@@ -132,14 +145,23 @@ extern bool session_isActive(int32 fd);
 // Function prototype declaration
 
 int32 make_listen_bind(uint32 ip, uint16 port);
+int32 make_listen_bind_io(uint32 ip, uint16 port);
 int32 make_connection(uint32 ip, uint16 port, bool silent, int32 timeout);
 #define realloc_fifo( fd, rfifo_size, wfifo_size ) _realloc_fifo( ( fd ), ( rfifo_size ), ( wfifo_size ), ALC_MARK )
 #define realloc_writefifo( fd, addition ) _realloc_writefifo( ( fd ), ( addition ), ALC_MARK )
 int32 _realloc_fifo( int32 fd, uint32 rfifo_size, uint32 wfifo_size, const char* file, int32 line, const char* func );
 int32 _realloc_writefifo( int32 fd, size_t addition, const char* file, int32 line, const char* func );
 int32 WFIFOSET(int32 fd, size_t len);
+SharedPacket socket_shared_packet(const void* buf, size_t len);
+int32 WFIFOSHARE(int32 fd, const SharedPacket& packet);
+int32 WFIFOSET_COALESCE(int32 fd, size_t len, uint64 key);
+const std::unordered_map<uint16, uint64>& socket_coalesce_stats();
 int32 RFIFOSKIP(int32 fd, size_t len);
 
+int32 make_wakeup_event(RecvFunc func_recv);
+void wakeup_event_signal(int32 fd);
+void wakeup_event_consume(int32 fd);
+
 int32 do_sockets(t_tick next);
 void do_close(int32 fd);
 void socket_init(void);
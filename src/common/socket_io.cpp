@@ -0,0 +1,408 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "socket_io.hpp"
+
+#ifdef SOCKET_EPOLL
+
+#include <cerrno>
+#include <thread>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "mpsc_queue.hpp"
+#include "showmsg.hpp"
+#include "socket.hpp"
+
+#ifndef MSG_NOSIGNAL
+	#define MSG_NOSIGNAL 0
+#endif
+
+// Ring sizes of a connection, the output ring overflows into the WFIFO
+static const size_t SOCKET_IO_IN_SIZE = 8 * 1024;
+static const size_t SOCKET_IO_OUT_SIZE = 32 * 1024;
+// Pending main thread requests per I/O thread
+static const size_t SOCKET_IO_COMMANDS = 16 * 1024;
+static const int32 SOCKET_IO_MAX_EVENTS = 256;
+
+enum e_socket_io_command : uint8 {
+	SOCKET_IO_ADD = 0,	// Start watching a new connection
+	SOCKET_IO_SEND,		// The output ring has data
+	SOCKET_IO_RESUME,	// The main thread drained a full input ring
+	SOCKET_IO_CLOSE,	// Send what is left, close the socket and free the state
+};
+
+struct s_socket_io_command {
+	e_socket_io_command type;
+	s_socket_io* io;
+};
+
+struct s_socket_io_thread {
+	int32 epfd;
+	int32 event_fd;
+	std::atomic<bool> signaled;
+	MPSCQueue<s_socket_io_command> commands;
+	std::thread thread;
+
+	s_socket_io_thread() : epfd( -1 ), event_fd( -1 ), signaled( false ), commands( SOCKET_IO_COMMANDS ){
+	}
+};
+
+// Only freed by socket_io_final, a plain exit() leaves the running threads alone
+static std::vector<s_socket_io_thread*> socket_io_threads;
+static std::atomic<bool> socket_io_running( false );
+static int32 socket_io_wakeup_fd = -1;
+
+static void socket_io_update_events( s_socket_io_thread* thread, s_socket_io* io ){
+	struct epoll_event event = {};
+
+	event.data.ptr = io;
+	event.events = ( io->rx_enabled ? EPOLLIN : 0 ) | ( io->tx_armed ? EPOLLOUT : 0 );
+
+	epoll_ctl( thread->epfd, EPOLL_CTL_MOD, io->fd, &event );
+}
+
+/// The connection is gone, stop watching it and let the main thread close it
+static void socket_io_set_eof( s_socket_io_thread* thread, s_socket_io* io ){
+	struct epoll_event event = {};
+
+	io->eof = true;
+	io->rx_enabled = false;
+	io->tx_armed = false;
+
+	epoll_ctl( thread->epfd, EPOLL_CTL_DEL, io->fd, &event );
+}
+
+/// Reads everything available into the input ring
+/// @return true if the main thread has something new to handle
+static bool socket_io_recv( s_socket_io_thread* thread, s_socket_io* io, uint32 events ){
+	bool delivered = false;
+
+	if( io->eof ){
+		return false;
+	}
+
+	for( ;; ){
+		uint8* region;
+		size_t space = io->in.write_region( &region );
+
+		if( space == 0 ){
+			if( events & ( EPOLLERR | EPOLLHUP ) ){
+				// Peer is gone, do not spin on the hangup until the main thread caught up
+				socket_io_set_eof( thread, io );
+				return true;
+			}
+
+			io->rx_enabled = false;
+			io->rx_paused = true;
+			socket_io_update_events( thread, io );
+			break;
+		}
+
+		ssize_t len = recv( io->fd, region, space, 0 );
+
+		if( len > 0 ){
+			io->in.commit_write( len );
+			delivered = true;
+
+			if( (size_t)len < space ){
+				break;
+			}
+
+			continue;
+		}
+
+		if( len < 0 && errno == EINTR ){
+			continue;
+		}
+
+		if( len == 0 || ( errno != EAGAIN && errno != EWOULDBLOCK ) ){
+			socket_io_set_eof( thread, io );
+			return true;
+		}
+
+		break;
+	}
+
+	return delivered;
+}
+
+/// Sends as much of the output ring as the socket takes
+/// @return true if the connection failed
+static bool socket_io_send( s_socket_io_thread* thread, s_socket_io* io ){
+	if( io->eof ){
+		return false;
+	}
+
+	for( ;; ){
+		const uint8* region;
+		size_t len = io->out.read_region( &region );
+
+		if( len == 0 ){
+			if( io->tx_armed ){
+				io->tx_armed = false;
+				socket_io_update_events( thread, io );
+			}
+			break;
+		}
+
+		ssize_t sent = send( io->fd, region, len, MSG_NOSIGNAL );
+
+		if( sent > 0 ){
+			io->out.commit_read( sent );
+
+			if( (size_t)sent == len ){
+				continue;
+			}
+		}else if( sent < 0 && errno == EINTR ){
+			continue;
+		}else if( sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK ){
+			socket_io_set_eof( thread, io );
+			return true;
+		}
+
+		// Socket buffer is full, continue once it is writable again
+		if( !io->tx_armed ){
+			io->tx_armed = true;
+			socket_io_update_events( thread, io );
+		}
+		break;
+	}
+
+	return false;
+}
+
+/// Handles the requests of the main thread
+/// @return true if the main thread has something new to handle
+static bool socket_io_do_commands( s_socket_io_thread* thread ){
+	s_socket_io_command command;
+	bool wake_main = false;
+
+	while( thread->commands.pop( command ) ){
+		s_socket_io* io = command.io;
+
+		switch( command.type ){
+			case SOCKET_IO_ADD: {
+				struct epoll_event event = {};
+
+				io->rx_enabled = true;
+				event.data.ptr = io;
+				event.events = EPOLLIN;
+
+				if( epoll_ctl( thread->epfd, EPOLL_CTL_ADD, io->fd, &event ) == -1 ){
+					ShowError( "socket_io: Failed to watch connection #%d: %s\n", io->fd, strerror( errno ) );
+					io->eof = true;
+					wake_main = true;
+				}
+				break;
+			}
+
+			case SOCKET_IO_SEND:
+				// Cleared before reading, so data queued from now on is requested again
+				io->tx_queued = false;
+				wake_main |= socket_io_send( thread, io );
+				break;
+
+			case SOCKET_IO_RESUME:
+				if( !io->eof && !io->rx_enabled ){
+					io->rx_enabled = true;
+					socket_io_update_events( thread, io );
+				}
+				break;
+
+			case SOCKET_IO_CLOSE: {
+				struct epoll_event event = {};
+
+				// Best effort, like do_close
+				socket_io_send( thread, io );
+
+				if( !io->eof ){
+					epoll_ctl( thread->epfd, EPOLL_CTL_DEL, io->fd, &event );
+				}
+
+				shutdown( io->fd, SHUT_RDWR );
+				close( io->fd );
+				delete io;
+				break;
+			}
+		}
+	}
+
+	return wake_main;
+}
+
+static void socket_io_worker( s_socket_io_thread* thread ){
+	std::vector<struct epoll_event> events( SOCKET_IO_MAX_EVENTS );
+
+	while( socket_io_running ){
+		int32 count = epoll_wait( thread->epfd, events.data(), SOCKET_IO_MAX_EVENTS, 1000 );
+
+		if( count == -1 ){
+			if( errno != EINTR ){
+				ShowError( "socket_io: epoll_wait() failed, %s!\n", strerror( errno ) );
+			}
+			continue;
+		}
+
+		bool wake_main = false;
+
+		for( int32 i = 0; i < count; i++ ){
+			s_socket_io* io = static_cast<s_socket_io*>( events[i].data.ptr );
+
+			if( io == nullptr ){
+				uint64 value;
+
+				// Set before draining the commands, so no request goes unnoticed
+				thread->signaled = false;
+
+				if( read( thread->event_fd, &value, sizeof( value ) ) == -1 && errno != EAGAIN ){
+					ShowError( "socket_io: failed to reset event: %s\n", strerror( errno ) );
+				}
+				continue;
+			}
+
+			if( events[i].events & EPOLLOUT ){
+				wake_main |= socket_io_send( thread, io );
+			}
+
+			if( events[i].events & ( EPOLLIN | EPOLLERR | EPOLLHUP ) ){
+				wake_main |= socket_io_recv( thread, io, events[i].events );
+			}
+		}
+
+		wake_main |= socket_io_do_commands( thread );
+
+		if( wake_main ){
+			wakeup_event_signal( socket_io_wakeup_fd );
+		}
+	}
+
+	// Close the connections the main thread handed back during shutdown
+	socket_io_do_commands( thread );
+}
+
+static void socket_io_command( s_socket_io* io, e_socket_io_command type ){
+	s_socket_io_thread* thread = socket_io_threads[io->thread];
+
+	while( !thread->commands.push( s_socket_io_command{ type, io } ) ){
+		// I/O thread is behind, it drains the queue on every wakeup
+		std::this_thread::yield();
+	}
+
+	if( !thread->signaled.exchange( true ) ){
+		uint64 value = 1;
+
+		if( write( thread->event_fd, &value, sizeof( value ) ) == -1 && errno != EAGAIN ){
+			ShowError( "socket_io: failed to signal I/O thread: %s\n", strerror( errno ) );
+		}
+	}
+}
+
+bool socket_io_enabled(){
+	return !socket_io_threads.empty();
+}
+
+/// Starts the I/O threads
+/// @param threads: Number of I/O threads, connections are spread by fd
+/// @param wakeup_fd: Wakeup event of the main thread, signaled when a connection has new data
+void socket_io_init( int32 threads, int32 wakeup_fd ){
+	if( threads <= 0 || wakeup_fd == -1 ){
+		return;
+	}
+
+	socket_io_wakeup_fd = wakeup_fd;
+	socket_io_running = true;
+
+	for( int32 i = 0; i < threads; i++ ){
+		s_socket_io_thread* thread = new s_socket_io_thread();
+		struct epoll_event event = {};
+
+		thread->epfd = epoll_create1( EPOLL_CLOEXEC );
+		thread->event_fd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+		event.data.ptr = nullptr;
+		event.events = EPOLLIN;
+
+		if( thread->epfd == -1 || thread->event_fd == -1 || epoll_ctl( thread->epfd, EPOLL_CTL_ADD, thread->event_fd, &event ) == -1 ){
+			ShowError( "socket_io_init: Failed to create I/O thread %d: %s\n", i, strerror( errno ) );
+
+			if( thread->epfd != -1 ){
+				close( thread->epfd );
+			}
+			if( thread->event_fd != -1 ){
+				close( thread->event_fd );
+			}
+			delete thread;
+			break;
+		}
+
+		thread->thread = std::thread( socket_io_worker, thread );
+		socket_io_threads.push_back( thread );
+	}
+
+	if( socket_io_threads.empty() ){
+		socket_io_running = false;
+		ShowWarning( "socket_io_init: No I/O thread could be started, client connections are handled by the main thread.\n" );
+		return;
+	}
+
+	ShowInfo( "Server uses '" CL_WHITE "%d" CL_RESET "' network I/O threads for client connections\n", (int32)socket_io_threads.size() );
+}
+
+/// Stops the I/O threads, after they closed the connections already detached
+void socket_io_final(){
+	if( socket_io_threads.empty() ){
+		return;
+	}
+
+	socket_io_running = false;
+
+	for( s_socket_io_thread* thread : socket_io_threads ){
+		uint64 value = 1;
+
+		if( write( thread->event_fd, &value, sizeof( value ) ) == -1 && errno != EAGAIN ){
+			ShowError( "socket_io_final: failed to signal I/O thread: %s\n", strerror( errno ) );
+		}
+	}
+
+	for( s_socket_io_thread* thread : socket_io_threads ){
+		thread->thread.join();
+		close( thread->epfd );
+		close( thread->event_fd );
+		delete thread;
+	}
+
+	socket_io_threads.clear();
+}
+
+/// Hands a new client connection to an I/O thread
+s_socket_io* socket_io_attach( int32 fd ){
+	s_socket_io* io = new s_socket_io( fd, fd % socket_io_threads.size(), SOCKET_IO_IN_SIZE, SOCKET_IO_OUT_SIZE );
+
+	socket_io_command( io, SOCKET_IO_ADD );
+
+	return io;
+}
+
+/// Closes a connection, the I/O thread sends what is left in the output ring,
+/// closes the socket and frees io. io must not be used afterwards.
+void socket_io_detach( s_socket_io* io ){
+	socket_io_command( io, SOCKET_IO_CLOSE );
+}
+
+/// Asks the I/O thread to send the output ring
+void socket_io_flush( s_socket_io* io ){
+	if( !io->tx_queued.exchange( true ) ){
+		socket_io_command( io, SOCKET_IO_SEND );
+	}
+}
+
+/// Asks the I/O thread to continue reading after the input ring was full
+void socket_io_resume( s_socket_io* io ){
+	socket_io_command( io, SOCKET_IO_RESUME );
+}
+
+#endif
@@ -0,0 +1,58 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef SOCKET_IO_HPP
+#define SOCKET_IO_HPP
+
+#include <atomic>
+
+#include "cbasetypes.hpp"
+#include "spsc_ring.hpp"
+
+/// Network I/O threads for client connections (Linux/epoll only)
+///
+/// When enabled, recv() and send() of client connections run on dedicated I/O
+/// threads instead of the main thread. Each connection belongs to one I/O
+/// thread and has two byte rings: the I/O thread fills the input ring and the
+/// main thread copies it into the RFIFO before parsing, the main thread moves
+/// the WFIFO into the output ring and the I/O thread sends it. Packet parsing,
+/// WFIFOHEAD/WFIFOSET and session handling stay on the main thread.
+/// Only connections accepted on a listen socket of make_listen_bind_io are
+/// handed to the I/O threads, which are the game clients of the map-server.
+
+/// Per-connection state shared by the main thread and one I/O thread
+struct s_socket_io {
+	int32 fd;
+	uint32 thread;
+
+	SPSCByteRing in;	// Written by the I/O thread, read by the main thread
+	SPSCByteRing out;	// Written by the main thread, read by the I/O thread
+
+	std::atomic<bool> eof;			// Connection closed or failed, set by the I/O thread
+	std::atomic<bool> rx_paused;	// Input ring was full, reading stopped until the main thread caught up
+	std::atomic<bool> tx_queued;	// Output is already queued for the I/O thread
+
+	// I/O thread only
+	bool rx_enabled;
+	bool tx_armed;
+
+	s_socket_io( int32 fd, uint32 thread, size_t in_size, size_t out_size )
+		: fd( fd ), thread( thread ), in( in_size ), out( out_size ), eof( false ), rx_paused( false ), tx_queued( false ), rx_enabled( false ), tx_armed( false ){
+	}
+};
+
+#ifdef SOCKET_EPOLL
+
+bool socket_io_enabled();
+void socket_io_init( int32 threads, int32 wakeup_fd );
+void socket_io_final();
+
+// Main thread only
+s_socket_io* socket_io_attach( int32 fd );
+void socket_io_detach( s_socket_io* io );
+void socket_io_flush( s_socket_io* io );
+void socket_io_resume( s_socket_io* io );
+
+#endif
+
+#endif /* SOCKET_IO_HPP */
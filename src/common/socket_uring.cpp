@@ -0,0 +1,273 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "socket_uring.hpp"
+
+#ifdef SOCKET_IO_URING
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "showmsg.hpp"
+
+static int32 sys_io_uring_setup( uint32 entries, struct io_uring_params* params ){
+	return (int32)syscall( __NR_io_uring_setup, entries, params );
+}
+
+static int32 sys_io_uring_enter( int32 fd, uint32 to_submit, uint32 min_complete, uint32 flags ){
+	return (int32)syscall( __NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0 );
+}
+
+// Ring indices are shared with the kernel
+static inline uint32 uring_load_acquire( uint32* p ){
+	return __atomic_load_n( p, __ATOMIC_ACQUIRE );
+}
+
+static inline void uring_store_release( uint32* p, uint32 value ){
+	__atomic_store_n( p, value, __ATOMIC_RELEASE );
+}
+
+SocketUring::SocketUring() : ring_fd( -1 ), entries( 0 ), queued( 0 ), sq_head( nullptr ), sq_tail( nullptr ), sq_mask( nullptr ), sq_array( nullptr ), sqes( nullptr ),
+	cq_head( nullptr ), cq_tail( nullptr ), cq_mask( nullptr ), cqes( nullptr ), sq_ptr( MAP_FAILED ), sq_size( 0 ), cq_ptr( MAP_FAILED ), cq_size( 0 ), sqes_size( 0 ){
+}
+
+SocketUring::~SocketUring(){
+	this->final();
+}
+
+/**
+ * Create the ring
+ * @param entries: Maximum number of requests per submission
+ * @return false if the kernel does not support io_uring, the ring stays inactive
+ */
+bool SocketUring::init( uint32 entries ){
+	struct io_uring_params params = {};
+
+	this->ring_fd = sys_io_uring_setup( entries, &params );
+
+	if( this->ring_fd < 0 ){
+		ShowWarning( "SocketUring: io_uring is not available (%s).\n", strerror( errno ) );
+		this->ring_fd = -1;
+		return false;
+	}
+
+	// IORING_OP_SEND/RECV exist since 5.6, the same release added IORING_FEAT_FAST_POLL
+	if( !( params.features & IORING_FEAT_FAST_POLL ) ){
+		ShowWarning( "SocketUring: kernel io_uring is too old for socket operations.\n" );
+		this->final();
+		return false;
+	}
+
+	this->entries = params.sq_entries;
+	this->sq_size = params.sq_off.array + params.sq_entries * sizeof( uint32 );
+	this->cq_size = params.cq_off.cqes + params.cq_entries * sizeof( struct io_uring_cqe );
+
+	if( params.features & IORING_FEAT_SINGLE_MMAP ){
+		this->sq_size = this->cq_size = std::max( this->sq_size, this->cq_size );
+	}
+
+	this->sq_ptr = mmap( nullptr, this->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ring_fd, IORING_OFF_SQ_RING );
+
+	if( this->sq_ptr == MAP_FAILED ){
+		ShowWarning( "SocketUring: failed to map the submission queue (%s).\n", strerror( errno ) );
+		this->final();
+		return false;
+	}
+
+	if( params.features & IORING_FEAT_SINGLE_MMAP ){
+		this->cq_ptr = this->sq_ptr;
+	}else{
+		this->cq_ptr = mmap( nullptr, this->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ring_fd, IORING_OFF_CQ_RING );
+
+		if( this->cq_ptr == MAP_FAILED ){
+			ShowWarning( "SocketUring: failed to map the completion queue (%s).\n", strerror( errno ) );
+			this->final();
+			return false;
+		}
+	}
+
+	this->sqes_size = params.sq_entries * sizeof( struct io_uring_sqe );
+	this->sqes = (struct io_uring_sqe*)mmap( nullptr, this->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->ring_fd, IORING_OFF_SQES );
+
+	if( this->sqes == MAP_FAILED ){
+		ShowWarning( "SocketUring: failed to map the submission entries (%s).\n", strerror( errno ) );
+		this->sqes = nullptr;
+		this->final();
+		return false;
+	}
+
+	uint8* sq = (uint8*)this->sq_ptr;
+	uint8* cq = (uint8*)this->cq_ptr;
+
+	this->sq_head = (uint32*)( sq + params.sq_off.head );
+	this->sq_tail = (uint32*)( sq + params.sq_off.tail );
+	this->sq_mask = (uint32*)( sq + params.sq_off.ring_mask );
+	this->sq_array = (uint32*)( sq + params.sq_off.array );
+	this->cq_head = (uint32*)( cq + params.cq_off.head );
+	this->cq_tail = (uint32*)( cq + params.cq_off.tail );
+	this->cq_mask = (uint32*)( cq + params.cq_off.ring_mask );
+	this->cqes = (struct io_uring_cqe*)( cq + params.cq_off.cqes );
+
+	return true;
+}
+
+void SocketUring::final(){
+	if( this->sqes != nullptr ){
+		munmap( this->sqes, this->sqes_size );
+		this->sqes = nullptr;
+	}
+
+	if( this->cq_ptr != MAP_FAILED && this->cq_ptr != this->sq_ptr ){
+		munmap( this->cq_ptr, this->cq_size );
+	}
+	this->cq_ptr = MAP_FAILED;
+
+	if( this->sq_ptr != MAP_FAILED ){
+		munmap( this->sq_ptr, this->sq_size );
+		this->sq_ptr = MAP_FAILED;
+	}
+
+	if( this->ring_fd != -1 ){
+		close( this->ring_fd );
+		this->ring_fd = -1;
+	}
+
+	this->queued = 0;
+}
+
+bool SocketUring::is_active() const {
+	return this->ring_fd != -1;
+}
+
+uint32 SocketUring::capacity() const {
+	return this->entries;
+}
+
+uint32 SocketUring::pending() const {
+	return this->queued;
+}
+
+struct io_uring_sqe* SocketUring::next_sqe(){
+	if( this->queued >= this->entries ){
+		return nullptr;
+	}
+
+	uint32 tail = *this->sq_tail + this->queued;
+	uint32 index = tail & *this->sq_mask;
+	struct io_uring_sqe* sqe = &this->sqes[index];
+
+	memset( sqe, 0, sizeof( *sqe ) );
+	this->sq_array[index] = index;
+	this->queued++;
+
+	return sqe;
+}
+
+/**
+ * Queue a recv, nothing is sent to the kernel before submit()
+ * @return false if the batch is full
+ */
+bool SocketUring::prep_recv( int32 fd, void* buffer, size_t len, uint64 user_data ){
+	struct io_uring_sqe* sqe = this->next_sqe();
+
+	if( sqe == nullptr ){
+		return false;
+	}
+
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = fd;
+	sqe->addr = (uint64)(uintptr_t)buffer;
+	sqe->len = (uint32)len;
+	sqe->msg_flags = MSG_DONTWAIT; // Fail with EAGAIN like the sockets do instead of parking the request
+	sqe->user_data = user_data;
+
+	return true;
+}
+
+/**
+ * Queue a send, nothing is sent to the kernel before submit()
+ * @return false if the batch is full
+ */
+bool SocketUring::prep_send( int32 fd, const void* buffer, size_t len, uint64 user_data ){
+	struct io_uring_sqe* sqe = this->next_sqe();
+
+	if( sqe == nullptr ){
+		return false;
+	}
+
+	sqe->opcode = IORING_OP_SEND;
+	sqe->fd = fd;
+	sqe->addr = (uint64)(uintptr_t)buffer;
+	sqe->len = (uint32)len;
+	sqe->msg_flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+	sqe->user_data = user_data;
+
+	return true;
+}
+
+int32 SocketUring::reap( void (*on_complete)( uint64 user_data, int32 result ) ){
+	uint32 head = *this->cq_head;
+	uint32 tail = uring_load_acquire( this->cq_tail );
+	int32 count = 0;
+
+	while( head != tail ){
+		struct io_uring_cqe* cqe = &this->cqes[head & *this->cq_mask];
+
+		on_complete( cqe->user_data, cqe->res );
+		head++;
+		count++;
+	}
+
+	uring_store_release( this->cq_head, head );
+
+	return count;
+}
+
+/**
+ * Hand every queued request to the kernel and wait for all of them
+ * Requests use MSG_DONTWAIT, so they complete right away.
+ * @param on_complete: Called for every request with its user_data and the recv/send result (-errno on failure)
+ * @return Number of completed requests, -1 if the ring failed
+ */
+int32 SocketUring::submit( void (*on_complete)( uint64 user_data, int32 result ) ){
+	uint32 submitted = this->queued;
+	int32 completed = 0;
+
+	if( submitted == 0 ){
+		return 0;
+	}
+
+	uring_store_release( this->sq_tail, *this->sq_tail + submitted );
+	this->queued = 0;
+
+	uint32 to_submit = submitted;
+
+	while( completed < (int32)submitted ){
+		int32 ret = sys_io_uring_enter( this->ring_fd, to_submit, submitted - completed, IORING_ENTER_GETEVENTS );
+
+		if( ret < 0 ){
+			if( errno == EINTR || errno == EAGAIN || errno == EBUSY ){
+				// Make room in the completion queue and try again
+				completed += this->reap( on_complete );
+				continue;
+			}
+
+			ShowError( "SocketUring: io_uring_enter failed (%s).\n", strerror( errno ) );
+			return -1;
+		}
+
+		to_submit -= std::min( (uint32)ret, to_submit );
+		completed += this->reap( on_complete );
+	}
+
+	return completed;
+}
+
+#endif
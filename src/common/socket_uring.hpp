@@ -0,0 +1,68 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef SOCKET_URING_HPP
+#define SOCKET_URING_HPP
+
+#include "cbasetypes.hpp"
+
+#ifdef SOCKET_IO_URING
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * Minimal io_uring submission/completion ring for batched socket I/O (Linux 5.6+).
+ * Talks to the kernel through the raw system calls, so no liburing is needed.
+ * recv/send requests are queued with prep_recv/prep_send and handed to the
+ * kernel together by submit(), which also reaps all their completions: a whole
+ * batch costs a single system call instead of one per socket.
+ */
+class SocketUring {
+private:
+	int32 ring_fd;
+	uint32 entries;
+	uint32 queued;
+
+	// Submission queue
+	uint32* sq_head;
+	uint32* sq_tail;
+	uint32* sq_mask;
+	uint32* sq_array;
+	struct io_uring_sqe* sqes;
+
+	// Completion queue
+	uint32* cq_head;
+	uint32* cq_tail;
+	uint32* cq_mask;
+	struct io_uring_cqe* cqes;
+
+	void* sq_ptr;
+	size_t sq_size;
+	void* cq_ptr;
+	size_t cq_size;
+	size_t sqes_size;
+
+	struct io_uring_sqe* next_sqe();
+	int32 reap( void (*on_complete)( uint64 user_data, int32 result ) );
+
+public:
+	SocketUring();
+	~SocketUring();
+
+	bool init( uint32 entries );
+	void final();
+
+	bool is_active() const;
+	uint32 capacity() const;
+	uint32 pending() const;
+
+	bool prep_recv( int32 fd, void* buffer, size_t len, uint64 user_data );
+	bool prep_send( int32 fd, const void* buffer, size_t len, uint64 user_data );
+
+	int32 submit( void (*on_complete)( uint64 user_data, int32 result ) );
+};
+
+#endif
+
+#endif /* SOCKET_URING_HPP */
@@ -0,0 +1,149 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+#include "cbasetypes.hpp"
+
+/**
+ * Bounded lock-free single-producer/single-consumer byte ring.
+ * The producer only moves the write position and the consumer only the read
+ * position, so neither side ever waits for the other. The contiguous regions
+ * let a socket recv() into or send() from the ring without an extra copy.
+ * Capacity is rounded up to a power of two.
+ */
+class SPSCByteRing {
+private:
+	std::unique_ptr<uint8[]> buffer;
+	size_t mask;
+
+	// Producer and consumer live on separate cache lines
+	alignas(64) std::atomic<size_t> write_pos;
+	alignas(64) std::atomic<size_t> read_pos;
+
+public:
+	SPSCByteRing( size_t capacity ){
+		size_t size = 2;
+
+		while( size < capacity ){
+			size <<= 1;
+		}
+
+		this->buffer = std::make_unique<uint8[]>( size );
+		this->mask = size - 1;
+		this->write_pos.store( 0, std::memory_order_relaxed );
+		this->read_pos.store( 0, std::memory_order_relaxed );
+	}
+
+	SPSCByteRing( const SPSCByteRing& ) = delete;
+	SPSCByteRing& operator=( const SPSCByteRing& ) = delete;
+
+	/**
+	 * Contiguous free space (producer only)
+	 * @param region: Output parameter for the start of the free space
+	 * @return Number of bytes that can be written at region
+	 */
+	size_t write_region( uint8** region ){
+		size_t wpos = this->write_pos.load( std::memory_order_relaxed );
+		size_t free = this->capacity() - ( wpos - this->read_pos.load( std::memory_order_acquire ) );
+		size_t offset = wpos & this->mask;
+
+		*region = &this->buffer[offset];
+
+		return std::min( free, this->capacity() - offset );
+	}
+
+	/**
+	 * Publish bytes written into write_region (producer only)
+	 */
+	void commit_write( size_t len ){
+		this->write_pos.store( this->write_pos.load( std::memory_order_relaxed ) + len, std::memory_order_release );
+	}
+
+	/**
+	 * Contiguous readable data (consumer only)
+	 * @param region: Output parameter for the start of the data
+	 * @return Number of bytes that can be read at region
+	 */
+	size_t read_region( const uint8** region ){
+		size_t rpos = this->read_pos.load( std::memory_order_relaxed );
+		size_t used = this->write_pos.load( std::memory_order_acquire ) - rpos;
+		size_t offset = rpos & this->mask;
+
+		*region = &this->buffer[offset];
+
+		return std::min( used, this->capacity() - offset );
+	}
+
+	/**
+	 * Release bytes consumed from read_region (consumer only)
+	 */
+	void commit_read( size_t len ){
+		this->read_pos.store( this->read_pos.load( std::memory_order_relaxed ) + len, std::memory_order_release );
+	}
+
+	/**
+	 * Copy data into the ring (producer only)
+	 * @return Number of bytes written, less than len if the ring is full
+	 */
+	size_t write( const uint8* data, size_t len ){
+		size_t written = 0;
+
+		while( written < len ){
+			uint8* region;
+			size_t chunk = std::min( this->write_region( &region ), len - written );
+
+			if( chunk == 0 ){
+				break;
+			}
+
+			memcpy( region, data + written, chunk );
+			this->commit_write( chunk );
+			written += chunk;
+		}
+
+		return written;
+	}
+
+	/**
+	 * Copy data out of the ring (consumer only)
+	 * @return Number of bytes read, less than len if the ring ran empty
+	 */
+	size_t read( uint8* data, size_t len ){
+		size_t done = 0;
+
+		while( done < len ){
+			const uint8* region;
+			size_t chunk = std::min( this->read_region( &region ), len - done );
+
+			if( chunk == 0 ){
+				break;
+			}
+
+			memcpy( data + done, region, chunk );
+			this->commit_read( chunk );
+			done += chunk;
+		}
+
+		return done;
+	}
+
+	/**
+	 * Approximate number of buffered bytes (any thread)
+	 */
+	size_t size_approx() const {
+		return this->write_pos.load( std::memory_order_acquire ) - this->read_pos.load( std::memory_order_acquire );
+	}
+
+	size_t capacity() const {
+		return this->mask + 1;
+	}
+};
+
+#endif /* SPSC_RING_HPP */
@@ -8,8 +8,11 @@
 #include "cbasetypes.hpp"
 #include "cli.hpp"
 #include "malloc.hpp"
+#include "metrics.hpp"
+#include "profiler.hpp"
 #include "showmsg.hpp"
 #include "timer.hpp"
+#include "watchdog.hpp"
 
 // MySQL 8.0 or later removed my_bool typedef.
 // Reintroduce it as a bandaid fix.
@@ -23,6 +26,22 @@ void ra_mysql_error_handler(uint32 ecode);
 int32 mysql_reconnect_type;
 uint32 mysql_reconnect_count;
 
+// Latency of all queries and statements, of all threads
+static MetricsHistogram sql_query_latency;
+
+/// Adds the time until the end of the scope to the query latency
+class SqlQueryTimer {
+private:
+	uint64 start;
+
+public:
+	SqlQueryTimer() : start( profiler_clock() ){}
+
+	~SqlQueryTimer(){
+		sql_query_latency.observe( profiler_clock() - this->start );
+	}
+};
+
 /// Sql handle
 struct Sql
 {
@@ -263,6 +282,9 @@ int32 Sql_QueryV(Sql* self, const char* query, va_list args)
 	if( self == nullptr )
 		return SQL_ERROR;
 
+	SqlQueryTimer timer;
+
+	watchdog_count(WATCHDOG_SQL_QUERIES);
 	Sql_FreeResult(self);
 	StringBuf_Clear(&self->buf);
 	StringBuf_Vprintf(&self->buf, query, args);
@@ -290,6 +312,9 @@ int32 Sql_QueryStr(Sql* self, const char* query)
 	if( self == nullptr )
 		return SQL_ERROR;
 
+	SqlQueryTimer timer;
+
+	watchdog_count(WATCHDOG_SQL_QUERIES);
 	Sql_FreeResult(self);
 	StringBuf_Clear(&self->buf);
 	StringBuf_AppendStr(&self->buf, query);
@@ -734,6 +759,9 @@ int32 SqlStmt::BindParam(size_t idx, enum SqlDataType buffer_type, void* buffer,
 
 /// Executes the prepared statement.
 int32 SqlStmt::Execute(){
+	SqlQueryTimer timer;
+
+	watchdog_count(WATCHDOG_SQL_QUERIES);
 	this->FreeResult();
 
 	if( ( this->bind_params && mysql_stmt_bind_param( this->stmt, this->params ) ) ||
@@ -1014,8 +1042,13 @@ void Sql_inter_server_read(const char* cfgName, bool first) {
 	return;
 }
 
+static void Sql_Metrics(MetricsWriter& writer) {
+	sql_query_latency.write(writer, "rathena_sql_query_seconds", "Time spent in SQL queries and statements.");
+}
+
 void Sql_Init(void) {
 	Sql_inter_server_read(INTER_CONF_NAME,true);
+	metrics_add_collector(Sql_Metrics);
 }
 
 #ifdef my_bool
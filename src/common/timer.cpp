@@ -3,16 +3,22 @@
 
 #include "timer.hpp"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "cbasetypes.hpp"
 #include "db.hpp"
 #include "malloc.hpp"
+#include "metrics.hpp"
 #include "nullpo.hpp"
+#include "profiler.hpp"
 #include "showmsg.hpp"
 #include "utils.hpp"
+#include "watchdog.hpp"
 #ifdef WIN32
 #include "winapi.hpp" // GetTickCount()
 #endif
@@ -35,6 +41,38 @@ static int32 free_timer_list_max = 0;
 static int32 free_timer_list_pos = 0;
 
 
+#ifdef TIMER_WHEEL
+/// Hierarchical timing wheel
+///
+/// 4 levels of 256 slots with a resolution of 1ms. Level 0 holds the timers
+/// that expire within the next 256ms, one slot per tick. Each higher level
+/// covers 256 times the range of the level below and is cascaded down when
+/// the level below wrapped around. Slots are intrusive FIFO lists of tid's,
+/// so adding and removing a timer is O(1).
+/// Timers of the same tick fire in the order they were scheduled.
+#define TIMER_WHEEL_BITS 8
+#define TIMER_WHEEL_SIZE (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SIZE - 1)
+#define TIMER_WHEEL_LEVELS 4
+
+/// Position of a timer in the wheel, indexed by tid
+struct TimerLink {
+	int32 prev;
+	int32 next;
+	int32 slot;		// level * TIMER_WHEEL_SIZE + index, -1 if not in the wheel
+	uint64 seq;		// scheduling order
+};
+
+static struct TimerLink* timer_link = nullptr;
+static int32 timer_wheel_head[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SIZE];
+static int32 timer_wheel_tail[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SIZE];
+static uint64 timer_wheel_used[TIMER_WHEEL_SIZE / 64]; // non-empty slots of level 0
+static int32 timer_wheel_count = 0; // timers in level 0
+static t_tick timer_wheel_now = 0; // next tick to process
+static bool timer_wheel_started = false;
+static uint64 timer_wheel_seq = 0;
+static std::vector<int32> timer_wheel_batch;
+#else
 /// Comparator for the timer heap. (minimum tick at top)
 /// Returns negative if tid1's tick is smaller, positive if tid2's tick is smaller, 0 if equal.
 ///
@@ -45,6 +83,7 @@ static int32 free_timer_list_pos = 0;
 
 // timer heap (binary heap of tid's)
 static BHEAP_VAR(int32, timer_heap);
+#endif
 
 
 // server startup time
@@ -60,6 +99,12 @@ struct timer_func_list {
 	char* name;
 } *tfl_root = nullptr;
 
+// number of timers that were run
+static uint64 timer_fired = 0;
+
+// timer function -> profiler section
+static std::unordered_map<TimerFunc, int32> timer_profiler_sections;
+
 /// Sets the name of a timer function.
 int32 add_timer_func_list(TimerFunc func, const char* name)
 {
@@ -94,6 +139,20 @@ const char* search_timer_func_list(TimerFunc func)
 	return "unknown timer function";
 }
 
+/// Returns the profiler section of a timer function, named after its timer_func_list entry.
+static int32 timer_profiler_section(TimerFunc func)
+{
+	auto it = timer_profiler_sections.find(func);
+
+	if( it != timer_profiler_sections.end() )
+		return it->second;
+
+	int32 section = profiler_add_section(search_timer_func_list(func));
+
+	timer_profiler_sections[func] = section;
+	return section;
+}
+
 /*----------------------------
  * 	Get tick time
  *----------------------------*/
@@ -201,6 +260,124 @@ t_tick gettick(void)
 #endif
 //////////////////////////////////////////////////////////////////////////
 
+#ifdef TIMER_WHEEL
+/*======================================
+ * 	CORE : Timer Wheel
+ *--------------------------------------*/
+
+/// Removes a timer from its slot
+static void unlink_timer_wheel(int32 tid)
+{
+	struct TimerLink* link = &timer_link[tid];
+	int32 slot = link->slot;
+
+	if( slot < 0 )
+		return;
+
+	if( link->prev != INVALID_TIMER )
+		timer_link[link->prev].next = link->next;
+	else
+		timer_wheel_head[slot] = link->next;
+
+	if( link->next != INVALID_TIMER )
+		timer_link[link->next].prev = link->prev;
+	else
+		timer_wheel_tail[slot] = link->prev;
+
+	if( slot < TIMER_WHEEL_SIZE ) {
+		timer_wheel_count--;
+		if( timer_wheel_head[slot] == INVALID_TIMER )
+			timer_wheel_used[slot / 64] &= ~( 1ULL << ( slot % 64 ) );
+	}
+
+	link->prev = link->next = link->slot = INVALID_TIMER;
+}
+
+/// Appends a timer to the slot of its tick
+static void link_timer_wheel(int32 tid)
+{
+	struct TimerLink* link = &timer_link[tid];
+	t_tick tick = timer_data[tid].tick;
+	t_tick delta = DIFF_TICK(tick, timer_wheel_now);
+	int32 slot;
+
+	if( delta < TIMER_WHEEL_SIZE ) {
+		// already due timers are handled with the current tick
+		slot = (int32)( ( delta < 0 ? timer_wheel_now : tick ) & TIMER_WHEEL_MASK );
+		timer_wheel_count++;
+		timer_wheel_used[slot / 64] |= 1ULL << ( slot % 64 );
+	} else {
+		int32 level = 1;
+
+		while( level < TIMER_WHEEL_LEVELS - 1 && delta >= ( (t_tick)1 << ( TIMER_WHEEL_BITS * ( level + 1 ) ) ) )
+			level++;
+
+		// beyond the range of the wheel, it is placed again once the top level comes around
+		tick = timer_wheel_now + std::min<t_tick>(delta, ( (t_tick)1 << ( TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS ) ) - 1);
+		slot = level * TIMER_WHEEL_SIZE + (int32)( ( tick >> ( TIMER_WHEEL_BITS * level ) ) & TIMER_WHEEL_MASK );
+	}
+
+	link->slot = slot;
+	link->next = INVALID_TIMER;
+	link->prev = timer_wheel_tail[slot];
+
+	if( link->prev != INVALID_TIMER )
+		timer_link[link->prev].next = tid;
+	else
+		timer_wheel_head[slot] = tid;
+
+	timer_wheel_tail[slot] = tid;
+}
+
+/// Adds a timer to the timer wheel
+static void push_timer_heap(int32 tid)
+{
+	if( !timer_wheel_started ) {
+		timer_wheel_now = gettick();
+		timer_wheel_started = true;
+	}
+
+	timer_link[tid].seq = timer_wheel_seq++;
+	link_timer_wheel(tid);
+}
+
+/// Moves the timers of a higher level slot down to the lower levels
+static void cascade_timer_wheel(int32 level)
+{
+	int32 slot = level * TIMER_WHEEL_SIZE + (int32)( ( timer_wheel_now >> ( TIMER_WHEEL_BITS * level ) ) & TIMER_WHEEL_MASK );
+	int32 tid = timer_wheel_head[slot];
+
+	timer_wheel_head[slot] = timer_wheel_tail[slot] = INVALID_TIMER;
+
+	while( tid != INVALID_TIMER ) {
+		int32 next = timer_link[tid].next;
+
+		link_timer_wheel(tid);
+		tid = next;
+	}
+}
+
+/// Ticks until the first timer in level 0 expires, or until level 0 is refilled
+static t_tick next_timer_wheel(void)
+{
+	int32 start = (int32)( timer_wheel_now & TIMER_WHEEL_MASK );
+
+	// the higher levels are not due before the refill, no need to look past it
+	if( timer_wheel_count > 0 ) {
+		for( int32 slot = start; slot < TIMER_WHEEL_SIZE; slot++ ) {
+			if( timer_wheel_used[slot / 64] == 0 ) {
+				slot |= 63; // skip the rest of the word
+				continue;
+			}
+
+			if( timer_wheel_used[slot / 64] & ( 1ULL << ( slot % 64 ) ) )
+				return slot - start;
+		}
+	}
+
+	return TIMER_WHEEL_SIZE - start;
+}
+#else
 /*======================================
  * 	CORE : Timer Heap
  *--------------------------------------*/
@@ -211,6 +388,7 @@ static void push_timer_heap(int32 tid)
 	BHEAP_ENSURE(timer_heap, 1, 256);
 	BHEAP_PUSH(timer_heap, tid, DIFFTICK_MINTOPCMP);
 }
+#endif
 
 /*==========================
  * 	Timer Management
@@ -240,6 +418,13 @@ static int32 acquire_timer(void)
 		else
 			CREATE(timer_data, struct TimerData, timer_data_max);
 		memset(timer_data + (timer_data_max - 256), 0, sizeof(struct TimerData)*256);
+#ifdef TIMER_WHEEL
+		RECREATE(timer_link, struct TimerLink, timer_data_max);
+		for( int32 i = timer_data_max - 256; i < timer_data_max; i++ ) {
+			timer_link[i].prev = timer_link[i].next = timer_link[i].slot = INVALID_TIMER;
+			timer_link[i].seq = 0;
+		}
+#endif
 	}
 
 	if( tid >= timer_data_num )
@@ -248,6 +433,18 @@ static int32 acquire_timer(void)
 	return tid;
 }
 
+/// Puts a timer back into the free list
+static void release_timer(int32 tid)
+{
+	timer_data[tid].type = 0;
+	if (free_timer_list_pos >= free_timer_list_max) {
+		free_timer_list_max += 256;
+		RECREATE(free_timer_list,int32,free_timer_list_max);
+		memset(free_timer_list + (free_timer_list_max - 256), 0, 256 * sizeof(int32));
+	}
+	free_timer_list[free_timer_list_pos++] = tid;
+}
+
 /// Starts a new timer that is deleted once it expires (single-use).
 /// Returns the timer's id.
 int32 add_timer(t_tick tick, TimerFunc func, int32 id, intptr_t data)
@@ -312,6 +509,8 @@ int32 delete_timer(int32 tid, TimerFunc func)
 		return -2;
 	}
 
+	// The timer stays scheduled and is released once it expires, so its id is
+	// not handed out again while a caller or the running pass may still hold it
 	timer_data[tid].func = nullptr;
 	timer_data[tid].type = TIMER_ONCE_AUTODEL;
 
@@ -329,6 +528,24 @@ t_tick addtick_timer(int32 tid, t_tick tick)
 /// Returns the new tick value, or -1 if it fails.
 t_tick settick_timer(int32 tid, t_tick tick)
 {
+#ifdef TIMER_WHEEL
+	if( tid < 0 || tid >= timer_data_num || timer_link[tid].slot < 0 )
+	{
+		ShowError("settick_timer: no such timer %d (%p(%s))\n", tid, ( tid >= 0 && tid < timer_data_num ) ? timer_data[tid].func : nullptr, search_timer_func_list(( tid >= 0 && tid < timer_data_num ) ? timer_data[tid].func : nullptr));
+		return -1;
+	}
+
+	if( tick == -1 )
+		tick = 0;// add 1ms to avoid the error value -1
+
+	if( timer_data[tid].tick == tick )
+		return tick;// nothing to do, already in propper position
+
+	unlink_timer_wheel(tid);
+	timer_data[tid].tick = tick;
+	push_timer_heap(tid);
+	return tick;
+#else
 	size_t i;
 
 	// search timer position
@@ -350,6 +567,58 @@ t_tick settick_timer(int32 tid, t_tick tick)
 	timer_data[tid].tick = tick;
 	BHEAP_PUSH(timer_heap, tid, DIFFTICK_MINTOPCMP);
 	return tick;
+#endif
+}
+
+/// Runs an expired timer that was already taken out of the heap/wheel
+static void run_timer(int32 tid, t_tick tick, t_tick diff)
+{
+	timer_data[tid].type |= TIMER_REMOVE_HEAP;
+	timer_fired++;
+
+	if( timer_data[tid].func )
+	{
+		TimerFunc func = timer_data[tid].func;
+		bool profile = profiler_enabled;
+		bool watch = watchdog_enabled;
+		uint64 start = ( profile || watch ) ? profiler_clock() : 0;
+
+		if( diff < -1000 )
+			// timer was delayed for more than 1 second, use current tick instead
+			func(tid, tick, timer_data[tid].id, timer_data[tid].data);
+		else
+			func(tid, timer_data[tid].tick, timer_data[tid].id, timer_data[tid].data);
+
+		if( profile || watch ) {
+			uint64 elapsed = profiler_clock() - start;
+
+			if( profile )
+				profiler_record(timer_profiler_section(func), elapsed);
+			if( watch )
+				watchdog_timer(func, elapsed);
+		}
+	}
+
+	// in the case the function didn't change anything...
+	if( timer_data[tid].type & TIMER_REMOVE_HEAP )
+	{
+		timer_data[tid].type &= ~TIMER_REMOVE_HEAP;
+
+		switch( timer_data[tid].type )
+		{
+		default:
+		case TIMER_ONCE_AUTODEL:
+			release_timer(tid);
+		break;
+		case TIMER_INTERVAL:
+			if( DIFF_TICK(timer_data[tid].tick, tick) < -1000 )
+				timer_data[tid].tick = tick + timer_data[tid].interval;
+			else
+				timer_data[tid].tick += timer_data[tid].interval;
+			push_timer_heap(tid);
+		break;
+		}
+	}
 }
 
 /// Executes all expired timers.
@@ -358,6 +627,57 @@ t_tick do_timer(t_tick tick)
 {
 	t_tick diff = TIMER_MAX_INTERVAL; // return value
 
+#ifdef TIMER_WHEEL
+	if( !timer_wheel_started )
+		return TIMER_MAX_INTERVAL;
+
+	while( DIFF_TICK(timer_wheel_now, tick) <= 0 )
+	{
+		int32 slot = (int32)( timer_wheel_now & TIMER_WHEEL_MASK );
+
+		// refill the lower levels once they wrapped around, top down
+		if( slot == 0 ) {
+			int32 level = 1;
+
+			while( level < TIMER_WHEEL_LEVELS - 1 && ( ( timer_wheel_now >> ( TIMER_WHEEL_BITS * level ) ) & TIMER_WHEEL_MASK ) == 0 )
+				level++;
+
+			for( ; level > 0; level-- )
+				cascade_timer_wheel(level);
+		}
+
+		if( timer_wheel_count == 0 ) {
+			// nothing in level 0, skip to the next refill
+			timer_wheel_now = std::min<t_tick>(( timer_wheel_now | TIMER_WHEEL_MASK ) + 1, tick + 1);
+			continue;
+		}
+
+		// timers added by the callbacks for this or an earlier tick go into this slot and run in this loop too
+		while( timer_wheel_head[slot] != INVALID_TIMER )
+		{
+			timer_wheel_batch.clear();
+
+			for( int32 tid = timer_wheel_head[slot]; tid != INVALID_TIMER; tid = timer_link[tid].next )
+				timer_wheel_batch.push_back(tid);
+
+			// cascaded timers can be behind newer ones, restore the scheduling order
+			std::sort(timer_wheel_batch.begin(), timer_wheel_batch.end(), []( int32 a, int32 b ){ return timer_link[a].seq < timer_link[b].seq; });
+
+			for( int32 tid : timer_wheel_batch ) {
+				// moved or deleted by an earlier callback
+				if( timer_link[tid].slot != slot )
+					continue;
+
+				unlink_timer_wheel(tid);
+				run_timer(tid, tick, DIFF_TICK(timer_data[tid].tick, tick));
+			}
+		}
+
+		timer_wheel_now++;
+	}
+
+	diff = next_timer_wheel() + 1;
+#else
 	// process all timers one by one
 	while( BHEAP_LENGTH(timer_heap) )
 	{
@@ -369,44 +689,9 @@ t_tick do_timer(t_tick tick)
 
 		// remove timer
 		BHEAP_POP(timer_heap, DIFFTICK_MINTOPCMP);
-		timer_data[tid].type |= TIMER_REMOVE_HEAP;
-
-		if( timer_data[tid].func )
-		{
-			if( diff < -1000 )
-				// timer was delayed for more than 1 second, use current tick instead
-				timer_data[tid].func(tid, tick, timer_data[tid].id, timer_data[tid].data);
-			else
-				timer_data[tid].func(tid, timer_data[tid].tick, timer_data[tid].id, timer_data[tid].data);
-		}
-
-		// in the case the function didn't change anything...
-		if( timer_data[tid].type & TIMER_REMOVE_HEAP )
-		{
-			timer_data[tid].type &= ~TIMER_REMOVE_HEAP;
-
-			switch( timer_data[tid].type )
-			{
-			default:
-			case TIMER_ONCE_AUTODEL:
-				timer_data[tid].type = 0;
-				if (free_timer_list_pos >= free_timer_list_max) {
-					free_timer_list_max += 256;
-					RECREATE(free_timer_list,int32,free_timer_list_max);
-					memset(free_timer_list + (free_timer_list_max - 256), 0, 256 * sizeof(int32));
-				}
-				free_timer_list[free_timer_list_pos++] = tid;
-			break;
-			case TIMER_INTERVAL:
-				if( DIFF_TICK(timer_data[tid].tick, tick) < -1000 )
-					timer_data[tid].tick = tick + timer_data[tid].interval;
-				else
-					timer_data[tid].tick += timer_data[tid].interval;
-				push_timer_heap(tid);
-			break;
-			}
-		}
+		run_timer(tid, tick, diff);
 	}
+#endif
 
 	return cap_value(diff, TIMER_MIN_INTERVAL, TIMER_MAX_INTERVAL);
 }
@@ -514,13 +799,28 @@ double solve_time(char* modif_p) {
 	return totaltime;
 }
 
+/// Writes the run and waiting timers for the metrics endpoint
+static void timer_metrics(MetricsWriter& writer)
+{
+	writer.counter("rathena_timers_total", "Timers that were run.", timer_fired);
+	writer.gauge("rathena_timers_active", "Timers that are waiting to run.", (double)( timer_data_num - free_timer_list_pos ));
+}
+
 void timer_init(void)
 {
 #if defined(ENABLE_RDTSC)
 	rdtsc_calibrate();
 #endif
 
+#ifdef TIMER_WHEEL
+	std::fill_n(timer_wheel_head, TIMER_WHEEL_LEVELS * TIMER_WHEEL_SIZE, INVALID_TIMER);
+	std::fill_n(timer_wheel_tail, TIMER_WHEEL_LEVELS * TIMER_WHEEL_SIZE, INVALID_TIMER);
+	ShowInfo("Timers are scheduled on a '" CL_WHITE "timing wheel" CL_RESET "'.\n");
+#endif
+
 	time(&start_time);
+
+	metrics_add_collector(timer_metrics);
 }
 
 void timer_final(void)
@@ -535,6 +835,10 @@ void timer_final(void)
 	}
 
 	if (timer_data) aFree(timer_data);
+#ifdef TIMER_WHEEL
+	if (timer_link) aFree(timer_link);
+#else
 	BHEAP_CLEAR(timer_heap);
+#endif
 	if (free_timer_list) aFree(free_timer_list);
 }
@@ -60,6 +60,7 @@ t_tick addtick_timer(int32 tid, t_tick tick);
 t_tick settick_timer(int32 tid, t_tick tick);
 
 int32 add_timer_func_list(TimerFunc func, const char* name);
+const char* search_timer_func_list(TimerFunc func);
 
 unsigned long get_uptime(void);
 
@@ -0,0 +1,224 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "watchdog.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "profiler.hpp"
+#include "showmsg.hpp"
+#include "strlib.hpp"
+
+// Packet types that are kept apart per tick, the others only show up in the total
+#define WATCHDOG_PACKET_TYPES 8
+
+struct s_watchdog_tick {
+	uint64 sequence;
+	t_tick tick;
+	uint64 total;	// whole loop iteration
+	uint64 timers;	// do_timer
+	uint64 idle;	// waiting for sockets
+	uint32 counters[WATCHDOG_COUNTER_MAX];
+	TimerFunc slowest_timer;
+	uint64 slowest_timer_time;
+	uint16 packet_types[WATCHDOG_PACKET_TYPES];
+	uint32 packet_counts[WATCHDOG_PACKET_TYPES];
+};
+
+bool watchdog_enabled = false;
+thread_local uint32 watchdog_counters[WATCHDOG_COUNTER_MAX]; // Per thread, SQL also runs on web-server threads
+
+static uint64 watchdog_threshold = 0; // nanoseconds
+static char watchdog_filename[256];
+static std::vector<s_watchdog_tick> watchdog_ring;
+static uint64 watchdog_sequence = 0; // number of recorded ticks
+static uint64 watchdog_dumped = 0; // ticks up to this one were already written
+static s_watchdog_tick watchdog_current;
+static uint64 watchdog_start = 0;
+static uint64 watchdog_idle_start = 0;
+
+/**
+ * Count a packet of the current tick
+ */
+void watchdog_count_packet( uint16 cmd ){
+	watchdog_count( WATCHDOG_PACKETS );
+
+	if( !watchdog_enabled ){
+		return;
+	}
+
+	for( int32 i = 0; i < WATCHDOG_PACKET_TYPES; i++ ){
+		if( watchdog_current.packet_counts[i] == 0 ){
+			watchdog_current.packet_types[i] = cmd;
+		}
+
+		if( watchdog_current.packet_types[i] == cmd ){
+			watchdog_current.packet_counts[i]++;
+			return;
+		}
+	}
+}
+
+/**
+ * Count a timer of the current tick
+ * @param func: Function of the timer
+ * @param nanoseconds: Time the function took
+ */
+void watchdog_timer( TimerFunc func, uint64 nanoseconds ){
+	watchdog_count( WATCHDOG_TIMERS );
+
+	if( nanoseconds > watchdog_current.slowest_timer_time ){
+		watchdog_current.slowest_timer = func;
+		watchdog_current.slowest_timer_time = nanoseconds;
+	}
+}
+
+void watchdog_tick_begin(){
+	if( !watchdog_enabled ){
+		return;
+	}
+
+	memset( &watchdog_current, 0, sizeof( watchdog_current ) );
+	memset( watchdog_counters, 0, sizeof( watchdog_counters ) );
+	watchdog_current.tick = gettick();
+	watchdog_start = profiler_clock();
+}
+
+void watchdog_timers_end(){
+	if( !watchdog_enabled ){
+		return;
+	}
+
+	watchdog_current.timers = profiler_clock() - watchdog_start;
+}
+
+void watchdog_idle_begin(){
+	if( !watchdog_enabled ){
+		return;
+	}
+
+	watchdog_idle_start = profiler_clock();
+}
+
+void watchdog_idle_end(){
+	if( !watchdog_enabled ){
+		return;
+	}
+
+	watchdog_current.idle += profiler_clock() - watchdog_idle_start;
+}
+
+/// Describe a recorded tick in one line
+static std::string watchdog_describe( const s_watchdog_tick& entry ){
+	std::string line;
+	char buf[256];
+
+	snprintf( buf, sizeof( buf ), "tick %" PRtf ": %.1f ms work (timers %.1f ms, sockets %.1f ms), %.1f ms idle | %u timers",
+		entry.tick, ( entry.total - entry.idle ) / 1e6, entry.timers / 1e6, ( entry.total - entry.idle - entry.timers ) / 1e6, entry.idle / 1e6,
+		entry.counters[WATCHDOG_TIMERS] );
+	line += buf;
+
+	if( entry.slowest_timer != nullptr ){
+		snprintf( buf, sizeof( buf ), " (slowest %s %.1f ms)", search_timer_func_list( entry.slowest_timer ), entry.slowest_timer_time / 1e6 );
+		line += buf;
+	}
+
+	snprintf( buf, sizeof( buf ), ", %u packets", entry.counters[WATCHDOG_PACKETS] );
+	line += buf;
+
+	for( int32 i = 0; i < WATCHDOG_PACKET_TYPES && entry.packet_counts[i] > 0; i++ ){
+		snprintf( buf, sizeof( buf ), "%s0x%04x x%u", i == 0 ? " (" : ", ", entry.packet_types[i], entry.packet_counts[i] );
+		line += buf;
+
+		if( i == WATCHDOG_PACKET_TYPES - 1 || entry.packet_counts[i + 1] == 0 ){
+			line += ")";
+		}
+	}
+
+	snprintf( buf, sizeof( buf ), ", %u SQL queries, %u script commands", entry.counters[WATCHDOG_SQL_QUERIES], entry.counters[WATCHDOG_SCRIPT_COMMANDS] );
+	line += buf;
+
+	return line;
+}
+
+/// Append the ticks that were not written yet to the log file
+static void watchdog_dump( const s_watchdog_tick& slow ){
+	FILE* fp = fopen( watchdog_filename, "a" );
+
+	if( fp == nullptr ){
+		ShowError( "watchdog_dump: Could not open '%s' for writing.\n", watchdog_filename );
+		return;
+	}
+
+	uint64 history = watchdog_ring.size();
+	uint64 first = std::max( watchdog_dumped + 1, watchdog_sequence > history ? watchdog_sequence - history + 1 : 1 );
+	char timestring[255];
+
+	timestamp2string( timestring, sizeof( timestring ), time( nullptr ), "%Y-%m-%d %H:%M:%S" );
+	fprintf( fp, "[%s] Tick %" PRtf " took %.1f ms (threshold %.1f ms), recorded ticks:\n", timestring, slow.tick, ( slow.total - slow.idle ) / 1e6, watchdog_threshold / 1e6 );
+
+	if( first > watchdog_dumped + 1 && watchdog_dumped > 0 ){
+		fprintf( fp, "  ... %" PRIu64 " ticks since the last slow tick were dropped\n", first - watchdog_dumped - 1 );
+	}
+
+	for( uint64 sequence = first; sequence <= watchdog_sequence; sequence++ ){
+		fprintf( fp, "  %s\n", watchdog_describe( watchdog_ring[sequence % history] ).c_str() );
+	}
+
+	fclose( fp );
+
+	watchdog_dumped = watchdog_sequence;
+}
+
+void watchdog_tick_end(){
+	if( !watchdog_enabled ){
+		return;
+	}
+
+	watchdog_current.total = profiler_clock() - watchdog_start;
+	memcpy( watchdog_current.counters, watchdog_counters, sizeof( watchdog_counters ) );
+	watchdog_current.sequence = ++watchdog_sequence;
+	watchdog_ring[watchdog_sequence % watchdog_ring.size()] = watchdog_current;
+
+	if( watchdog_current.total - watchdog_current.idle > watchdog_threshold ){
+		ShowWarning( "Tick %" PRtf " took %.1f ms (threshold %.1f ms), the flight recorder was written to '%s'.\n",
+			watchdog_current.tick, ( watchdog_current.total - watchdog_current.idle ) / 1e6, watchdog_threshold / 1e6, watchdog_filename );
+		watchdog_dump( watchdog_current );
+	}
+}
+
+/**
+ * Start watching the ticks
+ * @param threshold: Work time of a tick in milliseconds above which the recorded ticks are written, 0 to disable the watchdog
+ * @param history: Number of ticks to keep
+ * @param filename: File to append the recorded ticks to
+ */
+void watchdog_init( t_tick threshold, uint32 history, const char* filename ){
+	if( threshold <= 0 || history == 0 ){
+		watchdog_final();
+		return;
+	}
+
+	watchdog_threshold = (uint64)threshold * 1000000;
+	safestrncpy( watchdog_filename, filename, sizeof( watchdog_filename ) );
+	watchdog_ring.assign( history, s_watchdog_tick{} );
+	watchdog_sequence = 0;
+	watchdog_dumped = 0;
+	watchdog_enabled = true;
+
+	// Called while a tick is running, record it from here on
+	memset( &watchdog_current, 0, sizeof( watchdog_current ) );
+	watchdog_start = profiler_clock();
+}
+
+void watchdog_final(){
+	watchdog_enabled = false;
+	watchdog_ring.clear();
+	watchdog_ring.shrink_to_fit();
+}
@@ -0,0 +1,48 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef WATCHDOG_HPP
+#define WATCHDOG_HPP
+
+#include "cbasetypes.hpp"
+#include "timer.hpp"
+
+/**
+ * Tick watchdog and flight recorder
+ * The core loop reports where every tick spent its time (timers, socket
+ * processing and waiting for sockets), the servers count what happened in it.
+ * The last ticks are kept in a ring buffer, which is appended to a log file
+ * whenever the work of a tick took longer than the threshold.
+ * Only the main thread may report to the watchdog. Counters may be bumped from
+ * any thread, but only the ones of the main thread are recorded.
+ */
+
+enum e_watchdog_counter : uint8 {
+	WATCHDOG_TIMERS = 0,
+	WATCHDOG_PACKETS,
+	WATCHDOG_SQL_QUERIES,
+	WATCHDOG_SCRIPT_COMMANDS,
+	WATCHDOG_COUNTER_MAX
+};
+
+extern bool watchdog_enabled;
+extern thread_local uint32 watchdog_counters[WATCHDOG_COUNTER_MAX];
+
+/// Count an event of the current tick
+static inline void watchdog_count( e_watchdog_counter counter ){
+	watchdog_counters[counter]++;
+}
+
+void watchdog_count_packet( uint16 cmd );
+void watchdog_timer( TimerFunc func, uint64 nanoseconds );
+
+void watchdog_tick_begin();
+void watchdog_timers_end();
+void watchdog_idle_begin();
+void watchdog_idle_end();
+void watchdog_tick_end();
+
+void watchdog_init( t_tick threshold, uint32 history, const char* filename );
+void watchdog_final();
+
+#endif /* WATCHDOG_HPP */
@@ -0,0 +1,90 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "worker_pool.hpp"
+
+WorkerPool::WorkerPool( size_t threads ) : job( nullptr ), jobs( 0 ), next( 0 ), busy( 0 ), generation( 0 ), stopping( false ){
+	for( size_t i = 0; i < threads; i++ ){
+		this->threads.emplace_back( &WorkerPool::work, this );
+	}
+}
+
+WorkerPool::~WorkerPool(){
+	{
+		std::lock_guard<std::mutex> lock( this->mutex );
+
+		this->stopping = true;
+	}
+
+	this->wakeup.notify_all();
+
+	for( std::thread& thread : this->threads ){
+		thread.join();
+	}
+}
+
+/// Run jobs until none are left
+void WorkerPool::take(){
+	for( size_t i = this->next.fetch_add( 1 ); i < this->jobs; i = this->next.fetch_add( 1 ) ){
+		( *this->job )( i );
+	}
+}
+
+void WorkerPool::work(){
+	uint64 seen = 0;
+
+	while( true ){
+		{
+			std::unique_lock<std::mutex> lock( this->mutex );
+
+			this->wakeup.wait( lock, [this, seen]{ return this->stopping || this->generation != seen; } );
+
+			if( this->stopping ){
+				return;
+			}
+
+			seen = this->generation;
+		}
+
+		this->take();
+
+		std::lock_guard<std::mutex> lock( this->mutex );
+
+		if( --this->busy == 0 ){
+			this->finished.notify_one();
+		}
+	}
+}
+
+/**
+ * Run a batch of jobs and wait for all of them
+ * @param jobs: Number of jobs
+ * @param job: Function that runs the job with the given index
+ */
+void WorkerPool::run( size_t jobs, const std::function<void( size_t )>& job ){
+	if( this->threads.empty() || jobs < 2 ){
+		for( size_t i = 0; i < jobs; i++ ){
+			job( i );
+		}
+
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( this->mutex );
+
+		this->job = &job;
+		this->jobs = jobs;
+		this->next = 0;
+		this->busy = this->threads.size();
+		this->generation++;
+	}
+
+	this->wakeup.notify_all();
+	this->take();
+
+	std::unique_lock<std::mutex> lock( this->mutex );
+
+	this->finished.wait( lock, [this]{ return this->busy == 0; } );
+	this->job = nullptr;
+}
@@ -0,0 +1,48 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef WORKER_POOL_HPP
+#define WORKER_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cbasetypes.hpp"
+
+/**
+ * Fixed set of threads that run a batch of independent jobs
+ * run() hands out the jobs to the threads and to the calling thread and
+ * returns once all of them are finished. Jobs must not touch anything that is
+ * not safe to use from several threads, which includes the memory manager.
+ */
+class WorkerPool {
+private:
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wakeup;
+	std::condition_variable finished;
+	const std::function<void( size_t )>* job;
+	size_t jobs;
+	std::atomic<size_t> next;
+	size_t busy;
+	uint64 generation;
+	bool stopping;
+
+	void work();
+	void take();
+
+public:
+	WorkerPool( size_t threads );
+	~WorkerPool();
+
+	/// Number of threads, not counting the one calling run()
+	size_t size() const { return this->threads.size(); }
+
+	void run( size_t jobs, const std::function<void( size_t )>& job );
+};
+
+#endif /* WORKER_POOL_HPP */
@@ -0,0 +1,273 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "ai_dialogue_cache.hpp"
+
+#include <cctype>
+#include <functional>
+
+#include <common/showmsg.hpp>
+
+/**
+ * Constructor
+ */
+AIDialogueCache::AIDialogueCache(size_t bytes)
+    : max_bytes(bytes)
+    , used_bytes(0)
+    , bridge_epoch(0)
+    , total_hits(0)
+    , total_misses(0)
+    , total_evictions(0)
+    , total_invalidations(0)
+{
+    ShowStatus("AI Dialogue Cache: Initialized (max size: %zu bytes)\n", max_bytes);
+}
+
+/**
+ * Destructor
+ */
+AIDialogueCache::~AIDialogueCache() {
+    clear();
+}
+
+/**
+ * Build the cache key for a request
+ * The message is lowercased, whitespace is collapsed and trailing punctuation dropped,
+ * so "Hello!" and "hello" share an entry.
+ * @param npc_name AI NPC identifier
+ * @param message Player's text input
+ * @param context Optional player context the answer depends on (e.g. job or quest state)
+ */
+std::string AIDialogueCache::make_key(const std::string& npc_name, const std::string& message, const std::string& context) {
+    std::string key = npc_name;
+    bool space = false;
+
+    key += '\n';
+
+    for (char c : message) {
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            space = true;
+            continue;
+        }
+
+        if (space && key.back() != '\n') {
+            key += ' ';
+        }
+
+        space = false;
+        key += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+
+    while (key.back() == '?' || key.back() == '!' || key.back() == '.' || key.back() == ' ') {
+        key.pop_back();
+    }
+
+    if (!context.empty()) {
+        key += '\n';
+        key += std::to_string(std::hash<std::string>()(context));
+    }
+
+    return key;
+}
+
+/**
+ * Remove an entry (cache_mutex must be held)
+ */
+void AIDialogueCache::erase_entry(std::list<AIDialogueCacheEntry>::iterator it) {
+    used_bytes -= it->bytes;
+    index.erase(it->key);
+    entries.erase(it);
+}
+
+/**
+ * Look up a cached answer (thread-safe)
+ * @param key Key built by make_key
+ * @param npc_response Output parameter for the cached dialogue text
+ * @return true on a hit
+ */
+bool AIDialogueCache::lookup(const std::string& key, std::string& npc_response) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    auto it = index.find(key);
+
+    if (it == index.end()) {
+        total_misses++;
+        return false;
+    }
+
+    if (DIFF_TICK(gettick(), it->second->expire_time) >= 0) {
+        erase_entry(it->second);
+        total_misses++;
+        return false;
+    }
+
+    // Move to the front of the LRU list
+    entries.splice(entries.begin(), entries, it->second);
+    npc_response = it->second->npc_response;
+    total_hits++;
+
+    return true;
+}
+
+/**
+ * Store an answer (thread-safe)
+ * @param key Key built by make_key
+ * @param npc_name AI NPC identifier, used for invalidation
+ * @param npc_response Dialogue text to cache
+ * @param ttl_ms Time to live in milliseconds
+ */
+void AIDialogueCache::store(const std::string& key, const std::string& npc_name, const std::string& npc_response, int32 ttl_ms) {
+    size_t bytes = sizeof(AIDialogueCacheEntry) + key.size() * 2 + npc_name.size() + npc_response.size();
+
+    if (ttl_ms <= 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+
+    if (bytes > max_bytes) {
+        return;
+    }
+
+    auto it = index.find(key);
+
+    if (it != index.end()) {
+        erase_entry(it->second);
+    }
+
+    while (used_bytes + bytes > max_bytes && !entries.empty()) {
+        erase_entry(std::prev(entries.end()));
+        total_evictions++;
+    }
+
+    entries.push_front({ key, npc_name, npc_response, gettick() + ttl_ms, bytes });
+    index[key] = entries.begin();
+    used_bytes += bytes;
+}
+
+/**
+ * Drop all entries of an NPC (cache_mutex must be held)
+ */
+void AIDialogueCache::invalidate_npc_locked(const std::string& npc_name) {
+    auto it = entries.begin();
+
+    while (it != entries.end()) {
+        if (it->npc_name == npc_name) {
+            auto next = std::next(it);
+            erase_entry(it);
+            it = next;
+            total_invalidations++;
+        } else {
+            ++it;
+        }
+    }
+}
+
+/**
+ * Drop all entries of an NPC, e.g. after its persona changed (thread-safe)
+ */
+void AIDialogueCache::invalidate_npc(const std::string& npc_name) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    invalidate_npc_locked(npc_name);
+}
+
+/**
+ * Apply the persona versions reported by the bridge (thread-safe)
+ * NPCs whose version changed since the last report are invalidated.
+ * A new epoch means the bridge restarted and lost track, so everything is dropped.
+ * @param epoch Bridge instance identifier
+ * @param versions npc_name -> persona version
+ */
+void AIDialogueCache::apply_versions(uint64 epoch, const std::unordered_map<std::string, uint64>& versions) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+
+    if (epoch != bridge_epoch) {
+        if (bridge_epoch != 0 && !entries.empty()) {
+            ShowInfo("AI Dialogue Cache: Bridge restarted, dropping %zu entries\n", entries.size());
+            total_invalidations += entries.size();
+            entries.clear();
+            index.clear();
+            used_bytes = 0;
+        }
+
+        bridge_epoch = epoch;
+        npc_versions = versions;
+        return;
+    }
+
+    for (const auto& version : versions) {
+        auto known = npc_versions.find(version.first);
+
+        if (known == npc_versions.end() || known->second != version.second) {
+            invalidate_npc_locked(version.first);
+        }
+    }
+
+    npc_versions = versions;
+}
+
+/**
+ * Drop all entries (thread-safe)
+ */
+void AIDialogueCache::clear() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    entries.clear();
+    index.clear();
+    used_bytes = 0;
+}
+
+/**
+ * Set the size limit in bytes, evicting entries if needed (thread-safe)
+ */
+void AIDialogueCache::set_max_bytes(size_t bytes) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    max_bytes = bytes;
+
+    while (used_bytes > max_bytes && !entries.empty()) {
+        erase_entry(std::prev(entries.end()));
+        total_evictions++;
+    }
+}
+
+/**
+ * Get number of cached entries (thread-safe)
+ */
+size_t AIDialogueCache::size() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return entries.size();
+}
+
+/**
+ * Get memory accounted for cached entries (thread-safe)
+ */
+size_t AIDialogueCache::size_bytes() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return used_bytes;
+}
+
+/**
+ * Get total cache hits
+ */
+uint64 AIDialogueCache::get_total_hits() const {
+    return total_hits.load();
+}
+
+/**
+ * Get total cache misses (including expired entries)
+ */
+uint64 AIDialogueCache::get_total_misses() const {
+    return total_misses.load();
+}
+
+/**
+ * Get total entries evicted by the size limit
+ */
+uint64 AIDialogueCache::get_total_evictions() const {
+    return total_evictions.load();
+}
+
+/**
+ * Get total entries dropped because the NPC persona changed
+ */
+uint64 AIDialogueCache::get_total_invalidations() const {
+    return total_invalidations.load();
+}
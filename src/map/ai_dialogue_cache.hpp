@@ -0,0 +1,81 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef AI_DIALOGUE_CACHE_HPP
+#define AI_DIALOGUE_CACHE_HPP
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <common/cbasetypes.hpp>
+#include <common/timer.hpp>
+
+/**
+ * AI Dialogue Cache Entry
+ */
+struct AIDialogueCacheEntry {
+    std::string key;            // npc_name, normalized message and context hash
+    std::string npc_name;       // Owner NPC, used for invalidation
+    std::string npc_response;   // Cached dialogue text
+    t_tick expire_time;         // Entry is ignored after this tick
+    size_t bytes;               // Memory accounted for this entry
+};
+
+/**
+ * AI Dialogue Response Cache
+ * Thread-safe LRU cache of bridge answers shared by the worker threads.
+ * Only NPCs that opt in through ai_chat_start are cached, each with its own TTL.
+ * The total size is bounded in bytes, least recently used entries are evicted first.
+ */
+class AIDialogueCache {
+private:
+    size_t max_bytes;
+    size_t used_bytes;
+
+    // Most recently used at the front
+    std::list<AIDialogueCacheEntry> entries;
+    std::unordered_map<std::string, std::list<AIDialogueCacheEntry>::iterator> index;
+    std::mutex cache_mutex;
+
+    // Persona versions last reported by the bridge
+    uint64 bridge_epoch;
+    std::unordered_map<std::string, uint64> npc_versions;
+
+    // Statistics
+    std::atomic<uint64> total_hits;
+    std::atomic<uint64> total_misses;
+    std::atomic<uint64> total_evictions;
+    std::atomic<uint64> total_invalidations;
+
+    void erase_entry(std::list<AIDialogueCacheEntry>::iterator it);
+    void invalidate_npc_locked(const std::string& npc_name);
+
+public:
+    AIDialogueCache(size_t bytes);
+    ~AIDialogueCache();
+
+    static std::string make_key(const std::string& npc_name, const std::string& message, const std::string& context);
+
+    // Cache operations
+    bool lookup(const std::string& key, std::string& npc_response);
+    void store(const std::string& key, const std::string& npc_name, const std::string& npc_response, int32 ttl_ms);
+    void invalidate_npc(const std::string& npc_name);
+    void apply_versions(uint64 epoch, const std::unordered_map<std::string, uint64>& versions);
+    void clear();
+
+    // Configuration
+    void set_max_bytes(size_t bytes);
+
+    // Statistics
+    size_t size();
+    size_t size_bytes();
+    uint64 get_total_hits() const;
+    uint64 get_total_misses() const;
+    uint64 get_total_evictions() const;
+    uint64 get_total_invalidations() const;
+};
+
+#endif /* AI_DIALOGUE_CACHE_HPP */
@@ -0,0 +1,219 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "ai_dialogue_connection_pool.hpp"
+
+#include <httplib.h>
+
+#include <common/showmsg.hpp>
+#include <common/timer.hpp>
+
+/**
+ * Pooled connection constructor
+ */
+AIDialogueConnection::AIDialogueConnection()
+    : created_time(0)
+    , last_used_time(0)
+    , requests_served(0)
+{
+}
+
+/**
+ * Pooled connection destructor (closes the socket if still open)
+ */
+AIDialogueConnection::~AIDialogueConnection() {
+    if (client) {
+        client->stop();
+    }
+}
+
+/**
+ * Constructor
+ */
+AIDialogueConnectionPool::AIDialogueConnectionPool(const AIDialogueConnectionPoolConfig& cfg)
+    : config(cfg)
+    , total_connections_opened(0)
+    , total_connections_reused(0)
+    , total_connections_evicted(0)
+    , total_connections_failed(0)
+{
+    ShowStatus("AI Dialogue Connection Pool: Initialized (bridge: %s:%d, max idle: %d, idle timeout: %dms)\n",
+               config.host.c_str(), config.port, config.max_idle_connections, config.idle_timeout_ms);
+}
+
+/**
+ * Destructor
+ */
+AIDialogueConnectionPool::~AIDialogueConnectionPool() {
+    clear();
+}
+
+/**
+ * Open a new keep-alive connection to the bridge (pool_mutex must be held)
+ */
+std::unique_ptr<AIDialogueConnection> AIDialogueConnectionPool::open_connection() {
+    std::unique_ptr<AIDialogueConnection> conn = std::make_unique<AIDialogueConnection>();
+
+    conn->client = std::make_unique<httplib::Client>(config.host, config.port);
+    conn->client->set_keep_alive(true);
+    conn->client->set_tcp_nodelay(true);
+    conn->client->set_connection_timeout(config.connect_timeout_ms / 1000, (config.connect_timeout_ms % 1000) * 1000);
+    conn->client->set_read_timeout(config.request_timeout_ms / 1000, (config.request_timeout_ms % 1000) * 1000);
+    conn->client->set_write_timeout(config.request_timeout_ms / 1000, (config.request_timeout_ms % 1000) * 1000);
+    conn->created_time = gettick();
+    conn->last_used_time = conn->created_time;
+
+    total_connections_opened++;
+
+    return conn;
+}
+
+/**
+ * Health check for an idle connection
+ * @return true if the connection may be handed out again
+ */
+bool AIDialogueConnectionPool::is_reusable(const AIDialogueConnection& conn, t_tick current_time) const {
+    // The bridge closed the socket (Connection: close or error)
+    if (!conn.client || !conn.client->is_socket_open()) {
+        return false;
+    }
+
+    // Idle for too long, the bridge may already have dropped it
+    if (DIFF_TICK(current_time, conn.last_used_time) > config.idle_timeout_ms) {
+        return false;
+    }
+
+    // Recycle periodically so load balancers can rebalance
+    if (config.max_requests_per_connection > 0 && conn.requests_served >= (uint64)config.max_requests_per_connection) {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Acquire a connection from the pool (thread-safe)
+ * @param reused Output parameter, true if an existing keep-alive connection was handed out
+ * @return A connection owned by the caller until release()
+ */
+std::unique_ptr<AIDialogueConnection> AIDialogueConnectionPool::acquire(bool& reused) {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    t_tick current_time = gettick();
+
+    reused = false;
+
+    while (!idle_connections.empty()) {
+        std::unique_ptr<AIDialogueConnection> conn = std::move(idle_connections.back());
+        idle_connections.pop_back();
+
+        if (is_reusable(*conn, current_time)) {
+            reused = true;
+            total_connections_reused++;
+            return conn;
+        }
+
+        total_connections_evicted++;
+    }
+
+    // Opening is cheap here, the TCP handshake happens on first use
+    return open_connection();
+}
+
+/**
+ * Return a connection to the pool (thread-safe)
+ * @param conn The connection previously obtained from acquire()
+ * @param healthy false if the last request failed at the transport level
+ */
+void AIDialogueConnectionPool::release(std::unique_ptr<AIDialogueConnection> conn, bool healthy) {
+    if (!conn) {
+        return;
+    }
+
+    if (!healthy) {
+        total_connections_failed++;
+        return; // Destructor closes the socket
+    }
+
+    conn->last_used_time = gettick();
+
+    std::lock_guard<std::mutex> lock(pool_mutex);
+
+    if (idle_connections.size() >= (size_t)config.max_idle_connections) {
+        total_connections_evicted++;
+        return;
+    }
+
+    idle_connections.push_back(std::move(conn));
+}
+
+/**
+ * Close idle connections that are no longer reusable (thread-safe)
+ */
+void AIDialogueConnectionPool::evict_idle() {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    t_tick current_time = gettick();
+
+    auto it = idle_connections.begin();
+    while (it != idle_connections.end()) {
+        if (is_reusable(**it, current_time)) {
+            ++it;
+        } else {
+            it = idle_connections.erase(it);
+            total_connections_evicted++;
+        }
+    }
+}
+
+/**
+ * Close all idle connections (thread-safe)
+ */
+void AIDialogueConnectionPool::clear() {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    idle_connections.clear();
+}
+
+/**
+ * Set configuration
+ * Idle connections are dropped since they may point to the old bridge.
+ */
+void AIDialogueConnectionPool::set_config(const AIDialogueConnectionPoolConfig& cfg) {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    config = cfg;
+    idle_connections.clear();
+}
+
+/**
+ * Get number of idle connections (thread-safe)
+ */
+size_t AIDialogueConnectionPool::idle_count() {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    return idle_connections.size();
+}
+
+/**
+ * Get total connections opened since startup
+ */
+uint64 AIDialogueConnectionPool::get_total_connections_opened() const {
+    return total_connections_opened.load();
+}
+
+/**
+ * Get total times an idle keep-alive connection was reused
+ */
+uint64 AIDialogueConnectionPool::get_total_connections_reused() const {
+    return total_connections_reused.load();
+}
+
+/**
+ * Get total idle connections closed by the health check or the pool bound
+ */
+uint64 AIDialogueConnectionPool::get_total_connections_evicted() const {
+    return total_connections_evicted.load();
+}
+
+/**
+ * Get total connections discarded after a transport failure
+ */
+uint64 AIDialogueConnectionPool::get_total_connections_failed() const {
+    return total_connections_failed.load();
+}
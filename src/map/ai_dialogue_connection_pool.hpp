@@ -0,0 +1,91 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef AI_DIALOGUE_CONNECTION_POOL_HPP
+#define AI_DIALOGUE_CONNECTION_POOL_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <common/cbasetypes.hpp>
+#include <common/timer.hpp>
+
+namespace httplib {
+class Client;
+}
+
+/**
+ * AI Dialogue Pooled Connection
+ * A keep-alive HTTP client to the bridge plus its bookkeeping
+ */
+struct AIDialogueConnection {
+    std::unique_ptr<httplib::Client> client; // Keep-alive client bound to the bridge
+    t_tick created_time;                     // When the connection was opened
+    t_tick last_used_time;                   // When the connection was last released
+    uint64 requests_served;                  // Requests sent over this connection
+
+    AIDialogueConnection();
+    ~AIDialogueConnection();
+};
+
+/**
+ * AI Dialogue Connection Pool Configuration
+ */
+struct AIDialogueConnectionPoolConfig {
+    std::string host;                   // Bridge host
+    uint16 port;                        // Bridge port
+    int32 connect_timeout_ms;           // TCP connect timeout in milliseconds
+    int32 request_timeout_ms;           // Read/write timeout in milliseconds
+    int32 max_idle_connections;         // Idle connections kept open (0 disables pooling)
+    int32 idle_timeout_ms;              // Idle connections older than this are evicted
+    int32 max_requests_per_connection;  // Recycle a connection after this many requests (0 = unlimited)
+};
+
+/**
+ * AI Dialogue Connection Pool
+ * Bounded, thread-safe pool of keep-alive connections shared by the worker threads.
+ * Connections are handed out most-recently-used first so hot sockets stay warm,
+ * stale ones are evicted on acquire and broken ones are discarded on release.
+ */
+class AIDialogueConnectionPool {
+private:
+    AIDialogueConnectionPoolConfig config;
+
+    // Idle connections, most recently used at the back
+    std::vector<std::unique_ptr<AIDialogueConnection>> idle_connections;
+    std::mutex pool_mutex;
+
+    // Statistics
+    std::atomic<uint64> total_connections_opened;
+    std::atomic<uint64> total_connections_reused;
+    std::atomic<uint64> total_connections_evicted;
+    std::atomic<uint64> total_connections_failed;
+
+    std::unique_ptr<AIDialogueConnection> open_connection();
+    bool is_reusable(const AIDialogueConnection& conn, t_tick current_time) const;
+
+public:
+    AIDialogueConnectionPool(const AIDialogueConnectionPoolConfig& cfg);
+    ~AIDialogueConnectionPool();
+
+    // Connection lifecycle
+    std::unique_ptr<AIDialogueConnection> acquire(bool& reused);
+    void release(std::unique_ptr<AIDialogueConnection> conn, bool healthy);
+    void evict_idle();
+    void clear();
+
+    // Configuration
+    void set_config(const AIDialogueConnectionPoolConfig& cfg);
+
+    // Statistics
+    size_t idle_count();
+    uint64 get_total_connections_opened() const;
+    uint64 get_total_connections_reused() const;
+    uint64 get_total_connections_evicted() const;
+    uint64 get_total_connections_failed() const;
+};
+
+#endif /* AI_DIALOGUE_CONNECTION_POOL_HPP */
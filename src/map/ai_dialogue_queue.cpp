@@ -3,19 +3,33 @@
 
 #include "ai_dialogue_queue.hpp"
 
+#include <algorithm>
 #include <chrono>
 
 #include <common/showmsg.hpp>
+#include <common/socket.hpp>
 
 /**
  * Constructor
  */
-AIDialogueQueue::AIDialogueQueue() 
-    : total_requests_queued(0)
+AIDialogueQueue::AIDialogueQueue(const AIDialogueQueueConfig& cfg) 
+    : config(cfg)
+    , request_count(0)
+    , response_queue(MAX_RESPONSE_QUEUE_SIZE)
+    , response_wakeup_fd(-1)
+    , response_wakeup_pending(false)
+    , total_requests_queued(0)
     , total_responses_queued(0)
     , total_requests_dropped(0)
+    , total_responses_dropped(0)
+    , total_requests_expired(0)
 {
-    ShowStatus("AI Dialogue Queue: Initialized\n");
+    for (int32 i = 0; i < AI_DIALOGUE_PRIORITY_MAX; i++) {
+        request_classes[i].credits = std::max(config.priority_weights[i], 1);
+    }
+    
+    ShowStatus("AI Dialogue Queue: Initialized (capacity: %d, per NPC: %d, per account: %d)\n",
+               config.max_requests, config.max_requests_per_npc, config.max_requests_per_account);
 }
 
 /**
@@ -29,25 +43,122 @@ AIDialogueQueue::~AIDialogueQueue() {
 /**
  * Push a request to the queue (thread-safe)
  * @param req The request to queue
- * @return true if queued successfully, false if queue is full
+ * @return true if queued successfully, false if the queue or the NPC/account share is full
  */
 bool AIDialogueQueue::push_request(const AIDialogueRequest& req) {
     std::lock_guard<std::mutex> lock(request_mutex);
     
-    if (request_queue.size() >= MAX_REQUEST_QUEUE_SIZE) {
+    if (request_count >= (size_t)config.max_requests) {
         ShowWarning("AI Dialogue Queue: Request queue full! Dropping request from char_id=%u\n", req.char_id);
         total_requests_dropped++;
         return false;
     }
     
-    request_queue.push(req);
+    uint8 priority = std::min<uint8>(req.priority, AI_DIALOGUE_PRIORITY_MAX - 1);
+    AIDialogueRequestClass& rclass = request_classes[priority];
+    auto flow = rclass.npc_flows.find(req.npc_id);
+    
+    if (config.max_requests_per_npc > 0 && flow != rclass.npc_flows.end() && flow->second.size() >= (size_t)config.max_requests_per_npc) {
+        ShowWarning("AI Dialogue Queue: Too many requests for npc_id=%u! Dropping request from char_id=%u\n", req.npc_id, req.char_id);
+        total_requests_dropped++;
+        return false;
+    }
+    
+    auto account = account_pending.find(req.account_id);
+    
+    if (config.max_requests_per_account > 0 && account != account_pending.end() && account->second >= config.max_requests_per_account) {
+        ShowWarning("AI Dialogue Queue: Too many requests for account_id=%u! Dropping request from char_id=%u\n", req.account_id, req.char_id);
+        total_requests_dropped++;
+        return false;
+    }
+    
+    // The NPC joins the end of the round-robin when it had nothing pending
+    if (flow == rclass.npc_flows.end()) {
+        flow = rclass.npc_flows.emplace(req.npc_id, std::deque<AIDialogueRequest>()).first;
+        rclass.active_npcs.push_back(req.npc_id);
+    }
+    
+    flow->second.push_back(req);
+    flow->second.back().priority = priority;
+    account_pending[req.account_id]++;
+    request_count++;
     total_requests_queued++;
     
     // Notify waiting worker threads
     request_cv.notify_one();
     
     ShowDebug("AI Dialogue Queue: Queued request from char_id=%u (queue size: %zu)\n", 
-              req.char_id, request_queue.size());
+              req.char_id, request_count);
+    
+    return true;
+}
+
+/**
+ * Release the NPC and account shares held by a request (request_mutex must be held)
+ */
+void AIDialogueQueue::unaccount_request(const AIDialogueRequest& req) {
+    auto it = account_pending.find(req.account_id);
+    
+    if (it != account_pending.end() && --it->second <= 0) {
+        account_pending.erase(it);
+    }
+    
+    request_count--;
+}
+
+/**
+ * Pick the next request to process (request_mutex must be held)
+ * Classes are served by weight so ambient chatter still progresses under load,
+ * NPCs of a class take turns and each NPC's requests stay in FIFO order.
+ * @param req Output parameter for the picked request
+ * @return true if a request was picked, false if the queue is empty
+ */
+bool AIDialogueQueue::take_request(AIDialogueRequest& req) {
+    if (request_count == 0) {
+        return false;
+    }
+    
+    AIDialogueRequestClass* rclass = nullptr;
+    
+    // Highest class that still has credits in this round, otherwise start a new round
+    for (int32 round = 0; round < 2 && rclass == nullptr; round++) {
+        for (int32 i = AI_DIALOGUE_PRIORITY_MAX - 1; i >= 0; i--) {
+            AIDialogueRequestClass& candidate = request_classes[i];
+            
+            if (!candidate.active_npcs.empty() && candidate.credits > 0) {
+                rclass = &candidate;
+                break;
+            }
+        }
+        
+        if (rclass == nullptr) {
+            for (int32 i = 0; i < AI_DIALOGUE_PRIORITY_MAX; i++) {
+                request_classes[i].credits = std::max(config.priority_weights[i], 1);
+            }
+        }
+    }
+    
+    if (rclass == nullptr) {
+        return false;
+    }
+    
+    rclass->credits--;
+    
+    uint32 npc_id = rclass->active_npcs.front();
+    rclass->active_npcs.pop_front();
+    
+    auto flow = rclass->npc_flows.find(npc_id);
+    
+    req = std::move(flow->second.front());
+    flow->second.pop_front();
+    
+    if (flow->second.empty()) {
+        rclass->npc_flows.erase(flow);
+    } else {
+        rclass->active_npcs.push_back(npc_id);
+    }
+    
+    unaccount_request(req);
     
     return true;
 }
@@ -62,24 +173,51 @@ bool AIDialogueQueue::pop_request(AIDialogueRequest& req, int timeout_ms) {
     std::unique_lock<std::mutex> lock(request_mutex);
     
     // Wait for request or timeout
-    if (request_queue.empty()) {
+    if (request_count == 0) {
         auto timeout = std::chrono::milliseconds(timeout_ms);
-        if (!request_cv.wait_for(lock, timeout, [this] { return !request_queue.empty(); })) {
+        if (!request_cv.wait_for(lock, timeout, [this] { return request_count > 0; })) {
             return false; // Timeout
         }
     }
     
-    if (request_queue.empty()) {
+    if (!take_request(req)) {
         return false;
     }
     
-    req = request_queue.front();
-    request_queue.pop();
+    return true;
+}
+
+/**
+ * Pop up to max_count requests from the queue (thread-safe, blocking with timeout)
+ * Waits up to timeout_ms for a first request, then up to batch_wait_ms for the
+ * batch to fill before returning whatever is available.
+ * @param batch Output parameter, popped requests are appended
+ * @param max_count Maximum number of requests to pop
+ * @param timeout_ms Maximum time to wait for the first request in milliseconds
+ * @param batch_wait_ms Maximum time to wait for more requests in milliseconds
+ * @return true if at least one request was popped
+ */
+bool AIDialogueQueue::pop_request_batch(std::vector<AIDialogueRequest>& batch, size_t max_count, int timeout_ms, int batch_wait_ms) {
+    std::unique_lock<std::mutex> lock(request_mutex);
+    
+    if (!request_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this] { return request_count > 0; })) {
+        return false; // Timeout
+    }
+    
+    // Linger so requests arriving together share one bridge call
+    if (request_count < max_count && batch_wait_ms > 0) {
+        request_cv.wait_for(lock, std::chrono::milliseconds(batch_wait_ms), [this, max_count] { return request_count >= max_count; });
+    }
     
-    ShowDebug("AI Dialogue Queue: Popped request for char_id=%u (queue size: %zu)\n", 
-              req.char_id, request_queue.size());
+    size_t count = 0;
+    AIDialogueRequest req;
     
-    return true;
+    while (count < max_count && take_request(req)) {
+        batch.push_back(std::move(req));
+        count++;
+    }
+    
+    return count > 0;
 }
 
 /**
@@ -87,58 +225,114 @@ bool AIDialogueQueue::pop_request(AIDialogueRequest& req, int timeout_ms) {
  */
 size_t AIDialogueQueue::request_queue_size() {
     std::lock_guard<std::mutex> lock(request_mutex);
-    return request_queue.size();
+    return request_count;
 }
 
 /**
- * Push a response to the queue (thread-safe)
+ * Remove requests nobody is waiting for anymore (thread-safe)
+ * A request is dropped if it waited longer than max_wait_ms or if is_stale says so,
+ * e.g. because the player went offline. Called from the map thread, which owns player data.
+ * @param is_stale Predicate evaluated for every queued request
+ * @param dropped Output parameter, removed requests are appended
+ * @return Number of requests removed
+ */
+size_t AIDialogueQueue::purge_requests(const std::function<bool(const AIDialogueRequest&)>& is_stale, std::vector<AIDialogueRequest>& dropped) {
+    std::lock_guard<std::mutex> lock(request_mutex);
+    t_tick current_time = gettick();
+    size_t count = 0;
+    
+    for (AIDialogueRequestClass& rclass : request_classes) {
+        for (auto flow = rclass.npc_flows.begin(); flow != rclass.npc_flows.end(); ) {
+            std::deque<AIDialogueRequest>& requests = flow->second;
+            
+            for (auto it = requests.begin(); it != requests.end(); ) {
+                if ((config.max_wait_ms > 0 && DIFF_TICK(current_time, it->request_time) > config.max_wait_ms) || is_stale(*it)) {
+                    unaccount_request(*it);
+                    dropped.push_back(std::move(*it));
+                    it = requests.erase(it);
+                    count++;
+                } else {
+                    ++it;
+                }
+            }
+            
+            if (requests.empty()) {
+                uint32 npc_id = flow->first;
+                
+                rclass.active_npcs.erase(std::remove(rclass.active_npcs.begin(), rclass.active_npcs.end(), npc_id), rclass.active_npcs.end());
+                flow = rclass.npc_flows.erase(flow);
+            } else {
+                ++flow;
+            }
+        }
+    }
+    
+    if (count > 0) {
+        total_requests_expired += count;
+        ShowDebug("AI Dialogue Queue: Purged %zu stale requests (queue size: %zu)\n", count, request_count);
+    }
+    
+    return count;
+}
+
+/**
+ * Push a response to the queue (thread-safe, lock-free)
+ * Wakes up the map thread if it is not already about to drain the queue.
  * @param resp The response to queue
  * @return true if queued successfully, false if queue is full
  */
 bool AIDialogueQueue::push_response(const AIDialogueResponse& resp) {
-    std::lock_guard<std::mutex> lock(response_mutex);
-    
-    if (response_queue.size() >= MAX_RESPONSE_QUEUE_SIZE) {
+    if (!response_queue.push(resp)) {
         ShowWarning("AI Dialogue Queue: Response queue full! Dropping response for char_id=%u\n", resp.char_id);
+        total_responses_dropped++;
         return false;
     }
     
-    response_queue.push(resp);
     total_responses_queued++;
     
-    ShowDebug("AI Dialogue Queue: Queued response for char_id=%u (queue size: %zu)\n", 
-              resp.char_id, response_queue.size());
+    int32 wakeup_fd = response_wakeup_fd.load(std::memory_order_acquire);
+    
+    if (wakeup_fd >= 0 && !response_wakeup_pending.exchange(true)) {
+        wakeup_event_signal(wakeup_fd);
+    }
     
     return true;
 }
 
 /**
- * Pop a response from the queue (thread-safe, non-blocking)
+ * Pop a response from the queue (map thread only, non-blocking)
  * @param resp Output parameter for the popped response
  * @return true if response was popped, false if queue empty
  */
 bool AIDialogueQueue::pop_response(AIDialogueResponse& resp) {
-    std::lock_guard<std::mutex> lock(response_mutex);
-    
-    if (response_queue.empty()) {
-        return false;
-    }
-    
-    resp = response_queue.front();
-    response_queue.pop();
-    
-    ShowDebug("AI Dialogue Queue: Popped response for char_id=%u (queue size: %zu)\n", 
-              resp.char_id, response_queue.size());
+    return response_queue.pop(resp);
+}
+
+/**
+ * Move all available responses into a local vector (map thread only, non-blocking)
+ * @param out Responses are appended in the order they were queued
+ * @return Number of responses drained
+ */
+size_t AIDialogueQueue::drain_responses(std::vector<AIDialogueResponse>& out) {
+    // Clear first so a push racing with the drain signals again
+    response_wakeup_pending.store(false);
     
-    return true;
+    return response_queue.drain(out);
 }
 
 /**
- * Get current response queue size (thread-safe)
+ * Get approximate response queue size (thread-safe)
  */
 size_t AIDialogueQueue::response_queue_size() {
-    std::lock_guard<std::mutex> lock(response_mutex);
-    return response_queue.size();
+    return response_queue.size_approx();
+}
+
+/**
+ * Set the wakeup event signaled when responses are queued
+ * @param fd Event created by make_wakeup_event, or -1 to disable
+ */
+void AIDialogueQueue::set_response_wakeup(int32 fd) {
+    response_wakeup_fd.store(fd, std::memory_order_release);
 }
 
 /**
@@ -163,21 +357,45 @@ uint64 AIDialogueQueue::get_total_requests_dropped() const {
 }
 
 /**
- * Clear all queues (thread-safe)
+ * Get total responses dropped due to queue full
+ */
+uint64 AIDialogueQueue::get_total_responses_dropped() const {
+    return total_responses_dropped.load();
+}
+
+/**
+ * Get total requests purged because nobody was waiting for them anymore
+ */
+uint64 AIDialogueQueue::get_total_requests_expired() const {
+    return total_requests_expired.load();
+}
+
+/**
+ * Set configuration
+ * Already queued requests are kept even if they exceed the new limits.
+ */
+void AIDialogueQueue::set_config(const AIDialogueQueueConfig& cfg) {
+    std::lock_guard<std::mutex> lock(request_mutex);
+    config = cfg;
+}
+
+/**
+ * Clear all queues (map thread only)
  */
 void AIDialogueQueue::clear_all() {
     {
         std::lock_guard<std::mutex> lock(request_mutex);
-        while (!request_queue.empty()) {
-            request_queue.pop();
+        for (AIDialogueRequestClass& rclass : request_classes) {
+            rclass.npc_flows.clear();
+            rclass.active_npcs.clear();
         }
+        account_pending.clear();
+        request_count = 0;
     }
     
     {
-        std::lock_guard<std::mutex> lock(response_mutex);
-        while (!response_queue.empty()) {
-            response_queue.pop();
-        }
+        std::vector<AIDialogueResponse> discarded;
+        response_queue.drain(discarded);
     }
     
     ShowStatus("AI Dialogue Queue: All queues cleared\n");
@@ -187,13 +405,13 @@ void AIDialogueQueue::clear_all() {
  * Check if request queue is full
  */
 bool AIDialogueQueue::is_request_queue_full() const {
-    return request_queue.size() >= MAX_REQUEST_QUEUE_SIZE;
+    return request_count >= (size_t)config.max_requests;
 }
 
 /**
  * Check if response queue is full
  */
 bool AIDialogueQueue::is_response_queue_full() const {
-    return response_queue.size() >= MAX_RESPONSE_QUEUE_SIZE;
+    return response_queue.size_approx() >= response_queue.capacity();
 }
 
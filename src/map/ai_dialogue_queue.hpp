@@ -4,15 +4,21 @@
 #ifndef AI_DIALOGUE_QUEUE_HPP
 #define AI_DIALOGUE_QUEUE_HPP
 
-#include <queue>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <vector>
 #include <mutex>
 #include <condition_variable>
 #include <string>
 #include <atomic>
 
 #include <common/cbasetypes.hpp>
+#include <common/mpsc_queue.hpp>
 #include <common/timer.hpp>
 
+#include "script.hpp" // e_ai_dialogue_priority
+
 /**
  * AI Dialogue Request Structure
  * Represents a player's text input to an AI-enabled NPC
@@ -25,6 +31,9 @@ struct AIDialogueRequest {
     std::string player_message; // Player's text input
     t_tick request_time;        // When request was created
     int32 retry_count;          // Number of retry attempts
+    uint8 priority;             // e_ai_dialogue_priority
+    int32 cache_ttl_ms;         // Answer may be cached for this long (0 = not cached)
+    std::string cache_context;  // Player context the cached answer depends on
 };
 
 /**
@@ -41,6 +50,29 @@ struct AIDialogueResponse {
     std::string error_message;  // Error details if failed
     t_tick response_time;       // When response was generated
     t_tick request_time;        // Original request time (for latency tracking)
+    bool partial = false;       // Streamed segment, more of the answer follows
+};
+
+/**
+ * AI Dialogue Queue Configuration
+ */
+struct AIDialogueQueueConfig {
+    int32 max_requests;                                     // Total queued requests
+    int32 max_requests_per_npc;                             // Queued requests per NPC (0 = unlimited)
+    int32 max_requests_per_account;                         // Queued requests per account (0 = unlimited)
+    int32 max_wait_ms;                                      // Requests waiting longer are dropped (0 = never)
+    int32 priority_weights[AI_DIALOGUE_PRIORITY_MAX];       // Share of pops each class gets under contention
+};
+
+/**
+ * Requests of one priority class
+ * Every NPC has its own FIFO and NPCs with pending requests take turns,
+ * so one popular NPC cannot starve the others.
+ */
+struct AIDialogueRequestClass {
+    std::unordered_map<uint32, std::deque<AIDialogueRequest>> npc_flows;    // npc_id -> pending requests
+    std::deque<uint32> active_npcs;                                         // Round-robin order of NPCs with pending requests
+    int32 credits;                                                          // Pops left in the current weighted round
 };
 
 /**
@@ -49,42 +81,64 @@ struct AIDialogueResponse {
  */
 class AIDialogueQueue {
 private:
-    // Request queue (player input waiting to be processed)
-    std::queue<AIDialogueRequest> request_queue;
+    AIDialogueQueueConfig config;
+    
+    // Request scheduler (player input waiting to be processed)
+    AIDialogueRequestClass request_classes[AI_DIALOGUE_PRIORITY_MAX];
+    std::unordered_map<uint32, int32> account_pending;     // account_id -> queued requests
+    size_t request_count;
     std::mutex request_mutex;
     std::condition_variable request_cv;
     
+    // Queue size limits
+    static const size_t MAX_RESPONSE_QUEUE_SIZE = 1024;
+    
     // Response queue (AI responses waiting to be sent to players)
-    std::queue<AIDialogueResponse> response_queue;
-    std::mutex response_mutex;
+    // Lock-free: worker threads produce, only the map thread consumes
+    MPSCQueue<AIDialogueResponse> response_queue;
     
-    // Queue size limits
-    static const size_t MAX_REQUEST_QUEUE_SIZE = 1000;
-    static const size_t MAX_RESPONSE_QUEUE_SIZE = 1000;
+    // Wakes up the map thread's socket loop when responses are pushed
+    std::atomic<int32> response_wakeup_fd;
+    std::atomic<bool> response_wakeup_pending;
     
     // Statistics
     std::atomic<uint64> total_requests_queued;
     std::atomic<uint64> total_responses_queued;
     std::atomic<uint64> total_requests_dropped;
+    std::atomic<uint64> total_responses_dropped;
+    std::atomic<uint64> total_requests_expired;
+    
+    // Scheduler helpers (request_mutex must be held)
+    bool take_request(AIDialogueRequest& req);
+    void unaccount_request(const AIDialogueRequest& req);
     
 public:
-    AIDialogueQueue();
+    AIDialogueQueue(const AIDialogueQueueConfig& cfg);
     ~AIDialogueQueue();
     
     // Request queue operations
     bool push_request(const AIDialogueRequest& req);
     bool pop_request(AIDialogueRequest& req, int timeout_ms = 1000);
+    bool pop_request_batch(std::vector<AIDialogueRequest>& batch, size_t max_count, int timeout_ms, int batch_wait_ms);
     size_t request_queue_size();
+    size_t purge_requests(const std::function<bool(const AIDialogueRequest&)>& is_stale, std::vector<AIDialogueRequest>& dropped);
     
     // Response queue operations
     bool push_response(const AIDialogueResponse& resp);
     bool pop_response(AIDialogueResponse& resp);
+    size_t drain_responses(std::vector<AIDialogueResponse>& out);
     size_t response_queue_size();
+    void set_response_wakeup(int32 fd);
     
     // Statistics
     uint64 get_total_requests_queued() const;
     uint64 get_total_responses_queued() const;
     uint64 get_total_requests_dropped() const;
+    uint64 get_total_responses_dropped() const;
+    uint64 get_total_requests_expired() const;
+    
+    // Configuration
+    void set_config(const AIDialogueQueueConfig& cfg);
     
     // Utility
     void clear_all();
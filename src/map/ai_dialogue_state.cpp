@@ -17,6 +17,7 @@ AIDialogueStateManager::AIDialogueStateManager()
     , max_requests_per_window(10)       // 10 requests per minute default
     , state_cleanup_interval(300000)    // 5 minutes default
     , last_cleanup_time(0)
+    , cleanup_shard(0)
 {
     ShowStatus("AI Dialogue State Manager: Initialized (cooldown=%dms, rate_limit=%d/%dms)\n", 
                cooldown_ms, max_requests_per_window, rate_limit_window_ms);
@@ -49,31 +50,45 @@ void AIDialogueStateManager::set_rate_limit(int32 max_requests, int32 window_ms)
 }
 
 /**
- * Cleanup old request history entries
+ * Get the shard holding a player's state
  */
-void AIDialogueStateManager::cleanup_request_history(PlayerAIState& state, t_tick current_time) {
-    t_tick cutoff_time = current_time - rate_limit_window_ms;
+AIDialogueStateShard& AIDialogueStateManager::shard_for(uint32 char_id) {
+    return shards[char_id % STATE_SHARDS];
+}
+
+/**
+ * Roll the rate limit window forward to current_time
+ * Windows are aligned to multiples of rate_limit_window_ms, the previous window's
+ * count is kept so the limit slides instead of resetting at the window boundary.
+ */
+void AIDialogueStateManager::advance_rate_window(PlayerAIState& state, t_tick current_time) {
+    t_tick elapsed = current_time - state.rate_window_start;
     
-    while (!state.request_history.empty() && state.request_history.front() < cutoff_time) {
-        state.request_history.pop_front();
+    if (elapsed < rate_limit_window_ms) {
+        return;
     }
+    
+    state.rate_prev_count = (elapsed < 2 * rate_limit_window_ms) ? state.rate_window_count : 0;
+    state.rate_window_count = 0;
+    state.rate_window_start = current_time - (current_time % rate_limit_window_ms);
 }
 
 /**
  * Check if player is rate limited
+ * Sliding window counter: the previous window's requests are weighted by how
+ * much of it still overlaps the last rate_limit_window_ms. O(1), no history kept.
  */
 bool AIDialogueStateManager::is_rate_limited(const PlayerAIState& state, t_tick current_time) {
-    // Count requests within the rate limit window
-    t_tick cutoff_time = current_time - rate_limit_window_ms;
-    int32 recent_requests = 0;
+    t_tick elapsed = current_time - state.rate_window_start;
+    int64 overlap = 0;
     
-    for (t_tick request_time : state.request_history) {
-        if (request_time >= cutoff_time) {
-            recent_requests++;
-        }
+    if (elapsed < rate_limit_window_ms) {
+        overlap = rate_limit_window_ms - elapsed;
     }
     
-    return recent_requests >= max_requests_per_window;
+    int64 estimated = state.rate_window_count + (int64)state.rate_prev_count * overlap / rate_limit_window_ms;
+    
+    return estimated >= max_requests_per_window;
 }
 
 /**
@@ -82,12 +97,18 @@ bool AIDialogueStateManager::is_rate_limited(const PlayerAIState& state, t_tick
  * @return true if player can make request, false if blocked by cooldown/rate limit
  */
 bool AIDialogueStateManager::can_make_request(uint32 char_id) {
-    std::lock_guard<std::mutex> lock(state_mutex);
+    AIDialogueStateShard& shard = shard_for(char_id);
+    std::lock_guard<std::mutex> lock(shard.state_mutex);
     
-    t_tick current_time = gettick();
+    auto it = shard.player_states.find(char_id);
     
-    // Get or create player state
-    PlayerAIState& state = player_states[char_id];
+    // No state yet, nothing can block the player
+    if (it == shard.player_states.end()) {
+        return true;
+    }
+    
+    PlayerAIState& state = it->second;
+    t_tick current_time = gettick();
     
     // Check if player has pending request
     if (state.has_pending_request) {
@@ -103,8 +124,7 @@ bool AIDialogueStateManager::can_make_request(uint32 char_id) {
         return false;
     }
     
-    // Cleanup old request history
-    cleanup_request_history(state, current_time);
+    advance_rate_window(state, current_time);
     
     // Check rate limit
     if (is_rate_limited(state, current_time)) {
@@ -120,15 +140,18 @@ bool AIDialogueStateManager::can_make_request(uint32 char_id) {
  * Mark that a request has been sent for this player
  */
 void AIDialogueStateManager::mark_request_sent(uint32 char_id, uint32 npc_id) {
-    std::lock_guard<std::mutex> lock(state_mutex);
+    AIDialogueStateShard& shard = shard_for(char_id);
+    std::lock_guard<std::mutex> lock(shard.state_mutex);
     
     t_tick current_time = gettick();
-    PlayerAIState& state = player_states[char_id];
+    PlayerAIState& state = shard.player_states[char_id];
+    
+    advance_rate_window(state, current_time);
     
     state.has_pending_request = true;
     state.last_request_time = current_time;
     state.current_npc_id = npc_id;
-    state.request_history.push_back(current_time);
+    state.rate_window_count++;
     state.total_requests++;
     
     ShowDebug("AI Dialogue State: char_id=%u request sent (total: %d)\n", 
@@ -139,10 +162,11 @@ void AIDialogueStateManager::mark_request_sent(uint32 char_id, uint32 npc_id) {
  * Mark that a request has been completed (response received)
  */
 void AIDialogueStateManager::mark_request_completed(uint32 char_id) {
-    std::lock_guard<std::mutex> lock(state_mutex);
+    AIDialogueStateShard& shard = shard_for(char_id);
+    std::lock_guard<std::mutex> lock(shard.state_mutex);
     
-    auto it = player_states.find(char_id);
-    if (it == player_states.end()) {
+    auto it = shard.player_states.find(char_id);
+    if (it == shard.player_states.end()) {
         return;
     }
     
@@ -159,10 +183,11 @@ void AIDialogueStateManager::mark_request_completed(uint32 char_id) {
  * Mark that a request has failed
  */
 void AIDialogueStateManager::mark_request_failed(uint32 char_id) {
-    std::lock_guard<std::mutex> lock(state_mutex);
+    AIDialogueStateShard& shard = shard_for(char_id);
+    std::lock_guard<std::mutex> lock(shard.state_mutex);
     
-    auto it = player_states.find(char_id);
-    if (it == player_states.end()) {
+    auto it = shard.player_states.find(char_id);
+    if (it == shard.player_states.end()) {
         return;
     }
     
@@ -180,9 +205,10 @@ void AIDialogueStateManager::mark_request_failed(uint32 char_id) {
  * Apply custom cooldown to a player
  */
 void AIDialogueStateManager::apply_cooldown(uint32 char_id, int32 custom_cooldown_ms) {
-    std::lock_guard<std::mutex> lock(state_mutex);
+    AIDialogueStateShard& shard = shard_for(char_id);
+    std::lock_guard<std::mutex> lock(shard.state_mutex);
 
-    PlayerAIState& state = player_states[char_id];
+    PlayerAIState& state = shard.player_states[char_id];
     state.cooldown_until = gettick() + custom_cooldown_ms;
 
     ShowDebug("AI Dialogue State: char_id=%u custom cooldown applied (%dms)\n",
@@ -191,39 +217,44 @@ void AIDialogueStateManager::apply_cooldown(uint32 char_id, int32 custom_cooldow
 
 /**
  * Cleanup old player states (called periodically)
+ * Incremental: each call sweeps at most one shard, so every shard is swept once
+ * per state_cleanup_interval and only one stripe is locked at a time.
  */
 void AIDialogueStateManager::cleanup_old_states() {
-    std::lock_guard<std::mutex> lock(state_mutex);
-
     t_tick current_time = gettick();
 
     // Only cleanup if enough time has passed
-    if (current_time - last_cleanup_time < state_cleanup_interval) {
+    if (current_time - last_cleanup_time < state_cleanup_interval / (int32)STATE_SHARDS) {
         return;
     }
 
     last_cleanup_time = current_time;
 
+    AIDialogueStateShard& shard = shards[cleanup_shard];
+    cleanup_shard = (cleanup_shard + 1) % STATE_SHARDS;
+
     // Remove states for players who haven't made requests in a long time
     t_tick cutoff_time = current_time - (rate_limit_window_ms * 5); // 5x rate limit window
 
-    auto it = player_states.begin();
+    std::lock_guard<std::mutex> lock(shard.state_mutex);
+
+    auto it = shard.player_states.begin();
     int32 removed_count = 0;
 
-    while (it != player_states.end()) {
+    while (it != shard.player_states.end()) {
         const PlayerAIState& state = it->second;
 
         // Keep state if player has pending request or recent activity
         if (state.has_pending_request || state.last_request_time > cutoff_time) {
             ++it;
         } else {
-            it = player_states.erase(it);
+            it = shard.player_states.erase(it);
             removed_count++;
         }
     }
 
     if (removed_count > 0) {
-        ShowInfo("AI Dialogue State: Cleaned up %d old player states\n", removed_count);
+        ShowDebug("AI Dialogue State: Cleaned up %d old player states\n", removed_count);
     }
 }
 
@@ -231,8 +262,9 @@ void AIDialogueStateManager::cleanup_old_states() {
  * Clear state for a specific player
  */
 void AIDialogueStateManager::clear_player_state(uint32 char_id) {
-    std::lock_guard<std::mutex> lock(state_mutex);
-    player_states.erase(char_id);
+    AIDialogueStateShard& shard = shard_for(char_id);
+    std::lock_guard<std::mutex> lock(shard.state_mutex);
+    shard.player_states.erase(char_id);
     ShowDebug("AI Dialogue State: Cleared state for char_id=%u\n", char_id);
 }
 
@@ -240,9 +272,14 @@ void AIDialogueStateManager::clear_player_state(uint32 char_id) {
  * Clear all player states
  */
 void AIDialogueStateManager::clear_all_states() {
-    std::lock_guard<std::mutex> lock(state_mutex);
-    int32 count = (int32)player_states.size();
-    player_states.clear();
+    int32 count = 0;
+
+    for (AIDialogueStateShard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.state_mutex);
+        count += (int32)shard.player_states.size();
+        shard.player_states.clear();
+    }
+
     ShowStatus("AI Dialogue State: Cleared all states (%d players)\n", count);
 }
 
@@ -250,18 +287,25 @@ void AIDialogueStateManager::clear_all_states() {
  * Get count of active player states
  */
 int32 AIDialogueStateManager::get_active_states_count() {
-    std::lock_guard<std::mutex> lock(state_mutex);
-    return (int32)player_states.size();
+    int32 count = 0;
+
+    for (AIDialogueStateShard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.state_mutex);
+        count += (int32)shard.player_states.size();
+    }
+
+    return count;
 }
 
 /**
  * Get player state (for debugging/monitoring)
  */
 bool AIDialogueStateManager::get_player_state(uint32 char_id, PlayerAIState& out_state) {
-    std::lock_guard<std::mutex> lock(state_mutex);
+    AIDialogueStateShard& shard = shard_for(char_id);
+    std::lock_guard<std::mutex> lock(shard.state_mutex);
 
-    auto it = player_states.find(char_id);
-    if (it == player_states.end()) {
+    auto it = shard.player_states.find(char_id);
+    if (it == shard.player_states.end()) {
         return false;
     }
 
@@ -273,10 +317,11 @@ bool AIDialogueStateManager::get_player_state(uint32 char_id, PlayerAIState& out
  * Check if player is on cooldown
  */
 bool AIDialogueStateManager::is_player_on_cooldown(uint32 char_id) {
-    std::lock_guard<std::mutex> lock(state_mutex);
+    AIDialogueStateShard& shard = shard_for(char_id);
+    std::lock_guard<std::mutex> lock(shard.state_mutex);
 
-    auto it = player_states.find(char_id);
-    if (it == player_states.end()) {
+    auto it = shard.player_states.find(char_id);
+    if (it == shard.player_states.end()) {
         return false;
     }
 
@@ -287,10 +332,11 @@ bool AIDialogueStateManager::is_player_on_cooldown(uint32 char_id) {
  * Check if player has pending request
  */
 bool AIDialogueStateManager::has_pending_request(uint32 char_id) {
-    std::lock_guard<std::mutex> lock(state_mutex);
+    AIDialogueStateShard& shard = shard_for(char_id);
+    std::lock_guard<std::mutex> lock(shard.state_mutex);
 
-    auto it = player_states.find(char_id);
-    if (it == player_states.end()) {
+    auto it = shard.player_states.find(char_id);
+    if (it == shard.player_states.end()) {
         return false;
     }
 
@@ -301,10 +347,11 @@ bool AIDialogueStateManager::has_pending_request(uint32 char_id) {
  * Get remaining cooldown time in milliseconds
  */
 int32 AIDialogueStateManager::get_remaining_cooldown(uint32 char_id) {
-    std::lock_guard<std::mutex> lock(state_mutex);
+    AIDialogueStateShard& shard = shard_for(char_id);
+    std::lock_guard<std::mutex> lock(shard.state_mutex);
 
-    auto it = player_states.find(char_id);
-    if (it == player_states.end()) {
+    auto it = shard.player_states.find(char_id);
+    if (it == shard.player_states.end()) {
         return 0;
     }
 
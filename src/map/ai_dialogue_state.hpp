@@ -6,7 +6,6 @@
 
 #include <unordered_map>
 #include <mutex>
-#include <deque>
 
 #include <common/cbasetypes.hpp>
 #include <common/timer.hpp>
@@ -20,19 +19,30 @@ struct PlayerAIState {
     t_tick last_request_time;           // Last request timestamp
     t_tick cooldown_until;              // Cooldown expiration time
     uint32 current_npc_id;              // NPC ID of pending request
-    std::deque<t_tick> request_history; // Request timestamps for rate limiting
+    t_tick rate_window_start;           // Start of the current rate limit window
+    int32 rate_window_count;            // Requests made in the current window
+    int32 rate_prev_count;              // Requests made in the previous window
     int32 total_requests;               // Total requests made (lifetime)
     int32 failed_requests;              // Failed request count
 };
 
+/**
+ * One stripe of the player state table
+ * Each stripe has its own lock so players on different stripes never contend.
+ */
+struct alignas(64) AIDialogueStateShard {
+    std::unordered_map<uint32, PlayerAIState> player_states;
+    std::mutex state_mutex;
+};
+
 /**
  * AI Dialogue State Manager
  * Manages per-player state for cooldowns, rate limiting, and spam prevention
  */
 class AIDialogueStateManager {
 private:
-    std::unordered_map<uint32, PlayerAIState> player_states;
-    std::mutex state_mutex;
+    static const size_t STATE_SHARDS = 16;
+    AIDialogueStateShard shards[STATE_SHARDS];
     
     // Configuration (loaded from config file)
     int32 cooldown_ms;              // Cooldown between requests (default: 5000ms)
@@ -40,10 +50,12 @@ private:
     int32 max_requests_per_window;  // Max requests per window (default: 10)
     int32 state_cleanup_interval;   // How often to cleanup old states (default: 300000ms = 5 min)
     
-    t_tick last_cleanup_time;       // Last time cleanup was performed
+    t_tick last_cleanup_time;       // Last time a shard was cleaned up (map thread only)
+    size_t cleanup_shard;           // Next shard to clean up (map thread only)
     
     // Helper methods
-    void cleanup_request_history(PlayerAIState& state, t_tick current_time);
+    AIDialogueStateShard& shard_for(uint32 char_id);
+    void advance_rate_window(PlayerAIState& state, t_tick current_time);
     bool is_rate_limited(const PlayerAIState& state, t_tick current_time);
     
 public:
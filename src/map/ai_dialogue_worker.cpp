@@ -2,8 +2,11 @@
 // For more information, see LICENCE in the main folder
 
 #include "ai_dialogue_worker.hpp"
+#include "ai_dialogue_cache.hpp"
+#include "ai_dialogue_connection_pool.hpp"
 #include "ai_dialogue_queue.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <thread>
 #include <sstream>
@@ -16,23 +19,47 @@
 
 using json = nlohmann::json;
 
+/**
+ * Build the connection pool configuration from the worker configuration
+ */
+static AIDialogueConnectionPoolConfig ai_dialogue_pool_config(const AIDialogueWorkerConfig& cfg) {
+    AIDialogueConnectionPoolConfig pool_config;
+    pool_config.host = cfg.bridge_url;
+    pool_config.port = cfg.bridge_port;
+    pool_config.connect_timeout_ms = cfg.connect_timeout_ms;
+    pool_config.request_timeout_ms = cfg.request_timeout_ms;
+    pool_config.max_idle_connections = cfg.pool_max_idle_connections;
+    pool_config.idle_timeout_ms = cfg.pool_idle_timeout_ms;
+    pool_config.max_requests_per_connection = cfg.pool_max_requests_per_connection;
+    return pool_config;
+}
+
 /**
  * Constructor
  */
 AIDialogueWorker::AIDialogueWorker(AIDialogueQueue* q, const AIDialogueWorkerConfig& cfg)
     : running(false)
     , queue(q)
+    , connection_pool(std::make_unique<AIDialogueConnectionPool>(ai_dialogue_pool_config(cfg)))
+    , last_version_poll(0)
     , config(cfg)
     , total_requests_processed(0)
     , total_requests_succeeded(0)
     , total_requests_failed(0)
     , total_retries(0)
+    , total_batches_sent(0)
+    , total_batched_requests(0)
+    , total_streamed_requests(0)
 {
     if (!queue) {
         ShowError("AI Dialogue Worker: Queue pointer is null!\n");
         return;
     }
     
+    if (config.cache_max_bytes > 0) {
+        response_cache = std::make_unique<AIDialogueCache>(config.cache_max_bytes);
+    }
+    
     ShowStatus("AI Dialogue Worker: Initialized with %d threads (bridge: %s:%d)\n", 
                config.num_threads, config.bridge_url.c_str(), config.bridge_port);
 }
@@ -101,11 +128,63 @@ void AIDialogueWorker::worker_loop(int worker_id) {
     ShowInfo("AI Dialogue Worker: Thread %d started\n", worker_id);
     
     while (running.load()) {
+        refresh_cache_versions();
+        
+        if (config.batch_max_requests > 1 && !config.stream_responses) {
+            std::vector<AIDialogueRequest> batch;
+
+            // Wait for a first request, then linger briefly to fill the batch
+            if (!queue->pop_request_batch(batch, config.batch_max_requests, 1000, config.batch_wait_ms)) {
+                connection_pool->evict_idle();
+                continue;
+            }
+
+            // Cached answers do not need to go to the bridge at all
+            if (response_cache) {
+                std::vector<AIDialogueRequest> misses;
+
+                for (AIDialogueRequest& req : batch) {
+                    AIDialogueResponse resp;
+                    resp.account_id = req.account_id;
+                    resp.char_id = req.char_id;
+                    resp.npc_id = req.npc_id;
+                    resp.request_time = req.request_time;
+                    resp.response_time = gettick();
+
+                    if (answer_from_cache(req, resp)) {
+                        deliver_response(worker_id, resp);
+                    } else {
+                        misses.push_back(std::move(req));
+                    }
+                }
+
+                batch.swap(misses);
+
+                if (batch.empty()) {
+                    continue;
+                }
+            }
+
+            if (config.debug_logging) {
+                ShowDebug("AI Dialogue Worker %d: Processing batch of %zu requests\n",
+                          worker_id, batch.size());
+            }
+
+            std::vector<AIDialogueResponse> responses = process_batch(batch);
+
+            for (const AIDialogueResponse& resp : responses) {
+                deliver_response(worker_id, resp);
+            }
+
+            continue;
+        }
+
         AIDialogueRequest req;
         
         // Try to get a request from queue (with timeout)
         if (!queue->pop_request(req, 1000)) {
-            // Timeout or queue empty, continue loop
+            // Timeout or queue empty, close connections the bridge has likely dropped
+            connection_pool->evict_idle();
             continue;
         }
         
@@ -115,26 +194,34 @@ void AIDialogueWorker::worker_loop(int worker_id) {
         }
         
         // Process the request
-        AIDialogueResponse resp = process_request(req);
-        
-        // Queue the response
-        if (!queue->push_response(resp)) {
-            ShowWarning("AI Dialogue Worker %d: Failed to queue response for char_id=%u\n", 
-                        worker_id, req.char_id);
-        }
-        
-        total_requests_processed++;
-        
-        if (resp.success) {
-            total_requests_succeeded++;
+        if (config.stream_responses) {
+            deliver_response(worker_id, process_request_streaming(worker_id, req));
         } else {
-            total_requests_failed++;
+            deliver_response(worker_id, process_request(req));
         }
     }
     
     ShowInfo("AI Dialogue Worker: Thread %d stopped\n", worker_id);
 }
 
+/**
+ * Queue a finished response for the map thread and update statistics
+ */
+void AIDialogueWorker::deliver_response(int worker_id, const AIDialogueResponse& resp) {
+    if (!queue->push_response(resp)) {
+        ShowWarning("AI Dialogue Worker %d: Failed to queue response for char_id=%u\n", 
+                    worker_id, resp.char_id);
+    }
+    
+    total_requests_processed++;
+    
+    if (resp.success) {
+        total_requests_succeeded++;
+    } else {
+        total_requests_failed++;
+    }
+}
+
 /**
  * Process a single AI dialogue request
  */
@@ -147,6 +234,10 @@ AIDialogueResponse AIDialogueWorker::process_request(const AIDialogueRequest& re
     resp.response_time = gettick();
     resp.success = false;
     
+    if (answer_from_cache(req, resp)) {
+        return resp;
+    }
+    
     int retry_count = 0;
     
     while (retry_count <= config.max_retries) {
@@ -167,6 +258,8 @@ AIDialogueResponse AIDialogueWorker::process_request(const AIDialogueRequest& re
             resp.npc_response = ai_response;
             resp.error_message = "";
             
+            cache_answer(req, ai_response);
+            
             if (config.debug_logging) {
                 t_tick latency = resp.response_time - req.request_time;
                 ShowDebug("AI Dialogue Worker: Request succeeded for char_id=%u (latency: %llums)\n", 
@@ -209,70 +302,232 @@ AIDialogueResponse AIDialogueWorker::process_request(const AIDialogueRequest& re
 }
 
 /**
- * Call AI service via HTTP
+ * Answer a request from the response cache
+ * @param resp Response to fill, account/char/npc fields must already be set
+ * @return true on a cache hit
  */
-std::string AIDialogueWorker::call_ai_service(const std::string& npc_name, uint32 char_id,
-                                               const std::string& message, bool& success,
-                                               std::string& error_msg) {
-    success = false;
-    error_msg = "";
+bool AIDialogueWorker::answer_from_cache(const AIDialogueRequest& req, AIDialogueResponse& resp) {
+    if (!response_cache || req.cache_ttl_ms <= 0) {
+        return false;
+    }
 
-    try {
-        // Create HTTP client
-        httplib::Client client(config.bridge_url.c_str(), config.bridge_port);
-        client.set_connection_timeout(0, config.request_timeout_ms * 1000); // seconds, microseconds
-        client.set_read_timeout(config.request_timeout_ms / 1000, 0);
-        client.set_write_timeout(config.request_timeout_ms / 1000, 0);
+    if (!response_cache->lookup(AIDialogueCache::make_key(req.npc_name, req.player_message, req.cache_context), resp.npc_response)) {
+        return false;
+    }
 
-        // Build JSON request
-        json request_json;
-        request_json["npc_id"] = npc_name;
-        request_json["char_id"] = char_id;
-        request_json["message"] = message;
-        request_json["source"] = "npc_dialogue";
+    resp.success = true;
+    resp.error_message = "";
+
+    if (config.debug_logging) {
+        ShowDebug("AI Dialogue Worker: Cache hit for char_id=%u (npc=%s)\n", req.char_id, req.npc_name.c_str());
+    }
 
-        std::string request_body = request_json.dump();
+    return true;
+}
 
+/**
+ * Remember a successful answer if the NPC opted in to caching
+ */
+void AIDialogueWorker::cache_answer(const AIDialogueRequest& req, const std::string& npc_response) {
+    if (!response_cache || req.cache_ttl_ms <= 0) {
+        return;
+    }
+
+    response_cache->store(AIDialogueCache::make_key(req.npc_name, req.player_message, req.cache_context),
+                          req.npc_name, npc_response, req.cache_ttl_ms);
+}
+
+/**
+ * Fetch NPC persona versions from the bridge and invalidate changed NPCs
+ * The bridge bumps an NPC's version whenever its state is updated through
+ * PUT /ai/npc/{id}/state. Only one worker polls per interval.
+ */
+void AIDialogueWorker::refresh_cache_versions() {
+    if (!response_cache || config.cache_version_poll_ms <= 0) {
+        return;
+    }
+
+    t_tick current_time = gettick();
+    t_tick last_poll = last_version_poll.load();
+
+    if (DIFF_TICK(current_time, last_poll) < config.cache_version_poll_ms ||
+        !last_version_poll.compare_exchange_strong(last_poll, current_time)) {
+        return;
+    }
+
+    bool reused = false;
+    std::unique_ptr<AIDialogueConnection> conn = connection_pool->acquire(reused);
+    httplib::Result res = conn->client->Get("/ai/npc/versions");
+
+    conn->requests_served++;
+    connection_pool->release(std::move(conn), static_cast<bool>(res));
+
+    if (!res || res->status != 200) {
         if (config.debug_logging) {
-            ShowDebug("AI Dialogue Worker: Sending request to %s:%d/ai/chat/command\n",
-                      config.bridge_url.c_str(), config.bridge_port);
-            ShowDebug("AI Dialogue Worker: Request body: %s\n", request_body.c_str());
+            ShowDebug("AI Dialogue Worker: Could not fetch NPC persona versions\n");
+        }
+        return;
+    }
+
+    try {
+        json response_json = json::parse(res->body);
+        std::unordered_map<std::string, uint64> versions;
+
+        for (const auto& version : response_json.at("versions").items()) {
+            versions[version.key()] = version.value().get<uint64>();
+        }
+
+        response_cache->apply_versions(response_json.at("epoch").get<uint64>(), versions);
+    } catch (const std::exception& e) {
+        ShowWarning("AI Dialogue Worker: Invalid NPC persona versions: %s\n", e.what());
+    }
+}
+
+/**
+ * Extract the dialogue text from an answer of the AI service
+ * The service answers with {"success": ..., "npc_response": ..., "error": ...}, older
+ * bridges used "response" for the text.
+ * @param error Set to the reason if the answer holds no dialogue
+ * @return true if the answer succeeded and holds dialogue text
+ */
+static bool ai_dialogue_extract_text(const json& response_json, std::string& text, std::string& error) {
+    if (!response_json.contains("success") || !response_json["success"].is_boolean() || !response_json["success"].get<bool>()) {
+        if (response_json.contains("error") && response_json["error"].is_string()) {
+            error = response_json["error"].get<std::string>();
+        } else {
+            error = "AI service did not report success";
+        }
+        return false;
+    }
+
+    for (const char* key : { "npc_response", "response" }) {
+        if (response_json.contains(key) && response_json[key].is_string()) {
+            text = response_json[key].get<std::string>();
+            return true;
+        }
+    }
+
+    error = "Invalid response format: missing dialogue text";
+    return false;
+}
+
+/**
+ * Build the JSON payload for a single dialogue request
+ */
+static json ai_dialogue_request_json(const std::string& npc_name, uint32 char_id, const std::string& message) {
+    json request_json;
+    request_json["npc_id"] = npc_name;
+    request_json["char_id"] = char_id;
+    request_json["message"] = message;
+    request_json["source"] = "npc_dialogue";
+    return request_json;
+}
+
+/**
+ * POST a JSON body to the bridge
+ * Uses a pooled keep-alive connection. If a reused connection turns out to be
+ * stale (the bridge closed it while idle) the call is repeated once on a fresh
+ * connection without consuming a retry.
+ * @param timeout_ms: Read timeout of this call, 0 for request_timeout_ms
+ * @return true if the bridge answered with HTTP 200, error_msg is set otherwise
+ */
+bool AIDialogueWorker::send_to_bridge(const char* path, const std::string& request_body,
+                                      std::string& response_body, std::string& error_msg, int32 timeout_ms) {
+    if (timeout_ms <= 0) {
+        timeout_ms = config.request_timeout_ms;
+    }
+
+    if (config.debug_logging) {
+        ShowDebug("AI Dialogue Worker: Sending request to %s:%d%s\n",
+                  config.bridge_url.c_str(), config.bridge_port, path);
+        ShowDebug("AI Dialogue Worker: Request body: %s\n", request_body.c_str());
+    }
+
+    httplib::Result res(nullptr, httplib::Error::Unknown);
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        bool reused = false;
+        std::unique_ptr<AIDialogueConnection> conn = connection_pool->acquire(reused);
+        t_tick send_time = gettick();
+
+        if (timeout_ms != config.request_timeout_ms) {
+            conn->client->set_read_timeout(timeout_ms / 1000, (timeout_ms % 1000) * 1000);
         }
 
         // Make HTTP POST request
-        auto res = client.Post("/ai/chat/command", request_body, "application/json");
+        res = conn->client->Post(path, request_body, "application/json");
+        conn->requests_served++;
 
-        if (!res) {
-            error_msg = "HTTP request failed: " + httplib::to_string(res.error());
-            return "";
+        if (timeout_ms != config.request_timeout_ms) {
+            conn->client->set_read_timeout(config.request_timeout_ms / 1000, (config.request_timeout_ms % 1000) * 1000);
         }
 
-        if (res->status != 200) {
-            std::ostringstream oss;
-            oss << "HTTP " << res->status << ": " << res->body;
-            error_msg = oss.str();
-            return "";
+        if (res) {
+            connection_pool->release(std::move(conn), true);
+            break;
         }
 
-        // Parse JSON response
-        json response_json = json::parse(res->body);
+        connection_pool->release(std::move(conn), false);
+
+        // Only a reused connection can be stale, and a stale one fails fast;
+        // a fresh connection failing or a real timeout is reported as is
+        if (!reused || res.error() == httplib::Error::ConnectionTimeout ||
+            DIFF_TICK(gettick(), send_time) >= timeout_ms) {
+            break;
+        }
 
         if (config.debug_logging) {
-            ShowDebug("AI Dialogue Worker: Response: %s\n", res->body.c_str());
+            ShowDebug("AI Dialogue Worker: Stale keep-alive connection (%s), reconnecting\n",
+                      httplib::to_string(res.error()).c_str());
         }
+    }
+
+    if (!res) {
+        error_msg = "HTTP request failed: " + httplib::to_string(res.error());
+        return false;
+    }
+
+    if (res->status != 200) {
+        std::ostringstream oss;
+        oss << "HTTP " << res->status << ": " << res->body;
+        error_msg = oss.str();
+        return false;
+    }
+
+    if (config.debug_logging) {
+        ShowDebug("AI Dialogue Worker: Response: %s\n", res->body.c_str());
+    }
+
+    response_body = std::move(res->body);
+    return true;
+}
+
+/**
+ * Call AI service via HTTP
+ */
+std::string AIDialogueWorker::call_ai_service(const std::string& npc_name, uint32 char_id,
+                                               const std::string& message, bool& success,
+                                               std::string& error_msg) {
+    success = false;
+    error_msg = "";
+
+    try {
+        std::string response_body;
+
+        if (!send_to_bridge("/ai/chat/command", ai_dialogue_request_json(npc_name, char_id, message).dump(),
+                            response_body, error_msg)) {
+            return "";
+        }
+
+        // Parse JSON response
+        json response_json = json::parse(response_body);
+        std::string dialogue;
 
         // Extract dialogue text
-        if (response_json.contains("response") && response_json["response"].is_string()) {
-            success = true;
-            return response_json["response"].get<std::string>();
-        } else if (response_json.contains("dialogue") && response_json["dialogue"].is_string()) {
+        if (ai_dialogue_extract_text(response_json, dialogue, error_msg)) {
             success = true;
-            return response_json["dialogue"].get<std::string>();
-        } else if (response_json.contains("message") && response_json["message"].is_string()) {
-            success = true;
-            return response_json["message"].get<std::string>();
+            return dialogue;
         } else {
-            error_msg = "Invalid response format: missing dialogue text";
             return "";
         }
 
@@ -285,6 +540,319 @@ std::string AIDialogueWorker::call_ai_service(const std::string& npc_name, uint3
     }
 }
 
+/**
+ * Cut the next segment off a streamed answer
+ * A segment ends at the last sentence boundary once it is at least min_chars long,
+ * or at a space once it grew to four times that without one.
+ * @param pending Text received but not delivered yet, the segment is removed from it
+ * @param flush Take whatever is left (end of the stream)
+ * @param segment Output parameter for the trimmed segment
+ * @return true if a non-empty segment was cut
+ */
+static bool ai_dialogue_take_segment(std::string& pending, size_t min_chars, bool flush, std::string& segment) {
+    size_t cut = std::string::npos;
+
+    if (flush) {
+        cut = pending.size();
+    } else if (pending.size() >= min_chars) {
+        size_t pos = pending.find_last_of(".!?\n");
+
+        if (pos != std::string::npos && pos + 1 >= min_chars) {
+            cut = pos + 1;
+        } else if (pending.size() >= min_chars * 4) {
+            pos = pending.find_last_of(' ');
+            cut = (pos != std::string::npos && pos > 0) ? pos : pending.size();
+        }
+    }
+
+    if (cut == std::string::npos) {
+        return false;
+    }
+
+    size_t first = pending.find_first_not_of(" \n");
+    size_t last = pending.find_last_not_of(" \n", cut - 1);
+
+    segment = (first != std::string::npos && last != std::string::npos && first <= last) ? pending.substr(first, last - first + 1) : "";
+    pending.erase(0, cut);
+
+    return !segment.empty();
+}
+
+/**
+ * Value of a server-sent event field line ("data: value")
+ */
+static std::string ai_dialogue_event_field(const std::string& line, size_t prefix_length) {
+    size_t start = line.find_first_not_of(' ', prefix_length);
+
+    return (start == std::string::npos) ? "" : line.substr(start);
+}
+
+/**
+ * Process a single AI dialogue request as a stream
+ * The bridge answers /ai/chat/stream with server-sent events carrying text deltas.
+ * Complete sentences are queued as partial responses right away, the returned
+ * response carries the rest. If the bridge cannot stream, or fails before anything
+ * was shown to the player, the request falls back to process_request().
+ */
+AIDialogueResponse AIDialogueWorker::process_request_streaming(int worker_id, const AIDialogueRequest& req) {
+    AIDialogueResponse resp;
+    resp.account_id = req.account_id;
+    resp.char_id = req.char_id;
+    resp.npc_id = req.npc_id;
+    resp.request_time = req.request_time;
+    resp.response_time = gettick();
+    resp.success = false;
+
+    if (answer_from_cache(req, resp)) {
+        return resp;
+    }
+
+    size_t min_chars = std::max(config.stream_segment_chars, 1);
+    std::string event_buffer;
+    std::string pending;
+    std::string full_text;
+    std::string segment;
+    std::string error_msg;
+    bool streaming = false;
+    bool done = false;
+    bool delivered = false;
+
+    // One server-sent event, returns false to abort the stream
+    auto handle_event = [&](const std::string& event_name, const std::string& data) -> bool {
+        if (event_name == "error") {
+            error_msg = "Stream error: " + data;
+            return true;
+        }
+
+        if (data == "[DONE]") {
+            done = true;
+            return true;
+        }
+
+        try {
+            json chunk = json::parse(data);
+            std::string text;
+            std::string ignored;
+
+            if (chunk.contains("delta") && chunk["delta"].is_string()) {
+                text = chunk["delta"].get<std::string>();
+            } else if (!ai_dialogue_extract_text(chunk, text, ignored)) {
+                return true; // Keep-alive or metadata event
+            }
+
+            pending += text;
+            full_text += text;
+        } catch (const json::exception& e) {
+            error_msg = std::string("JSON error: ") + e.what();
+            return false;
+        }
+
+        while (ai_dialogue_take_segment(pending, min_chars, false, segment)) {
+            AIDialogueResponse part = resp;
+            part.success = true;
+            part.partial = true;
+            part.npc_response = segment;
+            part.response_time = gettick();
+
+            if (!queue->push_response(part)) {
+                ShowWarning("AI Dialogue Worker %d: Failed to queue streamed segment for char_id=%u\n",
+                            worker_id, req.char_id);
+            }
+
+            delivered = true;
+        }
+
+        return true;
+    };
+
+    httplib::Request request;
+    request.method = "POST";
+    request.path = "/ai/chat/stream";
+    request.body = ai_dialogue_request_json(req.npc_name, req.char_id, req.player_message).dump();
+    request.set_header("Content-Type", "application/json");
+    request.set_header("Accept", "text/event-stream");
+
+    request.response_handler = [&streaming](const httplib::Response& response) {
+        streaming = response.status == 200 && response.get_header_value("Content-Type").rfind("text/event-stream", 0) == 0;
+        return streaming;
+    };
+
+    request.content_receiver = [&](const char* data, size_t data_length, uint64_t, uint64_t) {
+        for (size_t i = 0; i < data_length; i++) {
+            if (data[i] != '\r') {
+                event_buffer += data[i];
+            }
+        }
+
+        size_t end;
+
+        // Events are separated by an empty line
+        while ((end = event_buffer.find("\n\n")) != std::string::npos) {
+            std::istringstream lines(event_buffer.substr(0, end));
+            std::string line, event_name, event_data;
+
+            event_buffer.erase(0, end + 2);
+
+            while (std::getline(lines, line)) {
+                if (line.rfind("event:", 0) == 0) {
+                    event_name = ai_dialogue_event_field(line, 6);
+                } else if (line.rfind("data:", 0) == 0) {
+                    if (!event_data.empty()) {
+                        event_data += '\n';
+                    }
+                    event_data += ai_dialogue_event_field(line, 5);
+                }
+            }
+
+            if ((!event_data.empty() || !event_name.empty()) && !handle_event(event_name, event_data)) {
+                return false;
+            }
+        }
+
+        return true;
+    };
+
+    bool reused = false;
+    std::unique_ptr<AIDialogueConnection> conn = connection_pool->acquire(reused);
+    httplib::Result res = conn->client->send(request);
+
+    conn->requests_served++;
+    connection_pool->release(std::move(conn), static_cast<bool>(res));
+
+    if (!streaming) {
+        if (config.debug_logging) {
+            ShowDebug("AI Dialogue Worker %d: Bridge did not stream (%s), sending regular request\n",
+                      worker_id, res ? "no event stream" : httplib::to_string(res.error()).c_str());
+        }
+        return process_request(req);
+    }
+
+    if (error_msg.empty() && !res && !done) {
+        error_msg = "Stream interrupted: " + httplib::to_string(res.error());
+    }
+
+    if (error_msg.empty() && full_text.empty()) {
+        error_msg = "Invalid response format: missing dialogue text";
+    }
+
+    if (!error_msg.empty()) {
+        // Nothing was shown yet, the regular path can still retry
+        if (!delivered) {
+            ShowWarning("AI Dialogue Worker %d: Streaming failed for char_id=%u (%s), sending regular request\n",
+                        worker_id, req.char_id, error_msg.c_str());
+            return process_request(req);
+        }
+
+        resp.success = false;
+        resp.error_message = error_msg;
+        resp.response_time = gettick();
+
+        ShowWarning("AI Dialogue Worker: Stream failed for char_id=%u after partial delivery: %s\n",
+                    req.char_id, error_msg.c_str());
+
+        return resp;
+    }
+
+    ai_dialogue_take_segment(pending, min_chars, true, segment);
+
+    resp.success = true;
+    resp.npc_response = segment;
+    resp.error_message = "";
+    resp.response_time = gettick();
+
+    cache_answer(req, full_text);
+    total_streamed_requests++;
+
+    return resp;
+}
+
+/**
+ * Process a batch of AI dialogue requests with a single bridge call
+ * The bridge answers /api/batch/players/interact with one result per interaction,
+ * in order, each shaped like an answer of /ai/chat/command. Only the entries that
+ * failed, or the whole batch if the call itself fails, fall back to process_request()
+ * so they still get the normal retry logic.
+ * The bridge answers the interactions concurrently, so the batch gets the timeout
+ * of a single request plus a tenth of it for every further request, at most twice
+ * the timeout of a single request.
+ */
+std::vector<AIDialogueResponse> AIDialogueWorker::process_batch(const std::vector<AIDialogueRequest>& batch) {
+    std::vector<AIDialogueResponse> responses;
+    responses.reserve(batch.size());
+
+    if (batch.size() == 1) {
+        responses.push_back(process_request(batch.front()));
+        return responses;
+    }
+
+    json results;
+
+    try {
+        json request_json;
+        json& interactions = request_json["interactions"];
+
+        interactions = json::array();
+        for (const AIDialogueRequest& req : batch) {
+            interactions.push_back(ai_dialogue_request_json(req.npc_name, req.char_id, req.player_message));
+        }
+
+        std::string response_body;
+        std::string error_msg;
+
+        int32 timeout_ms = config.request_timeout_ms + config.request_timeout_ms / 10 * static_cast<int32>(batch.size() - 1);
+
+        timeout_ms = std::min(timeout_ms, config.request_timeout_ms * 2);
+
+        if (send_to_bridge("/api/batch/players/interact", request_json.dump(), response_body, error_msg, timeout_ms)) {
+            json response_json = json::parse(response_body);
+
+            if (response_json.contains("results") && response_json["results"].is_array() &&
+                response_json["results"].size() == batch.size()) {
+                results = std::move(response_json["results"]);
+            } else {
+                ShowWarning("AI Dialogue Worker: Batch response does not match %zu requests, sending individually\n", batch.size());
+            }
+        } else {
+            ShowWarning("AI Dialogue Worker: Batch of %zu requests failed (%s), sending individually\n",
+                        batch.size(), error_msg.c_str());
+        }
+    } catch (const std::exception& e) {
+        ShowWarning("AI Dialogue Worker: Batch of %zu requests failed (%s), sending individually\n",
+                    batch.size(), e.what());
+        results = json();
+    }
+
+    total_batches_sent++;
+
+    for (size_t i = 0; i < batch.size(); i++) {
+        const AIDialogueRequest& req = batch[i];
+        std::string dialogue;
+        std::string error_msg;
+
+        if (results.is_array() && results[i].is_object() && ai_dialogue_extract_text(results[i], dialogue, error_msg)) {
+            AIDialogueResponse resp;
+            resp.account_id = req.account_id;
+            resp.char_id = req.char_id;
+            resp.npc_id = req.npc_id;
+            resp.request_time = req.request_time;
+            resp.response_time = gettick();
+            resp.success = true;
+            resp.npc_response = dialogue;
+            responses.push_back(resp);
+            cache_answer(req, dialogue);
+            total_batched_requests++;
+        } else {
+            if (results.is_array() && config.debug_logging) {
+                ShowDebug("AI Dialogue Worker: Batched request for char_id=%u failed (%s), sending individually\n",
+                          req.char_id, error_msg.c_str());
+            }
+            responses.push_back(process_request(req));
+        }
+    }
+
+    return responses;
+}
+
 /**
  * Check if request should be retried
  */
@@ -329,6 +897,7 @@ void AIDialogueWorker::apply_retry_delay(int retry_count) {
  */
 void AIDialogueWorker::set_config(const AIDialogueWorkerConfig& cfg) {
     config = cfg;
+    connection_pool->set_config(ai_dialogue_pool_config(cfg));
     ShowInfo("AI Dialogue Worker: Configuration updated\n");
 }
 
@@ -380,3 +949,72 @@ double AIDialogueWorker::get_success_rate() const {
     return (double)succeeded / (double)total;
 }
 
+/**
+ * Get total keep-alive connections opened to the bridge
+ */
+uint64 AIDialogueWorker::get_total_connections_opened() const {
+    return connection_pool->get_total_connections_opened();
+}
+
+/**
+ * Get total requests served over a reused keep-alive connection
+ */
+uint64 AIDialogueWorker::get_total_connections_reused() const {
+    return connection_pool->get_total_connections_reused();
+}
+
+/**
+ * Get total idle connections closed by the pool health check
+ */
+uint64 AIDialogueWorker::get_total_connections_evicted() const {
+    return connection_pool->get_total_connections_evicted();
+}
+
+/**
+ * Get total connections discarded after a transport failure
+ */
+uint64 AIDialogueWorker::get_total_connections_failed() const {
+    return connection_pool->get_total_connections_failed();
+}
+
+/**
+ * Get total batched bridge calls sent
+ */
+uint64 AIDialogueWorker::get_total_batches_sent() const {
+    return total_batches_sent.load();
+}
+
+/**
+ * Get total requests answered through a batched bridge call
+ */
+uint64 AIDialogueWorker::get_total_batched_requests() const {
+    return total_batched_requests.load();
+}
+
+/**
+ * Get total requests answered from the response cache
+ */
+uint64 AIDialogueWorker::get_total_cache_hits() const {
+    return response_cache ? response_cache->get_total_hits() : 0;
+}
+
+/**
+ * Get total cache lookups that had to go to the bridge
+ */
+uint64 AIDialogueWorker::get_total_cache_misses() const {
+    return response_cache ? response_cache->get_total_misses() : 0;
+}
+
+/**
+ * Get total cached answers dropped because an NPC persona changed
+ */
+uint64 AIDialogueWorker::get_total_cache_invalidations() const {
+    return response_cache ? response_cache->get_total_invalidations() : 0;
+}
+
+/**
+ * Get total requests answered through a streamed bridge call
+ */
+uint64 AIDialogueWorker::get_total_streamed_requests() const {
+    return total_streamed_requests.load();
+}
@@ -7,12 +7,16 @@
 #include <thread>
 #include <vector>
 #include <atomic>
+#include <memory>
 #include <string>
 
 #include <common/cbasetypes.hpp>
+#include <common/timer.hpp>
 
 // Forward declarations
 class AIDialogueQueue;
+class AIDialogueCache;
+class AIDialogueConnectionPool;
 struct AIDialogueRequest;
 struct AIDialogueResponse;
 
@@ -27,6 +31,24 @@ struct AIDialogueWorkerConfig {
     int32 max_retries;          // Maximum retry attempts for failed requests
     int32 retry_delay_ms;       // Delay between retries in milliseconds
     bool debug_logging;         // Enable verbose debug logging
+
+    // Keep-alive connection pool
+    int32 connect_timeout_ms;           // TCP connect timeout in milliseconds
+    int32 pool_max_idle_connections;    // Idle keep-alive connections kept open (0 disables pooling)
+    int32 pool_idle_timeout_ms;         // Idle connections older than this are closed
+    int32 pool_max_requests_per_connection; // Recycle a connection after this many requests (0 = unlimited)
+
+    // Micro-batching (opt-in)
+    int32 batch_max_requests;   // Requests sent per batched bridge call (0 or 1 disables batching)
+    int32 batch_wait_ms;        // Time to wait for a batch to fill up in milliseconds
+
+    // Response cache (NPCs opt in through ai_chat_start)
+    int32 cache_max_bytes;          // Memory used for cached answers (0 disables the cache)
+    int32 cache_version_poll_ms;    // How often persona versions are fetched from the bridge (0 = never)
+
+    // Streaming (opt-in, takes precedence over batching)
+    bool stream_responses;          // Deliver answers sentence by sentence while they are generated
+    int32 stream_segment_chars;     // Minimum length of a streamed segment
 };
 
 /**
@@ -42,6 +64,13 @@ private:
     // Queue reference (not owned)
     AIDialogueQueue* queue;
     
+    // Keep-alive connections to the bridge, shared by all worker threads
+    std::unique_ptr<AIDialogueConnectionPool> connection_pool;
+    
+    // Cached answers of opted-in NPCs, shared by all worker threads (null if disabled)
+    std::unique_ptr<AIDialogueCache> response_cache;
+    std::atomic<t_tick> last_version_poll;
+    
     // Configuration
     AIDialogueWorkerConfig config;
     
@@ -50,6 +79,9 @@ private:
     std::atomic<uint64> total_requests_succeeded;
     std::atomic<uint64> total_requests_failed;
     std::atomic<uint64> total_retries;
+    std::atomic<uint64> total_batches_sent;
+    std::atomic<uint64> total_batched_requests;
+    std::atomic<uint64> total_streamed_requests;
     
     // Worker thread main loop
     void worker_loop(int worker_id);
@@ -57,6 +89,24 @@ private:
     // Process a single request
     AIDialogueResponse process_request(const AIDialogueRequest& req);
     
+    // Process a single request, delivering the answer in segments as it is generated
+    AIDialogueResponse process_request_streaming(int worker_id, const AIDialogueRequest& req);
+    
+    // Process several requests with one bridge call
+    std::vector<AIDialogueResponse> process_batch(const std::vector<AIDialogueRequest>& batch);
+    
+    // Response cache
+    bool answer_from_cache(const AIDialogueRequest& req, AIDialogueResponse& resp);
+    void cache_answer(const AIDialogueRequest& req, const std::string& npc_response);
+    void refresh_cache_versions();
+    
+    // Queue a response and update statistics
+    void deliver_response(int worker_id, const AIDialogueResponse& resp);
+    
+    // POST to the bridge over a pooled connection
+    bool send_to_bridge(const char* path, const std::string& request_body,
+                        std::string& response_body, std::string& error_msg, int32 timeout_ms = 0);
+    
     // Call AI service via HTTP
     std::string call_ai_service(const std::string& npc_name, uint32 char_id, 
                                 const std::string& message, bool& success, 
@@ -85,6 +135,16 @@ public:
     uint64 get_total_requests_failed() const;
     uint64 get_total_retries() const;
     double get_success_rate() const;
+    uint64 get_total_connections_opened() const;
+    uint64 get_total_connections_reused() const;
+    uint64 get_total_connections_evicted() const;
+    uint64 get_total_connections_failed() const;
+    uint64 get_total_batches_sent() const;
+    uint64 get_total_batched_requests() const;
+    uint64 get_total_streamed_requests() const;
+    uint64 get_total_cache_hits() const;
+    uint64 get_total_cache_misses() const;
+    uint64 get_total_cache_invalidations() const;
 };
 
 #endif /* AI_DIALOGUE_WORKER_HPP */
@@ -14,6 +14,7 @@
 #include <common/malloc.hpp>
 #include <common/mmo.hpp>
 #include <common/nullpo.hpp>
+#include <common/profiler.hpp>
 #include <common/random.hpp>
 #include <common/showmsg.hpp>
 #include <common/socket.hpp>
@@ -4654,6 +4655,8 @@ ACMD_FUNC(mapinfo) {
 
 	sprintf(atcmd_output, msg_txt(sd,1040), mapname, mapdata->users, mapdata->npc_num, chat_num, vend_num); // Map: %s | Players: %d | NPCs: %d | Chats: %d | Vendings: %d
 	clif_displaymessage(fd, atcmd_output);
+	sprintf(atcmd_output, msg_txt(sd,1546), mapdata->xs, mapdata->ys, mapdata->cell->memory() / 1024); // Size: %d x %d | Cell flags: %zu KB
+	clif_displaymessage(fd, atcmd_output);
 	clif_displaymessage(fd, msg_txt(sd,1041)); // ------ Map Flags ------
 	if (map_getmapflag(m_id, MF_TOWN))
 		clif_displaymessage(fd, msg_txt(sd,1042)); // Town Map
@@ -11400,6 +11403,55 @@ ACMD_FUNC(macrochecker){
 	return 0;
 }
 
+/*==========================================
+ * @profiler {on|off|reset|dump|<count>}
+ * Shows where the timers and packet handlers spend their time
+ *------------------------------------------*/
+ACMD_FUNC(profiler){
+	char action[16] = {};
+
+	sscanf( message, "%15s", action );
+
+	if( strcmpi( action, "on" ) == 0 || strcmpi( action, "off" ) == 0 ){
+		profiler_enable( strcmpi( action, "on" ) == 0 );
+		clif_displaymessage( fd, msg_txt( sd, profiler_enabled ? 1542 : 1543 ) ); // Profiler is enabled. / Profiler is disabled.
+		return 0;
+	}
+
+	if( strcmpi( action, "reset" ) == 0 ){
+		profiler_reset();
+		clif_displaymessage( fd, msg_txt( sd, 1544 ) ); // Profiler statistics have been reset.
+		return 0;
+	}
+
+	if( strcmpi( action, "dump" ) == 0 ){
+		if( !profiler_dump( profiler_log_filepath, false ) ){
+			return -1;
+		}
+
+		sprintf( atcmd_output, msg_txt( sd, 1545 ), profiler_log_filepath ); // Profiler statistics have been written to '%s'.
+		clif_displaymessage( fd, atcmd_output );
+		return 0;
+	}
+
+	int32 count = 10;
+
+	if( action[0] != '\0' && ( count = atoi( action ) ) <= 0 ){
+		clif_displaymessage( fd, msg_txt( sd, 1541 ) ); // Usage: @profiler {on|off|reset|dump|<count>}
+		return -1;
+	}
+
+	std::vector<std::string> lines;
+
+	profiler_report( lines, count );
+
+	for( const std::string& line : lines ){
+		clif_displaymessage( fd, line.c_str() );
+	}
+
+	return 0;
+}
+
 #include <custom/atcommand.inc>
 
 /**
@@ -11729,6 +11781,7 @@ void atcommand_basecommands(void) {
 		ACMD_DEFR(roulette, ATCMD_NOCONSOLE|ATCMD_NOAUTOTRADE),
 		ACMD_DEF(setcard),
 		ACMD_DEF(macrochecker),
+		ACMD_DEF(profiler),
 	};
 	AtCommandInfo* atcommand;
 	int32 i;
@@ -7,6 +7,7 @@
 #include <cstdlib>
 
 #include <common/cbasetypes.hpp>
+#include <common/db.hpp>
 #include <common/ers.hpp>
 #include <common/malloc.hpp>
 #include <common/nullpo.hpp>
@@ -12378,6 +12379,8 @@ static const struct _battle_data {
 	{ "major_overweight_rate",              &battle_config.major_overweight_rate,           90,     0,      100             },
 	{ "trade_count_stackable",              &battle_config.trade_count_stackable,           1,      0,      1,              },
 	{ "enable_bonus_map_drops",             &battle_config.enable_bonus_map_drops,          1,      0,      1,              },
+	{ "monster_ai_threads",                 &battle_config.mob_ai_threads,                  0,      0,      64,             },
+	{ "path_cache_size",                    &battle_config.path_cache_size,                 256,    0,      65535,          },
 
 #include <custom/battle_config_init.inc>
 };
@@ -12617,6 +12620,12 @@ void battle_adjust_conf()
 		ShowWarning("Battle setting 'custom_cell_stack_limit' takes no effect as this server was compiled without Cell Stack Limit support.\n");
 #endif
 
+	// Lookups on the database trees move the lookup cache, the AI workers would race on it
+	if( battle_config.mob_ai_threads > 0 && !db_open_addressing_enabled() ){
+		ShowWarning("conf/battle/monster.conf:monster_ai_threads is enabled but it requires the databases with open addressing, this server was compiled with DB_DISABLE_OPEN_ADDRESSING, disabling...\n");
+		battle_config.mob_ai_threads = 0;
+	}
+
 #ifdef MAP_GENERATOR
 	battle_config.dynamic_mobs = 1;
 #endif
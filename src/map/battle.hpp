@@ -778,6 +778,8 @@ struct Battle_Config
 	int32 major_overweight_rate;
 	int32 trade_count_stackable;
 	int32 enable_bonus_map_drops;
+	int32 mob_ai_threads;
+	int32 path_cache_size;
 
 #include <custom/battle_config_struct.inc>
 };
@@ -0,0 +1,56 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "cell_grid.hpp"
+
+static uint64 cellgrid_versions = 0; // Last version handed out to a grid
+
+/**
+ * Grid of a map without any flagged cell
+ * @param xs: Width of the map in cells
+ * @param ys: Height of the map in cells
+ */
+CellGrid::CellGrid( int16 xs, int16 ys ) : xs( xs ), ys( ys ){
+	this->stride = ( xs + 63 ) / 64;
+	this->changes = ++cellgrid_versions;
+#ifdef CELL_NOSTACK
+	this->stacked.assign( (size_t)xs * ys, 0 );
+#endif
+}
+
+void CellGrid::set( cell_t flag, int16 x, int16 y, bool value ){
+	std::vector<uint64>& plane = this->planes[flag];
+
+	if( plane.empty() ){
+		if( !value ){
+			return;
+		}
+
+		plane.assign( this->stride * this->ys, 0 );
+	}
+
+	uint64& word = plane[y * this->stride + ( x >> 6 )];
+	uint64 bit = UINT64_C( 1 ) << ( x & 63 );
+
+	if( ( ( word & bit ) != 0 ) == value ){
+		return;
+	}
+
+	word ^= bit;
+	this->changes = ++cellgrid_versions;
+}
+
+/// Bytes used by the grid
+size_t CellGrid::memory() const {
+	size_t bytes = sizeof( *this );
+
+	for( const std::vector<uint64>& plane : this->planes ){
+		bytes += plane.capacity() * sizeof( uint64 );
+	}
+
+#ifdef CELL_NOSTACK
+	bytes += this->stacked.capacity();
+#endif
+
+	return bytes;
+}
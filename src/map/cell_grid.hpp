@@ -0,0 +1,78 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef CELL_GRID_HPP
+#define CELL_GRID_HPP
+
+#include <vector>
+
+#include <common/cbasetypes.hpp>
+#include <config/core.hpp>
+
+// used by map_setcell()
+enum cell_t{
+	CELL_WALKABLE,
+	CELL_SHOOTABLE,
+	CELL_WATER,
+
+	CELL_NPC,
+	CELL_BASILICA,
+	CELL_LANDPROTECTOR,
+	CELL_NOVENDING,
+	CELL_NOCHAT,
+	CELL_MAELSTROM,
+	CELL_ICEWALL,
+	CELL_NOBUYINGSTORE,
+
+	CELL_MAX
+};
+
+/**
+ * Flags of the cells of a map
+ * Every flag is kept in a bitplane of its own, so a check only touches the
+ * plane it asks for: a path search reads one bit per cell instead of a whole
+ * cell. Rows are padded to 64 cells, so a row of a plane never shares a 64 bit
+ * word with the next one.
+ * Planes are only allocated once a cell is flagged, most maps never use the
+ * planes of skills and NPCs.
+ * Every change of a flag gives the grid a new version, which is never handed out
+ * twice, so a version stands for one exact state of the cells.
+ */
+class CellGrid {
+private:
+	int16 xs;
+	int16 ys;
+	size_t stride; // Words per row
+	std::vector<uint64> planes[CELL_MAX];
+	uint64 changes; // Version of the cells
+#ifdef CELL_NOSTACK
+	std::vector<uint8> stacked; // Characters per cell
+#endif
+
+public:
+	CellGrid( int16 xs, int16 ys );
+
+	bool get( cell_t flag, int16 x, int16 y ) const {
+		const std::vector<uint64>& plane = this->planes[flag];
+
+		if( plane.empty() ){
+			return false;
+		}
+
+		return ( plane[y * this->stride + ( x >> 6 )] >> ( x & 63 ) ) & 1;
+	}
+
+	void set( cell_t flag, int16 x, int16 y, bool value );
+
+	/// Version of the cells, changes whenever a flag changes. Stacking is not included.
+	uint64 version() const { return this->changes; }
+
+#ifdef CELL_NOSTACK
+	uint8& stack( int16 x, int16 y ){ return this->stacked[x + y * this->xs]; }
+	uint8 stack( int16 x, int16 y ) const { return this->stacked[x + y * this->xs]; }
+#endif
+
+	size_t memory() const;
+};
+
+#endif /* CELL_GRID_HPP */
@@ -16,7 +16,9 @@
 #include <common/ers.hpp>
 #include <common/grfio.hpp>
 #include <common/malloc.hpp>
+#include <common/metrics.hpp>
 #include <common/nullpo.hpp>
+#include <common/profiler.hpp>
 #include <common/random.hpp>
 #include <common/showmsg.hpp>
 #include <common/socket.hpp>
@@ -24,6 +26,7 @@
 #include <common/timer.hpp>
 #include <common/utilities.hpp>
 #include <common/utils.hpp>
+#include <common/watchdog.hpp>
 
 #include "achievement.hpp"
 #include "ai_dialogue_queue.hpp"
@@ -395,6 +398,32 @@ static bool clif_session_isValid(map_session_data *sd) {
 	return ( sd != nullptr && session_isActive(sd->fd) );
 }
 
+/// Queues a packet of clif_send for one recipient.
+/// Large packets are built into a shared buffer on first use and referenced by every
+/// recipient instead of being copied into each WFIFO.
+/// Packets with a coalesce key replace an unsent packet with the same key.
+static void clif_send_packet( int32 fd, const void* buf, int32 len, SharedPacket& shared, uint64 coalesce_key ){
+	if( coalesce_key != 0 ){
+		WFIFOHEAD( fd, len );
+		memcpy( WFIFOP( fd, 0 ), buf, len );
+		WFIFOSET_COALESCE( fd, len, coalesce_key );
+		return;
+	}
+
+	if( len < SHARED_PACKET_MIN_SIZE ){
+		WFIFOHEAD( fd, len );
+		memcpy( WFIFOP( fd, 0 ), buf, len );
+		WFIFOSET( fd, len );
+		return;
+	}
+
+	if( shared == nullptr ){
+		shared = socket_shared_packet( buf, len );
+	}
+
+	WFIFOSHARE( fd, shared );
+}
+
 /*==========================================
  * sub process of clif_send
  * Called from a map_foreachinallarea (grabs all players in specific area and subjects them to this function)
@@ -405,26 +434,20 @@ static bool clif_session_isValid(map_session_data *sd) {
  * - AREA_WOS (AREA WITHOUT SELF) : Not run for self
  * - AREA_CHAT_WOC : Everyone in the area of your chat without a chat
  *------------------------------------------*/
-static int32 clif_send_sub(block_list *bl, va_list ap)
+static int32 clif_send_sub(block_list *bl, const void* buf, int32 len, block_list *src_bl, int32 type, SharedPacket& shared, uint64 coalesce_key)
 {
-	block_list *src_bl;
 	map_session_data *sd;
-	unsigned char *buf;
-	int32 len, type, fd;
+	int32 fd;
 
 	nullpo_ret(bl);
 	nullpo_ret(sd = (map_session_data *)bl);
+	nullpo_ret(src_bl);
 
 	// Don't send to disconnected clients.
 	if( !session_isActive( fd = sd->fd ) ){
 		return 0;
 	}
 
-	buf = va_arg(ap,unsigned char*);
-	len = va_arg(ap,int32);
-	nullpo_ret(src_bl = va_arg(ap,block_list*));
-	type = va_arg(ap,int32);
-
 	switch(type) {
 	case AREA_WOS:
 		if (bl == src_bl)
@@ -460,7 +483,6 @@ static int32 clif_send_sub(block_list *bl, va_list ap)
 		!sd->sc.getSCE(SC_INTRAVISION) && battle_check_target(src_bl,sd,BCT_ENEMY) > 0)
 		return 0;
 
-	WFIFOHEAD(fd, len);
 	if (WFIFOP(fd,0) == buf) {
 		ShowError("WARNING: Invalid use of clif_send function\n");
 		ShowError("         Packet x%4x use a WFIFO of a player instead of to use a buffer.\n", WBUFW(buf,0));
@@ -471,8 +493,7 @@ static int32 clif_send_sub(block_list *bl, va_list ap)
 		return 0;
 	}
 
-	memcpy(WFIFOP(fd,0), buf, len);
-	WFIFOSET(fd,len);
+	clif_send_packet(fd, buf, len, shared, coalesce_key);
 
 	return 0;
 }
@@ -481,7 +502,7 @@ static int32 clif_send_sub(block_list *bl, va_list ap)
  * Packet Delegation (called on all packets that require data to be sent to more than one client)
  * functions that are sent solely to one use whose ID it posses use WFIFOSET
  *------------------------------------------*/
-int32 clif_send(const void* buf, int32 len, block_list* bl, enum send_target type)
+int32 clif_send(const void* buf, int32 len, block_list* bl, enum send_target type, uint64 coalesce_key)
 {
 	int32 i;
 	map_session_data *sd, *tsd;
@@ -489,6 +510,7 @@ int32 clif_send(const void* buf, int32 len, block_list* bl, enum send_target typ
 	std::shared_ptr<s_battleground_data> bg;
 	int32 x0 = 0, x1 = 0, y0 = 0, y1 = 0, fd;
 	struct s_mapiterator* iter;
+	SharedPacket shared; // built once the first recipient needs it
 
 	if( type != ALL_CLIENT )
 		nullpo_ret(bl);
@@ -501,9 +523,7 @@ int32 clif_send(const void* buf, int32 len, block_list* bl, enum send_target typ
 		iter = mapit_getallusers();
 		while( ( tsd = (map_session_data*)mapit_next( iter ) ) != nullptr ){
 			if( session_isActive( fd = tsd->fd ) ){
-				WFIFOHEAD( fd, len );
-				memcpy( WFIFOP( fd, 0 ), buf, len );
-				WFIFOSET( fd, len );
+				clif_send_packet( fd, buf, len, shared, coalesce_key );
 			}
 		}
 		mapit_free(iter);
@@ -513,9 +533,7 @@ int32 clif_send(const void* buf, int32 len, block_list* bl, enum send_target typ
 		iter = mapit_getallusers();
 		while( ( tsd = (map_session_data*)mapit_next( iter ) ) != nullptr ){
 			if( bl->m == tsd->m && session_isActive( fd = tsd->fd ) ){
-				WFIFOHEAD( fd, len );
-				memcpy( WFIFOP( fd, 0 ), buf, len );
-				WFIFOSET( fd, len );
+				clif_send_packet( fd, buf, len, shared, coalesce_key );
 			}
 		}
 		mapit_free(iter);
@@ -528,12 +546,14 @@ int32 clif_send(const void* buf, int32 len, block_list* bl, enum send_target typ
 		[[fallthrough]];
 	case AREA_WOC:
 	case AREA_WOS:
-		map_foreachinallarea(clif_send_sub, bl->m, bl->x-AREA_SIZE, bl->y-AREA_SIZE, bl->x+AREA_SIZE, bl->y+AREA_SIZE,
-			BL_PC, buf, len, bl, type);
+		map_foreachinallarea(bl->m, bl->x-AREA_SIZE, bl->y-AREA_SIZE, bl->x+AREA_SIZE, bl->y+AREA_SIZE, BL_PC, [&](block_list *tbl) {
+			return clif_send_sub(tbl, buf, len, bl, type, shared, coalesce_key);
+		});
 		break;
 	case AREA_CHAT_WOC:
-		map_foreachinallarea(clif_send_sub, bl->m, bl->x-(AREA_SIZE-5), bl->y-(AREA_SIZE-5),
-			bl->x+(AREA_SIZE-5), bl->y+(AREA_SIZE-5), BL_PC, buf, len, bl, AREA_WOC);
+		map_foreachinallarea(bl->m, bl->x-(AREA_SIZE-5), bl->y-(AREA_SIZE-5), bl->x+(AREA_SIZE-5), bl->y+(AREA_SIZE-5), BL_PC, [&](block_list *tbl) {
+			return clif_send_sub(tbl, buf, len, bl, AREA_WOC, shared, coalesce_key);
+		});
 		break;
 
 	case CHAT:
@@ -551,9 +571,7 @@ int32 clif_send(const void* buf, int32 len, block_list* bl, enum send_target typ
 				if (type == CHAT_WOS && cd->usersd[i] == sd)
 					continue;
 				if( session_isActive( fd = cd->usersd[i]->fd ) ){
-					WFIFOHEAD(fd,len);
-					memcpy(WFIFOP(fd,0), buf, len);
-					WFIFOSET(fd,len);
+					clif_send_packet( fd, buf, len, shared, coalesce_key );
 				}
 			}
 		}
@@ -590,9 +608,7 @@ int32 clif_send(const void* buf, int32 len, block_list* bl, enum send_target typ
 				if( (type == PARTY_AREA || type == PARTY_AREA_WOS) && (sd->x < x0 || sd->y < y0 || sd->x > x1 || sd->y > y1) )
 					continue;
 
-				WFIFOHEAD(fd, len);
-				memcpy(WFIFOP(fd, 0), buf, len);
-				WFIFOSET(fd, len);
+				clif_send_packet( fd, buf, len, shared, coalesce_key );
 			}
 			if (!enable_spy) //Skip unnecessary parsing. [Skotlex]
 				break;
@@ -600,9 +616,7 @@ int32 clif_send(const void* buf, int32 len, block_list* bl, enum send_target typ
 			iter = mapit_getallusers();
 			while( ( tsd = (map_session_data*)mapit_next( iter ) ) != nullptr ){
 				if( tsd->partyspy == p->party.party_id && session_isActive( fd = tsd->fd ) ){
-					WFIFOHEAD( fd, len );
-					memcpy( WFIFOP( fd, 0 ), buf, len );
-					WFIFOSET( tsd->fd, len );
+					clif_send_packet( fd, buf, len, shared, coalesce_key );
 				}
 			}
 			mapit_free(iter);
@@ -618,9 +632,7 @@ int32 clif_send(const void* buf, int32 len, block_list* bl, enum send_target typ
 			if( type == DUEL_WOS && bl->id == tsd->id )
 				continue;
 			if( sd->duel_group == tsd->duel_group && session_isActive( fd = tsd->fd ) ){
-				WFIFOHEAD( fd, len );
-				memcpy( WFIFOP( fd, 0 ), buf, len );
-				WFIFOSET( fd, len );
+				clif_send_packet( fd, buf, len, shared, coalesce_key );
 			}
 		}
 		mapit_free(iter);
@@ -631,7 +643,10 @@ int32 clif_send(const void* buf, int32 len, block_list* bl, enum send_target typ
 			fd = sd->fd;
 			WFIFOHEAD(fd,len);
 			memcpy(WFIFOP(fd,0), buf, len);
-			WFIFOSET(fd,len);
+			if( coalesce_key != 0 )
+				WFIFOSET_COALESCE(fd, len, coalesce_key);
+			else
+				WFIFOSET(fd,len);
 		}
 		break;
 
@@ -669,9 +684,7 @@ int32 clif_send(const void* buf, int32 len, block_list* bl, enum send_target typ
 				if( (type == GUILD_AREA || type == GUILD_AREA_WOS) && (sd->x < x0 || sd->y < y0 || sd->x > x1 || sd->y > y1) )
 					continue;
 
-				WFIFOHEAD(fd,len);
-				memcpy(WFIFOP(fd,0), buf, len);
-				WFIFOSET(fd,len);
+				clif_send_packet( fd, buf, len, shared, coalesce_key );
 			}
 		}
 		if (!enable_spy) //Skip unnecessary parsing. [Skotlex]
@@ -680,9 +693,7 @@ int32 clif_send(const void* buf, int32 len, block_list* bl, enum send_target typ
 		iter = mapit_getallusers();
 		while( ( tsd = (map_session_data*)mapit_next( iter ) ) != nullptr ){
 			if( tsd->guildspy == g.guild_id && session_isActive( fd = tsd->fd ) ){
-				WFIFOHEAD( fd, len );
-				memcpy( WFIFOP( fd, 0 ), buf, len );
-				WFIFOSET( fd, len );
+				clif_send_packet( fd, buf, len, shared, coalesce_key );
 			}
 		}
 		mapit_free(iter);
@@ -710,9 +721,7 @@ int32 clif_send(const void* buf, int32 len, block_list* bl, enum send_target typ
 					continue;
 				if( (type == BG_AREA || type == BG_AREA_WOS) && (sd->x < x0 || sd->y < y0 || sd->x > x1 || sd->y > y1) )
 					continue;
-				WFIFOHEAD(fd,len);
-				memcpy(WFIFOP(fd,0), buf, len);
-				WFIFOSET(fd,len);
+				clif_send_packet( fd, buf, len, shared, coalesce_key );
 			}
 		}
 		break;
@@ -725,9 +734,7 @@ int32 clif_send(const void* buf, int32 len, block_list* bl, enum send_target typ
 					continue;
 				}
 
-				WFIFOHEAD(fd,len);
-				memcpy(WFIFOP(fd,0), buf, len);
-				WFIFOSET(fd,len);
+				clif_send_packet( fd, buf, len, shared, coalesce_key );
 			}
 
 			if (!enable_spy) //Skip unnecessary parsing. [Skotlex]
@@ -736,9 +743,7 @@ int32 clif_send(const void* buf, int32 len, block_list* bl, enum send_target typ
 			iter = mapit_getallusers();
 			while( ( tsd = (map_session_data*)mapit_next( iter ) ) != nullptr ){
 				if( tsd->clanspy == clan->id && session_isActive( fd = tsd->fd ) ){
-					WFIFOHEAD(fd, len);
-					memcpy(WFIFOP(fd, 0), buf, len);
-					WFIFOSET(fd, len);
+					clif_send_packet( fd, buf, len, shared, coalesce_key );
 				}
 			}
 			mapit_free(iter);
@@ -3542,7 +3547,7 @@ static void clif_par_change(map_session_data& sd, uint16 varId, int32 count) {
 	packet.varID = varId;
 	packet.count = count;
 
-	clif_send( &packet, sizeof( packet ), &sd, SELF );
+	clif_send( &packet, sizeof( packet ), &sd, SELF, CLIF_COALESCE_KEY( HEADER_ZC_PAR_CHANGE, varId ) );
 }
 
 /// Notifies client of a character parameter change.
@@ -3554,7 +3559,7 @@ static void clif_longpar_change(map_session_data& sd, uint16 varId, int32 amount
 	packet.varID = varId;
 	packet.amount = amount;
 
-	clif_send( &packet, sizeof( packet ), &sd, SELF );
+	clif_send( &packet, sizeof( packet ), &sd, SELF, CLIF_COALESCE_KEY( HEADER_ZC_LONGPAR_CHANGE, varId ) );
 }
 
 /// Notifies client of a character parameter change.
@@ -8093,7 +8098,7 @@ void clif_party_hp( map_session_data& sd ){
 	p.maxhp = sd.battle_status.max_hp;
 #endif
 
-	clif_send( &p, sizeof( p ), &sd, PARTY_AREA_WOS );
+	clif_send( &p, sizeof( p ), &sd, PARTY_AREA_WOS, CLIF_COALESCE_KEY( HEADER_ZC_NOTIFY_HP_TO_GROUPM, sd.status.account_id ) );
 }
 
 /// Notifies the party members of a character's death or revival.
@@ -8147,7 +8152,7 @@ void clif_hpmeter_single( map_session_data& sd, uint32 id, uint32 hp, uint32 max
 	p.maxhp = maxhp;
 #endif
 
-	clif_send( &p, sizeof( p ), &sd, SELF );
+	clif_send( &p, sizeof( p ), &sd, SELF, CLIF_COALESCE_KEY( HEADER_ZC_NOTIFY_HP_TO_GROUPM, id ) );
 }
 
 
@@ -13418,6 +13423,9 @@ void clif_parse_NpcStringInput(int32 fd, map_session_data* sd){
 		req.player_message = sd->npc_str;
 		req.request_time = gettick();
 		req.retry_count = 0;
+		req.priority = sd->ai_npc_priority;
+		req.cache_ttl_ms = sd->ai_npc_cache_ttl;
+		req.cache_context = sd->ai_npc_cache_context;
 
 		// Queue the request
 		if (ai_dialogue_queue->push_request(req)) {
@@ -20006,7 +20014,7 @@ void clif_monster_hp_bar( mob_data* md, int32 fd ) {
 	WFIFOL(fd,6)  = md->status.hp;
 	WFIFOL(fd,10) = md->status.max_hp;
 
-	WFIFOSET(fd,packet_len(0x977));
+	WFIFOSET_COALESCE(fd,packet_len(0x977),CLIF_COALESCE_KEY(0x977, md->id));
 #endif
 }
 
@@ -25692,6 +25700,11 @@ void clif_parse_MoveFromKafraFav( int32 fd, map_session_data* sd ){
 #endif
 }
 
+/// Profiler section of every packet + 1, 0 until the packet was profiled once
+static int32 packet_profiler_section[MAX_PACKET_DB+1];
+/// Number of parsed packets by type
+static uint64 packet_count[MAX_PACKET_DB+1];
+
 /*==========================================
  * Main client packet processing function
  *------------------------------------------*/
@@ -25816,6 +25829,12 @@ static int32 clif_parse(int32 fd)
 		sd->cryptKey = ((sd->cryptKey * clif_cryptKey[1]) + clif_cryptKey[2]) & 0xFFFFFFFF; // Update key for the next packet
 #endif
 
+	bool profile = profiler_enabled;
+	uint64 start = profile ? profiler_clock() : 0;
+
+	watchdog_count_packet(cmd);
+	packet_count[cmd]++;
+
 	if( packet_db[cmd].func == clif_parse_debug )
 		packet_db[cmd].func(fd, sd);
 	else if( packet_db[cmd].func != nullptr ) {
@@ -25830,6 +25849,17 @@ static int32 clif_parse(int32 fd)
 #ifdef DUMP_UNKNOWN_PACKET
 	else DumpUnknown(fd,sd,cmd,packet_len);
 #endif
+
+	if( profile ) {
+		if( packet_profiler_section[cmd] == 0 ) {
+			char name[16];
+
+			snprintf(name, sizeof(name), "packet 0x%04x", cmd);
+			packet_profiler_section[cmd] = profiler_add_section(name) + 1;
+		}
+
+		profiler_record(packet_profiler_section[cmd] - 1, profiler_clock() - start);
+	}
 	RFIFOSKIP(fd, packet_len);
 	}; // main loop end
 
@@ -25883,6 +25913,20 @@ void packetdb_readdb(){
 #endif
 }
 
+/// Writes the parsed client packets by packet type for the metrics endpoint
+static void clif_metrics(MetricsWriter& writer) {
+	writer.family("rathena_packets_received_total", "counter", "Client packets that were parsed, by packet type.");
+
+	for( int32 cmd = MIN_PACKET_DB; cmd <= MAX_PACKET_DB; cmd++ ) {
+		if( packet_count[cmd] > 0 ) {
+			char labels[32];
+
+			snprintf(labels, sizeof(labels), "packet=\"0x%04x\"", cmd);
+			writer.sample("rathena_packets_received_total", labels, packet_count[cmd]);
+		}
+	}
+}
+
 /*==========================================
  *
  *------------------------------------------*/
@@ -25907,13 +25951,14 @@ void do_init_clif(void) {
 	packetdb_readdb();
 
 	set_defaultparse(clif_parse);
-	if( make_listen_bind(bind_ip,map_port) == -1 ) {
+	if( make_listen_bind_io(bind_ip,map_port) == -1 ) {
 		ShowFatalError("Failed to bind to port '" CL_WHITE "%d" CL_RESET "'\n",map_port);
 		exit(EXIT_FAILURE);
 	}
 
 	add_timer_func_list(clif_clearunit_delayed_sub, "clif_clearunit_delayed_sub");
 	add_timer_func_list(clif_delayquit, "clif_delayquit");
+	metrics_add_collector(clif_metrics);
 
 #if PACKETVER_MAIN_NUM >= 20190403 || PACKETVER_RE_NUM >= 20190320
 	add_timer_func_list( clif_ping_timer, "clif_ping_timer" );
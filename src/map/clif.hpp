@@ -1222,7 +1222,9 @@ void clif_quest_update_objective(map_session_data * sd, struct quest * qd);
 void clif_quest_show_event(map_session_data *sd, block_list *bl, e_questinfo_types effect, e_questinfo_markcolor color);
 void clif_displayexp(map_session_data *sd, t_exp exp, char type, bool quest, bool lost);
 
-int32 clif_send(const void* buf, int32 len, block_list* bl, enum send_target type);
+/// Key for clif_send packets that only carry the latest state of an object, a newer packet with the same key replaces an unsent one
+#define CLIF_COALESCE_KEY( packet_type, id ) ( ( static_cast<uint64>( packet_type ) << 32 ) | static_cast<uint32>( id ) )
+int32 clif_send(const void* buf, int32 len, block_list* bl, enum send_target type, uint64 coalesce_key = 0);
 void do_init_clif(void);
 void do_final_clif(void);
 
@@ -0,0 +1,103 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "interest_grid.hpp"
+
+#include <algorithm>
+
+/**
+ * Size the grid for a map, nobody watches anything afterwards
+ * The blocks are only allocated once the first player enters the map.
+ * @param bxs: Width of the map in blocks
+ * @param bys: Height of the map in blocks
+ * @param range: Blocks around their own one that players watch
+ */
+void InterestGrid::init( int16 bxs, int16 bys, int16 range ){
+	this->clear();
+	this->bxs = bxs;
+	this->bys = bys;
+	this->range = range;
+}
+
+void InterestGrid::clear(){
+	this->bxs = 0;
+	this->bys = 0;
+	this->watchers.clear();
+	this->watchers.shrink_to_fit();
+	this->watched.clear();
+	this->watched.shrink_to_fit();
+	this->watched_pos.clear();
+	this->watched_pos.shrink_to_fit();
+}
+
+/**
+ * A player entered a block
+ * @param bl: Player
+ * @param bx: X of the block
+ * @param by: Y of the block
+ */
+void InterestGrid::add( block_list* bl, int16 bx, int16 by ){
+	if( this->watchers.empty() ){
+		size_t blocks = static_cast<size_t>( this->bxs ) * this->bys;
+
+		this->watchers.resize( blocks );
+		this->watched_pos.assign( blocks, -1 );
+	}
+
+	int16 x0 = std::max<int16>( bx - this->range, 0 ), x1 = std::min<int16>( bx + this->range, this->bxs - 1 );
+	int16 y0 = std::max<int16>( by - this->range, 0 ), y1 = std::min<int16>( by + this->range, this->bys - 1 );
+
+	for( int16 y = y0; y <= y1; y++ ){
+		for( int16 x = x0; x <= x1; x++ ){
+			int32 block = x + y * this->bxs;
+			std::vector<block_list*>& list = this->watchers[block];
+
+			if( list.empty() ){
+				this->watched_pos[block] = static_cast<int32>( this->watched.size() );
+				this->watched.push_back( block );
+			}
+
+			list.push_back( bl );
+		}
+	}
+}
+
+/**
+ * A player left a block
+ * @param bl: Player
+ * @param bx: X of the block
+ * @param by: Y of the block
+ */
+void InterestGrid::remove( block_list* bl, int16 bx, int16 by ){
+	if( this->watchers.empty() ){
+		return;
+	}
+
+	int16 x0 = std::max<int16>( bx - this->range, 0 ), x1 = std::min<int16>( bx + this->range, this->bxs - 1 );
+	int16 y0 = std::max<int16>( by - this->range, 0 ), y1 = std::min<int16>( by + this->range, this->bys - 1 );
+
+	for( int16 y = y0; y <= y1; y++ ){
+		for( int16 x = x0; x <= x1; x++ ){
+			int32 block = x + y * this->bxs;
+			std::vector<block_list*>& list = this->watchers[block];
+			auto it = std::find( list.begin(), list.end(), bl );
+
+			if( it == list.end() ){
+				continue;
+			}
+
+			list.erase( it );
+
+			if( list.empty() ){
+				// Move the last watched block into the gap
+				int32 pos = this->watched_pos[block];
+				int32 last = this->watched.back();
+
+				this->watched[pos] = last;
+				this->watched_pos[last] = pos;
+				this->watched.pop_back();
+				this->watched_pos[block] = -1;
+			}
+		}
+	}
+}
@@ -0,0 +1,44 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef INTEREST_GRID_HPP
+#define INTEREST_GRID_HPP
+
+#include <vector>
+
+#include <common/cbasetypes.hpp>
+
+struct block_list;
+
+/**
+ * Players that can see each block of a map
+ * A player watches every block within range blocks of its own block, so the
+ * watchers only change when a player enters or leaves a block. Anything that
+ * only matters near players can visit the watched blocks once, instead of
+ * searching the area around every single player.
+ */
+class InterestGrid {
+private:
+	int16 bxs;
+	int16 bys;
+	int16 range; // in blocks
+	std::vector<std::vector<block_list*>> watchers;
+	std::vector<int32> watched; // Blocks with at least one watcher
+	std::vector<int32> watched_pos; // Index of each block in watched, -1 if nobody watches it
+
+public:
+	InterestGrid() : bxs( 0 ), bys( 0 ), range( 0 ){}
+
+	void init( int16 bxs, int16 bys, int16 range );
+	void clear();
+
+	void add( block_list* bl, int16 bx, int16 by );
+	void remove( block_list* bl, int16 bx, int16 by );
+
+	/// Blocks that are watched by at least one player, in no particular order
+	const std::vector<int32>& blocks() const { return this->watched; }
+	/// Players that watch a block
+	const std::vector<block_list*>& watching( int32 block ) const { return this->watchers[block]; }
+};
+
+#endif /* INTEREST_GRID_HPP */
@@ -13,8 +13,11 @@
 #include <common/core.hpp>
 #include <common/ers.hpp>
 #include <common/grfio.hpp>
+#include <common/id_directory.hpp>
 #include <common/malloc.hpp>
+#include <common/metrics.hpp>
 #include <common/nullpo.hpp>
+#include <common/profiler.hpp>
 #include <common/random.hpp>
 #include <common/showmsg.hpp>
 #include <common/socket.hpp> // WFIFO*()
@@ -22,6 +25,7 @@
 #include <common/timer.hpp>
 #include <common/utilities.hpp>
 #include <common/utils.hpp>
+#include <common/watchdog.hpp>
 
 #include "achievement.hpp"
 #include "ai_dialogue_queue.hpp"
@@ -45,6 +49,7 @@
 #include "log.hpp"
 #include "mapreg.hpp"
 #include "mercenary.hpp"
+#include "metrics_server.hpp"
 #include "mob.hpp"
 #include "navi.hpp"
 #include "npc.hpp"
@@ -118,15 +123,21 @@ static DBMap* charid_db=nullptr; /// uint32 char_id -> map_session_data*
 static DBMap* regen_db=nullptr; /// int32 id -> block_list* (status_natural_heal processing)
 static DBMap* map_msg_db=nullptr;
 
+// Ids handed out by the map server, id -> block_list*
+// Players use their account id and are only looked up in id_db.
+static IdDirectory<block_list> map_object_ids( MIN_FLOORITEM, MAX_FLOORITEM, 17, 32768 ); /// floor items, skill units, chatrooms
+static IdDirectory<block_list> map_npc_ids( START_NPC_NUM, INT32_MAX, 20, 4096 ); /// npcs, mobs, pets, homunculi, mercenaries, elementals
+
 // AI Dialogue System (global - accessible from clif.cpp)
 AIDialogueQueue* ai_dialogue_queue = nullptr;
 static AIDialogueWorker* ai_dialogue_worker = nullptr;  // Keep static - only used in map.cpp
 AIDialogueStateManager* ai_dialogue_state = nullptr;
 bool ai_dialogue_enabled = true; // Can be configured
+static int32 ai_dialogue_wakeup_fd = -1; // Signaled by the workers when responses are queued
+static int32 ai_dialogue_max_requests_per_account = 2; // Queued requests per account (0 = unlimited)
 
 static int32 map_users=0;
 
-#define BLOCK_SIZE 8
 #define block_free_max 1048576
 block_list *block_free[block_free_max];
 static int32 block_free_count = 0, block_free_lock = 0;
@@ -135,6 +146,8 @@ static int32 block_free_count = 0, block_free_lock = 0;
 static block_list *bl_list[BL_LIST_MAX];
 static int32 bl_list_count = 0;
 
+static int16 map_interest_blocks = 0; // see map_setinterestrange
+
 #ifndef MAP_MAX_MSG
 	#define MAP_MAX_MSG 1550
 #endif
@@ -178,6 +191,13 @@ struct map_cache_map_info {
 char motd_txt[256] = "conf/motd.txt";
 char charhelp_txt[256] = "conf/charhelp.txt";
 char channel_conf[256] = "conf/channels.conf";
+char profiler_log_filepath[256] = "./log/map-profiler.log";
+static int32 profiler_dump_interval = 0; // seconds between the profiler dumps, 0 to disable them
+static int32 tick_watchdog_threshold = 0; // milliseconds of work per tick, 0 to disable the watchdog
+static int32 tick_watchdog_history = 64;
+static char tick_watchdog_log_filepath[256] = "./log/map-slow_ticks.log";
+static uint16 metrics_port = 0; // port of the metrics endpoint, 0 to disable it
+static char metrics_ip[64] = "127.0.0.1";
 
 const char *MSG_CONF_NAME_RUS;
 const char *MSG_CONF_NAME_SPN;
@@ -395,7 +415,7 @@ static void map_addblcell(block_list *bl)
 
 	if( bl->m<0 || bl->x<0 || bl->x>=mapdata->xs || bl->y<0 || bl->y>=mapdata->ys || !(bl->type&BL_CHAR) )
 		return;
-	mapdata->cell[bl->x+bl->y*mapdata->xs].cell_bl++;
+	mapdata->cell->stack(bl->x, bl->y)++;
 	return;
 }
 
@@ -405,7 +425,7 @@ static void map_delblcell(block_list *bl)
 
 	if( bl->m <0 || bl->x<0 || bl->x>=mapdata->xs || bl->y<0 || bl->y>=mapdata->ys || !(bl->type&BL_CHAR) )
 		return;
-	mapdata->cell[bl->x+bl->y*mapdata->xs].cell_bl--;
+	mapdata->cell->stack(bl->x, bl->y)--;
 }
 #endif
 
@@ -448,11 +468,19 @@ int32 map_addblock(block_list* bl)
 
 	pos = x/BLOCK_SIZE+(y/BLOCK_SIZE)*mapdata->bxs;
 
+	if (bl->type == BL_PC)
+		mapdata->interest.add(bl, x/BLOCK_SIZE, y/BLOCK_SIZE);
+
 	if (bl->type == BL_MOB) {
 		bl->next = mapdata->block_mob[pos];
 		bl->prev = &bl_head;
 		if (bl->next) bl->next->prev = bl;
 		mapdata->block_mob[pos] = bl;
+	} else if (bl->type == BL_PC) {
+		bl->next = mapdata->block_pc[pos];
+		bl->prev = &bl_head;
+		if (bl->next) bl->next->prev = bl;
+		mapdata->block_pc[pos] = bl;
 	} else {
 		bl->next = mapdata->block[pos];
 		bl->prev = &bl_head;
@@ -494,6 +522,9 @@ int32 map_delblock(block_list* bl)
 
 	pos = bl->x/BLOCK_SIZE+(bl->y/BLOCK_SIZE)*mapdata->bxs;
 
+	if (bl->type == BL_PC)
+		mapdata->interest.remove(bl, bl->x/BLOCK_SIZE, bl->y/BLOCK_SIZE);
+
 	if (bl->next)
 		bl->next->prev = bl->prev;
 	if (bl->prev == &bl_head) {
@@ -501,6 +532,9 @@ int32 map_delblock(block_list* bl)
 		if (bl->type == BL_MOB) {
 			nullpo_ret(mapdata->block_mob);
 			mapdata->block_mob[pos] = bl->next;
+		} else if (bl->type == BL_PC) {
+			nullpo_ret(mapdata->block_pc);
+			mapdata->block_pc[pos] = bl->next;
 		} else {
 			nullpo_ret(mapdata->block);
 			mapdata->block[pos] = bl->next;
@@ -649,45 +683,28 @@ int32 map_moveblock(block_list *bl, int32 x1, int32 y1, t_tick tick)
  *------------------------------------------*/
 int32 map_count_oncell(int16 m, int16 x, int16 y, int32 type, int32 flag)
 {
-	int32 bx,by;
-	block_list *bl;
 	int32 count = 0;
 	struct map_data *mapdata = map_getmapdata(m);
 
 	if (x < 0 || y < 0 || (x >= mapdata->xs) || (y >= mapdata->ys))
 		return 0;
 
-	bx = x/BLOCK_SIZE;
-	by = y/BLOCK_SIZE;
-
-	if (type&~BL_MOB)
-		for( bl = mapdata->block[bx+by*mapdata->bxs] ; bl != nullptr ; bl = bl->next )
-			if(bl->x == x && bl->y == y && bl->type&type) {
-				if (bl->type == BL_NPC) {	// Don't count hidden or invisible npc. Cloaked npc are counted
-					npc_data *nd = BL_CAST(BL_NPC, bl);
-					if (nd->m < 0 || nd->sc.option&OPTION_HIDE || nd->dynamicnpc.owner_char_id != 0)
-						continue;
-				}
-				if(flag&1) {
-					struct unit_data *ud = unit_bl2ud(bl);
-					if(!ud || ud->walktimer == INVALID_TIMER)
-						count++;
-				} else {
-					count++;
-				}
-			}
-
-	if (type&BL_MOB)
-		for( bl = mapdata->block_mob[bx+by*mapdata->bxs] ; bl != nullptr ; bl = bl->next )
-			if(bl->x == x && bl->y == y) {
-				if(flag&1) {
-					struct unit_data *ud = unit_bl2ud(bl);
-					if(!ud || ud->walktimer == INVALID_TIMER)
-						count++;
-				} else {
-					count++;
-				}
-			}
+	map_foreachblock(mapdata, x, y, x, y, type, [&](block_list *bl) {
+		if (bl->x != x || bl->y != y)
+			return;
+		if (bl->type == BL_NPC) {	// Don't count hidden or invisible npc. Cloaked npc are counted
+			npc_data *nd = BL_CAST(BL_NPC, bl);
+			if (nd->m < 0 || nd->sc.option&OPTION_HIDE || nd->dynamicnpc.owner_char_id != 0)
+				return;
+		}
+		if(flag&1) {
+			struct unit_data *ud = unit_bl2ud(bl);
+			if(!ud || ud->walktimer == INVALID_TIMER)
+				count++;
+		} else {
+			count++;
+		}
+	});
 
 	return count;
 }
@@ -727,76 +744,17 @@ skill_unit* map_find_skill_unit_oncell(block_list* target,int16 x,int16 y,uint16
  *------------------------------------------*/
 int32 map_foreachinrangeV(int32 (*func)(block_list*,va_list),block_list* center, int16 range, int32 type, va_list ap, bool wall_check)
 {
-	int32 bx, by, m;
-	int32 returnCount = 0;	//total sum of returned values of func() [Skotlex]
-	block_list *bl;
-	int32 blockcount = bl_list_count, i;
-	int32 x0, x1, y0, y1;
+	t_blocklist list;
 	va_list ap_copy;
 
-	m = center->m;
-	if( m < 0 )
-		return 0;
-
-	struct map_data *mapdata = map_getmapdata(m);
+	map_getinrange(list, center, range, type, wall_check);
 
-	if( mapdata == nullptr || mapdata->block == nullptr ){
-		return 0;
-	}
-
-	x0 = i16max(center->x - range, 0);
-	y0 = i16max(center->y - range, 0);
-	x1 = i16min(center->x + range, mapdata->xs - 1);
-	y1 = i16min(center->y + range, mapdata->ys - 1);
-
-	if ( type&~BL_MOB ) {
-		for( by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++ ) {
-			for( bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++ ) {
-				for(bl = mapdata->block[ bx + by * mapdata->bxs ]; bl != nullptr; bl = bl->next ) {
-					if( bl->type&type
-						&& bl->x >= x0 && bl->x <= x1 && bl->y >= y0 && bl->y <= y1
-#ifdef CIRCULAR_AREA
-						&& check_distance_bl(center, bl, range)
-#endif
-						&& ( !wall_check || path_search_long(nullptr, center->m, center->x, center->y, bl->x, bl->y, CELL_CHKWALL) )
-					  	&& bl_list_count < BL_LIST_MAX )
-						bl_list[ bl_list_count++ ] = bl;
-				}
-			}
-		}
-	}
-
-	if ( type&BL_MOB ) {
-		for( by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++ ) {
-			for( bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++ ) {
-				for(bl = mapdata->block_mob[ bx + by * mapdata->bxs ]; bl != nullptr; bl = bl->next ) {
-					if( bl->x >= x0 && bl->x <= x1 && bl->y >= y0 && bl->y <= y1
-#ifdef CIRCULAR_AREA
-						&& check_distance_bl(center, bl, range)
-#endif
-						&& ( !wall_check || path_search_long(nullptr, center->m, center->x, center->y, bl->x, bl->y, CELL_CHKWALL) )
-					  	&& bl_list_count < BL_LIST_MAX )
-						bl_list[ bl_list_count++ ] = bl;
-				}
-			}
-		}
-	}
-
-	if( bl_list_count >= BL_LIST_MAX )
-		ShowWarning("map_foreachinrange: block count too many!\n");
-
-	FreeBlockLock freeLock;
-
-	for( i = blockcount; i < bl_list_count; i++ ) {
-		if( bl_list[ i ]->prev ) { //func() may delete this bl_list[] slot, checking for prev ensures it wasn't queued for deletion.
-			va_copy(ap_copy, ap);
-			returnCount += func(bl_list[i], ap_copy);
-			va_end(ap_copy);
-		}
-	}
-
-	bl_list_count = blockcount;
-	return returnCount;	//[Skotlex]
+	return map_foreachinlist(list, [&](block_list *bl) {
+		va_copy(ap_copy, ap);
+		int32 returnCount = func(bl, ap_copy);
+		va_end(ap_copy);
+		return returnCount;
+	});
 }
 
 int32 map_foreachinrange(int32 (*func)(block_list*,va_list), block_list* center, int16 range, int32 type, ...)
@@ -819,6 +777,35 @@ int32 map_foreachinallrange(int32 (*func)(block_list*,va_list), block_list* cent
 	return returnCount;
 }
 
+/*==========================================
+ * Sets how far players watch the blocks around them, see map_data::interest.
+ * Rebuilds the grids of all maps when the range in blocks changed.
+ * @param range: Range in cells
+ *------------------------------------------*/
+void map_setinterestrange(int16 range)
+{
+	int16 blocks = (range + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+	if (blocks == map_interest_blocks)
+		return;
+
+	map_interest_blocks = blocks;
+
+	for (int32 m = 0; m < map_num; m++) {
+		struct map_data *mapdata = map_getmapdata(m);
+
+		if (mapdata->block == nullptr)
+			continue;
+
+		mapdata->interest.init(mapdata->bxs, mapdata->bys, blocks);
+
+		for (int32 i = 0; i < mapdata->bxs * mapdata->bys; i++) {
+			for (block_list *bl = mapdata->block_pc[i]; bl != nullptr; bl = bl->next)
+				mapdata->interest.add(bl, bl->x/BLOCK_SIZE, bl->y/BLOCK_SIZE);
+		}
+	}
+}
+
 /*==========================================
  * Same as foreachinrange, but there must be a shoot-able range between center and target to be counted in. [Skotlex]
  *------------------------------------------*/
@@ -845,78 +832,17 @@ int32 map_foreachinshootrange(int32 (*func)(block_list*,va_list),block_list* cen
 *------------------------------------------*/
 int32 map_foreachinareaV(int32 (*func)(block_list*, va_list), int16 m, int16 x0, int16 y0, int16 x1, int16 y1, int32 type, va_list ap, bool wall_check)
 {
-	int32 bx, by, cx, cy;
-	int32 returnCount = 0;	//total sum of returned values of func()
-	block_list *bl;
-	int32 blockcount = bl_list_count, i;
+	t_blocklist list;
 	va_list ap_copy;
 
-	if (m < 0)
-		return 0;
-
-	if (x1 < x0)
-		std::swap(x0, x1);
-	if (y1 < y0)
-		std::swap(y0, y1);
-
-	struct map_data *mapdata = map_getmapdata(m);
-
-	if( mapdata == nullptr || mapdata->block == nullptr ){
-		return 0;
-	}
-
-	x0 = i16max(x0, 0);
-	y0 = i16max(y0, 0);
-	x1 = i16min(x1, mapdata->xs - 1);
-	y1 = i16min(y1, mapdata->ys - 1);
-
-	if( wall_check ) {
-		cx = x0 + (x1 - x0) / 2;
-		cy = y0 + (y1 - y0) / 2;
-	}
-
-	if( type&~BL_MOB ) {
-		for (by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++) {
-			for (bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++) {
-				for(bl = mapdata->block[bx + by * mapdata->bxs]; bl != nullptr; bl = bl->next) {
-					if ( bl->type&type
-						&& bl->x >= x0 && bl->x <= x1 && bl->y >= y0 && bl->y <= y1
-						&& ( !wall_check || path_search_long(nullptr, m, cx, cy, bl->x, bl->y, CELL_CHKWALL) )
-						&& bl_list_count < BL_LIST_MAX )
-						bl_list[bl_list_count++] = bl;
-				}
-			}
-		}
-	}
-
-	if( type&BL_MOB ) {
-		for (by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++) {
-			for (bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++) {
-				for(bl = mapdata->block_mob[bx + by * mapdata->bxs]; bl != nullptr; bl = bl->next) {
-					if ( bl->x >= x0 && bl->x <= x1 && bl->y >= y0 && bl->y <= y1
-						&& ( !wall_check || path_search_long(nullptr, m, cx, cy, bl->x, bl->y, CELL_CHKWALL) )
-						&& bl_list_count < BL_LIST_MAX )
-						bl_list[bl_list_count++] = bl;
-				}
-			}
-		}
-	}
-
-	if (bl_list_count >= BL_LIST_MAX)
-		ShowWarning("map_foreachinarea: block count too many!\n");
-
-	FreeBlockLock freeLock;
-
-	for (i = blockcount; i < bl_list_count; i++) {
-		if (bl_list[i]->prev) { //func() may delete this bl_list[] slot, checking for prev ensures it wasn't queued for deletion.
-			va_copy(ap_copy, ap);
-			returnCount += func(bl_list[i], ap_copy);
-			va_end(ap_copy);
-		}
-	}
+	map_getinarea(list, m, x0, y0, x1, y1, type, wall_check);
 
-	bl_list_count = blockcount;
-	return returnCount;
+	return map_foreachinlist(list, [&](block_list *bl) {
+		va_copy(ap_copy, ap);
+		int32 returnCount = func(bl, ap_copy);
+		va_end(ap_copy);
+		return returnCount;
+	});
 }
 
 int32 map_foreachinallarea(int32 (*func)(block_list*,va_list), int16 m, int16 x0, int16 y0, int16 x1, int16 y1, int32 type, ...)
@@ -953,130 +879,47 @@ int32 map_foreachinarea(int32 (*func)(block_list*, va_list), int16 m, int16 x0,
  *------------------------------------------*/
 int32 map_forcountinrange(int32 (*func)(block_list*,va_list), block_list* center, int16 range, int32 count, int32 type, ...)
 {
-	int32 bx, by, m;
 	int32 returnCount = 0;	//total sum of returned values of func() [Skotlex]
-	block_list *bl;
-	int32 blockcount = bl_list_count, i;
-	int32 x0, x1, y0, y1;
-	struct map_data *mapdata;
+	t_blocklist list;
 	va_list ap;
 
-	m = center->m;
-	mapdata = map_getmapdata(m);
-
-	if( mapdata == nullptr || mapdata->block == nullptr ){
-		return 0;
-	}
-
-	x0 = i16max(center->x - range, 0);
-	y0 = i16max(center->y - range, 0);
-	x1 = i16min(center->x + range, mapdata->xs - 1);
-	y1 = i16min(center->y + range, mapdata->ys - 1);
-
-	if ( type&~BL_MOB )
-		for ( by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++ ) {
-			for( bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++ ) {
-				for( bl = mapdata->block[ bx + by * mapdata->bxs ]; bl != nullptr; bl = bl->next ) {
-					if( bl->type&type
-						&& bl->x >= x0 && bl->x <= x1 && bl->y >= y0 && bl->y <= y1
-#ifdef CIRCULAR_AREA
-						&& check_distance_bl(center, bl, range)
-#endif
-					  	&& bl_list_count < BL_LIST_MAX )
-						bl_list[ bl_list_count++ ] = bl;
-				}
-			}
-		}
-	if( type&BL_MOB )
-		for( by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++ ) {
-			for( bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++ ){
-				for( bl = mapdata->block_mob[ bx + by * mapdata->bxs ]; bl != nullptr; bl = bl->next ) {
-					if( bl->x >= x0 && bl->x <= x1 && bl->y >= y0 && bl->y <= y1
-#ifdef CIRCULAR_AREA
-						&& check_distance_bl(center, bl, range)
-#endif
-						&& bl_list_count < BL_LIST_MAX )
-						bl_list[ bl_list_count++ ] = bl;
-				}
-			}
-		}
-
-	if( bl_list_count >= BL_LIST_MAX )
-		ShowWarning("map_forcountinrange: block count too many!\n");
+	map_getinrange(list, center, range, type);
 
 	FreeBlockLock freeLock;
 
-	for( i = blockcount; i < bl_list_count; i++ ) {
-		if( bl_list[ i ]->prev ) { //func() may delete this bl_list[] slot, checking for prev ensures it wasn't queued for deletion.
+	for( block_list *bl : list ) {
+		if( bl->prev ) { //func() may delete an object of the list, checking for prev ensures it wasn't queued for deletion.
 			va_start(ap, type);
-			returnCount += func(bl_list[ i ], ap);
+			returnCount += func(bl, ap);
 			va_end(ap);
 			if( count && returnCount >= count )
 				break;
 		}
 	}
 
-	bl_list_count = blockcount;
 	return returnCount;	//[Skotlex]
 }
 int32 map_forcountinarea(int32 (*func)(block_list*,va_list), int16 m, int16 x0, int16 y0, int16 x1, int16 y1, int32 count, int32 type, ...)
 {
-	int32 bx, by;
 	int32 returnCount = 0;	//total sum of returned values of func() [Skotlex]
-	block_list *bl;
-	int32 blockcount = bl_list_count, i;
+	t_blocklist list;
 	va_list ap;
 
-	if ( m < 0 )
-		return 0;
-
-	if ( x1 < x0 )
-		std::swap(x0, x1);
-	if ( y1 < y0 )
-		std::swap(y0, y1);
-
-	struct map_data *mapdata = map_getmapdata(m);
-
-	if( mapdata == nullptr || mapdata->block == nullptr ){
-		return 0;
-	}
-
-	x0 = i16max(x0, 0);
-	y0 = i16max(y0, 0);
-	x1 = i16min(x1, mapdata->xs - 1);
-	y1 = i16min(y1, mapdata->ys - 1);
-
-	if ( type&~BL_MOB )
-		for( by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++ )
-			for( bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++ )
-				for( bl = mapdata->block[ bx + by * mapdata->bxs ]; bl != nullptr; bl = bl->next )
-					if( bl->type&type && bl->x >= x0 && bl->x <= x1 && bl->y >= y0 && bl->y <= y1 && bl_list_count < BL_LIST_MAX )
-						bl_list[ bl_list_count++ ] = bl;
-
-	if( type&BL_MOB )
-		for( by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++ )
-			for( bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++ )
-				for( bl = mapdata->block_mob[ bx + by * mapdata->bxs ]; bl != nullptr; bl = bl->next )
-					if( bl->x >= x0 && bl->x <= x1 && bl->y >= y0 && bl->y <= y1 && bl_list_count < BL_LIST_MAX )
-						bl_list[ bl_list_count++ ] = bl;
-
-	if( bl_list_count >= BL_LIST_MAX )
-		ShowWarning("map_forcountinarea: block count too many!\n");
+	map_getinarea(list, m, x0, y0, x1, y1, type);
 
 	FreeBlockLock freeLock;
 
-	for( i = blockcount; i < bl_list_count; i++ ) {
-		if(bl_list[ i ]->prev) { //func() may delete this bl_list[] slot, checking for prev ensures it wasn't queued for deletion.
+	for( block_list *bl : list ) {
+		if( bl->prev ) { //func() may delete an object of the list, checking for prev ensures it wasn't queued for deletion.
 			va_start(ap, type);
-			returnCount += func(bl_list[ i ], ap);
+			returnCount += func(bl, ap);
 			va_end(ap);
 			if( count && returnCount >= count )
 				break;
 		}
 	}
 
-	bl_list_count = blockcount;
-	return returnCount;	//[Skotlex]
+	return returnCount;
 }
 
 /*==========================================
@@ -1085,9 +928,8 @@ int32 map_forcountinarea(int32 (*func)(block_list*,va_list), int16 m, int16 x0,
  *------------------------------------------*/
 int32 map_foreachinmovearea(int32 (*func)(block_list*,va_list), block_list* center, int16 range, int16 dx, int16 dy, int32 type, ...)
 {
-	int32 bx, by, m;
+	int32 m;
 	int32 returnCount = 0;  //total sum of returned values of func() [Skotlex]
-	block_list *bl;
 	int32 blockcount = bl_list_count, i;
 	int16 x0, x1, y0, y1;
 	va_list ap;
@@ -1132,63 +974,37 @@ int32 map_foreachinmovearea(int32 (*func)(block_list*,va_list), block_list* cent
 		x1 = i16min(x1, mapdata->xs - 1);
 		y1 = i16min(y1, mapdata->ys - 1);
 
-		for( by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++ ) {
-			for( bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++ ) {
-				if ( type&~BL_MOB ) {
-					for( bl = mapdata->block[ bx + by * mapdata->bxs ]; bl != nullptr; bl = bl->next ) {
-						if( bl->type&type &&
-							bl->x >= x0 && bl->x <= x1 &&
-							bl->y >= y0 && bl->y <= y1 &&
-							bl_list_count < BL_LIST_MAX )
-							bl_list[ bl_list_count++ ] = bl;
-					}
-				}
-				if ( type&BL_MOB ) {
-					for( bl = mapdata->block_mob[ bx + by * mapdata->bxs ]; bl != nullptr; bl = bl->next ) {
-						if( bl->x >= x0 && bl->x <= x1 &&
-							bl->y >= y0 && bl->y <= y1 &&
-							bl_list_count < BL_LIST_MAX )
-							bl_list[ bl_list_count++ ] = bl;
-					}
-				}
-			}
-		}
+		auto collect = [&](block_list *bl) {
+			if( bl->x >= x0 && bl->x <= x1 &&
+				bl->y >= y0 && bl->y <= y1 &&
+				bl_list_count < BL_LIST_MAX )
+				bl_list[ bl_list_count++ ] = bl;
+		};
+
+		// Monsters are visited along with the other objects of their block
+		for( int32 by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++ )
+			for( int32 bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++ )
+				map_foreachblock(mapdata, bx * BLOCK_SIZE, by * BLOCK_SIZE, bx * BLOCK_SIZE, by * BLOCK_SIZE, type, collect);
 	} else { // Diagonal movement
 		x0 = i16max(x0, 0);
 		y0 = i16max(y0, 0);
 		x1 = i16min(x1, mapdata->xs - 1);
 		y1 = i16min(y1, mapdata->ys - 1);
 
-		for( by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++ ) {
-			for( bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++ ) {
-				if ( type & ~BL_MOB ) {
-					for( bl = mapdata->block[ bx + by * mapdata->bxs ]; bl != nullptr; bl = bl->next ) {
-						if( bl->type&type &&
-							bl->x >= x0 && bl->x <= x1 &&
-							bl->y >= y0 && bl->y <= y1 &&
-							bl_list_count < BL_LIST_MAX )
-						if( ( dx > 0 && bl->x < x0 + dx) ||
-							( dx < 0 && bl->x > x1 + dx) ||
-							( dy > 0 && bl->y < y0 + dy) ||
-							( dy < 0 && bl->y > y1 + dy) )
-							bl_list[ bl_list_count++ ] = bl;
-					}
-				}
-				if ( type&BL_MOB ) {
-					for( bl = mapdata->block_mob[ bx + by * mapdata->bxs ]; bl != nullptr; bl = bl->next ) {
-						if( bl->x >= x0 && bl->x <= x1 &&
-							bl->y >= y0 && bl->y <= y1 &&
-							bl_list_count < BL_LIST_MAX)
-						if( ( dx > 0 && bl->x < x0 + dx) ||
-							( dx < 0 && bl->x > x1 + dx) ||
-							( dy > 0 && bl->y < y0 + dy) ||
-							( dy < 0 && bl->y > y1 + dy) )
-							bl_list[ bl_list_count++ ] = bl;
-					}
-				}
-			}
-		}
+		auto collect = [&](block_list *bl) {
+			if( bl->x >= x0 && bl->x <= x1 &&
+				bl->y >= y0 && bl->y <= y1 &&
+				bl_list_count < BL_LIST_MAX )
+			if( ( dx > 0 && bl->x < x0 + dx) ||
+				( dx < 0 && bl->x > x1 + dx) ||
+				( dy > 0 && bl->y < y0 + dy) ||
+				( dy < 0 && bl->y > y1 + dy) )
+				bl_list[ bl_list_count++ ] = bl;
+		};
 
+		for( int32 by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++ )
+			for( int32 bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++ )
+				map_foreachblock(mapdata, bx * BLOCK_SIZE, by * BLOCK_SIZE, bx * BLOCK_SIZE, by * BLOCK_SIZE, type, collect);
 	}
 
 	if( bl_list_count >= BL_LIST_MAX )
@@ -1214,9 +1030,7 @@ int32 map_foreachinmovearea(int32 (*func)(block_list*,va_list), block_list* cent
 //
 int32 map_foreachincell(int32 (*func)(block_list*,va_list), int16 m, int16 x, int16 y, int32 type, ...)
 {
-	int32 bx, by;
 	int32 returnCount = 0;  //total sum of returned values of func() [Skotlex]
-	block_list *bl;
 	int32 blockcount = bl_list_count, i;
 	struct map_data *mapdata = map_getmapdata(m);
 	va_list ap;
@@ -1227,17 +1041,10 @@ int32 map_foreachincell(int32 (*func)(block_list*,va_list), int16 m, int16 x, in
 
 	if ( x < 0 || y < 0 || x >= mapdata->xs || y >= mapdata->ys ) return 0;
 
-	by = y / BLOCK_SIZE;
-	bx = x / BLOCK_SIZE;
-
-	if( type&~BL_MOB )
-		for( bl = mapdata->block[ bx + by * mapdata->bxs ]; bl != nullptr; bl = bl->next )
-			if( bl->type&type && bl->x == x && bl->y == y && bl_list_count < BL_LIST_MAX )
-				bl_list[ bl_list_count++ ] = bl;
-	if( type&BL_MOB )
-		for( bl = mapdata->block_mob[ bx + by * mapdata->bxs]; bl != nullptr; bl = bl->next )
-			if( bl->x == x && bl->y == y && bl_list_count < BL_LIST_MAX)
-				bl_list[ bl_list_count++ ] = bl;
+	map_foreachblock(mapdata, x, y, x, y, type, [&](block_list *bl) {
+		if( bl->x == x && bl->y == y && bl_list_count < BL_LIST_MAX )
+			bl_list[ bl_list_count++ ] = bl;
+	});
 
 	if( bl_list_count >= BL_LIST_MAX )
 		ShowWarning("map_foreachincell: block count too many!\n");
@@ -1297,8 +1104,6 @@ int32 map_foreachinpath(int32 (*func)(block_list*,va_list),int16 m,int16 x0,int1
 
 	//Generic map_foreach* variables.
 	int32 i, blockcount = bl_list_count;
-	block_list *bl;
-	int32 bx, by;
 	//method specific variables
 	int32 magnitude2, len_limit; //The square of the magnitude
 	int32 k, xi, yi, xu, yu;
@@ -1357,71 +1162,36 @@ int32 map_foreachinpath(int32 (*func)(block_list*,va_list),int16 m,int16 x0,int1
 
 	range *= range << 8; //Values are shifted later on for higher precision using int32 math.
 
-	if ( type&~BL_MOB )
-		for ( by = my0 / BLOCK_SIZE; by <= my1 / BLOCK_SIZE; by++ ) {
-			for( bx = mx0 / BLOCK_SIZE; bx <= mx1 / BLOCK_SIZE; bx++ ) {
-				for( bl = mapdata->block[ bx + by * mapdata->bxs ]; bl != nullptr; bl = bl->next ) {
-					if( bl->prev && bl->type&type && bl_list_count < BL_LIST_MAX ) {
-						xi = bl->x;
-						yi = bl->y;
+	map_foreachblock(mapdata, mx0, my0, mx1, my1, type, [&](block_list *bl) {
+		if( !bl->prev || bl_list_count >= BL_LIST_MAX )
+			return;
 
-						k = ( xi - x0 ) * ( x1 - x0 ) + ( yi - y0 ) * ( y1 - y0 );
+		xi = bl->x;
+		yi = bl->y;
 
-						if ( k < 0 || k > len_limit ) //Since more skills use this, check for ending point as well.
-							continue;
+		k = ( xi - x0 ) * ( x1 - x0 ) + ( yi - y0 ) * ( y1 - y0 );
 
-						if ( k > magnitude2 && !path_search_long(nullptr, m, x0, y0, xi, yi, CELL_CHKWALL) )
-							continue; //Targets beyond the initial ending point need the wall check.
+		if ( k < 0 || k > len_limit ) //Since more skills use this, check for ending point as well.
+			return;
 
-						//All these shifts are to increase the precision of the intersection point and distance considering how it's
-						//int32 math.
-						k  = ( k << 4 ) / magnitude2; //k will be between 1~16 instead of 0~1
-						xi <<= 4;
-						yi <<= 4;
-						xu = ( x0 << 4 ) + k * ( x1 - x0 );
-						yu = ( y0 << 4 ) + k * ( y1 - y0 );
-						k  = MAGNITUDE2(xi, yi, xu, yu);
+		if ( k > magnitude2 && !path_search_long(nullptr, m, x0, y0, xi, yi, CELL_CHKWALL) )
+			return; //Targets beyond the initial ending point need the wall check.
 
-						//If all dot coordinates were <<4 the square of the magnitude is <<8
-						if ( k > range )
-							continue;
+		//All these shifts are to increase the precision of the intersection point and distance considering how it's
+		//int32 math.
+		k  = ( k << 4 ) / magnitude2; //k will be between 1~16 instead of 0~1
+		xi <<= 4;
+		yi <<= 4;
+		xu = ( x0 << 4 ) + k * ( x1 - x0 );
+		yu = ( y0 << 4 ) + k * ( y1 - y0 );
+		k  = MAGNITUDE2(xi, yi, xu, yu);
 
-						bl_list[ bl_list_count++ ] = bl;
-					}
-				}
-			}
-		}
-	 if( type&BL_MOB )
-		for( by = my0 / BLOCK_SIZE; by <= my1 / BLOCK_SIZE; by++ ) {
-			for( bx = mx0 / BLOCK_SIZE; bx <= mx1 / BLOCK_SIZE; bx++ ) {
-				for( bl = mapdata->block_mob[ bx + by * mapdata->bxs ]; bl != nullptr; bl = bl->next ) {
-					if( bl->prev && bl_list_count < BL_LIST_MAX ) {
-						xi = bl->x;
-						yi = bl->y;
-						k = ( xi - x0 ) * ( x1 - x0 ) + ( yi - y0 ) * ( y1 - y0 );
-
-						if ( k < 0 || k > len_limit )
-							continue;
-
-						if ( k > magnitude2 && !path_search_long(nullptr, m, x0, y0, xi, yi, CELL_CHKWALL) )
-							continue; //Targets beyond the initial ending point need the wall check.
-
-						k  = ( k << 4 ) / magnitude2; //k will be between 1~16 instead of 0~1
-						xi <<= 4;
-						yi <<= 4;
-						xu = ( x0 << 4 ) + k * ( x1 - x0 );
-						yu = ( y0 << 4 ) + k * ( y1 - y0 );
-						k  = MAGNITUDE2(xi, yi, xu, yu);
-
-						//If all dot coordinates were <<4 the square of the magnitude is <<8
-						if ( k > range )
-							continue;
-
-						bl_list[ bl_list_count++ ] = bl;
-					}
-				}
-			}
-		}
+		//If all dot coordinates were <<4 the square of the magnitude is <<8
+		if ( k > range )
+			return;
+
+		bl_list[ bl_list_count++ ] = bl;
+	});
 
 	if( bl_list_count >= BL_LIST_MAX )
 		ShowWarning("map_foreachinpath: block count too many!\n");
@@ -1461,8 +1231,6 @@ int32 map_foreachindir(int32 (*func)(block_list*, va_list), int16 m, int16 x0, i
 	int32 returnCount = 0;  //Total sum of returned values of func()
 
 	int32 i, blockcount = bl_list_count;
-	block_list *bl;
-	int32 bx, by;
 	int32 mx0, mx1, my0, my1, rx, ry;
 	uint8 dir = map_calc_dir_xy( x0, y0, x1, y1, DIR_EAST );
 	int16 dx = dirx[dir];
@@ -1516,78 +1284,36 @@ int32 map_foreachindir(int32 (*func)(block_list*, va_list), int16 m, int16 x0, i
 	mx1 = min(mx1, mapdata->xs - 1);
 	my1 = min(my1, mapdata->ys - 1);
 
-	if (type&~BL_MOB) {
-		for (by = my0 / BLOCK_SIZE; by <= my1 / BLOCK_SIZE; by++) {
-			for (bx = mx0 / BLOCK_SIZE; bx <= mx1 / BLOCK_SIZE; bx++) {
-				for (bl = mapdata->block[bx + by * mapdata->bxs]; bl != nullptr; bl = bl->next) {
-					if (bl->prev && bl->type&type && bl_list_count < BL_LIST_MAX) {
-						//Check if inside search area
-						if (bl->x < mx0 || bl->x > mx1 || bl->y < my0 || bl->y > my1)
-							continue;
-						//What matters now is the relative x and y from the start point
-						rx = (bl->x - x0);
-						ry = (bl->y - y0);
-						//Do not hit source cell
-						if (battle_config.skill_eightpath_same_cell == 0 && rx == 0 && ry == 0)
-							continue;
-						//This turns it so that the area that is hit is always with positive rx and ry
-						rx *= dx;
-						ry *= dy;
-						//These checks only need to be done for diagonal paths
-						if( direction_diagonal( (directions)dir ) ){
-							//Check for length
-							if ((rx + ry < offset) || (rx + ry > 2 * (length + (offset/2) - 1)))
-								continue;
-							//Check for width
-							if (abs(rx - ry) > 2 * range)
-								continue;
-						}
-						//Everything else ok, check for line of sight from source
-						if (!path_search_long(nullptr, m, x0, y0, bl->x, bl->y, CELL_CHKWALL))
-							continue;
-						//All checks passed, add to list
-						bl_list[bl_list_count++] = bl;
-					}
-				}
-			}
+	map_foreachblock(mapdata, mx0, my0, mx1, my1, type, [&](block_list *bl) {
+		if (!bl->prev || bl_list_count >= BL_LIST_MAX)
+			return;
+		//Check if inside search area
+		if (bl->x < mx0 || bl->x > mx1 || bl->y < my0 || bl->y > my1)
+			return;
+		//What matters now is the relative x and y from the start point
+		rx = (bl->x - x0);
+		ry = (bl->y - y0);
+		//Do not hit source cell
+		if (battle_config.skill_eightpath_same_cell == 0 && rx == 0 && ry == 0)
+			return;
+		//This turns it so that the area that is hit is always with positive rx and ry
+		rx *= dx;
+		ry *= dy;
+		//These checks only need to be done for diagonal paths
+		if( direction_diagonal( (directions)dir ) ){
+			//Check for length
+			if ((rx + ry < offset) || (rx + ry > 2 * (length + (offset/2) - 1)))
+				return;
+			//Check for width
+			if (abs(rx - ry) > 2 * range)
+				return;
 		}
-	}
-	if (type&BL_MOB) {
-		for (by = my0 / BLOCK_SIZE; by <= my1 / BLOCK_SIZE; by++) {
-			for (bx = mx0 / BLOCK_SIZE; bx <= mx1 / BLOCK_SIZE; bx++) {
-				for (bl = mapdata->block_mob[bx + by * mapdata->bxs]; bl != nullptr; bl = bl->next) {
-					if (bl->prev && bl_list_count < BL_LIST_MAX) {
-						//Check if inside search area
-						if (bl->x < mx0 || bl->x > mx1 || bl->y < my0 || bl->y > my1)
-							continue;
-						//What matters now is the relative x and y from the start point
-						rx = (bl->x - x0);
-						ry = (bl->y - y0);
-						//Do not hit source cell
-						if (battle_config.skill_eightpath_same_cell == 0 && rx == 0 && ry == 0)
-							continue;
-						//This turns it so that the area that is hit is always with positive rx and ry
-						rx *= dx;
-						ry *= dy;
-						//These checks only need to be done for diagonal paths
-						if( direction_diagonal( (directions)dir ) ){
-							//Check for length
-							if ((rx + ry < offset) || (rx + ry > 2 * (length + (offset / 2) - 1)))
-								continue;
-							//Check for width
-							if (abs(rx - ry) > 2 * range)
-								continue;
-						}
-						//Everything else ok, check for line of sight from source
-						if (!path_search_long(nullptr, m, x0, y0, bl->x, bl->y, CELL_CHKWALL))
-							continue;
-						//All checks passed, add to list
-						bl_list[bl_list_count++] = bl;
-					}
-				}
-			}
-		}
-	}
+		//Everything else ok, check for line of sight from source
+		if (!path_search_long(nullptr, m, x0, y0, bl->x, bl->y, CELL_CHKWALL))
+			return;
+		//All checks passed, add to list
+		bl_list[bl_list_count++] = bl;
+	});
 
 	if( bl_list_count >= BL_LIST_MAX )
 		ShowWarning("map_foreachindir: block count too many!\n");
@@ -1609,9 +1335,7 @@ int32 map_foreachindir(int32 (*func)(block_list*, va_list), int16 m, int16 x0, i
 // Copy of map_foreachincell, but applied to the whole map. [Skotlex]
 int32 map_foreachinmap(int32 (*func)(block_list*,va_list), int16 m, int32 type,...)
 {
-	int32 b, bsize;
 	int32 returnCount = 0;  //total sum of returned values of func() [Skotlex]
-	block_list *bl;
 	int32 blockcount = bl_list_count, i;
 	struct map_data *mapdata = map_getmapdata(m);
 	va_list ap;
@@ -1620,19 +1344,10 @@ int32 map_foreachinmap(int32 (*func)(block_list*,va_list), int16 m, int32 type,.
 		return 0;
 	}
 
-	bsize = mapdata->bxs * mapdata->bys;
-
-	if( type&~BL_MOB )
-		for( b = 0; b < bsize; b++ )
-			for( bl = mapdata->block[ b ]; bl != nullptr; bl = bl->next )
-				if( bl->type&type && bl_list_count < BL_LIST_MAX )
-					bl_list[ bl_list_count++ ] = bl;
-
-	if( type&BL_MOB )
-		for( b = 0; b < bsize; b++ )
-			for( bl = mapdata->block_mob[ b ]; bl != nullptr; bl = bl->next )
-				if( bl_list_count < BL_LIST_MAX )
-					bl_list[ bl_list_count++ ] = bl;
+	map_foreachblock(mapdata, 0, 0, mapdata->xs - 1, mapdata->ys - 1, type, [&](block_list *bl) {
+		if( bl_list_count < BL_LIST_MAX )
+			bl_list[ bl_list_count++ ] = bl;
+	});
 
 	if( bl_list_count >= BL_LIST_MAX )
 		ShowWarning("map_foreachinmap: block count too many!\n");
@@ -1657,30 +1372,31 @@ int32 map_foreachinmap(int32 (*func)(block_list*,va_list), int16 m, int32 type,.
 /// @return The new object id
 int32 map_get_new_object_id(void)
 {
-	static int32 last_object_id = MIN_FLOORITEM - 1;
-	int32 i;
-
-	// find a free id
-	i = last_object_id + 1;
-	while( i != last_object_id ) {
-		if( i == MAX_FLOORITEM )
-			i = MIN_FLOORITEM;
-
-		if( !idb_exists(id_db, i) )
-			break;
+	int32 id = map_object_ids.acquire();
 
-		++i;
-	}
-
-	if( i == last_object_id ) {
+	if( id == 0 )
 		ShowError("map_addobject: no free object id!\n");
-		return 0;
-	}
 
-	// update cursor
-	last_object_id = i;
+	return id;
+}
 
-	return i;
+/// Generates a new id from the interval [START_NPC_NUM, INT32_MAX).
+/// Used for npcs, mobs, pets, homunculi, mercenaries and elementals.
+/// @return The new id or 0 if all ids are in use
+int32 map_get_new_npc_id(void)
+{
+	return map_npc_ids.acquire();
+}
+
+/// Returns the directory of the ids handed out by the map server,
+/// nullptr for account ids.
+static IdDirectory<block_list>* map_id_directory(int32 id)
+{
+	if( id >= START_NPC_NUM )
+		return &map_npc_ids;
+	if( id < MAX_FLOORITEM )
+		return &map_object_ids;
+	return nullptr;
 }
 
 /*==========================================
@@ -2197,6 +1913,11 @@ void map_addiddb(block_list *bl)
 		idb_put(regen_db, bl->id, bl);
 
 	idb_put(id_db,bl->id,bl);
+
+	IdDirectory<block_list>* ids = map_id_directory(bl->id);
+
+	if( ids != nullptr && !ids->set(bl->id, bl) )
+		ShowWarning("map_addiddb: id %d of bl type %d was not handed out by the map server.\n", bl->id, bl->type);
 }
 
 /*==========================================
@@ -2222,6 +1943,12 @@ void map_deliddb(block_list *bl)
 		idb_remove(regen_db,bl->id);
 
 	idb_remove(id_db,bl->id);
+
+	// The id can be handed out again, lookups of the old id fail from now on
+	IdDirectory<block_list>* ids = map_id_directory(bl->id);
+
+	if( ids != nullptr )
+		ids->release(bl->id);
 }
 
 /*==========================================
@@ -2349,8 +2076,9 @@ map_session_data * map_id2sd(int32 id){
 }
 
 mob_data * map_id2md(int32 id){
-	if (id <= 0) return nullptr;
-	return (mob_data*)idb_get(mobid_db,id);
+	if (id < START_NPC_NUM) return nullptr;
+	block_list* bl = map_npc_ids.find(id);
+	return BL_CAST(BL_MOB, bl);
 }
 
 npc_data * map_id2nd(int32 id){
@@ -2463,6 +2191,10 @@ map_session_data * map_nick2sd(const char *nick, bool allow_partial)
  * Looksup id_db DBMap and returns BL pointer of 'id' or nullptr if not found
  *------------------------------------------*/
 block_list * map_id2bl(int32 id) {
+	if( id >= START_NPC_NUM )
+		return map_npc_ids.find(id);
+	if( id < MAX_FLOORITEM )
+		return map_object_ids.find(id);
 	return (block_list*)idb_get(id_db,id);
 }
 
@@ -2470,7 +2202,7 @@ block_list * map_id2bl(int32 id) {
  * Same as map_id2bl except it only checks for its existence
  **/
 bool map_blid_exists( int32 id ) {
-	return (idb_exists(id_db,id));
+	return map_id2bl(id) != nullptr;
 }
 
 /*==========================================
@@ -2818,7 +2550,7 @@ bool map_addnpc(int16 m,npc_data *nd)
 		}
 	}
 	mapdata->npc_num++;
-	idb_put(id_db,nd->id,nd);
+	map_addiddb(nd);
 	return true;
 }
 
@@ -2877,15 +2609,14 @@ int32 map_addinstancemap(int32 src_m, int32 instance_id, bool no_mapflag)
 	dst_map->npc_num_warp = 0;
 
 	// Reallocate cells
-	size_t num_cell = dst_map->xs * dst_map->ys;
-
-	CREATE( dst_map->cell, struct mapcell, num_cell );
-	memcpy( dst_map->cell, src_map->cell, num_cell * sizeof(struct mapcell) );
+	dst_map->cell = new CellGrid( *src_map->cell );
 
 	size_t size = dst_map->bxs * dst_map->bys * sizeof(block_list*);
 
 	dst_map->block = (block_list **)aCalloc(1,size);
+	dst_map->block_pc = (block_list **)aCalloc(1,size);
 	dst_map->block_mob = (block_list **)aCalloc(1,size);
+	dst_map->interest.init(dst_map->bxs, dst_map->bys, map_interest_blocks);
 
 	dst_map->index = mapindex_addmap(-1, dst_map->name);
 	dst_map->channel = nullptr;
@@ -2967,15 +2698,19 @@ int32 map_delinstancemap(int32 m)
 	mapdata->mob_delete_timer = INVALID_TIMER;
 
 	// Free memory
-	if (mapdata->cell)
-		aFree(mapdata->cell);
+	delete mapdata->cell;
 	mapdata->cell = nullptr;
 	if (mapdata->block)
 		aFree(mapdata->block);
 	mapdata->block = nullptr;
+	if (mapdata->block_pc)
+		aFree(mapdata->block_pc);
+	mapdata->block_pc = nullptr;
 	if (mapdata->block_mob)
 		aFree(mapdata->block_mob);
 	mapdata->block_mob = nullptr;
+	mapdata->interest.clear();
+	mapdata->paths.clear();
 
 	map_free_questinfo(mapdata);
 	mapdata->damage_adjust = {};
@@ -3062,24 +2797,27 @@ int32 map_removemobs_sub(block_list *bl, va_list ap)
 }
 
 /**
- * AI Dialogue Response Timer
- * Checks response queue and sends AI responses to players
- * Called every 100ms
+ * Deliver all queued AI dialogue responses to players
+ * Drains the lock-free response queue in one go so the map thread never waits on a worker.
  */
-TIMER_FUNC(ai_dialogue_check_responses){
-	if (!ai_dialogue_enabled || !ai_dialogue_queue || !ai_dialogue_state) {
-		return 0;
-	}
+static void ai_dialogue_deliver_responses(void) {
+	static std::vector<AIDialogueResponse> responses;
 
-	// Process all available responses
-	while (true) {
-		AIDialogueResponse resp;
-		if (!ai_dialogue_queue->pop_response(resp)) {
-			break; // No more responses
-		}
+	responses.clear();
+	ai_dialogue_queue->drain_responses(responses);
 
+	for (const AIDialogueResponse& resp : responses) {
 		// Find player
 		map_session_data* sd = map_charid2sd(resp.char_id);
+
+		// Streamed segment, show it right away and keep the dialog open
+		if (resp.partial) {
+			if (sd) {
+				clif_scriptmes(*sd, resp.npc_id, resp.npc_response.c_str());
+			}
+			continue;
+		}
+
 		if (!sd) {
 			ShowDebug("AI Dialogue: Response for offline player (char_id=%u)\n", resp.char_id);
 			ai_dialogue_state->mark_request_completed(resp.char_id);
@@ -3090,8 +2828,10 @@ TIMER_FUNC(ai_dialogue_check_responses){
 		ai_dialogue_state->mark_request_completed(resp.char_id);
 
 		if (resp.success) {
-			// Display AI response
-			clif_scriptmes(*sd, resp.npc_id, resp.npc_response.c_str());
+			// Display AI response (empty if it was fully streamed already)
+			if (!resp.npc_response.empty()) {
+				clif_scriptmes(*sd, resp.npc_id, resp.npc_response.c_str());
+			}
 			clif_scriptclose(*sd, resp.npc_id);
 
 			t_tick latency = resp.response_time - resp.request_time;
@@ -3107,15 +2847,67 @@ TIMER_FUNC(ai_dialogue_check_responses){
 			            resp.char_id, resp.error_message.c_str());
 		}
 	}
+}
+
+/**
+ * Drop queued AI dialogue requests nobody is waiting for anymore
+ * Requests of players that went offline are discarded silently, players that waited
+ * longer than the queue allows are told to try again.
+ */
+static void ai_dialogue_purge_requests(void) {
+	static std::vector<AIDialogueRequest> dropped;
 
-	// Periodic cleanup of old player states (every 5 minutes)
-	static t_tick last_cleanup = 0;
-	t_tick current_time = gettick();
-	if (current_time - last_cleanup > 300000) { // 5 minutes
-		ai_dialogue_state->cleanup_old_states();
-		last_cleanup = current_time;
+	dropped.clear();
+	ai_dialogue_queue->purge_requests([](const AIDialogueRequest& req) { return map_charid2sd(req.char_id) == nullptr; }, dropped);
+
+	for (const AIDialogueRequest& req : dropped) {
+		ai_dialogue_state->mark_request_completed(req.char_id);
+
+		map_session_data* sd = map_charid2sd(req.char_id);
+		if (!sd) {
+			continue;
+		}
+
+		clif_scriptmes(*sd, req.npc_id, "I'm a bit overwhelmed right now. Please try again in a moment.");
+		clif_scriptclose(*sd, req.npc_id);
+
+		ShowWarning("AI Dialogue: Request from char_id=%u expired in queue\n", req.char_id);
+	}
+}
+
+/**
+ * AI Dialogue wakeup event
+ * Signaled by the worker threads, so responses are delivered on the next socket loop iteration
+ */
+static int32 ai_dialogue_wakeup_recv(int32 fd) {
+	wakeup_event_consume(fd);
+
+	if (ai_dialogue_enabled && ai_dialogue_queue && ai_dialogue_state) {
+		ai_dialogue_deliver_responses();
+	}
+
+	return 0;
+}
+
+/**
+ * AI Dialogue Response Timer
+ * Fallback delivery for platforms without a wakeup event, and periodic state cleanup
+ * Called every 100ms (every second if the wakeup event is available)
+ */
+TIMER_FUNC(ai_dialogue_check_responses){
+	if (!ai_dialogue_enabled || !ai_dialogue_queue || !ai_dialogue_state) {
+		return 0;
 	}
 
+	// Process all available responses
+	ai_dialogue_deliver_responses();
+
+	// Drop requests of players who left or waited too long
+	ai_dialogue_purge_requests();
+
+	// Incremental cleanup of old player states, one shard at a time
+	ai_dialogue_state->cleanup_old_states();
+
 	return 0;
 }
 
@@ -3344,33 +3136,37 @@ int32 map_random_dir(block_list *bl, int16 *x, int16 *y)
 }
 
 // gat system
-inline static struct mapcell map_gat2cell(int32 gat) {
-	struct mapcell cell;
-
-	memset(&cell,0,sizeof(struct mapcell));
+static void map_setgat(CellGrid& cells, int16 x, int16 y, int32 gat) {
+	bool walkable = false, shootable = false, water = false;
 
 	switch( gat ) {
-		case 0: cell.walkable = 1; cell.shootable = 1; cell.water = 0; break; // walkable ground
-		case 1: cell.walkable = 0; cell.shootable = 0; cell.water = 0; break; // non-walkable ground
-		case 2: cell.walkable = 1; cell.shootable = 1; cell.water = 0; break; // ???
-		case 3: cell.walkable = 1; cell.shootable = 1; cell.water = 1; break; // walkable water
-		case 4: cell.walkable = 1; cell.shootable = 1; cell.water = 0; break; // ???
-		case 5: cell.walkable = 0; cell.shootable = 1; cell.water = 0; break; // gap (snipable)
-		case 6: cell.walkable = 1; cell.shootable = 1; cell.water = 0; break; // ???
+		case 0: walkable = true; shootable = true; water = false; break; // walkable ground
+		case 1: walkable = false; shootable = false; water = false; break; // non-walkable ground
+		case 2: walkable = true; shootable = true; water = false; break; // ???
+		case 3: walkable = true; shootable = true; water = true; break; // walkable water
+		case 4: walkable = true; shootable = true; water = false; break; // ???
+		case 5: walkable = false; shootable = true; water = false; break; // gap (snipable)
+		case 6: walkable = true; shootable = true; water = false; break; // ???
 		default:
-			ShowWarning("map_gat2cell: unrecognized gat type '%d'\n", gat);
+			ShowWarning("map_setgat: unrecognized gat type '%d'\n", gat);
 			break;
 	}
 
-	return cell;
+	cells.set(CELL_WALKABLE, x, y, walkable);
+	cells.set(CELL_SHOOTABLE, x, y, shootable);
+	cells.set(CELL_WATER, x, y, water);
 }
 
-static int32 map_cell2gat(struct mapcell cell)
+static int32 map_cell2gat(const CellGrid& cells, int16 x, int16 y)
 {
-	if( cell.walkable == 1 && cell.shootable == 1 && cell.water == 0 ) return 0;
-	if( cell.walkable == 0 && cell.shootable == 0 && cell.water == 0 ) return 1;
-	if( cell.walkable == 1 && cell.shootable == 1 && cell.water == 1 ) return 3;
-	if( cell.walkable == 0 && cell.shootable == 1 && cell.water == 0 ) return 5;
+	bool walkable = cells.get(CELL_WALKABLE, x, y);
+	bool shootable = cells.get(CELL_SHOOTABLE, x, y);
+	bool water = cells.get(CELL_WATER, x, y);
+
+	if( walkable && shootable && !water ) return 0;
+	if( !walkable && !shootable && !water ) return 1;
+	if( walkable && shootable && water ) return 3;
+	if( !walkable && shootable && !water ) return 5;
 
 	ShowWarning("map_cell2gat: cell has no matching gat type\n");
 	return 1; // default to 'wall'
@@ -3389,69 +3185,67 @@ int32 map_getcell(int16 m,int16 x,int16 y,cell_chk cellchk)
 
 int32 map_getcellp(struct map_data* m,int16 x,int16 y,cell_chk cellchk)
 {
-	struct mapcell cell;
-
 	nullpo_ret(m);
 
 	//NOTE: this intentionally overrides the last row and column
 	if(x<0 || x>=m->xs-1 || y<0 || y>=m->ys-1)
 		return( cellchk == CELL_CHKNOPASS );
 
-	cell = m->cell[x + y*m->xs];
+	const CellGrid& cells = *m->cell;
 
 	switch(cellchk)
 	{
 		// gat type retrieval
 		case CELL_GETTYPE:
-			return map_cell2gat(cell);
+			return map_cell2gat(cells, x, y);
 
 		// base gat type checks
 		case CELL_CHKWALL:
-			return (!cell.walkable && !cell.shootable);
+			return (!cells.get(CELL_WALKABLE, x, y) && !cells.get(CELL_SHOOTABLE, x, y));
 
 		case CELL_CHKWATER:
-			return (cell.water);
+			return (cells.get(CELL_WATER, x, y));
 
 		case CELL_CHKCLIFF:
-			return (!cell.walkable && cell.shootable);
+			return (!cells.get(CELL_WALKABLE, x, y) && cells.get(CELL_SHOOTABLE, x, y));
 
 
 		// base cell type checks
 		case CELL_CHKNPC:
-			return (cell.npc);
+			return (cells.get(CELL_NPC, x, y));
 		case CELL_CHKBASILICA:
-			return (cell.basilica);
+			return (cells.get(CELL_BASILICA, x, y));
 		case CELL_CHKLANDPROTECTOR:
-			return (cell.landprotector);
+			return (cells.get(CELL_LANDPROTECTOR, x, y));
 		case CELL_CHKNOVENDING:
-			return (cell.novending);
+			return (cells.get(CELL_NOVENDING, x, y));
 		case CELL_CHKNOBUYINGSTORE:
-			return (cell.nobuyingstore);
+			return (cells.get(CELL_NOBUYINGSTORE, x, y));
 		case CELL_CHKNOCHAT:
-			return (cell.nochat);
+			return (cells.get(CELL_NOCHAT, x, y));
 		case CELL_CHKMAELSTROM:
-			return (cell.maelstrom);
+			return (cells.get(CELL_MAELSTROM, x, y));
 		case CELL_CHKICEWALL:
-			return (cell.icewall);
+			return (cells.get(CELL_ICEWALL, x, y));
 
 		// special checks
 		case CELL_CHKPASS:
 #ifdef CELL_NOSTACK
-			if (cell.cell_bl >= battle_config.custom_cell_stack_limit) return 0;
+			if (cells.stack(x, y) >= battle_config.custom_cell_stack_limit) return 0;
 #endif
 		case CELL_CHKREACH:
-			return (cell.walkable);
+			return (cells.get(CELL_WALKABLE, x, y));
 
 		case CELL_CHKNOPASS:
 #ifdef CELL_NOSTACK
-			if (cell.cell_bl >= battle_config.custom_cell_stack_limit) return 1;
+			if (cells.stack(x, y) >= battle_config.custom_cell_stack_limit) return 1;
 #endif
 		case CELL_CHKNOREACH:
-			return (!cell.walkable);
+			return (!cells.get(CELL_WALKABLE, x, y));
 
 		case CELL_CHKSTACK:
 #ifdef CELL_NOSTACK
-			return (cell.cell_bl >= battle_config.custom_cell_stack_limit);
+			return (cells.stack(x, y) >= battle_config.custom_cell_stack_limit);
 #else
 			return 0;
 #endif
@@ -3468,48 +3262,27 @@ int32 map_getcellp(struct map_data* m,int16 x,int16 y,cell_chk cellchk)
  *------------------------------------------*/
 void map_setcell(int16 m, int16 x, int16 y, cell_t cell, bool flag)
 {
-	int32 j;
 	struct map_data *mapdata = map_getmapdata(m);
 
 	if( m < 0 || x < 0 || x >= mapdata->xs || y < 0 || y >= mapdata->ys )
 		return;
 
-	j = x + y*mapdata->xs;
-
-	switch( cell ) {
-		case CELL_WALKABLE:      mapdata->cell[j].walkable = flag;      break;
-		case CELL_SHOOTABLE:     mapdata->cell[j].shootable = flag;     break;
-		case CELL_WATER:         mapdata->cell[j].water = flag;         break;
-
-		case CELL_NPC:           mapdata->cell[j].npc = flag;           break;
-		case CELL_BASILICA:      mapdata->cell[j].basilica = flag;      break;
-		case CELL_LANDPROTECTOR: mapdata->cell[j].landprotector = flag; break;
-		case CELL_NOVENDING:     mapdata->cell[j].novending = flag;     break;
-		case CELL_NOCHAT:        mapdata->cell[j].nochat = flag;        break;
-		case CELL_MAELSTROM:	 mapdata->cell[j].maelstrom = flag;	  break;
-		case CELL_ICEWALL:		 mapdata->cell[j].icewall = flag;		  break;
-		case CELL_NOBUYINGSTORE: mapdata->cell[j].nobuyingstore = flag; break;
-		default:
-			ShowWarning("map_setcell: invalid cell type '%d'\n", (int32)cell);
-			break;
+	if( cell < CELL_WALKABLE || cell >= CELL_MAX ){
+		ShowWarning("map_setcell: invalid cell type '%d'\n", (int32)cell);
+		return;
 	}
+
+	mapdata->cell->set(cell, x, y, flag);
 }
 
 void map_setgatcell(int16 m, int16 x, int16 y, int32 gat)
 {
-	int32 j;
-	struct mapcell cell;
 	struct map_data *mapdata = map_getmapdata(m);
 
 	if( m < 0 || x < 0 || x >= mapdata->xs || y < 0 || y >= mapdata->ys )
 		return;
 
-	j = x + y*mapdata->xs;
-
-	cell = map_gat2cell(gat);
-	mapdata->cell[j].walkable = cell.walkable;
-	mapdata->cell[j].shootable = cell.shootable;
-	mapdata->cell[j].water = cell.water;
+	map_setgat(*mapdata->cell, x, y, gat);
 }
 
 /*==========================================
@@ -3771,11 +3544,10 @@ int32 map_readfromcache(struct map_data *m, char *buffer, char *decode_buffer)
 		// TO-DO: Maybe handle the scenario, if the decoded buffer isn't the same size as expected? [Shinryo]
 		decode_zip(decode_buffer, &size, p+sizeof(struct map_cache_map_info), info->len);
 
-		CREATE(m->cell, struct mapcell, size);
-
+		m->cell = new CellGrid(m->xs, m->ys);
 
 		for( xy = 0; xy < size; ++xy )
-			m->cell[xy] = map_gat2cell(decode_buffer[xy]);
+			map_setgat(*m->cell, xy % m->xs, xy / m->xs, decode_buffer[xy]);
 
 		return 1;
 	}
@@ -3935,7 +3707,7 @@ int32 map_readgat (struct map_data* m)
 	m->xs = *(int32*)(gat+6);
 	m->ys = *(int32*)(gat+10);
 	num_cells = m->xs * m->ys;
-	CREATE(m->cell, struct mapcell, num_cells);
+	m->cell = new CellGrid(m->xs, m->ys);
 
 	water_height = map_waterheight(m->name);
 
@@ -3951,7 +3723,7 @@ int32 map_readgat (struct map_data* m)
 		if( type == 0 && water_height != RSW_NO_WATER && height > water_height )
 			type = 3; // Cell is 0 (walkable) but under water level, set to 3 (walkable water)
 
-		m->cell[xy] = map_gat2cell(type);
+		map_setgat(*m->cell, xy % m->xs, xy / m->xs, type);
 	}
 
 	aFree(gat);
@@ -4012,6 +3784,7 @@ int32 map_readallmaps (void)
 	}
 
 	int32 maps_removed = 0;
+	size_t cell_memory = 0;
 
 	ShowStatus("Loading %d maps.\n", map_num);
 
@@ -4050,10 +3823,8 @@ int32 map_readallmaps (void)
 
 		if (uidb_get(map_db,(uint32)mapdata->index) != nullptr) {
 			ShowWarning("Map %s already loaded!" CL_CLL "\n", mapdata->name);
-			if (mapdata->cell) {
-				aFree(mapdata->cell);
-				mapdata->cell = nullptr;
-			}
+			delete mapdata->cell;
+			mapdata->cell = nullptr;
 			map_delmapid(i);
 			maps_removed++;
 			i--;
@@ -4071,7 +3842,10 @@ int32 map_readallmaps (void)
 
 		size = mapdata->bxs * mapdata->bys * sizeof(block_list*);
 		mapdata->block = (block_list**)aCalloc(size, 1);
+		mapdata->block_pc = (block_list**)aCalloc(size, 1);
 		mapdata->block_mob = (block_list**)aCalloc(size, 1);
+		mapdata->interest.init(mapdata->bxs, mapdata->bys, map_interest_blocks);
+		cell_memory += mapdata->cell->memory();
 
 		memset(&mapdata->save, 0, sizeof(struct point));
 		mapdata->damage_adjust = {};
@@ -4096,6 +3870,7 @@ int32 map_readallmaps (void)
 
 	// finished map loading
 	ShowInfo("Successfully loaded '" CL_WHITE "%d" CL_RESET "' maps." CL_CLL "\n",map_num);
+	ShowInfo("Cell flags of all maps use '" CL_WHITE "%zu" CL_RESET "' KB.\n", cell_memory / 1024);
 
 	return 0;
 }
@@ -4175,6 +3950,40 @@ int32 parse_console(const char* buf){
 	return 0;
 }
 
+/// Appends the timer and packet profile of the last interval to profiler_log_filepath
+static TIMER_FUNC(map_profiler_dump_timer){
+	if (profiler_enabled)
+		profiler_dump(profiler_log_filepath, true);
+
+	return 0;
+}
+
+/// Writes the map server values for the metrics endpoint
+static void map_metrics(MetricsWriter& writer){
+	writer.gauge("rathena_map_players", "Players that are online on this map server.", (double)map_getusers());
+	writer.gauge("rathena_map_objects", "Objects with an id, like players, monsters and NPCs.", (double)db_size(id_db));
+	writer.gauge("rathena_map_mobs", "Spawned monsters.", (double)db_size(mobid_db));
+
+	writer.family("rathena_map_cell_bytes", "gauge", "Memory used by the cell flags of each map.");
+
+	for (int32 m = 0; m < map_num; m++) {
+		struct map_data *mapdata = map_getmapdata(m);
+		char labels[MAP_NAME_LENGTH + 16];
+
+		if (mapdata->cell == nullptr)
+			continue;
+
+		snprintf(labels, sizeof(labels), "map=\"%s\"", mapdata->name);
+		writer.sample("rathena_map_cell_bytes", labels, (uint64)mapdata->cell->memory());
+	}
+
+	uint64 path_hits, path_misses;
+
+	path_cache_usage(&path_hits, &path_misses);
+	writer.counter("rathena_path_cache_hits_total", "Walk path searches that were answered by the path cache.", path_hits);
+	writer.counter("rathena_path_cache_misses_total", "Walk path searches that had to run A*.", path_misses);
+}
+
 /*==========================================
  * Read map server configuration files (conf/map_athena.conf...)
  *------------------------------------------*/
@@ -4270,6 +4079,24 @@ int32 map_config_read(const char *cfgName)
 			console_msg_log = atoi(w2);//[Ind]
 		else if (strcmpi(w1, "console_log_filepath") == 0)
 			safestrncpy(console_log_filepath, w2, sizeof(console_log_filepath));
+		else if (strcmpi(w1, "profiler") == 0)
+			profiler_enable(config_switch(w2) != 0);
+		else if (strcmpi(w1, "profiler_dump_interval") == 0)
+			profiler_dump_interval = max(atoi(w2), 0);
+		else if (strcmpi(w1, "profiler_log_filepath") == 0)
+			safestrncpy(profiler_log_filepath, w2, sizeof(profiler_log_filepath));
+		else if (strcmpi(w1, "tick_watchdog_threshold") == 0)
+			tick_watchdog_threshold = max(atoi(w2), 0);
+		else if (strcmpi(w1, "tick_watchdog_history") == 0)
+			tick_watchdog_history = cap_value(atoi(w2), 1, 10000);
+		else if (strcmpi(w1, "tick_watchdog_log_filepath") == 0)
+			safestrncpy(tick_watchdog_log_filepath, w2, sizeof(tick_watchdog_log_filepath));
+		else if (strcmpi(w1, "metrics_port") == 0)
+			metrics_port = (uint16)cap_value(atoi(w2), 0, UINT16_MAX);
+		else if (strcmpi(w1, "metrics_ip") == 0)
+			safestrncpy(metrics_ip, w2, sizeof(metrics_ip));
+		else if (strcmpi(w1, "ai_dialogue_max_requests_per_account") == 0)
+			ai_dialogue_max_requests_per_account = max(atoi(w2), 0);
 		else if (strcmpi(w1, "import") == 0)
 			map_config_read(w2);
 		else
@@ -5077,10 +4904,23 @@ void MapServer::finalize(){
 	ShowStatus("Terminating...\n");
 	channel_config.closing = true;
 
+	metrics_server_stop();
+	metrics_final();
+
 	// Shutdown AI Dialogue System first
 	if (ai_dialogue_enabled && ai_dialogue_worker) {
 		ShowStatus("Shutting down AI Dialogue System...\n");
 		ai_dialogue_worker->stop();
+		ShowStatus("AI Dialogue System: %" PRIu64 " requests queued, %" PRIu64 " rejected, %" PRIu64 " expired\n",
+			ai_dialogue_queue->get_total_requests_queued(), ai_dialogue_queue->get_total_requests_dropped(),
+			ai_dialogue_queue->get_total_requests_expired());
+		ShowStatus("AI Dialogue System: %" PRIu64 " cache hits, %" PRIu64 " misses, %" PRIu64 " invalidated\n",
+			ai_dialogue_worker->get_total_cache_hits(), ai_dialogue_worker->get_total_cache_misses(),
+			ai_dialogue_worker->get_total_cache_invalidations());
+		ShowStatus("AI Dialogue System: %" PRIu64 " requests, %" PRIu64 " connections opened, %" PRIu64 " reused, %" PRIu64 " evicted, %" PRIu64 " failed\n",
+			ai_dialogue_worker->get_total_requests_processed(), ai_dialogue_worker->get_total_connections_opened(),
+			ai_dialogue_worker->get_total_connections_reused(), ai_dialogue_worker->get_total_connections_evicted(),
+			ai_dialogue_worker->get_total_connections_failed());
 		delete ai_dialogue_worker;
 		ai_dialogue_worker = nullptr;
 
@@ -5090,6 +4930,11 @@ void MapServer::finalize(){
 		delete ai_dialogue_queue;
 		ai_dialogue_queue = nullptr;
 
+		if (ai_dialogue_wakeup_fd >= 0) {
+			do_close(ai_dialogue_wakeup_fd);
+			ai_dialogue_wakeup_fd = -1;
+		}
+
 		ShowStatus("AI Dialogue System: Shutdown complete\n");
 	}
 
@@ -5161,9 +5006,12 @@ void MapServer::finalize(){
 	for (int32 i = 0; i < map_num; i++) {
 		struct map_data *mapdata = map_getmapdata(i);
 
-		if(mapdata->cell) aFree(mapdata->cell);
+		delete mapdata->cell;
 		if(mapdata->block) aFree(mapdata->block);
+		if(mapdata->block_pc) aFree(mapdata->block_pc);
 		if(mapdata->block_mob) aFree(mapdata->block_mob);
+		mapdata->interest.clear();
+		mapdata->paths.clear();
 		if(battle_config.dynamic_mobs) { //Dynamic mobs flag by [random]
 			if(mapdata->mob_delete_timer != INVALID_TIMER)
 				delete_timer(mapdata->mob_delete_timer, map_removemobs_timer);
@@ -5438,6 +5286,7 @@ bool MapServer::initialize( int32 argc, char *argv[] ){
 	cli_get_options(argc,argv);
 
 	map_config_read(MAP_CONF_NAME);
+	watchdog_init(tick_watchdog_threshold, tick_watchdog_history, tick_watchdog_log_filepath);
 
 	if (save_settings == CHARSAVE_NONE)
 		ShowWarning("Value of 'save_settings' is not set, player's data only will be saved every 'autosave_time' (%d seconds).\n", autosave_interval/1000);
@@ -5496,13 +5345,27 @@ bool MapServer::initialize( int32 argc, char *argv[] ){
 	add_timer_func_list(map_clearflooritem_timer, "map_clearflooritem_timer");
 	add_timer_func_list(map_removemobs_timer, "map_removemobs_timer");
 	add_timer_func_list(ai_dialogue_check_responses, "ai_dialogue_check_responses");
+	add_timer_func_list(map_profiler_dump_timer, "map_profiler_dump_timer");
+
+	if (profiler_dump_interval > 0)
+		add_timer_interval(gettick() + profiler_dump_interval * 1000, map_profiler_dump_timer, 0, 0, profiler_dump_interval * 1000);
 
 	// Initialize AI Dialogue System
 	if (ai_dialogue_enabled) {
 		ShowStatus("Initializing AI Dialogue System...\n");
 
+		// Create queue configuration
+		AIDialogueQueueConfig queue_config;
+		queue_config.max_requests = 1000;
+		queue_config.max_requests_per_npc = 100; // One popular NPC may not fill the whole queue
+		queue_config.max_requests_per_account = ai_dialogue_max_requests_per_account;
+		queue_config.max_wait_ms = 20000; // 20 seconds
+		queue_config.priority_weights[AI_DIALOGUE_PRIORITY_AMBIENT] = 1;
+		queue_config.priority_weights[AI_DIALOGUE_PRIORITY_NORMAL] = 2;
+		queue_config.priority_weights[AI_DIALOGUE_PRIORITY_CRITICAL] = 4;
+
 		// Create queue
-		ai_dialogue_queue = new AIDialogueQueue();
+		ai_dialogue_queue = new AIDialogueQueue(queue_config);
 
 		// Create state manager
 		ai_dialogue_state = new AIDialogueStateManager();
@@ -5518,13 +5381,28 @@ bool MapServer::initialize( int32 argc, char *argv[] ){
 		worker_config.max_retries = 2;
 		worker_config.retry_delay_ms = 1000; // 1 second
 		worker_config.debug_logging = false;
+		worker_config.connect_timeout_ms = 5000; // 5 seconds
+		worker_config.pool_max_idle_connections = 8; // 2 per worker thread
+		worker_config.pool_idle_timeout_ms = 30000; // 30 seconds
+		worker_config.pool_max_requests_per_connection = 1000;
+		worker_config.batch_max_requests = 0; // Set to e.g. 16 to batch bridge calls
+		worker_config.batch_wait_ms = 20;
+		worker_config.cache_max_bytes = 8 * 1024 * 1024; // 8MB, NPCs opt in through ai_chat_start
+		worker_config.cache_version_poll_ms = 5000; // 5 seconds
+		worker_config.stream_responses = false; // Set to true if the AI service supports /ai/chat/stream
+		worker_config.stream_segment_chars = 40;
+
+		// Deliver responses as soon as a worker queues them
+		ai_dialogue_wakeup_fd = make_wakeup_event(ai_dialogue_wakeup_recv);
+		ai_dialogue_queue->set_response_wakeup(ai_dialogue_wakeup_fd);
 
 		// Create and start worker
 		ai_dialogue_worker = new AIDialogueWorker(ai_dialogue_queue, worker_config);
 		ai_dialogue_worker->start();
 
-		// Start response check timer (every 100ms)
-		add_timer_interval(gettick() + 100, ai_dialogue_check_responses, 0, 0, 100);
+		// Start response check timer (every 100ms, or every second as a fallback to the wakeup event)
+		int32 check_interval = (ai_dialogue_wakeup_fd >= 0) ? 1000 : 100;
+		add_timer_interval(gettick() + check_interval, ai_dialogue_check_responses, 0, 0, check_interval);
 
 		ShowStatus("AI Dialogue System: Initialized successfully\n");
 	}
@@ -5565,6 +5443,12 @@ bool MapServer::initialize( int32 argc, char *argv[] ){
 
 	npc_event_do_oninit();	// Init npcs (OnInit)
 
+	if (metrics_port > 0) {
+		metrics_add_collector(map_metrics);
+		metrics_init();
+		metrics_server_start(metrics_ip, metrics_port);
+	}
+
 	if (battle_config.pk_mode)
 		ShowNotice("Server is running on '" CL_WHITE "PK Mode" CL_RESET "'.\n");
 
@@ -17,10 +17,14 @@
 #include <common/mapindex.hpp>
 #include <common/mmo.hpp>
 #include <common/msg_conf.hpp>
+#include <common/small_vector.hpp>
 #include <common/timer.hpp>
 #include <config/core.hpp>
 
+#include "cell_grid.hpp"
+#include "interest_grid.hpp"
 #include "navi.hpp"
+#include "path_cache.hpp"
 #include "script.hpp"
 #include "path.hpp"
 
@@ -743,22 +747,6 @@ union u_mapflag_args {
 	int32 flag_val;
 };
 
-// used by map_setcell()
-enum cell_t{
-	CELL_WALKABLE,
-	CELL_SHOOTABLE,
-	CELL_WATER,
-
-	CELL_NPC,
-	CELL_BASILICA,
-	CELL_LANDPROTECTOR,
-	CELL_NOVENDING,
-	CELL_NOCHAT,
-	CELL_MAELSTROM,
-	CELL_ICEWALL,
-	CELL_NOBUYINGSTORE,
-};
-
 // used by map_getcell()
 enum cell_chk : uint8 {
 	CELL_GETTYPE,			// Retrieves a cell's 'gat' type
@@ -784,30 +772,6 @@ enum cell_chk : uint8 {
 
 };
 
-struct mapcell
-{
-	// terrain flags
-	unsigned char
-		walkable : 1,
-		shootable : 1,
-		water : 1;
-
-	// dynamic flags
-	unsigned char
-		npc : 1,
-		basilica : 1,
-		landprotector : 1,
-		novending : 1,
-		nochat : 1,
-		maelstrom : 1,
-		icewall : 1,
-		nobuyingstore : 1;
-
-#ifdef CELL_NOSTACK
-	unsigned char cell_bl; //Holds amount of bls in this cell.
-#endif
-};
-
 struct iwall_data {
 	char wall_name[50];
 	int16 m, x, y, size;
@@ -818,9 +782,12 @@ struct iwall_data {
 struct map_data {
 	char name[MAP_NAME_LENGTH];
 	uint16 index; // The map index used by the mapindex* functions.
-	struct mapcell* cell; // Holds the information of each map cell (nullptr if the map is not on this map-server).
-	block_list **block;
+	CellGrid* cell; // Holds the information of each map cell (nullptr if the map is not on this map-server).
+	block_list **block; // Objects per block that are neither players nor monsters
+	block_list **block_pc;
 	block_list **block_mob;
+	InterestGrid interest; // Players that can see each block
+	PathCache paths; // Recent walk paths, see path_search
 	int16 m;
 	int16 xs,ys; // map dimensions (in cells)
 	int16 bxs,bys; // map dimensions (in blocks)
@@ -878,7 +845,7 @@ private:
 struct map_data_other_server {
 	char name[MAP_NAME_LENGTH];
 	uint16 index; //Index is the map index used by the mapindex* functions.
-	struct mapcell* cell; // If this is nullptr, the map is not on this map-server
+	CellGrid* cell; // If this is nullptr, the map is not on this map-server
 	uint32 ip;
 	uint16 port;
 };
@@ -1113,6 +1080,7 @@ private:
 extern char motd_txt[];
 extern char charhelp_txt[];
 extern char channel_conf[];
+extern char profiler_log_filepath[];
 
 extern char wisp_server_name[];
 
@@ -1146,6 +1114,7 @@ int32 map_delblock(block_list* bl);
 int32 map_moveblock(block_list *, int32, int32, t_tick);
 int32 map_foreachinrange(int32 (*func)(block_list*,va_list), block_list* center, int16 range, int32 type, ...);
 int32 map_foreachinallrange(int32 (*func)(block_list*,va_list), block_list* center, int16 range, int32 type, ...);
+void map_setinterestrange(int16 range);
 int32 map_foreachinshootrange(int32 (*func)(block_list*,va_list), block_list* center, int16 range, int32 type, ...);
 int32 map_foreachinarea(int32 (*func)(block_list*, va_list), int16 m, int16 x0, int16 y0, int16 x1, int16 y1, int32 type, ...);
 int32 map_foreachinallarea(int32 (*func)(block_list*, va_list), int16 m, int16 x0, int16 y0, int16 x1, int16 y1, int32 type, ...);
@@ -1160,8 +1129,162 @@ int32 map_foreachinmap(int32 (*func)(block_list*,va_list), int16 m, int32 type,
 //blocklist nb in one cell
 int32 map_count_oncell(int16 m,int16 x,int16 y,int32 type,int32 flag);
 skill_unit *map_find_skill_unit_oncell(block_list *,int16 x,int16 y,uint16 skill_id,skill_unit *, int32 flag);
+
+#define BLOCK_SIZE 8 // Cells per side of a block
+
+/// Objects found by a block query, most fit without reaching the heap
+typedef SmallVector<block_list*, 128> t_blocklist;
+
+/**
+ * Walks the objects of the given types in the blocks that cover an area.
+ * Every block keeps players, monsters and the other objects in lists of their
+ * own, so only the lists of the requested types are walked. The blocks are
+ * visited in the same order as when players shared the list of the other
+ * objects: block by block its players and other objects, then block by block
+ * the monsters.
+ * Within a block the players now always come before the other objects. The
+ * shared list had them in the order they entered the block, which the split
+ * lists no longer know. That order only depended on who moved last, so count
+ * limited callers (map_forcountinrange, splash caps) that stop inside a block
+ * prefer its players now instead of its latest arrival.
+ * The area must lie within the map, func checks the coordinates itself.
+ */
+template <typename Func>
+void map_foreachblock(struct map_data* mapdata, int16 x0, int16 y0, int16 x1, int16 y1, int32 type, Func&& func)
+{
+	int32 bx, by;
+	block_list *bl;
+
+	if (type&~BL_MOB)
+		for (by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++)
+			for (bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++) {
+				if (type&BL_PC)
+					for (bl = mapdata->block_pc[bx + by * mapdata->bxs]; bl != nullptr; bl = bl->next)
+						func(bl);
+
+				if (type&~(BL_PC|BL_MOB))
+					for (bl = mapdata->block[bx + by * mapdata->bxs]; bl != nullptr; bl = bl->next)
+						if (bl->type&type)
+							func(bl);
+			}
+
+	if (type&BL_MOB)
+		for (by = y0 / BLOCK_SIZE; by <= y1 / BLOCK_SIZE; by++)
+			for (bx = x0 / BLOCK_SIZE; bx <= x1 / BLOCK_SIZE; bx++)
+				for (bl = mapdata->block_mob[bx + by * mapdata->bxs]; bl != nullptr; bl = bl->next)
+					func(bl);
+}
+
+/**
+ * Collects the objects in an area, in the order map_foreachinallarea visits them.
+ * Neither uses the shared block list nor locks the blocks, so worker threads
+ * may call it while the main thread waits for them.
+ * @param out: Container the objects are appended to
+ * @param wall_check: Only objects that can be shot at from the center of the area
+ */
+template <typename Container>
+void map_getinarea(Container& out, int16 m, int16 x0, int16 y0, int16 x1, int16 y1, int32 type, bool wall_check = false)
+{
+	if (m < 0)
+		return;
+
+	if (x1 < x0)
+		std::swap(x0, x1);
+	if (y1 < y0)
+		std::swap(y0, y1);
+
+	struct map_data *mapdata = map_getmapdata(m);
+
+	if (mapdata == nullptr || mapdata->block == nullptr)
+		return;
+
+	x0 = i16max(x0, 0);
+	y0 = i16max(y0, 0);
+	x1 = i16min(x1, mapdata->xs - 1);
+	y1 = i16min(y1, mapdata->ys - 1);
+
+	int16 cx = x0 + (x1 - x0) / 2;
+	int16 cy = y0 + (y1 - y0) / 2;
+
+	map_foreachblock(mapdata, x0, y0, x1, y1, type, [&](block_list *bl) {
+		if (bl->x >= x0 && bl->x <= x1 && bl->y >= y0 && bl->y <= y1
+			&& (!wall_check || path_search_long(nullptr, m, cx, cy, bl->x, bl->y, CELL_CHKWALL)))
+			out.push_back(bl);
+	});
+}
+
+/**
+ * Collects the objects in range of center, in the order map_foreachinallrange visits them.
+ * Same rules as map_getinarea.
+ * @param wall_check: Only objects that center can shoot at
+ */
+template <typename Container>
+void map_getinrange(Container& out, block_list* center, int16 range, int32 type, bool wall_check = false)
+{
+	if (center->m < 0)
+		return;
+
+	struct map_data *mapdata = map_getmapdata(center->m);
+
+	if (mapdata == nullptr || mapdata->block == nullptr)
+		return;
+
+	int16 x0 = i16max(center->x - range, 0);
+	int16 y0 = i16max(center->y - range, 0);
+	int16 x1 = i16min(center->x + range, mapdata->xs - 1);
+	int16 y1 = i16min(center->y + range, mapdata->ys - 1);
+
+	map_foreachblock(mapdata, x0, y0, x1, y1, type, [&](block_list *bl) {
+		if (bl->x >= x0 && bl->x <= x1 && bl->y >= y0 && bl->y <= y1
+#ifdef CIRCULAR_AREA
+			&& check_distance_bl(center, bl, range)
+#endif
+			&& (!wall_check || path_search_long(nullptr, center->m, center->x, center->y, bl->x, bl->y, CELL_CHKWALL)))
+			out.push_back(bl);
+	});
+}
+
+/**
+ * Calls func for every object of a collected list while the blocks are locked.
+ * Objects that an earlier call removed from the map are skipped.
+ * @return Sum of the values returned by func
+ */
+template <typename Container, typename Func>
+int32 map_foreachinlist(const Container& list, Func&& func)
+{
+	int32 returnCount = 0;
+	FreeBlockLock freeLock;
+
+	for (block_list *bl : list) {
+		if (bl->prev) //func() may delete an object of the list, checking for prev ensures it wasn't queued for deletion.
+			returnCount += func(bl);
+	}
+
+	return returnCount;
+}
+
+/// map_foreachinallrange for a lambda, func takes the object and returns an int32
+template <typename Func>
+int32 map_foreachinallrange(block_list* center, int16 range, int32 type, Func&& func)
+{
+	t_blocklist list;
+
+	map_getinrange(list, center, range, type);
+	return map_foreachinlist(list, func);
+}
+
+/// map_foreachinallarea for a lambda, func takes the object and returns an int32
+template <typename Func>
+int32 map_foreachinallarea(int16 m, int16 x0, int16 y0, int16 x1, int16 y1, int32 type, Func&& func)
+{
+	t_blocklist list;
+
+	map_getinarea(list, m, x0, y0, x1, y1, type);
+	return map_foreachinlist(list, func);
+}
 // search and creation
 int32 map_get_new_object_id(void);
+int32 map_get_new_npc_id(void);
 int32 map_search_freecell(block_list *src, int16 m, int16 *x, int16 *y, int16 rx, int16 ry, int32 flag, int32 tries = 50);
 bool map_closest_freecell(int16 m, int16 *x, int16 *y, int32 type, int32 flag);
 bool map_nearby_freecell(int16 m, int16 &x, int16 &y, int32 type, int32 flag);
@@ -0,0 +1,58 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "metrics_server.hpp"
+
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <httplib.h>
+
+#include <common/metrics.hpp>
+#include <common/showmsg.hpp>
+
+static std::unique_ptr<httplib::Server> metrics_http_server;
+static std::thread metrics_http_thread;
+
+/**
+ * Start listening for scrapes
+ * @param ip: Address to bind to
+ * @param port: Port to bind to
+ * @return true if the port could be bound
+ */
+bool metrics_server_start( const char* ip, uint16 port ){
+	metrics_http_server = std::make_unique<httplib::Server>();
+
+	metrics_http_server->Get( "/metrics", []( const httplib::Request& req, httplib::Response& res ){
+		res.set_content( metrics_snapshot(), "text/plain; version=0.0.4" );
+	} );
+
+	if( !metrics_http_server->bind_to_port( ip, port ) ){
+		ShowError( "metrics_server_start: Could not bind the metrics endpoint to %s:%hu.\n", ip, port );
+		metrics_http_server.reset();
+		return false;
+	}
+
+	metrics_http_thread = std::thread( []{
+		metrics_http_server->listen_after_bind();
+	} );
+
+	ShowStatus( "Metrics are available at 'http://%s:%hu/metrics'.\n", ip, port );
+
+	return true;
+}
+
+void metrics_server_stop( void ){
+	if( metrics_http_server == nullptr ){
+		return;
+	}
+
+	metrics_http_server->stop();
+
+	if( metrics_http_thread.joinable() ){
+		metrics_http_thread.join();
+	}
+
+	metrics_http_server.reset();
+}
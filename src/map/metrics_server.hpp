@@ -0,0 +1,17 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef METRICS_SERVER_HPP
+#define METRICS_SERVER_HPP
+
+#include <common/cbasetypes.hpp>
+
+/**
+ * Small HTTP listener that hands out the metrics snapshot on GET /metrics
+ * It runs on its own thread and never touches the map data itself.
+ */
+
+bool metrics_server_start( const char* ip, uint16 port );
+void metrics_server_stop( void );
+
+#endif /* METRICS_SERVER_HPP */
@@ -7,6 +7,7 @@
 #include <cmath>
 #include <cstdlib>
 #include <map>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -22,6 +23,7 @@
 #include <common/timer.hpp>
 #include <common/utilities.hpp>
 #include <common/utils.hpp>
+#include <common/worker_pool.hpp>
 
 #include "achievement.hpp"
 #include "battle.hpp"
@@ -1309,33 +1311,37 @@ int32 mob_target(mob_data *md,block_list *bl,int32 dist)
 }
 
 /*==========================================
- * The ?? routine of an active monster
+ * Whether an active monster may pick bl as target, regardless of its current target.
+ * Only reads, so it also runs on the AI worker threads.
  *------------------------------------------*/
-static int32 mob_ai_sub_hard_activesearch(block_list *bl,va_list ap)
+static bool mob_ai_activesearch_check(mob_data *md, block_list *bl, enum e_mode mode)
 {
-	mob_data *md;
-	block_list **target;
-	enum e_mode mode;
-	int32 dist;
-
-	nullpo_ret(bl);
-	md=va_arg(ap,mob_data *);
-	target= va_arg(ap,block_list**);
-	mode= static_cast<enum e_mode>(va_arg(ap, int32));
-
 	//If can't seek yet, not an enemy, or you can't attack it, skip.
-	if ((*target) == bl || !status_check_skilluse(md, bl, 0, 0))
-		return 0;
+	if (!status_check_skilluse(md, bl, 0, 0))
+		return false;
 
 	if ((mode&MD_TARGETWEAK) && status_get_lv(bl) >= md->level-5)
-		return 0;
+		return false;
 
 	if(battle_check_target(md,bl,BCT_ENEMY)<=0)
-		return 0;
+		return false;
 
 	if (bl->type == BL_PC && BL_CAST(BL_PC, bl)->state.gangsterparadise &&
 		!status_has_mode(&md->status,MD_STATUSIMMUNE))
-		return 0; //Gangster paradise protection.
+		return false; //Gangster paradise protection.
+
+	return battle_check_range(md,bl,md->db->range2);
+}
+
+/*==========================================
+ * The ?? routine of an active monster
+ *------------------------------------------*/
+static int32 mob_ai_activesearch(mob_data *md, block_list *bl, block_list **target, enum e_mode mode)
+{
+	int32 dist;
+
+	if ((*target) == bl)
+		return 0;
 
 	if (battle_config.hom_setting&HOMSET_FIRST_TARGET &&
 		(*target) != nullptr && (*target)->type == BL_HOM && bl->type != BL_HOM)
@@ -1344,7 +1350,7 @@ static int32 mob_ai_sub_hard_activesearch(block_list *bl,va_list ap)
 	dist = distance_bl(md, bl);
 	if(
 		((*target) == nullptr || !check_distance_bl(md, *target, dist)) &&
-		battle_check_range(md,bl,md->db->range2)
+		mob_ai_activesearch_check(md, bl, mode)
 	) { //Pick closest target?
 #ifdef ACTIVEPATHSEARCH
 		struct walkpath_data wpd;
@@ -1364,21 +1370,21 @@ static int32 mob_ai_sub_hard_activesearch(block_list *bl,va_list ap)
 }
 
 /*==========================================
- * chase target-change routine.
+ * Whether a chasing monster may switch to bl, regardless of its current target.
+ * Only reads, so it also runs on the AI worker threads.
  *------------------------------------------*/
-static int32 mob_ai_sub_hard_changechase(block_list *bl,va_list ap)
+static bool mob_ai_changechase_check(mob_data *md, block_list *bl)
 {
-	mob_data *md;
-	block_list **target;
-
-	nullpo_ret(bl);
-	md=va_arg(ap,mob_data *);
-	target= va_arg(ap,block_list**);
-
 	//If can't seek yet, not an enemy, or you can't attack it, skip.
-	if ((*target) == bl ||
-		battle_check_target(md,bl,BCT_ENEMY)<=0 ||
-	  	!status_check_skilluse(md, bl, 0, 0))
+	return battle_check_target(md,bl,BCT_ENEMY) > 0 && status_check_skilluse(md, bl, 0, 0);
+}
+
+/*==========================================
+ * chase target-change routine.
+ *------------------------------------------*/
+static int32 mob_ai_changechase(mob_data *md, block_list *bl, block_list **target)
+{
+	if ((*target) == bl || !mob_ai_changechase_check(md, bl))
 		return 0;
 
 	if(battle_check_range (md, bl, md->status.rhw.range))
@@ -1389,6 +1395,60 @@ static int32 mob_ai_sub_hard_changechase(block_list *bl,va_list ap)
 	return 1;
 }
 
+/// Target search of a monster that was done ahead by the AI workers
+enum e_mob_ai_search : uint8 {
+	MOBAI_SEARCH_NONE = 0,
+	MOBAI_SEARCH_ACTIVE,		// mob_ai_activesearch
+	MOBAI_SEARCH_CHANGECHASE,	// mob_ai_changechase
+};
+
+/// Decision of the parallel AI pass for one monster
+struct s_mob_ai_intent {
+	mob_data *md; // Only used until the decisions are applied
+	int32 id;
+	int16 m;
+	e_mob_ai_search search;
+	int16 range;
+	e_mode mode;
+	std::vector<int32> targets; // Candidates that passed the checks, in block order
+};
+
+static std::unique_ptr<WorkerPool> mob_ai_pool;
+static std::vector<s_mob_ai_intent> mob_ai_intents; // Slots past mob_ai_intent_count keep their memory for the next pass
+static size_t mob_ai_intent_count = 0;
+static std::vector<int32> mob_ai_active; // Monsters near players, in the order their hard AI runs
+static bool mob_ai_applying = false;
+
+/**
+ * Replays a target search of the parallel AI pass on the current state
+ * The candidates were collected from the state at the start of the pass, each one is checked again before it is used.
+ * @return false if there is no matching search and the area has to be scanned
+ */
+static bool mob_ai_intent_search(mob_data *md, e_mob_ai_search search, int16 range, e_mode mode, block_list **target)
+{
+	if (!mob_ai_applying || md->ai_intent >= mob_ai_intent_count)
+		return false;
+
+	s_mob_ai_intent& intent = mob_ai_intents[md->ai_intent];
+
+	if (intent.id != md->id || intent.m != md->m || intent.search != search || intent.range != range || intent.mode != mode)
+		return false;
+
+	for (int32 id : intent.targets) {
+		block_list *bl = map_id2bl(id);
+
+		if (bl == nullptr || bl->prev == nullptr || bl->m != md->m)
+			continue;
+
+		if (search == MOBAI_SEARCH_ACTIVE)
+			mob_ai_activesearch(md, bl, target, mode);
+		else
+			mob_ai_changechase(md, bl, target);
+	}
+
+	return true;
+}
+
 /*==========================================
  * finds nearby bg ally for guardians looking for users to follow.
  *------------------------------------------*/
@@ -2024,7 +2084,10 @@ static bool mob_ai_sub_hard(mob_data *md, t_tick tick)
 	if ((mode&MD_AGGRESSIVE && (!tbl || slave_lost_target)) || md->state.skillstate == MSS_FOLLOW)
 	{
 		int32 prev_id = md->target_id;
-		map_foreachinallrange (mob_ai_sub_hard_activesearch, md, view_range, DEFAULT_ENEMY_TYPE(md), md, &tbl, mode);
+		if (!mob_ai_intent_search(md, MOBAI_SEARCH_ACTIVE, view_range, static_cast<e_mode>(mode), &tbl))
+			map_foreachinallrange(md, view_range, DEFAULT_ENEMY_TYPE(md), [&](block_list *bl) {
+				return mob_ai_activesearch(md, bl, &tbl, static_cast<e_mode>(mode));
+			});
 		// If a monster finds a new target that is already in attack range it immediately switches to rush mode
 		// This behavior overrides even angry mode and other mode-specific behavior
 		if (tbl != nullptr && prev_id != md->target_id && battle_check_range(md, tbl, md->status.rhw.range)) {
@@ -2037,7 +2100,10 @@ static bool mob_ai_sub_hard(mob_data *md, t_tick tick)
 	{
 		int32 search_size;
 		search_size = view_range<md->status.rhw.range ? view_range:md->status.rhw.range;
-		map_foreachinallrange (mob_ai_sub_hard_changechase, md, search_size, DEFAULT_ENEMY_TYPE(md), md, &tbl);
+		if (!mob_ai_intent_search(md, MOBAI_SEARCH_CHANGECHASE, search_size, static_cast<e_mode>(mode), &tbl))
+			map_foreachinallrange(md, search_size, DEFAULT_ENEMY_TYPE(md), [&](block_list *bl) {
+				return mob_ai_changechase(md, bl, &tbl);
+			});
 	}
 
 	if (!tbl) { //No targets available.
@@ -2329,28 +2395,174 @@ TIMER_FUNC(mob_norm_attacked) {
 	return 0;
 }
 
-static int32 mob_ai_sub_hard_timer(block_list *bl,va_list ap)
+/*==========================================
+ * Decides which target search the monster will need in the parallel AI pass
+ *------------------------------------------*/
+static void mob_ai_plan(mob_data *md, t_tick tick)
 {
-	mob_data *md = (mob_data*)bl;
-	uint32 char_id = va_arg(ap, uint32);
-	t_tick tick = va_arg(ap, t_tick);
-	mob_add_spotted(md, char_id);
-	if (mob_ai_sub_hard(md, tick))
-	{	//Hard AI triggered.
-		md->last_pcneartime = tick;
+	if (mob_ai_intent_count == mob_ai_intents.size())
+		mob_ai_intents.emplace_back();
+
+	md->ai_intent = static_cast<uint32>(mob_ai_intent_count);
+
+	s_mob_ai_intent& intent = mob_ai_intents[mob_ai_intent_count++];
+
+	intent.md = md;
+	intent.id = md->id;
+	intent.m = md->m;
+	intent.search = MOBAI_SEARCH_NONE;
+	intent.targets.clear();
+
+	// Same conditions mob_ai_sub_hard checks before it searches, on the state at the start of the pass
+	if (md->status.hp == 0 || md->ud.state.force_walk || DIFF_TICK(tick, md->next_thinktime) < 0 || md->ud.skilltimer != INVALID_TIMER)
+		return;
+
+	int16 view_range = md->sc.getSCE(SC_BLIND) ? 1 : md->db->range2;
+
+	intent.mode = static_cast<e_mode>(status_get_mode(md));
+
+	if ((intent.mode&MD_AGGRESSIVE && (!md->target_id || md->master_id > 0)) || md->state.skillstate == MSS_FOLLOW) {
+		intent.search = MOBAI_SEARCH_ACTIVE;
+		intent.range = view_range;
+	} else if (intent.mode&MD_CHANGECHASE && (md->state.skillstate == MSS_RUSH || md->state.skillstate == MSS_FOLLOW)) {
+		intent.search = MOBAI_SEARCH_CHANGECHASE;
+		intent.range = min(view_range, md->status.rhw.range);
 	}
-	return 0;
 }
 
 /*==========================================
- * Serious processing for mob in PC field of view (foreachclient)
+ * Finds the monsters in the field of view of players (foreachclient)
+ * Only the blocks players watch are visited, once each, no matter how many
+ * players watch them. Every player close enough spots the monster.
+ * @param plan: Whether the target searches are planned for the parallel pass
  *------------------------------------------*/
-static int32 mob_ai_sub_foreachclient(map_session_data *sd,va_list ap)
+static void mob_ai_collect(t_tick tick, bool plan)
 {
-	t_tick tick=va_arg(ap,t_tick);
-	map_foreachinallrange(mob_ai_sub_hard_timer,sd, AREA_SIZE+ACTIVE_AI_RANGE, BL_MOB, sd->status.char_id, tick);
+	int16 range = AREA_SIZE + ACTIVE_AI_RANGE;
 
-	return 0;
+	map_setinterestrange(range);
+
+	mob_ai_active.clear();
+	mob_ai_intent_count = 0;
+
+	for (int32 m = 0; m < map_num; m++) {
+		struct map_data *mapdata = map_getmapdata(m);
+
+		for (int32 block : mapdata->interest.blocks()) {
+			const std::vector<block_list*>& watchers = mapdata->interest.watching(block);
+
+			for (block_list *bl = mapdata->block_mob[block]; bl != nullptr; bl = bl->next) {
+				mob_data *md = (mob_data*)bl;
+				bool spotted = false;
+
+				for (block_list *wbl : watchers) {
+					if (!check_distance_bl(wbl, md, range))
+						continue;
+
+					mob_add_spotted(md, ((map_session_data*)wbl)->status.char_id);
+					spotted = true;
+				}
+
+				if (!spotted)
+					continue;
+
+				mob_ai_active.push_back(md->id);
+
+				if (plan)
+					mob_ai_plan(md, tick);
+			}
+		}
+	}
+}
+
+/*==========================================
+ * Runs the hard AI of the collected monsters
+ *------------------------------------------*/
+static void mob_ai_run(t_tick tick)
+{
+	FreeBlockLock freeLock;
+
+	for (int32 id : mob_ai_active) {
+		mob_data *md = map_id2md(id);
+
+		if (md == nullptr || md->prev == nullptr)
+			continue;
+
+		if (mob_ai_sub_hard(md, tick))
+		{	//Hard AI triggered.
+			md->last_pcneartime = tick;
+		}
+	}
+}
+
+/*==========================================
+ * Target searches of the monsters of one map, runs on the AI workers.
+ * Only reads the game state, the main thread waits until all maps are done.
+ * The id lookups are only free of writes on the open addressing databases, the
+ * trees update their lookup cache and free lock, so the workers are disabled
+ * when the server is compiled with DB_DISABLE_OPEN_ADDRESSING (see battle_adjust_conf).
+ *------------------------------------------*/
+static void mob_ai_decide(size_t first, size_t last)
+{
+	t_blocklist blocks;
+
+	for (size_t i = first; i < last; i++) {
+		s_mob_ai_intent& intent = mob_ai_intents[i];
+		mob_data *md = intent.md;
+
+		if (intent.search == MOBAI_SEARCH_NONE)
+			continue;
+
+		blocks.clear();
+		map_getinrange(blocks, md, intent.range, DEFAULT_ENEMY_TYPE(md));
+
+		for (block_list *bl : blocks) {
+			bool candidate;
+
+			if (intent.search == MOBAI_SEARCH_ACTIVE)
+				candidate = mob_ai_activesearch_check(md, bl, intent.mode);
+			else
+				candidate = mob_ai_changechase_check(md, bl) && battle_check_range(md, bl, md->status.rhw.range);
+
+			if (candidate)
+				intent.targets.push_back(bl->id);
+		}
+	}
+}
+
+/*==========================================
+ * Hard AI with the target searches spread over worker threads.
+ * The searches of each map run in parallel on the state at the start of the pass,
+ * then the main thread runs the AI in the same order as the serial AI and uses
+ * their candidates instead of scanning the area. Neither the thread count nor the
+ * scheduling can change the outcome.
+ *------------------------------------------*/
+static void mob_ai_hard_parallel(t_tick tick)
+{
+	size_t threads = static_cast<size_t>(battle_config.mob_ai_threads);
+
+	if (mob_ai_pool == nullptr || mob_ai_pool->size() != threads)
+		mob_ai_pool = std::make_unique<WorkerPool>(threads);
+
+	mob_ai_collect(tick, true);
+
+	// The monsters were collected map by map, one job per map
+	std::vector<size_t> maps;
+
+	for (size_t i = 0; i < mob_ai_intent_count; i++) {
+		if (i == 0 || mob_ai_intents[i].m != mob_ai_intents[i - 1].m)
+			maps.push_back(i);
+	}
+
+	maps.push_back(mob_ai_intent_count);
+
+	mob_ai_pool->run(maps.size() - 1, [&maps](size_t job) {
+		mob_ai_decide(maps[job], maps[job + 1]);
+	});
+
+	mob_ai_applying = true;
+	mob_ai_run(tick);
+	mob_ai_applying = false;
 }
 
 /*==========================================
@@ -2469,8 +2681,12 @@ static TIMER_FUNC(mob_ai_hard){
 
 	if (battle_config.mob_ai&0x20)
 		map_foreachmob(mob_ai_sub_lazy,tick);
-	else
-		map_foreachpc(mob_ai_sub_foreachclient,tick);
+	else if (battle_config.mob_ai_threads > 0)
+		mob_ai_hard_parallel(tick);
+	else {
+		mob_ai_collect(tick, false);
+		mob_ai_run(tick);
+	}
 
 	return 0;
 }
@@ -7375,5 +7591,6 @@ void do_final_mob(bool is_reload){
 	map_drop_db.clear();
 	if( !is_reload ) {
 		mob_delayed_drops.clear();
+		mob_ai_pool.reset();
 	}
 }
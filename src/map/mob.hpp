@@ -375,6 +375,7 @@ struct mob_data : public block_list {
 	int32 bg_id; // BattleGround System
 
 	t_tick next_walktime,next_thinktime,last_linktime,last_pcneartime,last_canmove,last_skillcheck;
+	uint32 ai_intent; // Decision of the current parallel AI pass, see mob_ai_hard
 	t_tick trickcasting; // Special state where you show a fake castbar while moving
 	int16 move_fail_count;
 	int16 lootitem_count;
@@ -42,7 +42,6 @@ npc_data* fake_nd;
 
 std::vector<std::string> npc_src_files;
 
-static int32 npc_id=START_NPC_NUM;
 static int32 npc_warp=0;
 static int32 npc_shop=0;
 static int32 npc_script=0;
@@ -71,20 +70,14 @@ TIMER_FUNC(npc_dynamicnpc_removal_timer);
 /// Returns a new npc id that isn't being used in id_db.
 /// Fatal error if nothing is available.
 int32 npc_get_new_npc_id(void) {
-	if( npc_id >= START_NPC_NUM && !map_blid_exists(npc_id) )
-		return npc_id++;// available
-	else {// find next id
-		int32 base_id = npc_id;
-		while( base_id != ++npc_id ) {
-			if( npc_id < START_NPC_NUM )
-				npc_id = START_NPC_NUM;
-			if( !map_blid_exists(npc_id) )
-				return npc_id++;// available
-		}
-		// full loop, nothing available
+	int32 id = map_get_new_npc_id();
+
+	if( id == 0 ) {// nothing available
 		ShowFatalError("npc_get_new_npc_id: All ids are taken. Exiting...");
 		exit(1);
 	}
+
+	return id;
 }
 
 static DBMap* ev_db; // const char* event_name -> struct event_data*
@@ -6056,7 +6049,6 @@ void npc_clear_pathlist(void) {
 
 //Clear then reload npcs files
 int32 npc_reload(void) {
-	int32 npc_new_min = npc_id;
 	struct s_mapiterator* iter;
 	block_list* bl;
 
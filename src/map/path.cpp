@@ -50,6 +50,9 @@ static BHEAP_STRUCT_VAR(node_heap, g_open_set);	// use static heap for all path
 
 #define calc_index(x,y) (((x)+(y)*MAX_WALKPATH) & (MAX_WALKPATH*MAX_WALKPATH-1))
 
+static uint64 path_cache_hits = 0;
+static uint64 path_cache_misses = 0;
+
 /// Estimates the cost from (x0,y0) to (x1,y1).
 /// This is inadmissible (overestimating) heuristic used by game client.
 #define heuristic(x0, y0, x1, y1)	(MOVE_COST * (abs((x1) - (x0)) + abs((y1) - (y0)))) // Manhattan distance
@@ -72,6 +75,11 @@ void do_final_path(){
 	BHEAP_CLEAR(g_open_set);
 }//
 
+/// Searches that were answered by the path caches of the maps, and searches that had to run
+void path_cache_usage(uint64* hits, uint64* misses){
+	*hits = path_cache_hits;
+	*misses = path_cache_misses;
+}
 
 /*==========================================
  * Find the closest reachable cell, 'count' cells away from (x0,y0) in direction (dx,dy).
@@ -257,6 +265,141 @@ static int32 add_path(struct node_heap *heap, struct path_node *tp, int16 x, int
 }
 ///@}
 
+/// A* search for a walk path from (x0,y0) to (x1,y1), the cells were already checked by path_search.
+/// The path is only written to wpd if one was found.
+static bool path_search_astar(struct walkpath_data *wpd, struct map_data *mapdata, int16 x0, int16 y0, int16 x1, int16 y1, cell_chk cell)
+{
+	int32 i, x, y, dx, dy;
+	// FIXME: This array is too small to ensure all paths shorter than MAX_WALKPATH
+	// can be found without node collision: calc_index(node1) = calc_index(node2).
+	// Figure out more proper size or another way to keep track of known nodes.
+	struct path_node tp[MAX_WALKPATH * MAX_WALKPATH];
+	struct path_node *current, *it;
+	int32 xs = mapdata->xs - 1;
+	int32 ys = mapdata->ys - 1;
+	int32 len = 0;
+	int32 j;
+
+	// A* (A-star) pathfinding
+	// We always use A* for finding walkpaths because it is what game client uses.
+	// Easy pathfinding cuts corners of non-walkable cells, but client always walks around it.
+	BHEAP_RESET(g_open_set);
+
+	memset(tp, 0, sizeof(tp));
+
+	// Start node
+	i = calc_index(x0, y0);
+	tp[i].parent = nullptr;
+	tp[i].x      = x0;
+	tp[i].y      = y0;
+	tp[i].g_cost = 0;
+	tp[i].f_cost = heuristic(x0, y0, x1, y1);
+	tp[i].flag   = SET_OPEN;
+
+	heap_push_node(&g_open_set, &tp[i]); // Put start node to 'open' set
+
+	for(;;) {
+		int32 e = 0; // error flag
+
+		// Saves allowed directions for the current cell. Diagonal directions
+		// are only allowed if both directions around it are allowed. This is
+		// to prevent cutting corner of nearby wall.
+		// For example, you can only go NW from the current cell, if you can
+		// go N *and* you can go W. Otherwise you need to walk around the
+		// (corner of the) non-walkable cell.
+		int32 allowed_dirs = 0;
+
+		int32 g_cost;
+
+		if (BHEAP_LENGTH(g_open_set) == 0) {
+			return false;
+		}
+
+		current = BHEAP_PEEK(g_open_set); // Look for the lowest f_cost node in the 'open' set
+		BHEAP_POP2(g_open_set, NODE_MINTOPCMP); // Remove it from 'open' set
+
+		x      = current->x;
+		y      = current->y;
+		g_cost = current->g_cost;
+
+		current->flag = SET_CLOSED; // Add current node to 'closed' set
+
+		if (x == x1 && y == y1) {
+			break;
+		}
+
+		if (y < ys && !map_getcellp(mapdata, x, y+1, cell)) allowed_dirs |= PATH_DIR_NORTH;
+		if (y >  0 && !map_getcellp(mapdata, x, y-1, cell)) allowed_dirs |= PATH_DIR_SOUTH;
+		if (x < xs && !map_getcellp(mapdata, x+1, y, cell)) allowed_dirs |= PATH_DIR_EAST;
+		if (x >  0 && !map_getcellp(mapdata, x-1, y, cell)) allowed_dirs |= PATH_DIR_WEST;
+
+#define chk_dir(d) ((allowed_dirs & (d)) == (d))
+		// Process neighbors of current node
+		if (chk_dir(PATH_DIR_SOUTH|PATH_DIR_EAST) && !map_getcellp(mapdata, x+1, y-1, cell))
+			e += add_path(&g_open_set, tp, x+1, y-1, g_cost + MOVE_DIAGONAL_COST, current, heuristic(x+1, y-1, x1, y1)); // (x+1, y-1) 5
+		if (chk_dir(PATH_DIR_EAST))
+			e += add_path(&g_open_set, tp, x+1, y, g_cost + MOVE_COST, current, heuristic(x+1, y, x1, y1)); // (x+1, y) 6
+		if (chk_dir(PATH_DIR_NORTH|PATH_DIR_EAST) && !map_getcellp(mapdata, x+1, y+1, cell))
+			e += add_path(&g_open_set, tp, x+1, y+1, g_cost + MOVE_DIAGONAL_COST, current, heuristic(x+1, y+1, x1, y1)); // (x+1, y+1) 7
+		if (chk_dir(PATH_DIR_NORTH))
+			e += add_path(&g_open_set, tp, x, y+1, g_cost + MOVE_COST, current, heuristic(x, y+1, x1, y1)); // (x, y+1) 0
+		if (chk_dir(PATH_DIR_NORTH|PATH_DIR_WEST) && !map_getcellp(mapdata, x-1, y+1, cell))
+			e += add_path(&g_open_set, tp, x-1, y+1, g_cost + MOVE_DIAGONAL_COST, current, heuristic(x-1, y+1, x1, y1)); // (x-1, y+1) 1
+		if (chk_dir(PATH_DIR_WEST))
+			e += add_path(&g_open_set, tp, x-1, y, g_cost + MOVE_COST, current, heuristic(x-1, y, x1, y1)); // (x-1, y) 2
+		if (chk_dir(PATH_DIR_SOUTH|PATH_DIR_WEST) && !map_getcellp(mapdata, x-1, y-1, cell))
+			e += add_path(&g_open_set, tp, x-1, y-1, g_cost + MOVE_DIAGONAL_COST, current, heuristic(x-1, y-1, x1, y1)); // (x-1, y-1) 3
+		if (chk_dir(PATH_DIR_SOUTH))
+			e += add_path(&g_open_set, tp, x, y-1, g_cost + MOVE_COST, current, heuristic(x, y-1, x1, y1)); // (x, y-1) 4
+#undef chk_dir
+		if (e) {
+			return false;
+		}
+	}
+
+	for (it = current; it->parent != nullptr; it = it->parent, len++);
+	if (len > sizeof(wpd->path))
+		return false;
+
+	// Recreate path
+	wpd->path_len = len;
+	wpd->path_pos = 0;
+
+	for (it = current, j = len-1; j >= 0; it = it->parent, j--) {
+		dx = it->x - it->parent->x;
+		dy = it->y - it->parent->y;
+		wpd->path[j] = walk_choices[-dy + 1][dx + 1];
+	}
+
+	return true;
+}
+
+/// Key of a search in the path cache, 0 if searches for this obstruction are not cached.
+/// Coordinates were already checked to be on the map, so they take 15 bits each.
+static uint64 path_cache_key(int16 x0, int16 y0, int16 x1, int16 y1, cell_chk cell)
+{
+	uint64 type;
+
+	switch (cell) {
+		case CELL_CHKWALL:
+			type = 1;
+			break;
+		case CELL_CHKNOREACH:
+			type = 2;
+			break;
+		// With the stacking limit, characters block cells without changing their flags
+#ifndef CELL_NOSTACK
+		case CELL_CHKNOPASS:
+			type = 3;
+			break;
+#endif
+		default:
+			return 0;
+	}
+
+	return (type << 60) | ((uint64)x0 << 45) | ((uint64)y0 << 30) | ((uint64)x1 << 15) | (uint64)y1;
+}
+
 /*==========================================
  * path search (x0,y0)->(x1,y1)
  * wpd: path info will be written here
@@ -264,6 +407,8 @@ static int32 add_path(struct node_heap *heap, struct path_node *tp, int16 x, int
  * flag: &2 = call path_search_long instead
  * cell: type of obstruction to check for
  *
+ * A* searches are cached per map, see PathCache.
+ *
  * Note: uses global g_open_set, therefore this method can't be called in parallel or recursivly.
  *------------------------------------------*/
 bool path_search(struct walkpath_data *wpd, int16 m, int16 x0, int16 y0, int16 x1, int16 y1, int32 flag, cell_chk cell)
@@ -323,112 +468,27 @@ bool path_search(struct walkpath_data *wpd, int16 m, int16 x0, int16 y0, int16 x
 		}
 
 		return false; // easy path unsuccessful
-	} else { // !(flag&1)
-		// FIXME: This array is too small to ensure all paths shorter than MAX_WALKPATH
-		// can be found without node collision: calc_index(node1) = calc_index(node2).
-		// Figure out more proper size or another way to keep track of known nodes.
-		struct path_node tp[MAX_WALKPATH * MAX_WALKPATH];
-		struct path_node *current, *it;
-		int32 xs = mapdata->xs - 1;
-		int32 ys = mapdata->ys - 1;
-		int32 len = 0;
-		int32 j;
-
-		// A* (A-star) pathfinding
-		// We always use A* for finding walkpaths because it is what game client uses.
-		// Easy pathfinding cuts corners of non-walkable cells, but client always walks around it.
-		BHEAP_RESET(g_open_set);
-
-		memset(tp, 0, sizeof(tp));
-
-		// Start node
-		i = calc_index(x0, y0);
-		tp[i].parent = nullptr;
-		tp[i].x      = x0;
-		tp[i].y      = y0;
-		tp[i].g_cost = 0;
-		tp[i].f_cost = heuristic(x0, y0, x1, y1);
-		tp[i].flag   = SET_OPEN;
-
-		heap_push_node(&g_open_set, &tp[i]); // Put start node to 'open' set
-
-		for(;;) {
-			int32 e = 0; // error flag
-
-			// Saves allowed directions for the current cell. Diagonal directions
-			// are only allowed if both directions around it are allowed. This is
-			// to prevent cutting corner of nearby wall.
-			// For example, you can only go NW from the current cell, if you can
-			// go N *and* you can go W. Otherwise you need to walk around the
-			// (corner of the) non-walkable cell.
-			int32 allowed_dirs = 0;
-
-			int32 g_cost;
-
-			if (BHEAP_LENGTH(g_open_set) == 0) {
-				return false;
-			}
-
-			current = BHEAP_PEEK(g_open_set); // Look for the lowest f_cost node in the 'open' set
-			BHEAP_POP2(g_open_set, NODE_MINTOPCMP); // Remove it from 'open' set
-
-			x      = current->x;
-			y      = current->y;
-			g_cost = current->g_cost;
-
-			current->flag = SET_CLOSED; // Add current node to 'closed' set
-
-			if (x == x1 && y == y1) {
-				break;
-			}
-
-			if (y < ys && !map_getcellp(mapdata, x, y+1, cell)) allowed_dirs |= PATH_DIR_NORTH;
-			if (y >  0 && !map_getcellp(mapdata, x, y-1, cell)) allowed_dirs |= PATH_DIR_SOUTH;
-			if (x < xs && !map_getcellp(mapdata, x+1, y, cell)) allowed_dirs |= PATH_DIR_EAST;
-			if (x >  0 && !map_getcellp(mapdata, x-1, y, cell)) allowed_dirs |= PATH_DIR_WEST;
+	}
 
-#define chk_dir(d) ((allowed_dirs & (d)) == (d))
-			// Process neighbors of current node
-			if (chk_dir(PATH_DIR_SOUTH|PATH_DIR_EAST) && !map_getcellp(mapdata, x+1, y-1, cell))
-				e += add_path(&g_open_set, tp, x+1, y-1, g_cost + MOVE_DIAGONAL_COST, current, heuristic(x+1, y-1, x1, y1)); // (x+1, y-1) 5
-			if (chk_dir(PATH_DIR_EAST))
-				e += add_path(&g_open_set, tp, x+1, y, g_cost + MOVE_COST, current, heuristic(x+1, y, x1, y1)); // (x+1, y) 6
-			if (chk_dir(PATH_DIR_NORTH|PATH_DIR_EAST) && !map_getcellp(mapdata, x+1, y+1, cell))
-				e += add_path(&g_open_set, tp, x+1, y+1, g_cost + MOVE_DIAGONAL_COST, current, heuristic(x+1, y+1, x1, y1)); // (x+1, y+1) 7
-			if (chk_dir(PATH_DIR_NORTH))
-				e += add_path(&g_open_set, tp, x, y+1, g_cost + MOVE_COST, current, heuristic(x, y+1, x1, y1)); // (x, y+1) 0
-			if (chk_dir(PATH_DIR_NORTH|PATH_DIR_WEST) && !map_getcellp(mapdata, x-1, y+1, cell))
-				e += add_path(&g_open_set, tp, x-1, y+1, g_cost + MOVE_DIAGONAL_COST, current, heuristic(x-1, y+1, x1, y1)); // (x-1, y+1) 1
-			if (chk_dir(PATH_DIR_WEST))
-				e += add_path(&g_open_set, tp, x-1, y, g_cost + MOVE_COST, current, heuristic(x-1, y, x1, y1)); // (x-1, y) 2
-			if (chk_dir(PATH_DIR_SOUTH|PATH_DIR_WEST) && !map_getcellp(mapdata, x-1, y-1, cell))
-				e += add_path(&g_open_set, tp, x-1, y-1, g_cost + MOVE_DIAGONAL_COST, current, heuristic(x-1, y-1, x1, y1)); // (x-1, y-1) 3
-			if (chk_dir(PATH_DIR_SOUTH))
-				e += add_path(&g_open_set, tp, x, y-1, g_cost + MOVE_COST, current, heuristic(x, y-1, x1, y1)); // (x, y-1) 4
-#undef chk_dir
-			if (e) {
-				return false;
-			}
-		}
+	// Searches on unchanged cells have the same outcome, unless the cache is disabled
+	uint64 key = path_cache_key(x0, y0, x1, y1, cell);
 
-		for (it = current; it->parent != nullptr; it = it->parent, len++);
-		if (len > sizeof(wpd->path))
-			return false;
+	if (key == 0 || battle_config.path_cache_size == 0)
+		return path_search_astar(wpd, mapdata, x0, y0, x1, y1, cell);
 
-		// Recreate path
-		wpd->path_len = len;
-		wpd->path_pos = 0;
+	uint64 version = mapdata->cell->version();
+	bool found;
 
-		for (it = current, j = len-1; j >= 0; it = it->parent, j--) {
-			dx = it->x - it->parent->x;
-			dy = it->y - it->parent->y;
-			wpd->path[j] = walk_choices[-dy + 1][dx + 1];
-		}
+	if (mapdata->paths.find(version, key, found, *wpd)) {
+		path_cache_hits++;
+		return found;
+	}
 
-		return true;
-	} // A* end
+	path_cache_misses++;
+	found = path_search_astar(wpd, mapdata, x0, y0, x1, y1, cell);
+	mapdata->paths.store(version, key, found, *wpd, battle_config.path_cache_size);
 
-	return false;
+	return found;
 }
 
 
@@ -76,6 +76,8 @@ int32 distance_client(int32 dx, int32 dy);
 bool direction_diagonal( enum directions direction );
 bool direction_opposite( enum directions direction );
 
+void path_cache_usage(uint64* hits, uint64* misses);
+
 //
 void do_init_path();
 void do_final_path();
@@ -0,0 +1,84 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "path_cache.hpp"
+
+#include <iterator>
+
+/**
+ * Look up a search
+ * @param version: Current version of the cells
+ * @param key: Start, destination and obstruction of the search
+ * @param found: Whether the search found a path
+ * @param wpd: Path of the search, only written if it found one
+ * @return true if the search is cached
+ */
+bool PathCache::find( uint64 version, uint64 key, bool& found, walkpath_data& wpd ){
+	if( version != this->version ){
+		this->clear();
+		this->version = version;
+		return false;
+	}
+
+	auto it = this->index.find( key );
+
+	if( it == this->index.end() ){
+		return false;
+	}
+
+	this->entries.splice( this->entries.begin(), this->entries, it->second );
+
+	found = it->second->found;
+
+	if( found ){
+		wpd = it->second->wpd;
+	}
+
+	return true;
+}
+
+/**
+ * Remember a search, dropping the least recently used one if the cache is full
+ * @param capacity: Maximum amount of searches, 0 to keep none
+ */
+void PathCache::store( uint64 version, uint64 key, bool found, const walkpath_data& wpd, size_t capacity ){
+	if( version != this->version ){
+		this->clear();
+		this->version = version;
+	}
+
+	if( capacity == 0 || this->index.find( key ) != this->index.end() ){
+		return;
+	}
+
+	// Trim the cache if the capacity was lowered
+	while( this->index.size() > capacity ){
+		this->index.erase( this->entries.back().key );
+		this->entries.pop_back();
+	}
+
+	if( this->index.size() == capacity ){
+		// Reuse the least recently used entry
+		this->index.erase( this->entries.back().key );
+		this->entries.splice( this->entries.begin(), this->entries, std::prev( this->entries.end() ) );
+	}else{
+		this->entries.emplace_front();
+	}
+
+	s_entry& entry = this->entries.front();
+
+	entry.key = key;
+	entry.found = found;
+
+	if( found ){
+		entry.wpd = wpd;
+	}
+
+	this->index[key] = this->entries.begin();
+}
+
+void PathCache::clear(){
+	this->entries.clear();
+	std::unordered_map<uint64, std::list<s_entry>::iterator>().swap( this->index );
+	this->version = 0;
+}
@@ -0,0 +1,43 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef PATH_CACHE_HPP
+#define PATH_CACHE_HPP
+
+#include <list>
+#include <unordered_map>
+
+#include <common/cbasetypes.hpp>
+
+#include "path.hpp"
+
+/**
+ * Recent walk paths of a map
+ * Holds the outcome of the last A* searches between two cells, failed searches
+ * included. The least recently used search is dropped first once the cache is
+ * full. All searches belong to one version of the cells of the map, a search on
+ * another version drops the whole cache.
+ */
+class PathCache {
+private:
+	struct s_entry {
+		uint64 key;
+		bool found;
+		walkpath_data wpd;
+	};
+
+	std::list<s_entry> entries; // Most recently used first
+	std::unordered_map<uint64, std::list<s_entry>::iterator> index;
+	uint64 version; // Version of the cells the searches were done on
+
+public:
+	PathCache() : version( 0 ){}
+
+	bool find( uint64 version, uint64 key, bool& found, walkpath_data& wpd );
+	void store( uint64 version, uint64 key, bool found, const walkpath_data& wpd, size_t capacity );
+	void clear();
+
+	size_t size() const { return this->index.size(); }
+};
+
+#endif /* PATH_CACHE_HPP */
@@ -508,6 +508,9 @@ public:
 	struct script_state *st;
 	char npc_str[CHATBOX_SIZE]; // for passing npc input box text to script engine
 	char ai_npc_name[50]; // AI NPC identifier for dialogue requests
+	uint8 ai_npc_priority; // e_ai_dialogue_priority of the AI dialogue request
+	int32 ai_npc_cache_ttl; // How long the AI dialogue answer may be cached in milliseconds (0 = not cached)
+	std::string ai_npc_cache_context; // Player context the cached AI dialogue answer depends on
 	int32 npc_timer_id; //For player attached npc timers. [Skotlex]
 	uint32 chatID;
 	time_t idletime;
@@ -22,6 +22,7 @@
 #include <common/ers.hpp>  // ers_destroy
 #include <common/malloc.hpp>
 #include <common/md5calc.hpp>
+#include <common/metrics.hpp>
 #include <common/nullpo.hpp>
 #include <common/random.hpp>
 #include <common/showmsg.hpp>
@@ -30,8 +31,10 @@
 #include <common/timer.hpp>
 #include <common/utilities.hpp>
 #include <common/utils.hpp>
+#include <common/watchdog.hpp>
 
 #include "achievement.hpp"
+#include "ai_dialogue_queue.hpp"
 #include "atcommand.hpp"
 #include "battle.hpp"
 #include "battleground.hpp"
@@ -4085,6 +4088,9 @@ static void script_check_buildin_argtype(struct script_state* st, int32 func)
 }
 
 
+/// Number of executed buildin commands
+static uint64 script_commands = 0;
+
 /// Executes a buildin command.
 /// Stack: C_NAME(<command>) C_ARG <arg0> <arg1> ... <argN>
 int32 run_func(struct script_state *st)
@@ -4131,6 +4137,9 @@ int32 run_func(struct script_state *st)
 		}
 #endif
 
+		watchdog_count(WATCHDOG_SCRIPT_COMMANDS);
+		script_commands++;
+
 		if (str_data[func].func(st) == SCRIPT_CMD_FAILURE) {
 			//Report error
 			ShowWarning("Script command '%s' returned failure.\n", get_str(func));
@@ -4842,6 +4851,11 @@ void do_final_script() {
 		dummy_sd = nullptr;
 	}
 }
+/// Writes the executed script commands for the metrics endpoint
+static void script_metrics(MetricsWriter& writer) {
+	writer.counter("rathena_script_commands_total", "Script commands that were executed.", script_commands);
+}
+
 /*==========================================
  * Initialization
  *------------------------------------------*/
@@ -4856,6 +4870,7 @@ void do_init_script(void) {
 	array_ers = ers_new(sizeof(struct script_array), "script.cpp:array_ers", ERS_CLEAN_OPTIONS);
 
 	add_timer_func_list( run_script_timer, "run_script_timer" );
+	metrics_add_collector( script_metrics );
 
 	ers_chunk_size(st_ers, 10);
 	ers_chunk_size(stack_ers, 10);
@@ -6198,13 +6213,15 @@ BUILDIN_FUNC(copyarray);
 /// The value is converted to the type of the variable.
 ///
 /**
- * ai_chat_start("<npc_name>")
+ * ai_chat_start("<npc_name>"{,<priority>{,<cache seconds>{,"<cache context>"}}})
  * Prepares player for AI dialogue text input
- * Sets the ai_dialogue_mode flag and stores NPC name for AI service routing
+ * Sets the ai_dialogue_mode flag and stores NPC name, request priority and caching for AI service routing
  */
 BUILDIN_FUNC(ai_chat_start)
 {
 	const char* npc_name = script_getstr(st, 2);
+	int32 priority = AI_DIALOGUE_PRIORITY_NORMAL;
+	int32 cache_seconds = 0;
 	map_session_data* sd;
 
 	if (!script_rid2sd(sd)) {
@@ -6217,9 +6234,30 @@ BUILDIN_FUNC(ai_chat_start)
 		return SCRIPT_CMD_FAILURE;
 	}
 
+	if (script_hasdata(st, 3)) {
+		priority = script_getnum(st, 3);
+
+		if (priority < AI_DIALOGUE_PRIORITY_AMBIENT || priority >= AI_DIALOGUE_PRIORITY_MAX) {
+			ShowError("script:ai_chat_start: Invalid priority %d\n", priority);
+			return SCRIPT_CMD_FAILURE;
+		}
+	}
+
+	if (script_hasdata(st, 4)) {
+		cache_seconds = script_getnum(st, 4);
+
+		if (cache_seconds < 0 || cache_seconds > 86400) {
+			ShowError("script:ai_chat_start: Invalid cache duration %d (0-86400 seconds)\n", cache_seconds);
+			return SCRIPT_CMD_FAILURE;
+		}
+	}
+
 	// Set AI dialogue mode
 	sd->state.ai_dialogue_mode = 1;
 	safestrncpy(sd->ai_npc_name, npc_name, sizeof(sd->ai_npc_name));
+	sd->ai_npc_priority = static_cast<uint8>(priority);
+	sd->ai_npc_cache_ttl = cache_seconds * 1000;
+	sd->ai_npc_cache_context = script_hasdata(st, 5) ? script_getstr(st, 5) : "";
 
 	ShowDebug("AI Dialogue: Enabled for %s (char_id=%u, npc=%s)\n",
 	          sd->status.name, sd->status.char_id, npc_name);
@@ -27893,7 +27931,7 @@ struct script_function buildin_func[] = {
 	BUILDIN_DEF(jobchange,"i??"),
 	BUILDIN_DEF(jobname,"i"),
 	BUILDIN_DEF(input,"r??"),
-	BUILDIN_DEF(ai_chat_start,"s"),
+	BUILDIN_DEF(ai_chat_start,"s???"),
 	BUILDIN_DEF(warp,"sii?"),
 	BUILDIN_DEF2(warp, "warpchar", "sii?"),
 	BUILDIN_DEF(areawarp,"siiiisii??"),
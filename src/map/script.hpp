@@ -2248,6 +2248,14 @@ enum e_guildinfo : uint8 {
 	GUILDINFO_MASTERNAME,
 };
 
+/* ai_chat_start script command, scheduling class of the request */
+enum e_ai_dialogue_priority : uint8 {
+	AI_DIALOGUE_PRIORITY_AMBIENT = 0,	// Idle chatter, first to wait under load
+	AI_DIALOGUE_PRIORITY_NORMAL,		// Default
+	AI_DIALOGUE_PRIORITY_CRITICAL,		// Quest-critical NPCs
+	AI_DIALOGUE_PRIORITY_MAX
+};
+
 class ConstantDatabase : public YamlDatabase {
 public:
 	ConstantDatabase() : YamlDatabase("CONSTANT_DB", 1) {
@@ -10906,6 +10906,11 @@
 	export_constant(GUILDINFO_MASTERID);
 	export_constant(GUILDINFO_MASTERNAME);
 
+	/* ai_chat_start script command */
+	export_constant(AI_DIALOGUE_PRIORITY_AMBIENT);
+	export_constant(AI_DIALOGUE_PRIORITY_NORMAL);
+	export_constant(AI_DIALOGUE_PRIORITY_CRITICAL);
+
 	#undef export_constant
 	#undef export_constant2
 	#undef export_parameter
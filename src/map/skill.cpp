@@ -4166,7 +4166,24 @@ int64 skill_attack (int32 attack_type, block_list* src, block_list *dsrc, block_
  * Checking bl battle flag and display damage
  * then call func with source,target,skill_id,skill_lv,tick,flag
  *------------------------------------------*/
-typedef int32 (*SkillFunc)(block_list *, block_list *, int32, int32, t_tick, int32);
+typedef int32 (*SkillFunc)(block_list *, block_list *, uint16, uint16, t_tick, int32);
+static int32 skill_area_splash(block_list *bl, block_list *src, uint16 skill_id, uint16 skill_lv, t_tick tick, int32 flag, SkillFunc func)
+{
+	nullpo_ret(bl);
+
+	if(battle_check_target(src,bl,flag) > 0) {
+		// several splash skills need this initial dummy packet to display correctly
+		if (flag&SD_PREAMBLE && skill_area_temp[2] == 0)
+			clif_skill_damage( *src, *bl, tick, status_get_amotion(src), 0, DMGVAL_IGNORE, 1, skill_id, skill_lv, DMG_SINGLE );
+
+		if (flag&(SD_SPLASH|SD_PREAMBLE))
+			skill_area_temp[2]++;
+
+		return func(src,bl,skill_id,skill_lv,tick,flag);
+	}
+	return 0;
+}
+
 int32 skill_area_sub(block_list *bl, va_list ap)
 {
 	block_list *src;
@@ -4175,8 +4192,6 @@ int32 skill_area_sub(block_list *bl, va_list ap)
 	t_tick tick;
 	SkillFunc func;
 
-	nullpo_ret(bl);
-
 	src = va_arg(ap,block_list *);
 	skill_id = va_arg(ap,int32);
 	skill_lv = va_arg(ap,int32);
@@ -4184,17 +4199,7 @@ int32 skill_area_sub(block_list *bl, va_list ap)
 	flag = va_arg(ap,int32);
 	func = va_arg(ap,SkillFunc);
 
-	if(battle_check_target(src,bl,flag) > 0) {
-		// several splash skills need this initial dummy packet to display correctly
-		if (flag&SD_PREAMBLE && skill_area_temp[2] == 0)
-			clif_skill_damage( *src, *bl, tick, status_get_amotion(src), 0, DMGVAL_IGNORE, 1, skill_id, skill_lv, DMG_SINGLE );
-
-		if (flag&(SD_SPLASH|SD_PREAMBLE))
-			skill_area_temp[2]++;
-
-		return func(src,bl,skill_id,skill_lv,tick,flag);
-	}
-	return 0;
+	return skill_area_splash(bl, src, skill_id, skill_lv, tick, flag, func);
 }
 
 static int32 skill_check_unit_range_sub(block_list *bl, va_list ap)
@@ -6155,14 +6160,21 @@ int32 skill_castend_damage_id (block_list* src, block_list *bl, uint16 skill_id,
 			//SD_LEVEL -> Forced splash damage for Auto Blitz-Beat -> count targets
 			//special case: Venom Splasher uses a different range for searching than for splashing
 			if (flag&SD_LEVEL || skill_get_nk(skill_id, NK_SPLASHSPLIT)) {
-				skill_area_temp[0] = map_foreachinallrange(skill_area_sub, bl, (skill_id == AS_SPLASHER)?1:splash_size, BL_CHAR, src, skill_id, skill_lv, tick, BCT_ENEMY, skill_area_sub_count);
+				skill_area_temp[0] = map_foreachinallrange(bl, (skill_id == AS_SPLASHER)?1:splash_size, BL_CHAR, [&](block_list *target) {
+					return skill_area_splash(target, src, skill_id, skill_lv, tick, BCT_ENEMY, skill_area_sub_count);
+				});
 				// If there are no characters in the area, then it always counts as if there was one target
 				// This happens when targetting skill units such as icewall
 				skill_area_temp[0] = std::max(1, skill_area_temp[0]);
 			}
 
 			// recursive invocation of skill_castend_damage_id() with flag|1
-			map_foreachinrange(skill_area_sub, bl, splash_size, starget, src, skill_id, skill_lv, tick, flag|BCT_ENEMY|SD_SPLASH|1, skill_castend_damage_id);
+			t_blocklist targets;
+
+			map_getinrange(targets, bl, splash_size, starget, battle_config.skill_wall_check > 0);
+			map_foreachinlist(targets, [&](block_list *target) {
+				return skill_area_splash(target, src, skill_id, skill_lv, tick, flag|BCT_ENEMY|SD_SPLASH|1, skill_castend_damage_id);
+			});
 
 			if (skill_id == RA_ARROWSTORM)
 				status_change_end(src, SC_CAMOUFLAGE);
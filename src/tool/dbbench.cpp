@@ -0,0 +1,177 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+// Times the databases with integer keys (idb_*), the way the map-server uses
+// id_db: ids handed out in sequence, looked up in random order.
+// The tool is built on the open addressing databases (dbbench) and on the
+// hashtable of RED-BLACK trees (dbbench-trees, DB_DISABLE_OPEN_ADDRESSING),
+// run both to compare them.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <common/cbasetypes.hpp>
+#include <common/core.hpp>
+#include <common/db.hpp>
+#include <common/showmsg.hpp>
+
+using namespace rathena::server_core;
+
+namespace rathena::tool_dbbench {
+class DbBenchTool : public Core{
+	protected:
+		bool initialize( int32 argc, char* argv[] ) override;
+
+	public:
+		DbBenchTool() : Core( e_core_type::TOOL ){
+
+		}
+};
+}
+
+using namespace rathena::tool_dbbench;
+
+// Runs of every size, the best one is reported
+static const int32 DBBENCH_RUNS = 5;
+// Lookups of every run
+static const int32 DBBENCH_LOOKUPS = 20000000;
+// Entries replaced by new ids in every run
+static const int32 DBBENCH_CHURN = 2000000;
+// First id, like START_ACCOUNT_NUM
+static const int32 DBBENCH_START_ID = 2000000;
+
+struct s_dbbench_result {
+	double insert;
+	double lookup;
+	double iterate;
+	double churn;
+};
+
+static double dbbench_ns( std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end, double count ){
+	return std::chrono::duration<double, std::nano>( end - start ).count() / count;
+}
+
+/**
+ * Times one size of the database
+ * @param entries: Amount of entries
+ * @return Best time per operation of all runs, in nanoseconds
+ */
+static s_dbbench_result dbbench_run( int32 entries ){
+	std::mt19937_64 rng( 7 );
+	std::vector<int32> ids( entries );
+	s_dbbench_result best = { 1e9, 1e9, 1e9, 1e9 };
+	int32 lookups = std::max( DBBENCH_LOOKUPS / entries, 1 );
+	int32 iterations = lookups / 4 + 1;
+	intptr_t sum = 0;
+
+	for( int32 run = 0; run < DBBENCH_RUNS; run++ ){
+		for( int32 i = 0; i < entries; i++ ){
+			ids[i] = DBBENCH_START_ID + i;
+		}
+
+		DBMap* db = idb_alloc( DB_OPT_BASE );
+
+		auto start = std::chrono::steady_clock::now();
+
+		for( int32 id : ids ){
+			idb_put( db, id, (void*)(intptr_t)( id | 1 ) );
+		}
+
+		auto inserted = std::chrono::steady_clock::now();
+
+		std::shuffle( ids.begin(), ids.end(), rng );
+
+		auto shuffled = std::chrono::steady_clock::now();
+
+		for( int32 i = 0; i < lookups; i++ ){
+			for( int32 id : ids ){
+				sum += (intptr_t)idb_get( db, id );
+			}
+		}
+
+		auto looked_up = std::chrono::steady_clock::now();
+
+		for( int32 i = 0; i < iterations; i++ ){
+			DBIterator* iter = db_iterator( db );
+
+			for( void* data = dbi_first( iter ); dbi_exists( iter ); data = dbi_next( iter ) ){
+				sum += (intptr_t)data;
+			}
+
+			dbi_destroy( iter );
+		}
+
+		auto iterated = std::chrono::steady_clock::now();
+
+		// Characters leave and new ones get the next free ids
+		for( int32 i = 0; i < DBBENCH_CHURN; i++ ){
+			int32& id = ids[i % entries];
+
+			idb_remove( db, id );
+			id += entries;
+			idb_put( db, id, (void*)(intptr_t)( id | 1 ) );
+		}
+
+		auto churned = std::chrono::steady_clock::now();
+
+		best.insert = std::min( best.insert, dbbench_ns( start, inserted, entries ) );
+		best.lookup = std::min( best.lookup, dbbench_ns( shuffled, looked_up, (double)lookups * entries ) );
+		best.iterate = std::min( best.iterate, dbbench_ns( looked_up, iterated, (double)iterations * entries ) );
+		best.churn = std::min( best.churn, dbbench_ns( iterated, churned, DBBENCH_CHURN ) );
+
+		db_destroy( db );
+	}
+
+	// Keep the lookups from being optimized away
+	if( sum == 0 ){
+		ShowDebug( "dbbench: no data\n" );
+	}
+
+	return best;
+}
+
+bool DbBenchTool::initialize( int32 argc, char* argv[] ){
+	std::vector<int32> sizes;
+
+	for( int32 i = 1; i < argc; i++ ){
+		int32 entries = atoi( argv[i] );
+
+		if( entries <= 0 ){
+			ShowError( "Usage: %s [entries...]\n", argv[0] );
+			return false;
+		}
+
+		sizes.push_back( entries );
+	}
+
+	if( sizes.empty() ){
+		sizes = { 100, 10000, 200000 };
+	}
+
+	db_init();
+
+#ifdef DB_DISABLE_OPEN_ADDRESSING
+	ShowInfo( "Databases with integer keys use the hashtable of trees.\n" );
+#else
+	ShowInfo( "Databases with integer keys use open addressing.\n" );
+#endif
+	ShowInfo( "Best of %d runs, nanoseconds per operation:\n", DBBENCH_RUNS );
+	ShowMessage( "%10s %8s %8s %13s %14s\n", "entries", "insert", "lookup", "iterate/entry", "remove+insert" );
+
+	for( int32 entries : sizes ){
+		s_dbbench_result result = dbbench_run( entries );
+
+		ShowMessage( "%10d %8.1f %8.1f %13.1f %14.1f\n", entries, result.insert, result.lookup, result.iterate, result.churn );
+	}
+
+	db_final();
+
+	return true;
+}
+
+int32 main( int32 argc, char *argv[] ){
+	return main_core<DbBenchTool>( argc, argv );
+}
@@ -0,0 +1,241 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+// Times the A* walk path search of the map-server on the maps of the map
+// cache, once without and once with the path cache of the maps.
+// Every map gets random searches of up to 14 cells around walkable cells,
+// each one repeated like a monster chasing its target. The cached searches
+// are compared with the uncached ones.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <common/cbasetypes.hpp>
+#include <common/core.hpp>
+#include <common/grfio.hpp>
+#include <common/mmo.hpp>
+#include <common/showmsg.hpp>
+
+#include <map/battle.hpp>
+#include <map/cell_grid.hpp>
+#include <map/map.hpp>
+#include <map/path.hpp>
+
+using namespace rathena::server_core;
+
+namespace rathena::tool_pathbench {
+class PathBenchTool : public Core{
+	protected:
+		bool initialize( int32 argc, char* argv[] ) override;
+
+	public:
+		PathBenchTool() : Core( e_core_type::TOOL ){
+
+		}
+};
+}
+
+using namespace rathena::tool_pathbench;
+
+// Searches per map
+static const size_t PATHBENCH_SEARCHES = 400;
+// How often every search is repeated
+static const int32 PATHBENCH_REPEATS = 8;
+// Searches the path cache of a map keeps during the run
+static const int32 PATHBENCH_CACHE_SIZE = 1024;
+
+// Layout of db/map_cache.dat, see map_readfromcache
+struct map_cache_main_header {
+	uint32 file_size;
+	uint16 map_count;
+};
+
+struct map_cache_map_info {
+	char name[MAP_NAME_LENGTH];
+	int16 xs;
+	int16 ys;
+	int32 len;
+};
+
+struct s_pathbench_search {
+	int16 x0, y0, x1, y1;
+	cell_chk cell;
+};
+
+// The searches run on map 0, the parts of the map-server that path.cpp uses
+struct Battle_Config battle_config;
+static struct map_data pathbench_map;
+
+struct map_data* map_getmapdata( int16 m ){
+	return m == 0 ? &pathbench_map : nullptr;
+}
+
+/// The cell checks of the path searches, like in map.cpp
+int32 map_getcellp( struct map_data* m, int16 x, int16 y, cell_chk cellchk ){
+	if( x < 0 || x >= m->xs - 1 || y < 0 || y >= m->ys - 1 )
+		return ( cellchk == CELL_CHKNOPASS );
+
+	const CellGrid& cells = *m->cell;
+
+	switch( cellchk ){
+		case CELL_CHKWALL:
+			return ( !cells.get( CELL_WALKABLE, x, y ) && !cells.get( CELL_SHOOTABLE, x, y ) );
+		case CELL_CHKPASS:
+		case CELL_CHKREACH:
+			return ( cells.get( CELL_WALKABLE, x, y ) );
+		case CELL_CHKNOPASS:
+		case CELL_CHKNOREACH:
+			return ( !cells.get( CELL_WALKABLE, x, y ) );
+		default:
+			return 0;
+	}
+}
+
+/// Same as map_setgat
+static void pathbench_setgat( CellGrid& cells, int16 x, int16 y, int32 gat ){
+	cells.set( CELL_WALKABLE, x, y, gat != 1 && gat != 5 );
+	cells.set( CELL_SHOOTABLE, x, y, gat != 1 );
+	cells.set( CELL_WATER, x, y, gat == 3 );
+}
+
+static double pathbench_time( const std::vector<s_pathbench_search>& searches ){
+	auto start = std::chrono::steady_clock::now();
+
+	for( int32 i = 0; i < PATHBENCH_REPEATS; i++ ){
+		for( const s_pathbench_search& search : searches ){
+			walkpath_data wpd;
+
+			path_search( &wpd, 0, search.x0, search.y0, search.x1, search.y1, 0, search.cell );
+		}
+	}
+
+	return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+bool PathBenchTool::initialize( int32 argc, char* argv[] ){
+	std::string filename = argc > 1 ? argv[1] : "db/map_cache.dat";
+	int32 max_maps = argc > 2 ? atoi( argv[2] ) : INT32_MAX;
+	FILE* fp = fopen( filename.c_str(), "rb" );
+
+	if( fp == nullptr ){
+		ShowError( "Usage: %s [map cache [maps]], could not open '%s'.\n", argv[0], filename.c_str() );
+		return false;
+	}
+
+	fseek( fp, 0, SEEK_END );
+	std::vector<char> buffer( ftell( fp ) );
+	fseek( fp, 0, SEEK_SET );
+
+	if( fread( buffer.data(), 1, buffer.size(), fp ) != buffer.size() || buffer.size() < sizeof( map_cache_main_header ) ){
+		ShowError( "Could not read '%s'.\n", filename.c_str() );
+		fclose( fp );
+		return false;
+	}
+
+	fclose( fp );
+
+	const map_cache_main_header* header = (const map_cache_main_header*)buffer.data();
+	const char* p = buffer.data() + sizeof( map_cache_main_header );
+	std::vector<uint8> cells;
+	std::mt19937 rng( 1234 );
+	const cell_chk checks[] = { CELL_CHKNOREACH, CELL_CHKNOPASS, CELL_CHKWALL };
+	int32 maps = 0;
+	uint64 searches = 0, mismatches = 0;
+	double uncached = 0, cached = 0;
+
+	do_init_path();
+
+	for( int32 i = 0; i < header->map_count && maps < max_maps; i++ ){
+		const map_cache_map_info* info = (const map_cache_map_info*)p;
+		unsigned long size = (unsigned long)info->xs * (unsigned long)info->ys;
+
+		p += sizeof( map_cache_map_info ) + info->len;
+
+		if( info->xs <= 0 || info->ys <= 0 || size > MAX_MAP_SIZE ){
+			continue;
+		}
+
+		cells.resize( size );
+		decode_zip( cells.data(), &size, info + 1, info->len );
+
+		delete pathbench_map.cell;
+		pathbench_map.xs = info->xs;
+		pathbench_map.ys = info->ys;
+		pathbench_map.cell = new CellGrid( info->xs, info->ys );
+		pathbench_map.paths.clear();
+
+		for( unsigned long xy = 0; xy < size; xy++ ){
+			pathbench_setgat( *pathbench_map.cell, (int16)( xy % info->xs ), (int16)( xy / info->xs ), cells[xy] );
+		}
+
+		std::vector<s_pathbench_search> map_searches;
+
+		for( int32 tries = 0; map_searches.size() < PATHBENCH_SEARCHES && tries < 200000; tries++ ){
+			int32 x0 = rng() % info->xs, y0 = rng() % info->ys;
+			int32 x1 = x0 + (int32)( rng() % 29 ) - 14, y1 = y0 + (int32)( rng() % 29 ) - 14;
+
+			if( x1 < 0 || y1 < 0 || x1 >= info->xs || y1 >= info->ys || !pathbench_map.cell->get( CELL_WALKABLE, x0, y0 ) ){
+				continue;
+			}
+
+			map_searches.push_back( { (int16)x0, (int16)y0, (int16)x1, (int16)y1, checks[rng() % ARRAYLENGTH( checks )] } );
+		}
+
+		// Maps without walkable cells
+		if( map_searches.empty() ){
+			continue;
+		}
+
+		maps++;
+		searches += map_searches.size() * PATHBENCH_REPEATS;
+
+		battle_config.path_cache_size = 0;
+		uncached += pathbench_time( map_searches );
+
+		battle_config.path_cache_size = PATHBENCH_CACHE_SIZE;
+		cached += pathbench_time( map_searches );
+
+		for( const s_pathbench_search& search : map_searches ){
+			walkpath_data wpd_uncached = {}, wpd_cached = {};
+
+			battle_config.path_cache_size = 0;
+			bool found = path_search( &wpd_uncached, 0, search.x0, search.y0, search.x1, search.y1, 0, search.cell );
+			battle_config.path_cache_size = PATHBENCH_CACHE_SIZE;
+
+			if( found != path_search( &wpd_cached, 0, search.x0, search.y0, search.x1, search.y1, 0, search.cell ) ||
+				( found && ( wpd_uncached.path_len != wpd_cached.path_len || memcmp( wpd_uncached.path, wpd_cached.path, wpd_uncached.path_len * sizeof( wpd_uncached.path[0] ) ) != 0 ) ) ){
+				mismatches++;
+			}
+		}
+	}
+
+	delete pathbench_map.cell;
+	pathbench_map.cell = nullptr;
+	pathbench_map.paths.clear();
+
+	do_final_path();
+
+	uint64 hits, misses;
+
+	path_cache_usage( &hits, &misses );
+
+	ShowInfo( "%d maps, %" PRIu64 " searches, %d repeats of every search.\n", maps, searches, PATHBENCH_REPEATS );
+	ShowInfo( "Without path cache: %.3fs (%.0fns per search)\n", uncached, uncached * 1e9 / searches );
+	ShowInfo( "With path cache:    %.3fs (%.0fns per search), %" PRIu64 " hits, %" PRIu64 " misses\n", cached, cached * 1e9 / searches, hits, misses );
+
+	if( mismatches > 0 ){
+		ShowError( "%" PRIu64 " cached searches differ from the search.\n", mismatches );
+		return false;
+	}
+
+	return true;
+}
+
+int32 main( int32 argc, char *argv[] ){
+	return main_core<PathBenchTool>( argc, argv );
+}
@@ -0,0 +1,24 @@
+#
+# Runs timercheck on the timer heap and on the timing wheel, both have to fire
+# the timers in the same order
+#
+foreach( TIMERS HEAP WHEEL )
+	execute_process(
+		COMMAND "${TIMERCHECK_${TIMERS}}" "${TIMERCHECK_DIR}/timercheck-${TIMERS}.txt"
+		RESULT_VARIABLE RESULT
+		OUTPUT_QUIET
+	)
+	if( NOT RESULT EQUAL 0 )
+		message( FATAL_ERROR "timercheck failed on the ${TIMERS} timers" )
+	endif()
+endforeach()
+
+execute_process(
+	COMMAND "${CMAKE_COMMAND}" -E compare_files "${TIMERCHECK_DIR}/timercheck-HEAP.txt" "${TIMERCHECK_DIR}/timercheck-WHEEL.txt"
+	RESULT_VARIABLE RESULT
+)
+if( NOT RESULT EQUAL 0 )
+	message( FATAL_ERROR "The timing wheel fired the timers in another order than the timer heap" )
+endif()
+
+file( REMOVE "${TIMERCHECK_DIR}/timercheck-HEAP.txt" "${TIMERCHECK_DIR}/timercheck-WHEEL.txt" )
@@ -0,0 +1,342 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+// Runs a fixed series of timers and writes the order in which they fired.
+// The tool is built once on the timer heap and once on the timing wheel
+// (TIMER_WHEEL), the traces of both builds have to be identical.
+//
+// Timers are added, deleted and moved from the main loop and from inside
+// the callbacks, with delays from a few milliseconds to several hours, so
+// every level of the wheel is cascaded. The heap does not order timers that
+// expire on the same tick, so only the interval timers share ticks; their
+// callbacks do nothing but record, and the records of one tick are sorted.
+// The timer ids are part of the trace, a deleted timer must keep its id
+// until it expires, like in the heap.
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <common/cbasetypes.hpp>
+#include <common/core.hpp>
+#include <common/showmsg.hpp>
+#include <common/timer.hpp>
+
+using namespace rathena::server_core;
+
+namespace rathena::tool_timercheck {
+class TimerCheckTool : public Core{
+	protected:
+		bool initialize( int32 argc, char* argv[] ) override;
+
+	public:
+		TimerCheckTool() : Core( e_core_type::TOOL ){
+
+		}
+};
+}
+
+using namespace rathena::tool_timercheck;
+
+// Passes of do_timer
+static const int32 TIMERCHECK_PASSES = 200000;
+// Single-use timers that are kept pending
+static const size_t TIMERCHECK_PENDING = 400;
+
+struct s_timercheck_record {
+	int32 pass;
+	t_tick tick;
+	int32 tid;
+	int32 label;
+
+	bool operator<( const s_timercheck_record& other ) const {
+		if( this->tick != other.tick )
+			return this->tick < other.tick;
+
+		return this->tid < other.tid;
+	}
+};
+
+static t_tick timercheck_base; // Start of the fake clock
+static t_tick timercheck_now; // Tick of the running pass
+static int32 timercheck_pass;
+static int32 timercheck_label = 0; // Serial number of the created timers
+static uint64 timercheck_seed = 0x2545F4914F6CDD1DULL;
+
+static std::vector<s_timercheck_record> timercheck_records; // Records of the running pass
+static std::map<int32, t_tick> timercheck_once; // Pending single-use timers, tid -> tick
+static std::set<t_tick> timercheck_once_ticks; // Ticks of the single-use timers, deleted ones included
+static std::vector<int32> timercheck_intervals;
+
+static uint32 timercheck_rand( uint32 range ){
+	// xorshift64*, the same sequence on every platform
+	timercheck_seed ^= timercheck_seed >> 12;
+	timercheck_seed ^= timercheck_seed << 25;
+	timercheck_seed ^= timercheck_seed >> 27;
+
+	return (uint32)( ( timercheck_seed * 0x2545F4914F6CDD1DULL ) >> 32 ) % range;
+}
+
+/// Delay of a new timer, mostly within level 0 but reaching every level
+static t_tick timercheck_delay(){
+	switch( timercheck_rand( 10 ) ){
+		case 0:
+			return 1 + timercheck_rand( 20000000 ); // Hours, level 3
+		case 1:
+		case 2:
+			return 1 + timercheck_rand( 70000 ); // Minutes, level 2
+		case 3:
+		case 4:
+			return 1 + timercheck_rand( 5000 ); // Seconds, level 1
+		default:
+			return 1 + timercheck_rand( 256 );
+	}
+}
+
+/// Free tick after the given tick for a single-use timer
+/// Interval timers only use ticks that are a multiple of 4 from the start, single-use timers never do.
+static t_tick timercheck_free_tick( t_tick after ){
+	t_tick tick = after + timercheck_delay();
+
+	while( ( tick - timercheck_base ) % 4 == 0 || timercheck_once_ticks.find( tick ) != timercheck_once_ticks.end() ){
+		tick++;
+	}
+
+	return tick;
+}
+
+/// Pending single-use timer that is not due in the running pass, INVALID_TIMER if there is none
+static int32 timercheck_pick(){
+	std::vector<int32> candidates;
+
+	for( const auto& it : timercheck_once ){
+		if( DIFF_TICK( it.second, timercheck_now ) > 0 ){
+			candidates.push_back( it.first );
+		}
+	}
+
+	if( candidates.empty() ){
+		return INVALID_TIMER;
+	}
+
+	return candidates[timercheck_rand( (uint32)candidates.size() )];
+}
+
+static TIMER_FUNC( timercheck_once_timer );
+
+static void timercheck_add( t_tick after ){
+	t_tick tick = timercheck_free_tick( after );
+	int32 tid = add_timer( tick, timercheck_once_timer, timercheck_label++, 0 );
+
+	timercheck_once[tid] = tick;
+	timercheck_once_ticks.insert( tick );
+}
+
+/// Adds, deletes and moves some of the single-use timers
+static void timercheck_mutate( t_tick after ){
+	if( timercheck_once.size() < TIMERCHECK_PENDING ){
+		for( uint32 i = timercheck_rand( 3 ); i > 0; i-- ){
+			timercheck_add( after );
+		}
+	}
+
+	if( timercheck_rand( 4 ) == 0 ){
+		int32 tid = timercheck_pick();
+
+		if( tid != INVALID_TIMER ){
+			// The tick stays taken until the deleted timer expired
+			delete_timer( tid, timercheck_once_timer );
+			timercheck_once.erase( tid );
+		}
+	}
+
+	if( timercheck_rand( 4 ) == 0 ){
+		int32 tid = timercheck_pick();
+
+		if( tid != INVALID_TIMER ){
+			t_tick tick = timercheck_free_tick( after );
+
+			settick_timer( tid, tick );
+			timercheck_once_ticks.erase( timercheck_once[tid] );
+			timercheck_once[tid] = tick;
+			timercheck_once_ticks.insert( tick );
+		}
+	}
+}
+
+static TIMER_FUNC( timercheck_once_timer ){
+	timercheck_records.push_back( { timercheck_pass, tick - timercheck_base, tid, id } );
+
+	timercheck_once_ticks.erase( timercheck_once[tid] );
+	timercheck_once.erase( tid );
+
+	timercheck_mutate( timercheck_now );
+
+	return 0;
+}
+
+static TIMER_FUNC( timercheck_interval_timer ){
+	timercheck_records.push_back( { timercheck_pass, tick - timercheck_base, tid, id } );
+
+	return 0;
+}
+
+static TIMER_FUNC( timercheck_noop_timer ){
+	return 0;
+}
+
+/**
+ * Writes the records of the running pass
+ * @return false if the timers did not fire in the order of their ticks
+ */
+static bool timercheck_flush( FILE* fp ){
+	if( !std::is_sorted( timercheck_records.begin(), timercheck_records.end(), []( const s_timercheck_record& a, const s_timercheck_record& b ){ return a.tick < b.tick; } ) ){
+		ShowError( "Timers of pass %d fired out of the order of their ticks.\n", timercheck_pass );
+		return false;
+	}
+
+	// Only the order within a tick may differ
+	std::sort( timercheck_records.begin(), timercheck_records.end() );
+
+	for( const s_timercheck_record& record : timercheck_records ){
+		fprintf( fp, "%d %" PRtf " %d %d\n", record.pass, record.tick, record.tid, record.label );
+	}
+
+	timercheck_records.clear();
+
+	return true;
+}
+
+static std::vector<int32> timercheck_order;
+
+static TIMER_FUNC( timercheck_order_timer ){
+	timercheck_order.push_back( id );
+
+	return 0;
+}
+
+/**
+ * Timers of the same tick fire in the order they were scheduled, the heap
+ * does not promise any order for them.
+ * @return true if the order was kept
+ */
+static bool timercheck_same_tick(){
+#ifdef TIMER_WHEEL
+	// Cascaded from level 2 and level 1 down to the slot of the new timers
+	t_tick tick = timercheck_now + 70000;
+
+	add_timer( tick, timercheck_order_timer, 0, 0 );
+
+	for( timercheck_now += 1000; DIFF_TICK( tick - 1000, timercheck_now ) > 0; timercheck_now += 1000 ){
+		do_timer( timercheck_now );
+	}
+
+	add_timer( tick - 10, timercheck_order_timer, 1, 0 );
+	add_timer( tick, timercheck_order_timer, 2, 0 );
+
+	int32 moved = add_timer( tick + 10, timercheck_order_timer, 4, 0 );
+
+	add_timer( tick, timercheck_order_timer, 3, 0 );
+
+	// Moving a timer schedules it again
+	settick_timer( moved, tick );
+
+	timercheck_now = tick;
+	do_timer( timercheck_now );
+
+	if( timercheck_order != std::vector<int32>{ 1, 0, 2, 3, 4 } ){
+		ShowError( "Timers of the same tick fired out of order.\n" );
+		return false;
+	}
+#endif
+
+	return true;
+}
+
+bool TimerCheckTool::initialize( int32 argc, char* argv[] ){
+	if( argc < 2 ){
+		ShowError( "Usage: %s <trace file>\n", argv[0] );
+		return false;
+	}
+
+	FILE* fp = fopen( argv[1], "w" );
+
+	if( fp == nullptr ){
+		ShowError( "Could not open '%s' for writing.\n", argv[1] );
+		return false;
+	}
+
+	timer_init();
+
+	// The wheel starts at the current tick, the fake clock must not start before it
+	add_timer( gettick(), timercheck_noop_timer, 0, 0 );
+	timercheck_base = gettick();
+	timercheck_now = timercheck_base;
+
+	for( int32 i = 0; i < 32; i++ ){
+		int32 interval = 4 * ( 1 + (int32)timercheck_rand( 500 ) );
+
+		timercheck_intervals.push_back( add_timer_interval( timercheck_base + 4 * ( 1 + timercheck_rand( 250 ) ), timercheck_interval_timer, timercheck_label++, 0, interval ) );
+	}
+
+	for( size_t i = 0; i < TIMERCHECK_PENDING; i++ ){
+		timercheck_add( timercheck_base );
+	}
+
+	for( timercheck_pass = 0; timercheck_pass < TIMERCHECK_PASSES; timercheck_pass++ ){
+		// A timer is never late by more than a second, the callbacks always get its own tick
+		switch( timercheck_rand( 20 ) ){
+			case 0:
+				timercheck_now += 1000;
+				break;
+			case 1:
+			case 2:
+			case 3:
+				timercheck_now += 40 + timercheck_rand( 960 );
+				break;
+			default:
+				timercheck_now += 1 + timercheck_rand( 40 );
+				break;
+		}
+
+		do_timer( timercheck_now );
+
+		if( !timercheck_flush( fp ) ){
+			fclose( fp );
+			timer_final();
+			return false;
+		}
+
+		timercheck_once_ticks.erase( timercheck_once_ticks.begin(), timercheck_once_ticks.upper_bound( timercheck_now ) );
+		timercheck_mutate( timercheck_now );
+
+		// Replace an interval timer now and then
+		if( timercheck_rand( 500 ) == 0 ){
+			size_t i = timercheck_rand( (uint32)timercheck_intervals.size() );
+			t_tick start = timercheck_now + 4 - ( timercheck_now - timercheck_base ) % 4;
+
+			delete_timer( timercheck_intervals[i], timercheck_interval_timer );
+			timercheck_intervals[i] = add_timer_interval( start + 4 * timercheck_rand( 250 ), timercheck_interval_timer, timercheck_label++, 0, 4 * ( 1 + (int32)timercheck_rand( 500 ) ) );
+		}
+	}
+
+	fclose( fp );
+
+	bool result = timercheck_same_tick();
+
+	timer_final();
+
+	if( result ){
+		ShowStatus( "Wrote the timers of %d passes to '%s'.\n", TIMERCHECK_PASSES, argv[1] );
+	}
+
+	return result;
+}
+
+int32 main( int32 argc, char *argv[] ){
+	return main_core<TimerCheckTool>( argc, argv );
+}
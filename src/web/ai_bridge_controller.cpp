@@ -3,14 +3,22 @@
 
 #include "ai_bridge_controller.hpp"
 
+#include <ctime>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+
+#include <nlohmann/json.hpp>
 
 #include <common/cbasetypes.hpp>
 #include <common/showmsg.hpp>
 #include <common/socket.hpp>
 #include <common/strlib.hpp>
+#include <common/utils.hpp>
 
+#include "ai_upstream.hpp"
 #include "auth.hpp"
 #include "http.hpp"
 #include "web.hpp"
@@ -21,11 +29,45 @@ namespace AIBridge {
 	uint16 ai_service_port = 8000;
 	std::string ai_service_api_key = "";
 	bool ai_service_enabled = true;
+	int32 ai_service_connect_timeout = 5000;
+	int32 ai_service_read_timeout = 5000;
+	int32 ai_service_generate_timeout = 30000;
+	int32 ai_service_max_connections = 4;
+	int32 ai_service_max_idle_connections = 8;
+	int32 ai_service_breaker_threshold = 5;
+	int32 ai_service_breaker_cooldown = 10000;
+	int32 ai_service_read_cache_ttl = 1000;
+	int32 ai_service_read_cache_entries = 256;
+
+	// Shared upstream client, created by initialize()
+	std::unique_ptr<AIUpstreamClient> upstream;
+
+	// NPC persona versions, bumped whenever an NPC's state changes
+	static std::unordered_map<std::string, uint64> npc_versions;
+	static std::mutex npc_versions_mutex;
+	static uint64 npc_versions_epoch = static_cast<uint64>(time(nullptr));
 
 	void initialize() {
 		ShowInfo("[AI Bridge] Initializing AI Bridge Layer...\n");
 		ShowInfo("[AI Bridge] AI Service URL: %s:%d\n", ai_service_url.c_str(), ai_service_port);
 		ShowInfo("[AI Bridge] AI Service Enabled: %s\n", ai_service_enabled ? "Yes" : "No");
+
+		AIUpstreamConfig config;
+
+		config.host = ai_service_url;
+		config.port = ai_service_port;
+		config.api_key = ai_service_api_key;
+		config.connect_timeout_ms = ai_service_connect_timeout;
+		config.read_timeout_ms = ai_service_read_timeout;
+		config.generate_timeout_ms = ai_service_generate_timeout;
+		config.max_idle_connections = ai_service_max_idle_connections;
+		config.max_concurrent_requests = ai_service_max_connections;
+		config.breaker_failure_threshold = ai_service_breaker_threshold;
+		config.breaker_open_ms = ai_service_breaker_cooldown;
+		config.read_cache_ttl_ms = ai_service_read_cache_ttl;
+		config.read_cache_max_entries = ai_service_read_cache_entries;
+
+		upstream = std::make_unique<AIUpstreamClient>(config);
 	}
 
 	void read_config(const char* w1, const char* w2) {
@@ -37,9 +79,32 @@ namespace AIBridge {
 			ai_service_port = (uint16)atoi(w2);
 		} else if (!strcmpi(w1, "ai_service_api_key")) {
 			ai_service_api_key = w2;
+		} else if (!strcmpi(w1, "ai_service_connect_timeout")) {
+			ai_service_connect_timeout = cap_value(atoi(w2), 100, 60000);
+		} else if (!strcmpi(w1, "ai_service_read_timeout")) {
+			ai_service_read_timeout = cap_value(atoi(w2), 100, 300000);
+		} else if (!strcmpi(w1, "ai_service_generate_timeout")) {
+			ai_service_generate_timeout = cap_value(atoi(w2), 100, 300000);
+		} else if (!strcmpi(w1, "ai_service_max_connections")) {
+			ai_service_max_connections = max(atoi(w2), 1);
+		} else if (!strcmpi(w1, "ai_service_max_idle_connections")) {
+			ai_service_max_idle_connections = max(atoi(w2), 0);
+		} else if (!strcmpi(w1, "ai_service_breaker_threshold")) {
+			ai_service_breaker_threshold = max(atoi(w2), 1);
+		} else if (!strcmpi(w1, "ai_service_breaker_cooldown")) {
+			ai_service_breaker_cooldown = max(atoi(w2), 0);
+		} else if (!strcmpi(w1, "ai_service_read_cache_ttl")) {
+			ai_service_read_cache_ttl = max(atoi(w2), 0);
+		} else if (!strcmpi(w1, "ai_service_read_cache_entries")) {
+			ai_service_read_cache_entries = max(atoi(w2), 1);
 		}
 	}
 
+	void bump_npc_version(const std::string& npc_id) {
+		std::lock_guard<std::mutex> lock(npc_versions_mutex);
+		npc_versions[npc_id]++;
+	}
+
 	// Helper function to extract path parameter (e.g., NPC ID from /ai/npc/{id}/action)
 	std::string extract_path_param(const std::string& path, const std::string& prefix) {
 		if (path.find(prefix) != 0) {
@@ -83,7 +148,7 @@ namespace AIBridge {
 		std::string& response_body,
 		int& status_code
 	) {
-		if (!ai_service_enabled) {
+		if (!ai_service_enabled || upstream == nullptr) {
 			ShowWarning("[AI Bridge] AI Service is disabled. Skipping request to %s\n", endpoint.c_str());
 			status_code = 503; // Service Unavailable
 			response_body = "{\"error\": \"AI Service is disabled\"}";
@@ -93,72 +158,13 @@ namespace AIBridge {
 		try {
 			ShowDebug("[AI Bridge] Making %s request to AI Service: %s\n", method.c_str(), endpoint.c_str());
 			ShowDebug("[AI Bridge] Request body: %s\n", body.c_str());
-			
-			// Create HTTP client
-			httplib::Client client(ai_service_url.c_str(), ai_service_port);
-			client.set_connection_timeout(5, 0); // 5 seconds
-			client.set_read_timeout(30, 0); // 30 seconds
-			client.set_write_timeout(5, 0); // 5 seconds
-			
-			// Set headers
-			httplib::Headers headers = {
-				{"Content-Type", "application/json"},
-				{"User-Agent", "rAthena-AI-Bridge/1.0"}
-			};
-			
-			// Add API key if configured
-			if (!ai_service_api_key.empty()) {
-				headers.insert({"X-API-Key", ai_service_api_key});
-			}
-			
-			// Make request based on method and get response
-			if (method == "GET") {
-				auto res = client.Get(endpoint.c_str(), headers);
-				if (!res) {
-					auto err = res.error();
-					ShowError("[AI Bridge] HTTP GET request failed: %s (error code: %d)\n",
-						httplib::to_string(err).c_str(), static_cast<int>(err));
-					status_code = 503; // Service Unavailable
-					response_body = "{\"error\": \"Failed to connect to AI Service\"}";
-					return false;
-				}
-				status_code = res->status;
-				response_body = res->body;
-			} else if (method == "POST") {
-				auto res = client.Post(endpoint.c_str(), headers, body, "application/json");
-				if (!res) {
-					auto err = res.error();
-					ShowError("[AI Bridge] HTTP POST request failed: %s (error code: %d)\n",
-						httplib::to_string(err).c_str(), static_cast<int>(err));
-					status_code = 503; // Service Unavailable
-					response_body = "{\"error\": \"Failed to connect to AI Service\"}";
-					return false;
-				}
-				status_code = res->status;
-				response_body = res->body;
-			} else if (method == "PUT") {
-				auto res = client.Put(endpoint.c_str(), headers, body, "application/json");
-				if (!res) {
-					auto err = res.error();
-					ShowError("[AI Bridge] HTTP PUT request failed: %s (error code: %d)\n",
-						httplib::to_string(err).c_str(), static_cast<int>(err));
-					status_code = 503; // Service Unavailable
-					response_body = "{\"error\": \"Failed to connect to AI Service\"}";
-					return false;
-				}
-				status_code = res->status;
-				response_body = res->body;
-			} else {
-				ShowError("[AI Bridge] Unsupported HTTP method: %s\n", method.c_str());
-				status_code = 400;
-				response_body = "{\"error\": \"Unsupported HTTP method\"}";
-				return false;
-			}
+
+			bool success = upstream->request(endpoint, method, body, response_body, status_code);
 
 			ShowDebug("[AI Bridge] Response status: %d\n", status_code);
 			ShowDebug("[AI Bridge] Response body: %s\n", response_body.c_str());
 
-			return (status_code >= 200 && status_code < 300);
+			return success;
 
 		} catch (const std::exception& e) {
 			ShowError("[AI Bridge] Exception during HTTP request: %s\n", e.what());
@@ -167,6 +173,50 @@ namespace AIBridge {
 			return false;
 		}
 	}
+
+	bool make_shared_ai_request(
+		const httplib::Request& req,
+		httplib::Response& res,
+		const std::string& endpoint,
+		int& status_code
+	) {
+		if (!ai_service_enabled || upstream == nullptr) {
+			std::string response_body;
+			bool success = make_ai_request(endpoint, "GET", "", response_body, status_code);
+
+			res.status = status_code;
+			res.set_content(response_body, "application/json");
+			return success;
+		}
+
+		std::shared_ptr<const AIUpstreamReadEntry> answer = upstream->shared_get(endpoint);
+
+		status_code = answer->status_code;
+
+		if (status_code != 200) {
+			res.status = status_code;
+			res.set_content(answer->body, "application/json");
+			return (status_code >= 200 && status_code < 300);
+		}
+
+		res.set_header("ETag", answer->etag);
+		res.set_header("Cache-Control", "no-cache");
+
+		// The client already has this answer
+		if (req.has_header("If-None-Match")) {
+			std::string tags = req.get_header_value("If-None-Match");
+
+			if (tags == "*" || tags.find(answer->etag) != std::string::npos) {
+				res.status = 304; // Not Modified
+				return true;
+			}
+		}
+
+		res.status = status_code;
+		res.set_content(answer->body, "application/json");
+
+		return true;
+	}
 }
 
 // Helper function to extract path parameter
@@ -299,6 +349,7 @@ HANDLER_FUNC(ai_world_state_update) {
 	res.set_content(response_body, "application/json");
 
 	if (success) {
+		AIBridge::upstream->invalidate_reads("/ai/world/state");
 		ShowInfo("[AI Bridge] World state updated successfully\n");
 	} else {
 		ShowWarning("[AI Bridge] World state update failed with status %d\n", status_code);
@@ -318,14 +369,9 @@ HANDLER_FUNC(ai_world_state_get) {
 		ShowDebug("[AI Bridge] Query parameters: %s\n", query_string.c_str());
 	}
 
-	// Forward to AI service
-	std::string response_body;
+	// Forward to AI service, shared with concurrent pollers
 	int status_code;
-	bool success = AIBridge::make_ai_request(endpoint, "GET", "", response_body, status_code);
-
-	// Set response
-	res.status = status_code;
-	res.set_content(response_body, "application/json");
+	bool success = AIBridge::make_shared_ai_request(req, res, endpoint, status_code);
 
 	if (success) {
 		ShowInfo("[AI Bridge] World state retrieved successfully\n");
@@ -505,6 +551,88 @@ HANDLER_FUNC(ai_chat_command) {
 	}
 }
 
+// POST /ai/chat/stream
+HANDLER_FUNC(ai_chat_stream) {
+	ShowInfo("[AI Bridge] Received streaming chat command request\n");
+
+	if (!AIBridge::ai_service_enabled || AIBridge::upstream == nullptr) {
+		ShowWarning("[AI Bridge] AI Service is disabled. Skipping request to /ai/chat/stream\n");
+		res.status = 503;
+		res.set_content("{\"error\": \"AI Service is disabled\"}", "application/json");
+		return;
+	}
+
+	std::string error;
+
+	// The stream counts against the upstream concurrency limit until the response is released
+	if (!AIBridge::upstream->begin(error)) {
+		ShowWarning("[AI Bridge] Rejected request to /ai/chat/stream: %s\n", error.c_str());
+		res.status = 503;
+		res.set_content(nlohmann::json({ { "error", error } }).dump(), "application/json");
+		return;
+	}
+
+	const AIUpstreamConfig& config = AIBridge::upstream->get_config();
+	std::string request_body = req.body;
+	std::string service_url = config.host;
+	uint16 service_port = config.port;
+	std::string api_key = config.api_key;
+	int32 connect_timeout = config.connect_timeout_ms;
+	int32 read_timeout = config.generate_timeout_ms;
+	std::shared_ptr<bool> upstream_ok = std::make_shared<bool>(false);
+
+	// Relay the AI service's event stream as it is generated; errors after this
+	// point can only be reported in-band as an "error" event
+	res.set_chunked_content_provider("text/event-stream",
+		[request_body, service_url, service_port, api_key, connect_timeout, read_timeout, upstream_ok](size_t, httplib::DataSink& sink) {
+			httplib::Client client(service_url.c_str(), service_port);
+			client.set_connection_timeout(connect_timeout / 1000, (connect_timeout % 1000) * 1000);
+			client.set_read_timeout(read_timeout / 1000, (read_timeout % 1000) * 1000);
+			client.set_write_timeout(connect_timeout / 1000, (connect_timeout % 1000) * 1000);
+
+			httplib::Request upstream;
+			upstream.method = "POST";
+			upstream.path = "/ai/chat/stream";
+			upstream.body = request_body;
+			upstream.set_header("Content-Type", "application/json");
+			upstream.set_header("Accept", "text/event-stream");
+			upstream.set_header("User-Agent", "rAthena-AI-Bridge/1.0");
+
+			if (!api_key.empty()) {
+				upstream.set_header("X-API-Key", api_key);
+			}
+
+			int status_code = 0;
+
+			upstream.response_handler = [&status_code](const httplib::Response& response) {
+				status_code = response.status;
+				return true;
+			};
+			upstream.content_receiver = [&status_code, &sink](const char* data, size_t data_length, uint64_t, uint64_t) {
+				// Only relay a successful stream, the error body is replaced below
+				return status_code != 200 || sink.write(data, data_length);
+			};
+
+			auto result = client.send(upstream);
+
+			*upstream_ok = result && status_code < 500;
+
+			if (!result || status_code != 200) {
+				std::string error = result ? ("AI Service returned status " + std::to_string(status_code)) : ("Failed to connect to AI Service: " + httplib::to_string(result.error()));
+				std::string event = "event: error\ndata: " + nlohmann::json({ { "error", error } }).dump() + "\n\n";
+
+				ShowWarning("[AI Bridge] Streaming chat command failed: %s\n", error.c_str());
+				sink.write(event.data(), event.size());
+			}
+
+			sink.done();
+			return true;
+		},
+		[upstream_ok](bool) {
+			AIBridge::upstream->end(*upstream_ok);
+		});
+}
+
 // GET /ai/chat/history
 HANDLER_FUNC(ai_chat_history) {
 	ShowInfo("[AI Bridge] Received chat history request\n");
@@ -613,12 +741,27 @@ HANDLER_FUNC(ai_npc_state_update) {
 	res.set_content(response_body, "application/json");
 
 	if (success) {
+		AIBridge::bump_npc_version(npc_id);
 		ShowInfo("[AI Bridge] NPC state updated successfully for NPC %s\n", npc_id.c_str());
 	} else {
 		ShowWarning("[AI Bridge] NPC state update failed for NPC %s (status %d)\n", npc_id.c_str(), status_code);
 	}
 }
 
+// GET /ai/npc/versions
+HANDLER_FUNC(ai_npc_versions_get) {
+	nlohmann::json response_json;
+
+	{
+		std::lock_guard<std::mutex> lock(AIBridge::npc_versions_mutex);
+		response_json["epoch"] = AIBridge::npc_versions_epoch;
+		response_json["versions"] = AIBridge::npc_versions;
+	}
+
+	res.status = 200;
+	res.set_content(response_json.dump(), "application/json");
+}
+
 // DELETE /ai/npc/{npc_id}
 HANDLER_FUNC(ai_npc_delete) {
 	ShowInfo("[AI Bridge] Received NPC deletion request\n");
@@ -648,6 +791,7 @@ HANDLER_FUNC(ai_npc_delete) {
 	res.set_content(response_body, "application/json");
 
 	if (success) {
+		AIBridge::bump_npc_version(npc_id);
 		ShowInfo("[AI Bridge] NPC deleted successfully: %s\n", npc_id.c_str());
 	} else {
 		ShowWarning("[AI Bridge] NPC deletion failed for NPC %s (status %d)\n", npc_id.c_str(), status_code);
@@ -864,14 +1008,9 @@ HANDLER_FUNC(ai_chat_status) {
 HANDLER_FUNC(ai_economy_state) {
 	ShowInfo("[AI Bridge] Received economy state request\n");
 
-	// Forward to AI service
-	std::string response_body;
+	// Forward to AI service, shared with concurrent pollers
 	int status_code;
-	bool success = AIBridge::make_ai_request("/ai/economy/state", "GET", "", response_body, status_code);
-
-	// Set response
-	res.status = status_code;
-	res.set_content(response_body, "application/json");
+	bool success = AIBridge::make_shared_ai_request(req, res, "/ai/economy/state", status_code);
 
 	if (success) {
 		ShowInfo("[AI Bridge] Economy state retrieved successfully\n");
@@ -897,6 +1036,7 @@ HANDLER_FUNC(ai_economy_price_update) {
 	res.set_content(response_body, "application/json");
 
 	if (success) {
+		AIBridge::upstream->invalidate_reads("/ai/economy/state");
 		ShowInfo("[AI Bridge] Economy price updated successfully\n");
 	} else {
 		ShowWarning("[AI Bridge] Economy price update failed with status %d\n", status_code);
@@ -934,14 +1074,9 @@ HANDLER_FUNC(ai_economy_market_analyze) {
 HANDLER_FUNC(ai_faction_list) {
 	ShowInfo("[AI Bridge] Received faction list request\n");
 
-	// Forward to AI service
-	std::string response_body;
+	// Forward to AI service, shared with concurrent pollers
 	int status_code;
-	bool success = AIBridge::make_ai_request("/ai/faction/list", "GET", "", response_body, status_code);
-
-	// Set response
-	res.status = status_code;
-	res.set_content(response_body, "application/json");
+	bool success = AIBridge::make_shared_ai_request(req, res, "/ai/faction/list", status_code);
 
 	if (success) {
 		ShowInfo("[AI Bridge] Faction list retrieved successfully\n");
@@ -967,6 +1102,7 @@ HANDLER_FUNC(ai_faction_create) {
 	res.set_content(response_body, "application/json");
 
 	if (success) {
+		AIBridge::upstream->invalidate_reads("/ai/faction/list");
 		ShowInfo("[AI Bridge] Faction created successfully\n");
 	} else {
 		ShowWarning("[AI Bridge] Faction creation failed with status %d\n", status_code);
@@ -990,6 +1126,7 @@ HANDLER_FUNC(ai_faction_reputation_update) {
 	res.set_content(response_body, "application/json");
 
 	if (success) {
+		AIBridge::upstream->invalidate_reads("/ai/faction/list");
 		ShowInfo("[AI Bridge] Faction reputation updated successfully\n");
 	} else {
 		ShowWarning("[AI Bridge] Faction reputation update failed with status %d\n", status_code);
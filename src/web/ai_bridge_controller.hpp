@@ -4,8 +4,11 @@
 #ifndef AI_BRIDGE_CONTROLLER_HPP
 #define AI_BRIDGE_CONTROLLER_HPP
 
+#include <memory>
+
 #include <common/cbasetypes.hpp>
 
+#include "ai_upstream.hpp"
 #include "http.hpp"
 
 // AI Service Configuration
@@ -16,12 +19,18 @@ namespace AIBridge {
 	extern std::string ai_service_api_key;
 	extern bool ai_service_enabled;
 
+	// Pooled, rate-limited connection to the AI service
+	extern std::unique_ptr<AIUpstreamClient> upstream;
+
 	// Initialize AI Bridge configuration
 	void initialize();
 
 	// Read AI Bridge configuration from web_athena.conf
 	void read_config(const char* w1, const char* w2);
 
+	// Bump an NPC's persona version after its state changed
+	void bump_npc_version(const std::string& npc_id);
+
 	// Helper function to make HTTP requests to AI service
 	bool make_ai_request(
 		const std::string& endpoint,
@@ -30,6 +39,15 @@ namespace AIBridge {
 		std::string& response_body,
 		int& status_code
 	);
+
+	// GET a hot read endpoint: concurrent identical requests share one upstream call,
+	// answers are reused for a short time and carry an ETag (304 on If-None-Match)
+	bool make_shared_ai_request(
+		const httplib::Request& req,
+		httplib::Response& res,
+		const std::string& endpoint,
+		int& status_code
+	);
 }
 
 // AI Bridge API Endpoints
@@ -125,6 +143,15 @@ HANDLER_FUNC(ai_quest_complete);
  */
 HANDLER_FUNC(ai_chat_command);
 
+/**
+ * POST /ai/chat/stream
+ * Process free-form chat command, streaming the answer while it is generated
+ * Request body: same as /ai/chat/command
+ * Response: text/event-stream, "data:" events carry JSON with a "delta" text
+ * fragment, "data: [DONE]" ends the answer, an "error" event reports failures
+ */
+HANDLER_FUNC(ai_chat_stream);
+
 /**
  * GET /ai/chat/history
  * Get chat history
@@ -150,6 +177,14 @@ HANDLER_FUNC(ai_npc_state_get);
  */
 HANDLER_FUNC(ai_npc_state_update);
 
+/**
+ * GET /ai/npc/versions
+ * Get the persona version of every NPC changed since the web server started
+ * Used by the map-server to invalidate cached dialogue
+ * Response: JSON with epoch (changes on restart) and versions (npc_id -> version)
+ */
+HANDLER_FUNC(ai_npc_versions_get);
+
 /**
  * DELETE /ai/npc/{npc_id}
  * Delete NPC from AI service
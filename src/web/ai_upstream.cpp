@@ -0,0 +1,421 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "ai_upstream.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+
+#include <httplib.h>
+
+#include <common/showmsg.hpp>
+
+// Endpoints that wait for the AI service to generate text get the long read timeout
+static const char* ai_generate_endpoints[] = {
+	"/ai/chat/",
+	"/ai/player/interaction",
+	"/ai/quest/generate",
+	"/ai/economy/market/analyze",
+	"/api/batch/players/interact",
+};
+
+AIUpstreamClient::AIUpstreamClient(const AIUpstreamConfig& cfg)
+	: config(cfg)
+	, in_flight(0)
+	, breaker_state(AI_CIRCUIT_CLOSED)
+	, consecutive_failures(0)
+	, open_until(0)
+	, probe_in_flight(false)
+	, total_requests(0)
+	, total_rejected_open(0)
+	, total_rejected_busy(0)
+	, total_failures(0)
+	, total_read_hits(0)
+	, total_read_coalesced(0)
+{
+	ShowInfo("[AI Bridge] Upstream client: %d concurrent requests, %d idle connections, circuit opens after %d failures for %dms\n",
+		config.max_concurrent_requests, config.max_idle_connections, config.breaker_failure_threshold, config.breaker_open_ms);
+}
+
+AIUpstreamClient::~AIUpstreamClient() {
+	std::lock_guard<std::mutex> lock(pool_mutex);
+
+	for (auto& client : idle_clients) {
+		client->stop();
+	}
+
+	idle_clients.clear();
+}
+
+/**
+ * Get a keep-alive connection to the AI service, opening one if none is idle
+ */
+std::unique_ptr<httplib::Client> AIUpstreamClient::acquire_client() {
+	{
+		std::lock_guard<std::mutex> lock(pool_mutex);
+
+		if (!idle_clients.empty()) {
+			std::unique_ptr<httplib::Client> client = std::move(idle_clients.back());
+			idle_clients.pop_back();
+			return client;
+		}
+	}
+
+	std::unique_ptr<httplib::Client> client = std::make_unique<httplib::Client>(config.host, config.port);
+
+	client->set_keep_alive(true);
+	client->set_tcp_nodelay(true);
+	client->set_connection_timeout(config.connect_timeout_ms / 1000, (config.connect_timeout_ms % 1000) * 1000);
+	client->set_write_timeout(config.read_timeout_ms / 1000, (config.read_timeout_ms % 1000) * 1000);
+
+	return client;
+}
+
+/**
+ * Return a connection to the pool, broken ones and those over the pool bound are closed
+ */
+void AIUpstreamClient::release_client(std::unique_ptr<httplib::Client> client, bool healthy) {
+	if (healthy) {
+		std::lock_guard<std::mutex> lock(pool_mutex);
+
+		if (idle_clients.size() < (size_t)config.max_idle_connections) {
+			idle_clients.push_back(std::move(client));
+			return;
+		}
+	}
+
+	client->stop();
+}
+
+int32 AIUpstreamClient::read_timeout_for(const std::string& endpoint) const {
+	for (const char* prefix : ai_generate_endpoints) {
+		if (endpoint.rfind(prefix, 0) == 0) {
+			return config.generate_timeout_ms;
+		}
+	}
+
+	return config.read_timeout_ms;
+}
+
+/**
+ * Strong entity tag of an answer (FNV-1a of the body)
+ */
+static std::string ai_upstream_etag(const std::string& body) {
+	uint64 hash = 14695981039346656037ULL;
+
+	for (unsigned char c : body) {
+		hash ^= c;
+		hash *= 1099511628211ULL;
+	}
+
+	char buf[24];
+
+	snprintf(buf, sizeof(buf), "\"%016" PRIx64 "\"", hash);
+
+	return buf;
+}
+
+/**
+ * Admit an upstream request
+ * Fails fast while the circuit is open, lets a single probe through once the cooldown
+ * is over and rejects requests beyond max_concurrent_requests.
+ * @param error: Reason if the request is rejected
+ * @return true if the request may be sent, end() must be called afterwards
+ */
+bool AIUpstreamClient::begin(std::string& error) {
+	bool probe = false;
+
+	{
+		std::lock_guard<std::mutex> lock(breaker_mutex);
+
+		if (breaker_state == AI_CIRCUIT_OPEN) {
+			if (DIFF_TICK(gettick(), open_until) < 0) {
+				total_rejected_open++;
+				error = "AI Service is unavailable";
+				return false;
+			}
+
+			breaker_state = AI_CIRCUIT_HALF_OPEN;
+			probe_in_flight = false;
+		}
+
+		if (breaker_state == AI_CIRCUIT_HALF_OPEN) {
+			if (probe_in_flight) {
+				total_rejected_open++;
+				error = "AI Service is unavailable";
+				return false;
+			}
+
+			probe_in_flight = true;
+			probe = true;
+		}
+	}
+
+	if (in_flight.fetch_add(1) >= config.max_concurrent_requests) {
+		in_flight--;
+		total_rejected_busy++;
+		error = "AI Service is busy";
+
+		if (probe) {
+			std::lock_guard<std::mutex> lock(breaker_mutex);
+			probe_in_flight = false;
+		}
+
+		return false;
+	}
+
+	total_requests++;
+
+	return true;
+}
+
+/**
+ * Finish an admitted upstream request and update the circuit breaker
+ * @param success: false on transport errors and 5xx answers
+ */
+void AIUpstreamClient::end(bool success) {
+	in_flight--;
+
+	std::lock_guard<std::mutex> lock(breaker_mutex);
+
+	if (success) {
+		consecutive_failures = 0;
+
+		if (breaker_state != AI_CIRCUIT_CLOSED) {
+			ShowStatus("[AI Bridge] AI Service recovered, circuit closed\n");
+			breaker_state = AI_CIRCUIT_CLOSED;
+			probe_in_flight = false;
+		}
+
+		return;
+	}
+
+	total_failures++;
+	consecutive_failures++;
+
+	if (breaker_state == AI_CIRCUIT_HALF_OPEN || (breaker_state == AI_CIRCUIT_CLOSED && consecutive_failures >= config.breaker_failure_threshold)) {
+		ShowWarning("[AI Bridge] AI Service failing (%d consecutive failures), circuit open for %dms\n", consecutive_failures, config.breaker_open_ms);
+		breaker_state = AI_CIRCUIT_OPEN;
+		open_until = gettick() + config.breaker_open_ms;
+		probe_in_flight = false;
+	}
+}
+
+/**
+ * Send a request to the AI service over a pooled connection
+ * @param endpoint: Path of the AI service endpoint, including the query string
+ * @param method: GET, POST, PUT or DELETE
+ * @param body: JSON request body
+ * @param response_body: AI service answer, or a JSON error
+ * @param status_code: AI service status, 503 if the request was not sent
+ * @return true on a 2xx answer
+ */
+bool AIUpstreamClient::request(const std::string& endpoint, const std::string& method, const std::string& body, std::string& response_body, int& status_code) {
+	if (method != "GET" && method != "POST" && method != "PUT" && method != "DELETE") {
+		ShowError("[AI Bridge] Unsupported HTTP method: %s\n", method.c_str());
+		status_code = 400;
+		response_body = "{\"error\": \"Unsupported HTTP method\"}";
+		return false;
+	}
+
+	std::string error;
+
+	if (!begin(error)) {
+		ShowWarning("[AI Bridge] Rejected %s request to %s: %s\n", method.c_str(), endpoint.c_str(), error.c_str());
+		status_code = 503; // Service Unavailable
+		response_body = "{\"error\": \"" + error + "\"}";
+		return false;
+	}
+
+	std::unique_ptr<httplib::Client> client = acquire_client();
+	int32 read_timeout_ms = read_timeout_for(endpoint);
+
+	client->set_read_timeout(read_timeout_ms / 1000, (read_timeout_ms % 1000) * 1000);
+
+	httplib::Headers headers = {
+		{"User-Agent", "rAthena-AI-Bridge/1.0"}
+	};
+
+	if (!config.api_key.empty()) {
+		headers.insert({"X-API-Key", config.api_key});
+	}
+
+	httplib::Result res(nullptr, httplib::Error::Unknown);
+
+	if (method == "GET") {
+		res = client->Get(endpoint, headers);
+	} else if (method == "POST") {
+		res = client->Post(endpoint, headers, body, "application/json");
+	} else if (method == "PUT") {
+		res = client->Put(endpoint, headers, body, "application/json");
+	} else {
+		res = client->Delete(endpoint, headers);
+	}
+
+	release_client(std::move(client), static_cast<bool>(res));
+
+	if (!res) {
+		auto err = res.error();
+		ShowError("[AI Bridge] HTTP %s request failed: %s (error code: %d)\n",
+			method.c_str(), httplib::to_string(err).c_str(), static_cast<int>(err));
+		status_code = 503; // Service Unavailable
+		response_body = "{\"error\": \"Failed to connect to AI Service\"}";
+		end(false);
+		return false;
+	}
+
+	status_code = res->status;
+	response_body = std::move(res->body);
+	end(status_code < 500);
+
+	return (status_code >= 200 && status_code < 300);
+}
+
+/**
+ * GET a hot read endpoint
+ * Concurrent calls for the same endpoint share a single upstream request and
+ * successful answers are reused for read_cache_ttl_ms, so the load on the AI
+ * service depends on the number of distinct endpoints instead of the pollers.
+ * @param endpoint: Path of the AI service endpoint, including the query string
+ * @return Shared answer with its entity tag
+ */
+std::shared_ptr<const AIUpstreamReadEntry> AIUpstreamClient::shared_get(const std::string& endpoint) {
+	std::shared_ptr<AIUpstreamReadEntry> flight;
+
+	{
+		std::unique_lock<std::mutex> lock(read_mutex);
+		auto cached = read_cache.find(endpoint);
+
+		if (cached != read_cache.end()) {
+			if (DIFF_TICK(gettick(), cached->second->expire_time) < 0) {
+				total_read_hits++;
+				return cached->second;
+			}
+
+			read_cache.erase(cached);
+		}
+
+		auto running = read_flights.find(endpoint);
+
+		if (running != read_flights.end()) {
+			std::shared_ptr<AIUpstreamReadEntry> shared = running->second;
+
+			total_read_coalesced++;
+			read_cv.wait(lock, [&shared]() { return shared->done; });
+
+			return shared;
+		}
+
+		flight = std::make_shared<AIUpstreamReadEntry>();
+		flight->done = false;
+		read_flights[endpoint] = flight;
+	}
+
+	std::string body;
+	int status_code = 500;
+
+	try {
+		this->request(endpoint, "GET", "", body, status_code);
+	} catch (const std::exception& e) {
+		ShowError("[AI Bridge] Exception during HTTP request: %s\n", e.what());
+		status_code = 500;
+		body = "{\"error\": \"Internal server error\"}";
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(read_mutex);
+
+		flight->status_code = status_code;
+		flight->etag = ai_upstream_etag(body);
+		flight->body = std::move(body);
+		flight->expire_time = gettick() + config.read_cache_ttl_ms;
+		flight->done = true;
+
+		// Removed unless invalidate_reads already dropped it
+		auto running = read_flights.find(endpoint);
+
+		if (running != read_flights.end() && running->second == flight) {
+			read_flights.erase(running);
+
+			if (status_code == 200 && config.read_cache_ttl_ms > 0) {
+				if (read_cache.size() >= (size_t)config.read_cache_max_entries) {
+					t_tick tick = gettick();
+
+					for (auto it = read_cache.begin(); it != read_cache.end(); ) {
+						if (DIFF_TICK(tick, it->second->expire_time) >= 0) {
+							it = read_cache.erase(it);
+						} else {
+							++it;
+						}
+					}
+				}
+
+				if (read_cache.size() < (size_t)config.read_cache_max_entries) {
+					read_cache[endpoint] = flight;
+				}
+			}
+		}
+	}
+
+	read_cv.notify_all();
+
+	return flight;
+}
+
+/**
+ * Drop shared GET answers after the data behind them changed
+ * Requests already on their way upstream are still answered, but not cached.
+ * @param prefix: Endpoint prefix, e.g. "/ai/faction/"
+ */
+void AIUpstreamClient::invalidate_reads(const std::string& prefix) {
+	std::lock_guard<std::mutex> lock(read_mutex);
+
+	for (auto it = read_cache.begin(); it != read_cache.end(); ) {
+		if (it->first.rfind(prefix, 0) == 0) {
+			it = read_cache.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	for (auto it = read_flights.begin(); it != read_flights.end(); ) {
+		if (it->first.rfind(prefix, 0) == 0) {
+			it = read_flights.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
+
+const AIUpstreamConfig& AIUpstreamClient::get_config() const {
+	return config;
+}
+
+e_ai_circuit_state AIUpstreamClient::get_circuit_state() {
+	std::lock_guard<std::mutex> lock(breaker_mutex);
+	return breaker_state;
+}
+
+uint64 AIUpstreamClient::get_total_requests() const {
+	return total_requests.load();
+}
+
+uint64 AIUpstreamClient::get_total_rejected_open() const {
+	return total_rejected_open.load();
+}
+
+uint64 AIUpstreamClient::get_total_rejected_busy() const {
+	return total_rejected_busy.load();
+}
+
+uint64 AIUpstreamClient::get_total_failures() const {
+	return total_failures.load();
+}
+
+uint64 AIUpstreamClient::get_total_read_hits() const {
+	return total_read_hits.load();
+}
+
+uint64 AIUpstreamClient::get_total_read_coalesced() const {
+	return total_read_coalesced.load();
+}
@@ -0,0 +1,118 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef AI_UPSTREAM_HPP
+#define AI_UPSTREAM_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <common/cbasetypes.hpp>
+#include <common/timer.hpp>
+
+namespace httplib {
+class Client;
+}
+
+enum e_ai_circuit_state : uint8 {
+	AI_CIRCUIT_CLOSED = 0,	// AI service healthy, requests pass
+	AI_CIRCUIT_OPEN,		// AI service down, requests fail fast
+	AI_CIRCUIT_HALF_OPEN,	// Cooldown over, a single probe request decides
+};
+
+struct AIUpstreamConfig {
+	std::string host;					// AI service host
+	uint16 port;						// AI service port
+	std::string api_key;				// Sent as X-API-Key if not empty
+	int32 connect_timeout_ms;			// TCP connect timeout
+	int32 read_timeout_ms;				// Read timeout of regular endpoints
+	int32 generate_timeout_ms;			// Read timeout of endpoints that wait for text generation
+	int32 max_idle_connections;			// Keep-alive connections kept open
+	int32 max_concurrent_requests;		// Upstream requests in flight, the rest is rejected with 503
+	int32 breaker_failure_threshold;	// Consecutive failures that open the circuit
+	int32 breaker_open_ms;				// How long the circuit stays open before a probe
+	int32 read_cache_ttl_ms;			// How long shared GET answers are reused, 0 only coalesces
+	int32 read_cache_max_entries;		// Distinct shared GET answers kept
+};
+
+// Answer of a shared GET, also used for the upstream call in progress
+struct AIUpstreamReadEntry {
+	std::string body;
+	std::string etag;
+	int status_code;
+	t_tick expire_time;
+	bool done;
+};
+
+/**
+ * Shared upstream client of the AI bridge
+ * Keep-alive connections to the AI service are pooled, the number of requests in
+ * flight is bounded so a slow AI service cannot occupy every web-server thread, and a
+ * circuit breaker answers 503 right away while the AI service is known to be down.
+ */
+class AIUpstreamClient {
+private:
+	AIUpstreamConfig config;
+
+	// Idle keep-alive connections, most recently used at the back
+	std::vector<std::unique_ptr<httplib::Client>> idle_clients;
+	std::mutex pool_mutex;
+
+	// Bounded concurrency
+	std::atomic<int32> in_flight;
+
+	// Circuit breaker
+	std::mutex breaker_mutex;
+	e_ai_circuit_state breaker_state;
+	int32 consecutive_failures;
+	t_tick open_until;
+	bool probe_in_flight;
+
+	// Shared GETs: answers being fetched and answers still fresh
+	std::unordered_map<std::string, std::shared_ptr<AIUpstreamReadEntry>> read_flights;
+	std::unordered_map<std::string, std::shared_ptr<AIUpstreamReadEntry>> read_cache;
+	std::mutex read_mutex;
+	std::condition_variable read_cv;
+
+	// Statistics
+	std::atomic<uint64> total_requests;
+	std::atomic<uint64> total_rejected_open;
+	std::atomic<uint64> total_rejected_busy;
+	std::atomic<uint64> total_failures;
+	std::atomic<uint64> total_read_hits;
+	std::atomic<uint64> total_read_coalesced;
+
+	std::unique_ptr<httplib::Client> acquire_client();
+	void release_client(std::unique_ptr<httplib::Client> client, bool healthy);
+	int32 read_timeout_for(const std::string& endpoint) const;
+
+public:
+	AIUpstreamClient(const AIUpstreamConfig& cfg);
+	~AIUpstreamClient();
+
+	// Admission control, every successful begin() must be paired with end()
+	bool begin(std::string& error);
+	void end(bool success);
+
+	bool request(const std::string& endpoint, const std::string& method, const std::string& body, std::string& response_body, int& status_code);
+
+	// Hot read endpoints, polled by many clients
+	std::shared_ptr<const AIUpstreamReadEntry> shared_get(const std::string& endpoint);
+	void invalidate_reads(const std::string& prefix);
+
+	const AIUpstreamConfig& get_config() const;
+	e_ai_circuit_state get_circuit_state();
+	uint64 get_total_requests() const;
+	uint64 get_total_rejected_open() const;
+	uint64 get_total_rejected_busy() const;
+	uint64 get_total_failures() const;
+	uint64 get_total_read_hits() const;
+	uint64 get_total_read_coalesced() const;
+};
+
+#endif /* AI_UPSTREAM_HPP */
@@ -0,0 +1,58 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#include "metrics_controller.hpp"
+
+#include <atomic>
+#include <cstdio>
+
+#include <common/metrics.hpp>
+
+#include "http.hpp"
+
+// Answered requests by the first digit of their status code
+static std::atomic<uint64> metrics_responses[6];
+
+/**
+ * Count an answered request, called from the request threads
+ */
+void metrics_count_response( int32 status ){
+	int32 group = status / 100;
+
+	if( group < 1 || group > 5 ){
+		group = 0;
+	}
+
+	metrics_responses[group].fetch_add( 1, std::memory_order_relaxed );
+}
+
+static void metrics_web( MetricsWriter& writer ){
+	writer.family( "rathena_web_responses_total", "counter", "Answered HTTP requests, by status class." );
+
+	for( int32 group = 0; group <= 5; group++ ){
+		uint64 count = metrics_responses[group].load( std::memory_order_relaxed );
+
+		if( count == 0 ){
+			continue;
+		}
+
+		char labels[32];
+
+		if( group == 0 ){
+			snprintf( labels, sizeof( labels ), "status=\"other\"" );
+		}else{
+			snprintf( labels, sizeof( labels ), "status=\"%dxx\"", group );
+		}
+
+		writer.sample( "rathena_web_responses_total", labels, count );
+	}
+}
+
+void do_init_metrics_controller( void ){
+	metrics_add_collector( metrics_web );
+	metrics_init();
+}
+
+HANDLER_FUNC(metrics_get) {
+	res.set_content( metrics_snapshot(), "text/plain; version=0.0.4" );
+}
@@ -0,0 +1,16 @@
+// Copyright (c) rAthena Dev Teams - Licensed under GNU GPL
+// For more information, see LICENCE in the main folder
+
+#ifndef METRICS_CONTROLLER_HPP
+#define METRICS_CONTROLLER_HPP
+
+#include <common/cbasetypes.hpp>
+
+#include "http.hpp"
+
+void metrics_count_response( int32 status );
+void do_init_metrics_controller( void );
+
+HANDLER_FUNC(metrics_get);
+
+#endif
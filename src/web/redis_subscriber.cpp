@@ -11,10 +11,15 @@
 #include <hiredis/hiredis.h>
 #include <nlohmann/json.hpp>
 #include <iostream>
+#include <algorithm>
 #include <cstring>
+#include <set>
 
 using json = nlohmann::json;
 
+// Maximum number of parsed actions waiting for the main thread
+static const size_t REDIS_ACTION_QUEUE_SIZE = 4096;
+
 RedisSubscriber::RedisSubscriber(
 	const std::string& redis_host,
 	int redis_port,
@@ -23,6 +28,12 @@ RedisSubscriber::RedisSubscriber(
     redis_port_(redis_port),
     redis_password_(redis_password),
     running_(false),
+    action_queue_(REDIS_ACTION_QUEUE_SIZE),
+    total_received_(0),
+    total_dropped_(0),
+    total_merged_(0),
+    total_applied_(0),
+    max_queue_size_(0),
     redis_connection_(nullptr),
     redis_subscriber_(nullptr)
 {
@@ -87,7 +98,9 @@ void RedisSubscriber::stop() {
 		subscriber_thread_.join();
 	}
 	
-	std::cout << "[RedisSubscriber] Stopped" << std::endl;
+	std::cout << "[RedisSubscriber] Stopped (received=" << total_received_.load()
+	          << " applied=" << total_applied_ << " merged=" << total_merged_
+	          << " dropped=" << total_dropped_.load() << " max_queue=" << max_queue_size_ << ")" << std::endl;
 }
 
 bool RedisSubscriber::subscribe_npc(const std::string& npc_id) {
@@ -145,24 +158,28 @@ void RedisSubscriber::subscriber_thread() {
 			break;
 		}
 		
-		if (reply == nullptr) {
-			continue;
-		}
-		
-		// Check if it's a message
-		if (reply->type == REDIS_REPLY_ARRAY && reply->elements >= 3) {
-			std::string message_type(reply->element[0]->str, reply->element[0]->len);
-			
-			if (message_type == "pmessage" && reply->elements == 4) {
-				// Pattern message: [pmessage, pattern, channel, message]
-				std::string channel(reply->element[2]->str, reply->element[2]->len);
-				std::string message(reply->element[3]->str, reply->element[3]->len);
+		// Handle this reply and every further one already read from the socket
+		while (reply != nullptr) {
+			// Check if it's a message
+			if (reply->type == REDIS_REPLY_ARRAY && reply->elements >= 3) {
+				std::string message_type(reply->element[0]->str, reply->element[0]->len);
 				
-				handle_message(channel, message);
+				if (message_type == "pmessage" && reply->elements == 4) {
+					// Pattern message: [pmessage, pattern, channel, message]
+					std::string channel(reply->element[2]->str, reply->element[2]->len);
+					std::string message(reply->element[3]->str, reply->element[3]->len);
+					
+					handle_message(channel, message);
+				}
+			}
+			
+			freeReplyObject(reply);
+			reply = nullptr;
+
+			if (redisGetReplyFromReader(ctx, reinterpret_cast<void**>(&reply)) != REDIS_OK) {
+				break;
 			}
 		}
-		
-		freeReplyObject(reply);
 	}
 	
 	std::cout << "[RedisSubscriber] Subscriber thread stopped" << std::endl;
@@ -170,8 +187,6 @@ void RedisSubscriber::subscriber_thread() {
 
 void RedisSubscriber::handle_message(const std::string& channel, const std::string& message) {
 	try {
-		std::cout << "[RedisSubscriber] Received message on channel: " << channel << std::endl;
-
 		// Parse JSON message
 		json msg = json::parse(message);
 
@@ -186,12 +201,13 @@ void RedisSubscriber::handle_message(const std::string& channel, const std::stri
 		// Extract action_data as JSON string
 		std::string action_data = msg.value("action_data", json::object()).dump();
 
-		// Execute NPC action
-		execute_npc_action(npc_id, action_type, action_data);
+		total_received_++;
 
-		// Call user callback if set
-		if (action_callback_) {
-			action_callback_(npc_id, message);
+		// Executed by the main thread in apply_actions
+		if (!action_queue_.push(RedisNpcAction{ npc_id, action_type, action_data, message })) {
+			if (total_dropped_++ % 1000 == 0) {
+				std::cerr << "[RedisSubscriber] Action queue full, dropping actions (dropped so far: " << total_dropped_.load() << ")" << std::endl;
+			}
 		}
 
 	} catch (const json::exception& e) {
@@ -201,6 +217,50 @@ void RedisSubscriber::handle_message(const std::string& channel, const std::stri
 	}
 }
 
+bool RedisSubscriber::is_superseded_by_newer(const std::string& action_type) {
+	// Only the latest destination and state matter, emotes are all shown
+	return action_type == "move" || action_type == "state_change";
+}
+
+size_t RedisSubscriber::apply_actions() {
+	max_queue_size_ = std::max(max_queue_size_, action_queue_.size_approx());
+
+	action_batch_.clear();
+
+	if (action_queue_.drain(action_batch_) == 0) {
+		return 0;
+	}
+
+	// Newest first, so the first move/state change seen for an NPC is the one to keep
+	std::set<std::pair<std::string, std::string>> seen;
+	std::vector<const RedisNpcAction*> apply;
+
+	for (auto it = action_batch_.rbegin(); it != action_batch_.rend(); ++it) {
+		if (is_superseded_by_newer(it->action_type) && !seen.emplace(it->npc_id, it->action_type).second) {
+			total_merged_++;
+			continue;
+		}
+
+		apply.push_back(&(*it));
+	}
+
+	for (auto it = apply.rbegin(); it != apply.rend(); ++it) {
+		const RedisNpcAction* action = *it;
+
+		// Execute NPC action
+		execute_npc_action(action->npc_id, action->action_type, action->action_data);
+
+		// Call user callback if set
+		if (action_callback_) {
+			action_callback_(action->npc_id, action->message);
+		}
+	}
+
+	total_applied_ += apply.size();
+
+	return apply.size();
+}
+
 void RedisSubscriber::execute_npc_action(
 	const std::string& npc_id,
 	const std::string& action_type,
@@ -15,6 +15,10 @@
 #include <atomic>
 #include <functional>
 #include <map>
+#include <vector>
+
+#include <common/cbasetypes.hpp>
+#include <common/mpsc_queue.hpp>
 
 // Forward declarations
 namespace sw {
@@ -24,9 +28,23 @@ namespace redis {
 }
 }
 
+/**
+ * NPC action parsed by the subscriber thread, applied on the main thread
+ */
+struct RedisNpcAction {
+	std::string npc_id;
+	std::string action_type;
+	std::string action_data;	// JSON
+	std::string message;		// Raw message, passed to the action callback
+};
+
 /**
  * Redis Pub/Sub Subscriber
- * Listens for NPC action messages from AI service
+ * Listens for NPC action messages from AI service.
+ * The subscriber thread reads every reply already buffered by the connection in one
+ * go and pushes the parsed actions into a lock-free queue. The main thread applies
+ * them in batches from a timer, where a newer move or state change of an NPC
+ * supersedes the older ones still waiting in the same batch.
  */
 class RedisSubscriber {
 public:
@@ -90,6 +108,20 @@ public:
 	 */
 	void set_action_callback(std::function<void(const std::string&, const std::string&)> callback);
 
+	/**
+	 * Apply the queued NPC actions (main thread only)
+	 * @return Number of actions applied
+	 */
+	size_t apply_actions();
+
+	// Statistics
+	uint64 get_total_received() const { return total_received_.load(); }
+	uint64 get_total_dropped() const { return total_dropped_.load(); }
+	uint64 get_total_merged() const { return total_merged_; }
+	uint64 get_total_applied() const { return total_applied_; }
+	size_t get_queue_size() const { return action_queue_.size_approx(); }
+	size_t get_max_queue_size() const { return max_queue_size_; }
+
 private:
 	/**
 	 * Subscriber thread function
@@ -102,6 +134,12 @@ private:
 	 * @param message Message content (JSON)
 	 */
 	void handle_message(const std::string& channel, const std::string& message);
+
+	/**
+	 * Check whether a newer action of the same type replaces an older one
+	 * @param action_type Action type
+	 */
+	static bool is_superseded_by_newer(const std::string& action_type);
 	
 	/**
 	 * Execute NPC action from message
@@ -123,6 +161,17 @@ private:
 	std::thread subscriber_thread_;
 	
 	std::function<void(const std::string&, const std::string&)> action_callback_;
+
+	// Parsed actions waiting for the main thread
+	MPSCQueue<RedisNpcAction> action_queue_;
+	std::vector<RedisNpcAction> action_batch_;
+
+	// Statistics
+	std::atomic<uint64> total_received_;
+	std::atomic<uint64> total_dropped_;	// Queue full, the main thread is not keeping up
+	uint64 total_merged_;
+	uint64 total_applied_;
+	size_t max_queue_size_;
 	
 	// Redis connection (will be initialized in .cpp)
 	void* redis_connection_;  // Opaque pointer to avoid header dependency
@@ -23,6 +23,7 @@
 #include <common/timer.hpp>
 #include <common/utilities.hpp>
 #include <common/utils.hpp>
+#include <common/watchdog.hpp>
 #include <config/core.hpp>
 
 #include "ai_bridge_controller.hpp"
@@ -30,6 +31,7 @@
 #include "emblem_controller.hpp"
 #include "http.hpp"
 #include "merchantstore_controller.hpp"
+#include "metrics_controller.hpp"
 #include "partybooking_controller.hpp"
 #include "userconfig_controller.hpp"
 #include "redis_subscriber.hpp"  // Phase 8B: Redis Pub/Sub for async NPC actions
@@ -155,6 +157,8 @@ bool web_config_read(const char* cfgName, bool normal) {
 			web_config_read(w2, normal);
 		else if (!strcmpi(w1, "allow_gifs"))
 			web_config.allow_gifs = config_switch(w2) == 1;
+		else if (!strcmpi(w1, "metrics_enable"))
+			web_config.metrics_enable = config_switch(w2) == 1;
 		else
 			// Try AI Bridge configuration
 			AIBridge::read_config(w1, w2);
@@ -268,6 +272,7 @@ void web_set_defaults() {
 	safestrncpy(web_config.webconf_name, "conf/web_athena.conf", sizeof(web_config.webconf_name));
 	safestrncpy(web_config.msgconf_name, "conf/msg_conf/web_msg.conf", sizeof(web_config.msgconf_name));
 	web_config.print_req_res = false;
+	web_config.metrics_enable = false;
 
 	inter_config.emblem_transparency_limit = 100;
 	inter_config.emblem_woe_change = true;
@@ -368,6 +373,17 @@ int32 web_sql_close(void)
 	return 0;
 }
 
+/**
+ * Apply the NPC actions received by the Redis subscriber since the last tick
+ */
+static TIMER_FUNC(redis_subscriber_apply_timer){
+	if (redis_subscriber != nullptr) {
+		redis_subscriber->apply_actions();
+	}
+
+	return 0;
+}
+
 /**
  * web-server destructor
  *  dealloc..., function called at exit of the web-server
@@ -434,6 +450,7 @@ void logger(const Request & req, const Response & res) {
 		ShowDebug("Body is:\n%s\n", res.body.c_str());
 	}
 	ShowInfo("%s [%s %s] %d\n", req.remote_addr.c_str(), req.method.c_str(), req.path.c_str(), res.status);
+	metrics_count_response(res.status);
 }
 
 
@@ -480,9 +497,15 @@ bool WebServer::initialize( int32 argc, char* argv[] ){
 	http_server->Post("/userconfig/load", userconfig_load);
 	http_server->Post("/userconfig/save", userconfig_save);
 
+	if (web_config.metrics_enable) {
+		do_init_metrics_controller();
+		http_server->Get("/metrics", metrics_get);
+	}
+
 	// AI Bridge routes - NPC Management
 	http_server->Post("/ai/npc/register", ai_npc_register);
 	http_server->Post("/ai/npc/event", ai_npc_event);
+	http_server->Get("/ai/npc/versions", ai_npc_versions_get);
 	http_server->Get("/ai/npc/:id/action", ai_npc_action);
 	http_server->Post("/ai/npc/:id/execute-action", ai_npc_execute_action);
 	http_server->Get("/ai/npc/:id/state", ai_npc_state_get);
@@ -506,6 +529,7 @@ bool WebServer::initialize( int32 argc, char* argv[] ){
 
 	// AI Bridge routes - Chat Commands
 	http_server->Post("/ai/chat/command", ai_chat_command);
+	http_server->Post("/ai/chat/stream", ai_chat_stream);
 	http_server->Get("/ai/chat/status", ai_chat_status);
 	http_server->Get("/ai/chat/history", ai_chat_history);
 
@@ -555,6 +579,8 @@ bool WebServer::initialize( int32 argc, char* argv[] ){
 
 	if (redis_subscriber->start()) {
 		redis_subscriber->subscribe_all_npcs();
+		add_timer_func_list(redis_subscriber_apply_timer, "redis_subscriber_apply_timer");
+		add_timer_interval(gettick() + 100, redis_subscriber_apply_timer, 0, 0, 100);
 		ShowStatus("Redis Pub/Sub subscriber " CL_GREEN "started" CL_RESET " (listening for NPC actions).\n");
 	} else {
 		ShowWarning("Redis Pub/Sub subscriber failed to start. Async NPC actions will not work.\n");
@@ -567,7 +593,9 @@ bool WebServer::initialize( int32 argc, char* argv[] ){
 }
 
 void WebServer::handle_main( t_tick next ){
+	watchdog_idle_begin();
 	std::this_thread::sleep_for( std::chrono::milliseconds( next ) );
+	watchdog_idle_end();
 }
 
 int32 main( int32 argc, char *argv[] ){
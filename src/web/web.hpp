@@ -42,6 +42,7 @@ struct Web_Config {
 	char webconf_name[256];						/// name of main config file
 	char msgconf_name[256];							/// name of msg_conf config file
 	bool allow_gifs;
+	bool metrics_enable;							// Whether or not to serve /metrics
 };
 
 struct Inter_Config {